@@ -0,0 +1,89 @@
+#pragma once
+
+#include <malloc.h>
+#include <new>
+
+//alignment of AlignedArray storage. one cache line, which also covers SSE / AVX loads
+#define CACHE_LINE_SIZE 64
+
+//Fixed size heap array whose storage starts on a cache line.
+//For the large per chunk terrain arrays, sized at runtime from the chunk's resolution.
+template <typename T>
+class AlignedArray
+{
+public:
+	AlignedArray()
+	{
+		m_data = NULL;
+		m_count = 0;
+	}
+
+	~AlignedArray()
+	{
+		Free();
+	}
+
+	void Allocate(size_t count)		//discards the old contents
+	{
+		Free();
+		if (count == 0)
+		{
+			return;
+		}
+
+		m_data = (T*)_aligned_malloc(count * sizeof(T), CACHE_LINE_SIZE);
+		if (!m_data)
+		{
+			throw std::bad_alloc();
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			new (&m_data[i]) T();
+		}
+		m_count = count;
+	}
+
+	void Resize(size_t count)		//keeps as much of the old contents as fits
+	{
+		if (count == m_count)
+		{
+			return;
+		}
+
+		AlignedArray resized;
+		resized.Allocate(count);
+		for (size_t i = 0; i < m_count && i < count; i++)
+		{
+			resized.m_data[i] = m_data[i];
+		}
+		Free();
+		m_data = resized.m_data;
+		m_count = resized.m_count;
+		resized.m_data = NULL;
+		resized.m_count = 0;
+	}
+
+	void Free()
+	{
+		for (size_t i = 0; i < m_count; i++)
+		{
+			m_data[i].~T();
+		}
+		_aligned_free(m_data);
+		m_data = NULL;
+		m_count = 0;
+	}
+
+	T &			operator[](size_t index)		{ return m_data[index]; }
+	const T &	operator[](size_t index) const	{ return m_data[index]; }
+	T *			data()							{ return m_data; }
+	const T *	data() const					{ return m_data; }
+	size_t		size() const					{ return m_count; }
+
+private:
+	AlignedArray(const AlignedArray &);				//not copyable, the terrain arrays are far too big to copy by accident
+	AlignedArray & operator=(const AlignedArray &);
+
+	T *		m_data;
+	size_t	m_count;
+};
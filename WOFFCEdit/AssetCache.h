@@ -0,0 +1,132 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+//lower case, forward slashes, no "./" segments, so "Database\\Data\\Rock.dds" and "database/data/rock.dds" name the same asset
+inline std::string NormalizeAssetPath(const std::string & path)
+{
+	std::string normalized;
+	normalized.reserve(path.size());
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		char c = path[i];
+		if (c == '\\')
+		{
+			c = '/';
+		}
+		else if (c >= 'A' && c <= 'Z')
+		{
+			c = c - 'A' + 'a';
+		}
+
+		if (c == '/' && !normalized.empty() && normalized.back() == '/')
+		{
+			continue;		//collapse repeated separators
+		}
+		normalized.push_back(c);
+
+		if (normalized.size() >= 2 && normalized.compare(normalized.size() - 2, 2, "./") == 0
+			&& (normalized.size() == 2 || normalized[normalized.size() - 3] == '/'))
+		{
+			normalized.resize(normalized.size() - 2);	//drop "./"
+		}
+	}
+	return normalized;
+}
+
+//Shares loaded assets between display objects, keyed on the normalized file path.
+//Entries are reference counted through shared_ptr: the cache holds one reference and every user holds another,
+//so Purge can drop exactly the assets nothing uses any more. Failed loads are cached as well (as null) so a
+//missing file is only tried once per load rather than once per object.
+template <typename T>
+class AssetCache
+{
+public:
+	//creates the asset for a path, or returns null on failure. bytes is set to the asset's resident size
+	typedef std::function<std::shared_ptr<T>(const std::string & path, size_t & bytes)> Loader;
+
+	AssetCache()
+	{
+		m_hits = 0;
+		m_misses = 0;
+		m_residentBytes = 0;
+	}
+
+	std::shared_ptr<T> Get(const std::string & path, const Loader & loader)
+	{
+		const std::string key = NormalizeAssetPath(path);
+		auto found = m_entries.find(key);
+		if (found != m_entries.end())
+		{
+			m_hits++;
+			return found->second.asset;
+		}
+
+		m_misses++;
+		Entry entry;
+		entry.bytes = 0;
+		entry.asset = loader(path, entry.bytes);
+		if (!entry.asset)
+		{
+			entry.bytes = 0;
+		}
+		m_residentBytes += entry.bytes;
+		m_entries[key] = entry;
+		return entry.asset;
+	}
+
+	//drops every entry only the cache still references. Call after the display list has been rebuilt, so assets
+	//shared by the old and new list survive the reload
+	void Purge()
+	{
+		for (auto entry = m_entries.begin(); entry != m_entries.end();)
+		{
+			if (entry->second.asset.use_count() <= 1)
+			{
+				m_residentBytes -= entry->second.bytes;
+				entry = m_entries.erase(entry);
+			}
+			else
+			{
+				++entry;
+			}
+		}
+	}
+
+	bool Contains(const std::string & path) const
+	{
+		return m_entries.find(NormalizeAssetPath(path)) != m_entries.end();
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+		m_residentBytes = 0;
+	}
+
+	void ResetCounters()
+	{
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+	int		GetHits() const				{ return m_hits; }
+	int		GetMisses() const			{ return m_misses; }
+	size_t	GetResidentBytes() const	{ return m_residentBytes; }
+	int		GetCount() const			{ return (int)m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<T>	asset;
+		size_t				bytes;
+	};
+
+	std::map<std::string, Entry>	m_entries;
+	int								m_hits;
+	int								m_misses;
+	size_t							m_residentBytes;
+};
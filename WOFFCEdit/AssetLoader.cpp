@@ -0,0 +1,171 @@
+#include "AssetLoader.h"
+#include "AssetCache.h"
+#include <algorithm>
+#include <fstream>
+
+
+AssetLoader::AssetLoader()
+{
+	m_stopping = false;
+	m_pending = 0;
+}
+
+
+AssetLoader::~AssetLoader()
+{
+	Stop();
+}
+
+void AssetLoader::Start(int threadCount)
+{
+	Stop();
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	}
+
+	m_stopping = false;
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&AssetLoader::WorkerMain, this));
+	}
+}
+
+void AssetLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+
+		//unstarted reads are forgotten, so a later Request queues them again
+		for (size_t i = 0; i < m_queue.size(); i++)
+		{
+			m_files.erase(NormalizeAssetPath(m_queue[i]));
+		}
+		m_pending -= (int)m_queue.size();
+		m_queue.clear();
+	}
+	m_wake.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+void AssetLoader::Request(const std::string & path)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const std::string key = NormalizeAssetPath(path);
+		if (m_files.find(key) != m_files.end())
+		{
+			return;
+		}
+
+		FileState state;
+		state.complete = false;
+		m_files[key] = state;
+		m_queue.push_back(path);
+		m_pending++;
+	}
+	m_wake.notify_one();
+}
+
+bool AssetLoader::IsComplete(const std::string & path) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto file = m_files.find(NormalizeAssetPath(path));
+	return file != m_files.end() && file->second.complete;
+}
+
+AssetLoader::FileData AssetLoader::GetData(const std::string & path) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto file = m_files.find(NormalizeAssetPath(path));
+	if (file == m_files.end() || !file->second.complete)
+	{
+		return nullptr;
+	}
+	return file->second.data;
+}
+
+void AssetLoader::ReleaseData()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto file = m_files.begin(); file != m_files.end();)
+	{
+		if (file->second.complete)
+		{
+			file = m_files.erase(file);
+		}
+		else
+		{
+			++file;
+		}
+	}
+}
+
+int AssetLoader::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending;
+}
+
+int AssetLoader::GetThreadCount() const
+{
+	return (int)m_workers.size();
+}
+
+void AssetLoader::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+		if (m_stopping)
+		{
+			return;
+		}
+
+		const std::string path = m_queue.front();
+		m_queue.pop_front();
+
+		//the read itself happens unlocked, so the workers and the render thread never wait on each other's I/O
+		lock.unlock();
+		FileData data = ReadFile(path);
+		lock.lock();
+
+		auto file = m_files.find(NormalizeAssetPath(path));
+		if (file != m_files.end())
+		{
+			file->second.complete = true;
+			file->second.data = data;
+		}
+		m_pending--;
+	}
+}
+
+AssetLoader::FileData AssetLoader::ReadFile(const std::string & path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	const std::streamoff size = file.tellg();
+	if (size <= 0)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)data->data(), size))
+	{
+		return nullptr;
+	}
+	return data;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Reads asset files into memory on a pool of worker threads.
+//Only the file I/O happens here: the render thread picks the bytes up once they are read and creates the
+//device objects from memory, so nothing on the workers touches D3D or the effect factory.
+class AssetLoader
+{
+public:
+	typedef std::shared_ptr<const std::vector<uint8_t>> FileData;
+
+	AssetLoader();
+	~AssetLoader();
+
+	void	Start(int threadCount);		//0 or less uses one thread per core, less one for the UI
+	void	Stop();						//drops anything still queued and joins the workers
+
+	void	Request(const std::string & path);			//queues a read, unless the file is already queued or read
+	bool	IsComplete(const std::string & path) const;	//the read has finished, whether or not it succeeded
+	FileData GetData(const std::string & path) const;	//the file contents, null if it could not be read or is not read yet
+	void	ReleaseData();								//forgets every finished read, call once the bytes have been used
+
+	int		GetPendingCount() const;		//requested reads that have not finished
+	int		GetThreadCount() const;
+
+private:
+	struct FileState
+	{
+		bool		complete;
+		FileData	data;
+	};
+
+	void	WorkerMain();
+	static FileData ReadFile(const std::string & path);
+
+	std::map<std::string, FileState>	m_files;		//keyed on the normalized path
+	std::deque<std::string>				m_queue;		//paths as requested, read in order
+	std::vector<std::thread>			m_workers;
+	mutable std::mutex					m_mutex;		//guards everything above
+	std::condition_variable				m_wake;
+	bool								m_stopping;
+	int									m_pending;
+};
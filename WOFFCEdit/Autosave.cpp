@@ -0,0 +1,210 @@
+#include "Autosave.h"
+#include <algorithm>
+
+
+Autosave::Autosave()
+{
+	m_busy = false;
+	m_stopping = false;
+	m_failedWrite.type = JOB_WRITE;
+	m_backlog = false;
+	m_interval = std::chrono::seconds(AUTOSAVE_INTERVAL_SECONDS);
+	m_lastSnapshot = std::chrono::steady_clock::now();
+}
+
+
+Autosave::~Autosave()
+{
+	Stop();
+}
+
+bool Autosave::Start(const char * databasePath, int intervalSeconds)
+{
+	Stop();
+	if (!m_database.Open(databasePath))
+	{
+		return false;
+	}
+
+	m_interval = std::chrono::seconds(intervalSeconds);
+	m_lastSnapshot = std::chrono::steady_clock::now();
+	m_stopping = false;
+	m_worker = std::thread(&Autosave::WorkerMain, this);
+	return true;
+}
+
+void Autosave::Stop()
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+
+		//the next startup rebuilds the cache, there is no need to hold up the exit for it
+		m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [](const Job & job) { return job.type == JOB_LEVEL_CACHE; }), m_jobs.end());
+	}
+	m_wake.notify_all();
+	m_worker.join();
+	m_database.Close();
+}
+
+bool Autosave::IsDue() const
+{
+	if (!m_backlog && std::chrono::steady_clock::now() - m_lastSnapshot < m_interval)
+	{
+		return false;
+	}
+
+	//a slow disk delays the next snapshot rather than queueing them up
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_worker.joinable() && !m_busy && m_jobs.empty();
+}
+
+void Autosave::Submit(std::vector<SceneObject> & objects, std::vector<int> & deletedObjectIDs, bool complete)
+{
+	m_lastSnapshot = std::chrono::steady_clock::now();
+	m_backlog = !complete;
+
+	{
+		//an empty snapshot is still written if an earlier one failed, so those rows are tried again
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (objects.empty() && deletedObjectIDs.empty() && m_failedWrite.objects.empty() && m_failedWrite.deletedObjectIDs.empty())
+		{
+			return;
+		}
+		m_jobs.push_back(Job());
+		Job & job = m_jobs.back();
+		job.type = JOB_WRITE;
+		job.objects.swap(objects);
+		job.deletedObjectIDs.swap(deletedObjectIDs);
+	}
+	m_wake.notify_one();
+	objects.clear();
+	deletedObjectIDs.clear();
+}
+
+void Autosave::Discard()
+{
+	m_lastSnapshot = std::chrono::steady_clock::now();
+	m_backlog = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		//snapshots not yet written hold nothing the save missed
+		m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [](const Job & job) { return job.type == JOB_WRITE; }), m_jobs.end());
+		m_jobs.push_back(Job());
+		m_jobs.back().type = JOB_DISCARD;
+	}
+	m_wake.notify_one();
+}
+
+void Autosave::RebuildLevelCache(const std::string & path)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_jobs.size(); i++)
+		{
+			if (m_jobs[i].type == JOB_LEVEL_CACHE)
+			{
+				return;		//the queued one will read the table as it is by then
+			}
+		}
+		m_jobs.push_back(Job());
+		m_jobs.back().type = JOB_LEVEL_CACHE;
+		m_jobs.back().path = path;
+	}
+	m_wake.notify_one();
+}
+
+void Autosave::MergeWrite(Job & newer, Job & older)
+{
+	//newer rows replace older ones of the same object, and a newer deletion drops the older row, as WriteAutosave
+	//deletes before it inserts and would otherwise bring the object back
+	std::unordered_set<int> newerIDs(newer.deletedObjectIDs.begin(), newer.deletedObjectIDs.end());
+	for (size_t i = 0; i < newer.objects.size(); i++)
+	{
+		newerIDs.insert(newer.objects[i].ID);
+	}
+	for (size_t i = 0; i < older.objects.size(); i++)
+	{
+		if (newerIDs.count(older.objects[i].ID) == 0)
+		{
+			newer.objects.push_back(older.objects[i]);
+		}
+	}
+	for (size_t i = 0; i < older.deletedObjectIDs.size(); i++)
+	{
+		if (newerIDs.count(older.deletedObjectIDs[i]) == 0)
+		{
+			newer.deletedObjectIDs.push_back(older.deletedObjectIDs[i]);
+		}
+	}
+	older.objects.clear();
+	older.deletedObjectIDs.clear();
+}
+
+void Autosave::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	bool finalRetry = false;
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+		Job job;
+		if (m_jobs.empty())
+		{
+			//stopping, and everything submitted has been written. a failed snapshot gets one last try
+			if (finalRetry || (m_failedWrite.objects.empty() && m_failedWrite.deletedObjectIDs.empty()))
+			{
+				return;
+			}
+			job.type = JOB_WRITE;
+			finalRetry = true;
+		}
+		else
+		{
+			job.type = m_jobs.front().type;
+			job.path.swap(m_jobs.front().path);
+			job.objects.swap(m_jobs.front().objects);
+			job.deletedObjectIDs.swap(m_jobs.front().deletedObjectIDs);
+			m_jobs.pop_front();
+		}
+		if (job.type == JOB_WRITE)
+		{
+			MergeWrite(job, m_failedWrite);
+		}
+		m_busy = true;
+		lock.unlock();
+
+		bool failed = false;
+		switch (job.type)
+		{
+		case JOB_WRITE:
+			failed = !m_database.WriteAutosave(job.objects, job.deletedObjectIDs).succeeded;
+			break;
+		case JOB_DISCARD:
+			m_database.ClearAutosave();
+			break;
+		case JOB_LEVEL_CACHE:
+			m_database.WriteLevelCache(job.path.c_str());		//if it fails the database keeps no hash, and the SQL path is used
+			break;
+		}
+
+		lock.lock();
+		m_busy = false;
+		if (failed)
+		{
+			//nothing has been added since the merge emptied it
+			job.objects.swap(m_failedWrite.objects);
+			job.deletedObjectIDs.swap(m_failedWrite.deletedObjectIDs);
+		}
+		else if (job.type == JOB_DISCARD)
+		{
+			m_failedWrite.objects.clear();			//the save before the discard wrote them all
+			m_failedWrite.deletedObjectIDs.clear();
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SceneDatabase.h"
+#include "SceneObject.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+//seconds between autosaves of the unsaved edits
+#define AUTOSAVE_INTERVAL_SECONDS 30
+//most rows copied in one frame. A bigger backlog goes over the next snapshots, each due as soon as the last is written
+#define AUTOSAVE_MAX_ROWS 1024
+
+//Writes the edits not yet saved to the recovery tables of the level database on a background thread, so a crash loses
+//at most one interval of work. The UI thread only copies out the rows changed since the last autosave and hands them
+//over; the SQL runs on the worker through its own connection, which WAL lets commit while the editor's reads.
+//Snapshots are written in the order they were submitted, so a later one always wins. A snapshot that fails to write,
+//say because a save held the database past the busy timeout, is kept by the worker and folded into the next one.
+//The worker also rebuilds the level cache after a save, for the same reason: a full read of Objects has no place on the UI thread.
+class Autosave
+{
+public:
+	Autosave();
+	~Autosave();
+
+	bool	Start(const char * databasePath, int intervalSeconds = AUTOSAVE_INTERVAL_SECONDS);	//opens the worker's connection
+	void	Stop();						//writes anything already submitted, then joins the worker. a queued level cache is dropped
+
+	bool	IsDue() const;				//the interval has passed since the last snapshot, or it left rows behind, and the worker has finished with it
+	void	Submit(std::vector<SceneObject> & objects, std::vector<int> & deletedObjectIDs, bool complete);	//takes the contents of both. complete is false if changed rows were left for the next snapshot
+	void	Discard();					//clears the recovery tables, once a save has put everything in Objects
+	void	RebuildLevelCache(const std::string & path);	//writes a level cache of Objects as it is once the queue ahead is done
+
+private:
+	enum JobType
+	{
+		JOB_WRITE,
+		JOB_DISCARD,
+		JOB_LEVEL_CACHE,
+	};
+
+	struct Job
+	{
+		JobType						type;
+		std::string					path;			//of the level cache
+		std::vector<SceneObject>	objects;
+		std::vector<int>			deletedObjectIDs;
+	};
+
+	void	WorkerMain();
+	static void	MergeWrite(Job & newer, Job & older);		//older's rows and deletions go into newer, where newer does not replace them
+
+	SceneDatabase			m_database;			//only used by the worker once it is started
+	std::thread				m_worker;
+	std::deque<Job>			m_jobs;
+	bool					m_busy;				//a job has been taken off the queue and is being written
+	bool					m_stopping;
+	Job						m_failedWrite;		//rows and deletions of snapshots that failed, for the next write
+	mutable std::mutex		m_mutex;			//guards everything above
+	std::condition_variable	m_wake;
+
+	std::chrono::steady_clock::duration		m_interval;
+	std::chrono::steady_clock::time_point	m_lastSnapshot;		//UI thread only
+	bool									m_backlog;			//UI thread only, the last snapshot was not complete
+};
@@ -0,0 +1,124 @@
+#include "ChunkManager.h"
+#include <algorithm>
+#include <cmath>
+
+
+ChunkManager::ChunkManager()
+{
+	m_loadRadius = 768.0f;		//the chunk we are in plus its neighbours, at the default 512m chunk size
+	m_unloadRadius = m_loadRadius * 1.5f;
+}
+
+
+ChunkManager::~ChunkManager()
+{
+}
+
+void ChunkManager::SetChunks(const std::vector<ChunkObject> & chunks)
+{
+	m_chunks = chunks;
+	m_chunkIndex.clear();
+	m_residentChunks.clear();
+
+	for (int i = 0; i < (int)m_chunks.size(); i++)
+	{
+		m_chunkIndex[m_chunks[i].ID] = i;
+	}
+}
+
+void ChunkManager::SetLoadRadius(float radius)
+{
+	m_loadRadius = radius;
+	m_unloadRadius = radius * 1.5f;
+}
+
+int ChunkManager::NextChunkToLoad(float x, float z) const
+{
+	int nearestChunk = -1;
+	float nearestDistance = m_loadRadius;
+
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (IsResident(m_chunks[i].ID))
+		{
+			continue;
+		}
+
+		//<= so a chunk the camera is inside is still picked with a zero radius
+		float distance = DistanceToChunk(m_chunks[i], x, z);
+		if (distance <= nearestDistance)
+		{
+			nearestDistance = distance;
+			nearestChunk = m_chunks[i].ID;
+		}
+	}
+	return nearestChunk;
+}
+
+void ChunkManager::GetChunksToUnload(float x, float z, std::vector<int> & chunkIDs) const
+{
+	chunkIDs.clear();
+	for (size_t i = 0; i < m_residentChunks.size(); i++)
+	{
+		auto chunk = m_chunkIndex.find(m_residentChunks[i]);
+		if (chunk != m_chunkIndex.end() && DistanceToChunk(m_chunks[chunk->second], x, z) > m_unloadRadius)
+		{
+			chunkIDs.push_back(m_residentChunks[i]);
+		}
+	}
+}
+
+int ChunkManager::GetChunkAt(float x, float z) const
+{
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		if (DistanceToChunk(m_chunks[i], x, z) == 0.0f)
+		{
+			return m_chunks[i].ID;
+		}
+	}
+	return -1;
+}
+
+void ChunkManager::SetResident(int chunkID, bool resident)
+{
+	auto found = std::find(m_residentChunks.begin(), m_residentChunks.end(), chunkID);
+	if (resident && found == m_residentChunks.end())
+	{
+		m_residentChunks.push_back(chunkID);
+	}
+	else if (!resident && found != m_residentChunks.end())
+	{
+		m_residentChunks.erase(found);
+	}
+}
+
+bool ChunkManager::IsResident(int chunkID) const
+{
+	return std::find(m_residentChunks.begin(), m_residentChunks.end(), chunkID) != m_residentChunks.end();
+}
+
+const std::vector<int> & ChunkManager::GetResidentChunks() const
+{
+	return m_residentChunks;
+}
+
+ChunkObject * ChunkManager::GetChunk(int chunkID)
+{
+	auto chunk = m_chunkIndex.find(chunkID);
+	if (chunk == m_chunkIndex.end())
+	{
+		return NULL;
+	}
+	return &m_chunks[chunk->second];
+}
+
+float ChunkManager::DistanceToChunk(const ChunkObject & chunk, float x, float z) const
+{
+	//distance on the ground plane from the point to the nearest edge of the chunk footprint
+	float halfX = chunk.chunk_x_size_metres * 0.5f;
+	float halfZ = chunk.chunk_y_size_metres * 0.5f;
+	float dx = std::max(std::fabs(x - chunk.origin_x) - halfX, 0.0f);
+	float dz = std::max(std::fabs(z - chunk.origin_z) - halfZ, 0.0f);
+	return std::sqrt(dx * dx + dz * dz);
+}
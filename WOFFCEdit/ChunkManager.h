@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ChunkObject.h"
+#include <map>
+#include <vector>
+
+//Decides which chunks of the world should be resident, based on distance from the camera.
+//It only does the bookkeeping: ToolMain streams objects and the renderer builds the terrain for
+//the chunks it is told to load, and throws them away when they fall out of range.
+class ChunkManager
+{
+public:
+	ChunkManager();
+	~ChunkManager();
+
+	void	SetChunks(const std::vector<ChunkObject> & chunks);	//every row of the Chunks table. Clears residency
+	void	SetLoadRadius(float radius);			//chunks closer than this are loaded, unloaded again past radius * 1.5
+
+	int		NextChunkToLoad(float x, float z) const;	//nearest non-resident chunk in range, -1 if there is none
+	void	GetChunksToUnload(float x, float z, std::vector<int> & chunkIDs) const;
+	int		GetChunkAt(float x, float z) const;			//chunk whose footprint contains the point, -1 if none
+
+	void	SetResident(int chunkID, bool resident);
+	bool	IsResident(int chunkID) const;
+	const std::vector<int> & GetResidentChunks() const;
+
+	ChunkObject * GetChunk(int chunkID);
+
+private:
+	float	DistanceToChunk(const ChunkObject & chunk, float x, float z) const;	//0 inside the footprint
+
+	std::vector<ChunkObject>	m_chunks;
+	std::map<int, int>			m_chunkIndex;		//chunk ID to index in m_chunks
+	std::vector<int>			m_residentChunks;	//IDs, small enough that a linear search is fine
+	float						m_loadRadius;
+	float						m_unloadRadius;		//larger than the load radius so chunks on the boundary do not thrash
+};
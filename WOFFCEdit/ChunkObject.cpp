@@ -4,6 +4,19 @@
 
 ChunkObject::ChunkObject()
 {
+	ID = 0;
+	chunk_x_size_metres = 0;
+	chunk_y_size_metres = 0;
+	chunk_base_resolution = 0;
+	render_wireframe = false;
+	render_normals = false;
+	tex_diffuse_tiling = 1;
+	tex_splat_1_tiling = 1;
+	tex_splat_2_tiling = 1;
+	tex_splat_3_tiling = 1;
+	tex_splat_4_tiling = 1;
+	origin_x = 0.0f;
+	origin_z = 0.0f;
 }
 
 
@@ -27,6 +27,7 @@ public:
 	int tex_splat_2_tiling;
 	int tex_splat_3_tiling;
 	int tex_splat_4_tiling;
-
+	float origin_x;		//world position of the chunk centre.  Optional columns, chunks sit on the origin when the table has none
+	float origin_z;
 };
 
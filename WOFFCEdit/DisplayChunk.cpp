@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <cfloat>
 #include <string>
+#include <vector>
 #include "DisplayChunk.h"
 #include "Game.h"
+#include "TerrainNormals.h"
 
 
 using namespace DirectX;
@@ -8,16 +12,37 @@ using namespace DirectX::SimpleMath;
 
 DisplayChunk::DisplayChunk()
 {
-	//terrain size in meters. note that this is hard coded here, we COULD get it from the terrain chunk along with the other info from the tool if we want to be more flexible.
+	//terrain size in meters. a default, PopulateChunkData takes it from the chunk
 	m_terrainSize = 512;
-	m_terrainHeightScale = 0.25;  //convert our 0-256 terrain to 64
-	m_textureCoordStep = 1.0 / (TERRAINRESOLUTION-1);	//-1 becuase its split into chunks. not vertices.  we want tthe last one in each row to have tex coord 1
-	m_terrainPositionScalingFactor = m_terrainSize / (TERRAINRESOLUTION-1);
+	m_terrainHeightScale = 0.25;  //convert our 0-256 terrain to 64. 16 bit heightmaps cover the same range in finer steps
+	m_resolution = 0;		//set from the chunk in PopulateChunkData
+	m_textureCoordStep = 0.0f;
+	m_terrainPositionScalingFactor = 0.0f;
+	m_origin_x = 0.0f;
+	m_origin_z = 0.0f;
+	m_texture_diffuse = NULL;
+	m_heightMapFormat = HEIGHTMAP_R8;
+	m_indexCount = 0;
+	m_dirtyFirstRow = -1;
+	m_dirtyLastRow = -1;
+	m_triangleCount = 0;
+	m_frustumValid = false;
+	m_culledNodeCount = 0;
+	for (int i = 0; i < TERRAIN_LOD_STITCH_MASKS; i++)
+	{
+		m_lodIndexCount[i] = 0;
+	}
+	m_lodProjectionScale = 0.0f;
+	m_lodDirty = true;
 }
 
 
 DisplayChunk::~DisplayChunk()
 {
+	if (m_texture_diffuse)
+	{
+		m_texture_diffuse->Release();	//chunks are now created and destroyed as the camera moves, so give the texture back
+	}
 }
 
 void DisplayChunk::PopulateChunkData(ChunkObject * SceneChunk)
@@ -40,24 +65,314 @@ void DisplayChunk::PopulateChunkData(ChunkObject * SceneChunk)
 	m_tex_splat_2_tiling = SceneChunk->tex_splat_2_tiling;
 	m_tex_splat_3_tiling = SceneChunk->tex_splat_3_tiling;
 	m_tex_splat_4_tiling = SceneChunk->tex_splat_4_tiling;
+	m_origin_x = SceneChunk->origin_x;
+	m_origin_z = SceneChunk->origin_z;
+
+	//size the terrain from the chunk rather than compile time constants
+	if (m_chunk_x_size_metres > 0)
+	{
+		m_terrainSize = m_chunk_x_size_metres;
+	}
+	SetResolution(m_chunk_base_resolution > 1 ? m_chunk_base_resolution : DEFAULT_TERRAIN_RESOLUTION);
+}
+
+void DisplayChunk::SetResolution(int resolution)
+{
+	m_resolution = resolution;
+	m_textureCoordStep = 1.0f / (m_resolution - 1);	//-1 becuase its split into chunks. not vertices.  we want tthe last one in each row to have tex coord 1
+	m_terrainPositionScalingFactor = (float)m_terrainSize / (m_resolution - 1);
+	m_terrainGeometry.Allocate((size_t)m_resolution * m_resolution);
+	m_heightMap.Allocate((size_t)m_resolution * m_resolution);
+	m_raycast.Clear();
+	m_lod.Clear();
+	m_lodDraws.clear();
+	m_morphedNodes.clear();
 }
 
 void DisplayChunk::RenderBatch(std::shared_ptr<DX::DeviceResources>  DevResources)
 {
 	auto context = DevResources->GetD3DDeviceContext();
 
+	if (!m_vertexBuffer)
+	{
+		CreateBuffers(DevResources->GetD3DDevice());
+	}
+	else
+	{
+		if (m_dirtyFirstRow >= 0)
+		{
+			//rows are contiguous in the buffer, so the dirty rows are one range of bytes
+			D3D11_BOX box;
+			box.left = (UINT)(m_dirtyFirstRow * m_resolution * sizeof(VertexPositionNormalTexture));
+			box.right = (UINT)((m_dirtyLastRow + 1) * m_resolution * sizeof(VertexPositionNormalTexture));
+			box.top = 0;
+			box.bottom = 1;
+			box.front = 0;
+			box.back = 1;
+			context->UpdateSubresource(m_vertexBuffer.Get(), 0, &box, &m_terrainGeometry[m_dirtyFirstRow * m_resolution], 0, 0);
+		}
+
+		//LOD nodes whose morph changed
+		for (size_t i = 0; i < m_lodUploads.size(); i++)
+		{
+			UploadNode(context, m_lodUploads[i]);
+		}
+	}
+	m_dirtyFirstRow = -1;
+	m_dirtyLastRow = -1;
+	m_lodUploads.clear();
+
 	m_terrainEffect->Apply(context);
 	context->IASetInputLayout(m_terrainInputLayout.Get());
 
-	m_batch->Begin();
-	for (size_t i = 0; i < TERRAINRESOLUTION-1; i++)	//looping through QUADS.  so we subtrack one from the terrain array or it will try to draw a quad starting with the last vertex in each row. Which wont work
+	ID3D11Buffer * vertexBuffer = m_vertexBuffer.Get();
+	UINT vertexStride = sizeof(VertexPositionNormalTexture);
+	UINT vertexOffset = 0;
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
+	context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	m_triangleCount = 0;
+	m_culledNodeCount = 0;
+	if (m_lod.IsBuilt())
+	{
+		//one draw per node, its level and stitching pick the index list, its first vertex is the base.
+		//morphed heights stay between the node's min and max, so its bounds hold whatever the morph
+		for (size_t i = 0; i < m_lodDraws.size(); i++)
+		{
+			const TerrainLODDraw & draw = m_lodDraws[i];
+			if (m_frustumValid)
+			{
+				float center[3], extents[3];
+				m_lod.GetNodeBounds(draw.node, center, extents);
+				if (!m_frustum.IntersectsBox(center, extents))
+				{
+					m_culledNodeCount++;
+					continue;
+				}
+			}
+			context->DrawIndexed(m_lodIndexCount[draw.stitchMask], m_lodIndexStart[draw.level * TERRAIN_LOD_STITCH_MASKS + draw.stitchMask], draw.baseVertex);
+			m_triangleCount += m_lodIndexCount[draw.stitchMask] / 3;
+		}
+	}
+	else
+	{
+		//no nodes, so the chunk is culled whole
+		if (m_frustumValid && m_raycast.IsBuilt())
+		{
+			float minHeight, maxHeight;
+			m_raycast.GetHeightRange(minHeight, maxHeight);
+			const float halfSize = (m_resolution - 1) * m_terrainPositionScalingFactor * 0.5f;
+			const float center[3] = { m_terrainGeometry[0].position.x + halfSize, (minHeight + maxHeight) * 0.5f, m_terrainGeometry[0].position.z + halfSize };
+			const float extents[3] = { halfSize, (maxHeight - minHeight) * 0.5f, halfSize };
+			if (!m_frustum.IntersectsBox(center, extents))
+			{
+				m_culledNodeCount = 1;
+				return;
+			}
+		}
+		context->DrawIndexed(m_indexCount, 0, 0);
+		m_triangleCount = m_indexCount / 3;
+	}
+}
+
+void DisplayChunk::UpdateLOD(const Vector3 & cameraPosition, float projectionScale)
+{
+	if (!m_lod.IsBuilt())
+	{
+		return;
+	}
+	if (!m_lodDirty && cameraPosition == m_lodCameraPosition && projectionScale == m_lodProjectionScale)
+	{
+		return;		//same view, same nodes, same morph
+	}
+	m_lodDirty = false;
+	m_lodCameraPosition = cameraPosition;
+	m_lodProjectionScale = projectionScale;
+
+	const float camera[3] = { cameraPosition.x, cameraPosition.y, cameraPosition.z };
+	m_lod.Select(camera, projectionScale, TERRAIN_LOD_PIXEL_ERROR, m_lodDraws);
+
+	//geomorphing. BasicEffect has no vertex shader to do it in, so the in between vertices of nodes nearing their switch
+	//distance are moved towards the coarser surface here, and only those nodes are uploaded. put back last frame's first
+	for (size_t i = 0; i < m_morphedNodes.size(); i++)
+	{
+		MorphNode(m_morphedNodes[i], cameraPosition, true);
+		m_lodUploads.push_back(m_morphedNodes[i]);
+	}
+	m_morphedNodes.clear();
+
+	for (size_t i = 0; i < m_lodDraws.size(); i++)
+	{
+		const TerrainLODDraw & draw = m_lodDraws[i];
+		if (m_lod.GetMorphFactor(draw.level, m_lod.GetNodeFarDistance(draw.node, camera)) <= 0.0f)
+		{
+			continue;		//all of the node is closer than the morph starts, or there is no coarser level
+		}
+		MorphNode(draw.node, cameraPosition, false);
+		m_morphedNodes.push_back(draw.node);
+		m_lodUploads.push_back(draw.node);
+	}
+
+	std::sort(m_lodUploads.begin(), m_lodUploads.end());
+	m_lodUploads.erase(std::unique(m_lodUploads.begin(), m_lodUploads.end()), m_lodUploads.end());
+}
+
+int DisplayChunk::GetTriangleCount() const
+{
+	return m_triangleCount;
+}
+
+void DisplayChunk::SetFrustum(const Frustum & frustum)
+{
+	m_frustum = frustum;
+	m_frustumValid = true;
+}
+
+int DisplayChunk::GetCulledNodeCount() const
+{
+	return m_culledNodeCount;
+}
+
+void DisplayChunk::MorphNode(int node, const Vector3 & cameraPosition, bool restore)
+{
+	int x, z, size;
+	m_lod.GetNodeRect(node, x, z, size);
+	const int level = m_lod.GetNodeLevel(node);
+	const int step = size / TERRAIN_LOD_NODE_QUADS;
+
+	for (int r = 0; r <= TERRAIN_LOD_NODE_QUADS; r++)
+	{
+		for (int c = 0; c <= TERRAIN_LOD_NODE_QUADS; c++)
+		{
+			if (!(r & 1) && !(c & 1))
+			{
+				continue;		//on the coarser level's grid as well, never moves
+			}
+
+			const int index = (z + r * step) * m_resolution + x + c * step;
+			float height = m_heightMap[index];
+			if (!restore)
+			{
+				//where the coarser level's triangles put this vertex, same diagonal as the index lists
+				float coarseHeight;
+				if (!(r & 1))
+				{
+					coarseHeight = 0.5f * (m_heightMap[index - step] + m_heightMap[index + step]);
+				}
+				else if (!(c & 1))
+				{
+					coarseHeight = 0.5f * (m_heightMap[index - step * m_resolution] + m_heightMap[index + step * m_resolution]);
+				}
+				else
+				{
+					coarseHeight = 0.5f * (m_heightMap[index - step * m_resolution - step] + m_heightMap[index + step * m_resolution + step]);
+				}
+				const Vector3 position(m_terrainGeometry[index].position.x, height, m_terrainGeometry[index].position.z);
+				height += (coarseHeight - height) * m_lod.GetMorphFactor(level, Vector3::Distance(cameraPosition, position));
+			}
+			m_terrainGeometry[index].position.y = height;
+		}
+	}
+}
+
+void DisplayChunk::UploadNode(ID3D11DeviceContext * context, int node)
+{
+	//only the node's own rows, and only its own columns of those
+	int x, z, size;
+	m_lod.GetNodeRect(node, x, z, size);
+	const int step = size / TERRAIN_LOD_NODE_QUADS;
+
+	D3D11_BOX box;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	for (int row = z; row <= z + size; row += step)
+	{
+		const int first = row * m_resolution + x;
+		box.left = (UINT)(first * sizeof(VertexPositionNormalTexture));
+		box.right = (UINT)((first + size + 1) * sizeof(VertexPositionNormalTexture));
+		context->UpdateSubresource(m_vertexBuffer.Get(), 0, &box, &m_terrainGeometry[first], 0, 0);
+	}
+}
+
+void DisplayChunk::CreateBuffers(ID3D11Device * device)
+{
+	std::vector<uint32_t> indices;
+	if (m_lod.IsBuilt())
+	{
+		//every (level, stitch mask) node list back to back. the full grid is never drawn in one go, and at 2^n + 1 it would be huge
+		std::vector<unsigned int> nodeIndices;
+		m_lodIndexStart.resize(m_lod.GetLevelCount() * TERRAIN_LOD_STITCH_MASKS);
+		for (int level = 0; level < m_lod.GetLevelCount(); level++)
+		{
+			for (int mask = 0; mask < TERRAIN_LOD_STITCH_MASKS; mask++)
+			{
+				nodeIndices.clear();
+				TerrainLOD::BuildIndices(level, mask, m_resolution, nodeIndices);
+				m_lodIndexStart[level * TERRAIN_LOD_STITCH_MASKS + mask] = (UINT)indices.size();
+				m_lodIndexCount[mask] = (UINT)nodeIndices.size();
+				indices.insert(indices.end(), nodeIndices.begin(), nodeIndices.end());
+			}
+		}
+	}
+	else
 	{
-		for (size_t j = 0; j < TERRAINRESOLUTION-1; j++)//same as above
+		//two triangles per quad, in the same order DrawQuad used: bottom left, bottom right, top right, top left
+		indices.reserve((size_t)(m_resolution - 1) * (m_resolution - 1) * 6);
+		for (uint32_t i = 0; i < (uint32_t)m_resolution - 1; i++)	//looping through QUADS.  so we subtrack one from the terrain array or it will try to draw a quad starting with the last vertex in each row. Which wont work
 		{
-			m_batch->DrawQuad(m_terrainGeometry[i][j], m_terrainGeometry[i][j+1], m_terrainGeometry[i+1][j+1], m_terrainGeometry[i+1][j]); //bottom left bottom right, top right top left.
+			for (uint32_t j = 0; j < (uint32_t)m_resolution - 1; j++)//same as above
+			{
+				const uint32_t bottomLeft = i * m_resolution + j;
+				const uint32_t bottomRight = bottomLeft + 1;
+				const uint32_t topRight = bottomRight + m_resolution;
+				const uint32_t topLeft = bottomLeft + m_resolution;
+				indices.push_back(bottomLeft);	indices.push_back(bottomRight);	indices.push_back(topRight);
+				indices.push_back(bottomLeft);	indices.push_back(topRight);	indices.push_back(topLeft);
+			}
 		}
 	}
-	m_batch->End();
+	m_indexCount = (UINT)indices.size();
+
+	D3D11_BUFFER_DESC indexDesc = {};
+	indexDesc.ByteWidth = (UINT)(indices.size() * sizeof(uint32_t));
+	indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = indices.data();
+	DX::ThrowIfFailed(device->CreateBuffer(&indexDesc, &indexData, m_indexBuffer.ReleaseAndGetAddressOf()));
+
+	//default usage rather than dynamic: edits are occasional and only touch a few rows, so UpdateSubresource on a range beats re-mapping the whole buffer
+	D3D11_BUFFER_DESC vertexDesc = {};
+	vertexDesc.ByteWidth = (UINT)(m_terrainGeometry.size() * sizeof(VertexPositionNormalTexture));
+	vertexDesc.Usage = D3D11_USAGE_DEFAULT;
+	vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA vertexData = {};
+	vertexData.pSysMem = m_terrainGeometry.data();
+	DX::ThrowIfFailed(device->CreateBuffer(&vertexDesc, &vertexData, m_vertexBuffer.ReleaseAndGetAddressOf()));
+}
+
+void DisplayChunk::MarkRowsDirty(int firstRow, int lastRow)
+{
+	firstRow = std::max(firstRow, 0);
+	lastRow = std::min(lastRow, m_resolution - 1);
+	if (firstRow > lastRow)
+	{
+		return;
+	}
+
+	if (m_dirtyFirstRow < 0)
+	{
+		m_dirtyFirstRow = firstRow;
+		m_dirtyLastRow = lastRow;
+	}
+	else
+	{
+		m_dirtyFirstRow = std::min(m_dirtyFirstRow, firstRow);
+		m_dirtyLastRow = std::max(m_dirtyLastRow, lastRow);
+	}
 }
 
 void DisplayChunk::InitialiseBatch()
@@ -66,50 +381,58 @@ void DisplayChunk::InitialiseBatch()
 	//iterate through all the vertices of our required resolution terrain.
 	int index = 0;
 
-	for (size_t i = 0; i < TERRAINRESOLUTION; i++)
+	for (int i = 0; i < m_resolution; i++)
 	{
-		for (size_t j = 0; j < TERRAINRESOLUTION; j++)
+		for (int j = 0; j < m_resolution; j++)
 		{
-			index = (TERRAINRESOLUTION * i) + j;
-			m_terrainGeometry[i][j].position =			Vector3(j*m_terrainPositionScalingFactor-(0.5*m_terrainSize), (float)(m_heightMap[index])*m_terrainHeightScale, i*m_terrainPositionScalingFactor-(0.5*m_terrainSize));	//This will create a terrain going from -64->64.  rather than 0->128.  So the center of the terrain is on the origin
-			m_terrainGeometry[i][j].normal =			Vector3(0.0f, 1.0f, 0.0f);						//standard y =up
-			m_terrainGeometry[i][j].textureCoordinate =	Vector2(((float)m_textureCoordStep*j)*m_tex_diffuse_tiling, ((float)m_textureCoordStep*i)*m_tex_diffuse_tiling);				//Spread tex coords so that its distributed evenly across the terrain from 0-1
+			index = (m_resolution * i) + j;
+			m_terrainGeometry[i * m_resolution + j].position =			Vector3(j*m_terrainPositionScalingFactor-(0.5*m_terrainSize)+m_origin_x, m_heightMap[index], i*m_terrainPositionScalingFactor-(0.5*m_terrainSize)+m_origin_z);	//This will create a terrain going from -64->64.  rather than 0->128.  So the center of the terrain is on the chunk origin
+			m_terrainGeometry[i * m_resolution + j].textureCoordinate =	Vector2(((float)m_textureCoordStep*j)*m_tex_diffuse_tiling, ((float)m_textureCoordStep*i)*m_tex_diffuse_tiling);				//Spread tex coords so that its distributed evenly across the terrain from 0-1
 			
 		}
 	}
-	CalculateTerrainNormals();
-	
+	CalculateTerrainNormals(0, m_resolution - 1, 0, m_resolution - 1);
+	MarkRowsDirty(0, m_resolution - 1);	//only matters if the buffers already exist
+
+	m_raycast.Build(m_heightMap.data(), m_resolution, m_terrainGeometry[0].position.x, m_terrainGeometry[0].position.z, m_terrainPositionScalingFactor);
+
+	//LOD over the same vertices, when the resolution allows it
+	if (TerrainLOD::IsSupported(m_resolution))
+	{
+		m_lod.Build(m_heightMap.data(), m_resolution, m_terrainGeometry[0].position.x, m_terrainGeometry[0].position.z, m_terrainPositionScalingFactor);
+	}
+	m_morphedNodes.clear();
+	m_lodDirty = true;
 }
 
 void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources)
 {
 	auto device = DevResources->GetD3DDevice();
-	auto devicecontext = DevResources->GetD3DDeviceContext();
-
-	//load in heightmap .raw
-	FILE *pFile = NULL;
-
-	// Open The File In Read / Binary Mode.
 
-	pFile = fopen(m_heightmap_path.c_str(), "rb");
-	// Check To See If We Found The File And Could Open It
-	if (pFile == NULL)
+	//load in heightmap. .raw or .dds, 8 bit, 16 bit or float samples
+	HeightMapFile heightMapFile;
+	if (heightMapFile.Open(m_heightmap_path, m_resolution))
 	{
-		// Display Error Message And Stop The Function
+		if (heightMapFile.GetResolution() != m_resolution)
+		{
+			SetResolution(heightMapFile.GetResolution());	//a DDS carries its own size, and that is what the terrain is
+		}
+		heightMapFile.ReadHeights(m_heightMap.data(), m_terrainHeightScale);
+		m_heightMapFormat = heightMapFile.GetFormat();
+		m_heightMapHeader = heightMapFile.GetHeader();
+		heightMapFile.Close();
+	}
+	else
+	{
+		// Display Error Message, the terrain stays flat
 		MessageBox(NULL, L"Can't Find The Height Map!", L"Error", MB_OK);
-		return;
 	}
 
-	// Here We Load The .RAW File Into Our pHeightMap Data Array
-	// We Are Only Reading In '1', And The Size Is (Width * Height)
-	fread(m_heightMap, 1, TERRAINRESOLUTION*TERRAINRESOLUTION, pFile);
-
-	fclose(pFile);
-
 	//load in texture diffuse
 	
 	//load the diffuse texture
-	std::wstring texturewstr = StringToWCHART(m_tex_diffuse_path);
+	StringPool & strings = StringPool::Global();
+	const std::wstring & texturewstr = strings.GetWideString(strings.Intern(m_tex_diffuse_path));
 	HRESULT rs;	
 	rs = CreateDDSTextureFromFile(device, texturewstr.c_str(), NULL, &m_texture_diffuse);	//load tex into Shader resource	view and resource
 	
@@ -134,80 +457,133 @@ void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResour
 			m_terrainInputLayout.GetAddressOf())
 		);
 
-	m_batch = std::make_unique<PrimitiveBatch<VertexPositionNormalTexture>>(devicecontext);
-
-	
 }
 
 void DisplayChunk::SaveHeightMap()
 {
-/*	for (size_t i = 0; i < TERRAINRESOLUTION*TERRAINRESOLUTION; i++)
-	{
-		m_heightMap[i] = 0;
-	}*/
-
-	FILE *pFile = NULL;
-
-	// Open The File In Read / Binary Mode.
-	pFile = fopen(m_heightmap_path.c_str(), "wb+");;
-	// Check To See If We Found The File And Could Open It
-	if (pFile == NULL)
+	//back in the format it was loaded in, replacing the old file only once the new one is fully written
+	if (!HeightMapFile::Save(m_heightmap_path, m_heightMap.data(), m_resolution, m_heightMapFormat, m_heightMapHeader, m_terrainHeightScale))
 	{
 		// Display Error Message And Stop The Function
-		MessageBox(NULL, L"Can't Find The Height Map!", L"Error", MB_OK);
-		return;
+		MessageBox(NULL, L"Can't Save The Height Map!", L"Error", MB_OK);
 	}
-
-	fwrite(m_heightMap, 1, TERRAINRESOLUTION*TERRAINRESOLUTION, pFile);
-	fclose(pFile);
-	
 }
 
 void DisplayChunk::UpdateTerrain()
 {
+	UpdateTerrainRows(0, m_resolution - 1);
+}
+
+void DisplayChunk::UpdateTerrainRows(int firstRow, int lastRow)
+{
+	UpdateTerrainRect(firstRow, lastRow, 0, m_resolution - 1);
+}
+
+void DisplayChunk::UpdateTerrainRect(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	firstRow = std::max(firstRow, 0);
+	lastRow = std::min(lastRow, m_resolution - 1);
+	firstColumn = std::max(firstColumn, 0);
+	lastColumn = std::min(lastColumn, m_resolution - 1);
+
 	//all this is doing is transferring the height from the heigtmap into the terrain geometry.
 	int index;
-	for (size_t i = 0; i < TERRAINRESOLUTION; i++)
+	for (int i = firstRow; i <= lastRow; i++)
 	{
-		for (size_t j = 0; j < TERRAINRESOLUTION; j++)
+		for (int j = firstColumn; j <= lastColumn; j++)
 		{
-			index = (TERRAINRESOLUTION * i) + j;
-			m_terrainGeometry[i][j].position.y = (float)(m_heightMap[index])*m_terrainHeightScale;	
+			index = (m_resolution * i) + j;
+			m_terrainGeometry[i * m_resolution + j].position.y = m_heightMap[index];	
 		}
 	}
-	CalculateTerrainNormals();
 
-}
+	//normals of the vertices all round depend on the changed heights too
+	CalculateTerrainNormals(firstRow - 1, lastRow + 1, firstColumn - 1, lastColumn + 1);
+	MarkRowsDirty(firstRow - 1, lastRow + 1);
 
-void DisplayChunk::GenerateHeightmap()
-{
-	//insert how YOU want to update the heigtmap here! :D
+	m_raycast.UpdateRect(firstRow, lastRow, firstColumn, lastColumn);
+
+	//node bounds and level errors follow the heights, and the vertices just written have lost any morph
+	if (firstRow == 0 && lastRow == m_resolution - 1 && firstColumn == 0 && lastColumn == m_resolution - 1)
+	{
+		m_lod.UpdateHeights(m_heightMap.data());
+	}
+	else
+	{
+		m_lod.UpdateHeights(firstRow, lastRow, firstColumn, lastColumn);
+	}
+	m_lodDirty = true;
 }
 
-void DisplayChunk::CalculateTerrainNormals()
+void DisplayChunk::ApplyBrush(const TerrainBrush & brush, const Vector3 & centre, float deltaTime)
 {
-	int index1, index2, index3, index4;
-	DirectX::SimpleMath::Vector3 upDownVector, leftRightVector, normalVector;
-
+	//whatever the heightmap file can hold, so what is sculpted is what gets saved
+	TerrainBrush chunkBrush = brush;
+	if (m_heightMapFormat == HEIGHTMAP_R32F)
+	{
+		chunkBrush.minHeight = -FLT_MAX;
+		chunkBrush.maxHeight = FLT_MAX;
+	}
+	else
+	{
+		chunkBrush.minHeight = 0.0f;
+		chunkBrush.maxHeight = 255.0f * m_terrainHeightScale;
+	}
 
+	const float column = (centre.x - m_terrainGeometry[0].position.x) / m_terrainPositionScalingFactor;
+	const float row = (centre.z - m_terrainGeometry[0].position.z) / m_terrainPositionScalingFactor;
+	TerrainRect dirty;
+	if (ApplyTerrainBrush(m_heightMap.data(), m_resolution, m_terrainPositionScalingFactor, column, row, chunkBrush, deltaTime, dirty))
+	{
+		UpdateTerrainRect(dirty.firstRow, dirty.lastRow, dirty.firstColumn, dirty.lastColumn);
+	}
+}
 
-	for (int i = 0; i<(TERRAINRESOLUTION - 1); i++)
+float DisplayChunk::GetHeightAt(float x, float z) const
+{
+	const float column = std::min(std::max((x - m_terrainGeometry[0].position.x) / m_terrainPositionScalingFactor, 0.0f), (float)(m_resolution - 1));
+	const float row = std::min(std::max((z - m_terrainGeometry[0].position.z) / m_terrainPositionScalingFactor, 0.0f), (float)(m_resolution - 1));
+	const int cellColumn = std::min((int)column, m_resolution - 2);
+	const int cellRow = std::min((int)row, m_resolution - 2);
+	const float u = column - cellColumn;
+	const float v = row - cellRow;
+
+	//the cell is split bottom left to top right, as the index buffer splits it
+	const int bottomLeft = cellRow * m_resolution + cellColumn;
+	const float h00 = m_heightMap[bottomLeft];
+	const float h10 = m_heightMap[bottomLeft + 1];
+	const float h01 = m_heightMap[bottomLeft + m_resolution];
+	const float h11 = m_heightMap[bottomLeft + m_resolution + 1];
+	if (u >= v)
 	{
-		for (int j = 0; j<(TERRAINRESOLUTION - 1); j++)
-		{
-			upDownVector.x = (m_terrainGeometry[i + 1][j].position.x - m_terrainGeometry[i - 1][j].position.x);
-			upDownVector.y = (m_terrainGeometry[i + 1][j].position.y - m_terrainGeometry[i - 1][j].position.y);
-			upDownVector.z = (m_terrainGeometry[i + 1][j].position.z - m_terrainGeometry[i - 1][j].position.z);
+		return h00 + (h10 - h00) * u + (h11 - h10) * v;
+	}
+	return h00 + (h11 - h01) * u + (h01 - h00) * v;
+}
 
-			leftRightVector.x = (m_terrainGeometry[i][j - 1].position.x - m_terrainGeometry[i][j + 1].position.x);
-			leftRightVector.y = (m_terrainGeometry[i][j - 1].position.y - m_terrainGeometry[i][j + 1].position.y);
-			leftRightVector.z = (m_terrainGeometry[i][j - 1].position.z - m_terrainGeometry[i][j + 1].position.z);
+bool DisplayChunk::IntersectRay(const Vector3 & origin, const Vector3 & direction, float maxDistance, TerrainRayHit & hit) const
+{
+	const float rayOrigin[3] = { origin.x, origin.y, origin.z };
+	const float rayDirection[3] = { direction.x, direction.y, direction.z };
+	return m_raycast.IntersectRay(rayOrigin, rayDirection, maxDistance, hit);
+}
 
+bool DisplayChunk::ContainsPoint(float x, float z) const
+{
+	const float minX = m_terrainGeometry[0].position.x;
+	const float minZ = m_terrainGeometry[0].position.z;
+	const float size = (m_resolution - 1) * m_terrainPositionScalingFactor;
+	return x >= minX && x <= minX + size && z >= minZ && z <= minZ + size;
+}
 
-			leftRightVector.Cross(upDownVector, normalVector);	//get cross product
-			normalVector.Normalize();			//normalise it.
+void DisplayChunk::GenerateHeightmap()
+{
+	//insert how YOU want to update the heigtmap here! :D
+}
 
-			m_terrainGeometry[i][j].normal = normalVector;	//set the normal for this point based on our result
-		}
-	}
+void DisplayChunk::CalculateTerrainNormals(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	//from the heightmap, not the vertex positions, so LOD morphing never leaks into the lighting
+	ComputeTerrainNormals(m_heightMap.data(), m_resolution, m_terrainPositionScalingFactor, firstRow, lastRow, firstColumn, lastColumn,
+		&m_terrainGeometry[0].normal.x, sizeof(VertexPositionNormalTexture));
 }
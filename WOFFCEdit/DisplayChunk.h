@@ -2,9 +2,18 @@
 #include "pch.h"
 #include "DeviceResources.h"
 #include "ChunkObject.h"
+#include "AlignedArray.h"
+#include "HeightMapFile.h"
+#include "TerrainLOD.h"
+#include "TerrainBrush.h"
+#include "TerrainRaycast.h"
+#include "FrustumCuller.h"
 
-//geometric resoltuion - note,  hard coded.
-#define TERRAINRESOLUTION 128
+//geometric resolution used when the chunk row does not give a usable one
+#define DEFAULT_TERRAIN_RESOLUTION 128
+
+//screen space error in pixels a terrain LOD level may have before it is split into the finer one
+#define TERRAIN_LOD_PIXEL_ERROR 2.0f
 
 class DisplayChunk
 {
@@ -17,8 +26,17 @@ public:
 	void LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources);
 	void SaveHeightMap();			//saves the heigtmap back to file.
 	void UpdateTerrain();			//updates the geometry based on the heigtmap
+	void UpdateTerrainRows(int firstRow, int lastRow);	//as above, for heightmap rows firstRow to lastRow inclusive
+	void UpdateTerrainRect(int firstRow, int lastRow, int firstColumn, int lastColumn);	//as above, for a rectangle of the heightmap
+	void ApplyBrush(const TerrainBrush & brush, const DirectX::SimpleMath::Vector3 & centre, float deltaTime);	//one dab at a world position, the chunk works out what it covers
+	bool IntersectRay(const DirectX::SimpleMath::Vector3 & origin, const DirectX::SimpleMath::Vector3 & direction, float maxDistance, TerrainRayHit & hit) const;
+	bool ContainsPoint(float x, float z) const;		//world x / z inside the terrain's square
+	float GetHeightAt(float x, float z) const;		//on the drawn triangles at a world position, clamped to the terrain
 	void GenerateHeightmap();		//creates or alters the heightmap
-	std::unique_ptr<DirectX::PrimitiveBatch<DirectX::VertexPositionNormalTexture>>  m_batch;
+	void UpdateLOD(const DirectX::SimpleMath::Vector3 & cameraPosition, float projectionScale);	//picks the LOD nodes to draw, projectionScale is pixels per unit of error at unit distance
+	int  GetTriangleCount() const;	//drawn by the last RenderBatch
+	void SetFrustum(const Frustum & frustum);	//the next RenderBatch skips whatever is outside it
+	int  GetCulledNodeCount() const;	//LOD nodes, or the whole chunk as one, the last RenderBatch left out
 	std::unique_ptr<DirectX::BasicEffect>       m_terrainEffect;
 
 	ID3D11ShaderResourceView *					m_texture_diffuse;				//diffuse texture
@@ -26,9 +44,42 @@ public:
 
 private:
 	
-	DirectX::VertexPositionNormalTexture m_terrainGeometry[TERRAINRESOLUTION][TERRAINRESOLUTION];
-	BYTE m_heightMap[TERRAINRESOLUTION*TERRAINRESOLUTION];
-	void CalculateTerrainNormals();
+	//m_resolution x m_resolution, row major. sized from the chunk, so they live on the heap
+	AlignedArray<DirectX::VertexPositionNormalTexture> m_terrainGeometry;
+	AlignedArray<float> m_heightMap;	//in metres, whatever the file format
+	int		m_resolution;				//vertices along each side
+	HeightMapFormat			m_heightMapFormat;		//as loaded, and saved back the same way
+	std::vector<uint8_t>	m_heightMapHeader;		//DDS header to write back, empty for .raw
+	void SetResolution(int resolution);			//resizes the terrain arrays, discarding their contents
+	void CalculateTerrainNormals(int firstRow, int lastRow, int firstColumn, int lastColumn);	//vertices in the rectangle, inclusive, clamped to the terrain
+	void CreateBuffers(ID3D11Device * device);		//index buffer never changes, vertex buffer is refreshed from m_terrainGeometry
+	void MarkRowsDirty(int firstRow, int lastRow);
+
+	//the terrain lives on the GPU. m_terrainGeometry is uploaded once, then only the rows an edit touched
+	Microsoft::WRL::ComPtr<ID3D11Buffer>		m_vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer>		m_indexBuffer;
+	UINT										m_indexCount;
+	int											m_dirtyFirstRow;	//vertex rows to upload before the next draw, -1 if none
+	int											m_dirtyLastRow;
+	int											m_triangleCount;
+	Frustum										m_frustum;
+	bool										m_frustumValid;		//draw everything until a frustum is set
+	int											m_culledNodeCount;
+
+	//LOD, only for 2^n + 1 resolutions. anything else is drawn whole at full resolution as before
+	//the index buffer then holds one list per (level, stitch mask) instead of the full grid, every node draws one of them offset to its first vertex
+	TerrainRaycast					m_raycast;				//picking and sculpting rays, over m_heightMap
+	TerrainLOD						m_lod;
+	std::vector<TerrainLODDraw>		m_lodDraws;
+	std::vector<UINT>				m_lodIndexStart;		//[level * TERRAIN_LOD_STITCH_MASKS + mask]
+	UINT							m_lodIndexCount[TERRAIN_LOD_STITCH_MASKS];	//same at every level
+	DirectX::SimpleMath::Vector3	m_lodCameraPosition;	//as of the last selection
+	float							m_lodProjectionScale;
+	bool							m_lodDirty;				//heights changed, select and morph again even if the camera has not moved
+	std::vector<int>				m_morphedNodes;			//nodes whose vertices hold morphed heights
+	std::vector<int>				m_lodUploads;			//nodes whose vertices changed since the last upload
+	void MorphNode(int node, const DirectX::SimpleMath::Vector3 & cameraPosition, bool restore);
+	void UploadNode(ID3D11DeviceContext * context, int node);
 
 	float	m_terrainHeightScale;
 	int		m_terrainSize;				//size of terrain in metres
@@ -53,6 +104,7 @@ private:
 	int m_tex_splat_2_tiling;
 	int m_tex_splat_3_tiling;
 	int m_tex_splat_4_tiling;
-
+	float m_origin_x;		//world position of the chunk centre
+	float m_origin_z;
 };
 
@@ -3,7 +3,10 @@
 DisplayObject::DisplayObject()
 {
 	m_model = NULL;
-	m_texture_diffuse = NULL;
+	m_modelPath = STRING_HANDLE_EMPTY;
+	m_texturePath = STRING_HANDLE_EMPTY;
+	m_ID = 0;
+	m_parentID = 0;
 	m_orientation.x = 0.0f;
 	m_orientation.y = 0.0f;
 	m_orientation.z = 0.0f;
@@ -15,6 +18,8 @@ DisplayObject::DisplayObject()
 	m_scale.z = 0.0f;
 	m_render = true;
 	m_wireframe = false;
+	m_snapToGround = false;
+	m_transformDirty = true;
 
 	m_light_type =0;
 	m_light_diffuse_r = 0.0f;	m_light_diffuse_g = 0.0f;	m_light_diffuse_b = 0.0f;
@@ -30,3 +35,56 @@ DisplayObject::~DisplayObject()
 {
 //	delete m_texture_diffuse;
 }
+
+void DisplayObject::UpdateLocalTransform()
+{
+	if (!m_transformDirty)
+	{
+		return;
+	}
+
+	const DirectX::XMVECTORF32 scale = { m_scale.x, m_scale.y, m_scale.z };
+	const DirectX::XMVECTORF32 translate = { m_position.x, m_position.y, m_position.z };
+
+	//convert degrees into radians for rotation matrix
+	const DirectX::XMVECTOR rotate = DirectX::SimpleMath::Quaternion::CreateFromYawPitchRoll(m_orientation.y * 3.1415 / 180,
+																							m_orientation.x * 3.1415 / 180,
+																							m_orientation.z * 3.1415 / 180);
+
+	m_local = DirectX::XMMatrixTransformation(DirectX::g_XMZero, DirectX::SimpleMath::Quaternion::Identity, scale, DirectX::g_XMZero, rotate, translate);
+	m_transformDirty = false;
+}
+
+void DisplayObject::SetWorld(const DirectX::SimpleMath::Matrix & world)
+{
+	m_world = world;
+	m_worldInverse = m_world.Invert();
+	UpdateBounds();
+}
+
+void DisplayObject::UpdateBounds()
+{
+	//an object without a model gets an empty box at its position, so it is still in the picking tree but never hit
+	m_worldBounds = DirectX::BoundingBox(m_world.Translation(), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+	if (m_model)
+	{
+		for (size_t i = 0; i < m_model->meshes.size(); i++)
+		{
+			DirectX::BoundingBox meshBounds;
+			m_model->meshes[i]->boundingBox.Transform(meshBounds, m_world);
+			if (i == 0)
+			{
+				m_worldBounds = meshBounds;
+			}
+			else
+			{
+				DirectX::BoundingBox::CreateMerged(m_worldBounds, m_worldBounds, meshBounds);
+			}
+		}
+	}
+}
+
+void DisplayObject::MarkTransformDirty()
+{
+	m_transformDirty = true;
+}
@@ -1,23 +1,44 @@
 #pragma once
 #include "pch.h"
+#include "StringPool.h"
 
 
 class DisplayObject
 {
 public:
 	DisplayObject();
+	DisplayObject(const DisplayObject &) = default;
+	DisplayObject(DisplayObject &&) = default;		//moved when the display list is synced, rather than copying its assets' references
+	DisplayObject & operator=(const DisplayObject &) = default;
+	DisplayObject & operator=(DisplayObject &&) = default;
 	~DisplayObject();
 
+	void	UpdateLocalTransform();		//rebuilds m_local, if the transform has changed
+	void	SetWorld(const DirectX::SimpleMath::Matrix & world);	//m_local * the parent's world, from Game's hierarchy. updates the inverse and bounds
+	void	UpdateBounds();				//from m_world, after the model changes
+	void	MarkTransformDirty();		//call after changing position, orientation or scale
+
 	std::shared_ptr<DirectX::Model>						m_model;							//main Mesh
-	ID3D11ShaderResourceView *							m_texture_diffuse;					//diffuse texture
+	std::shared_ptr<ID3D11ShaderResourceView>			m_texture_diffuse;					//diffuse texture, shared through the asset cache
+	StringHandle										m_modelPath;						//the files they came from, so a sync can tell when they change
+	StringHandle										m_texturePath;
 
 
 	int m_ID;
+	int m_parentID;						//SceneObject ID of the parent, position / orientation / scale are relative to it
 	DirectX::SimpleMath::Vector3			m_position;
 	DirectX::SimpleMath::Vector3			m_orientation;
 	DirectX::SimpleMath::Vector3			m_scale;
 	bool									m_render;
 	bool									m_wireframe;
+	bool									m_snapToGround;		//kept on the terrain whenever it or the terrain under it moves
+
+	//cached from position / orientation / scale and the parent, shared by rendering and picking
+	DirectX::SimpleMath::Matrix				m_local;
+	DirectX::SimpleMath::Matrix				m_world;
+	DirectX::SimpleMath::Matrix				m_worldInverse;
+	DirectX::BoundingBox					m_worldBounds;		//all meshes merged, in world space
+	bool									m_transformDirty;
 
 	int		m_light_type;
 	float	m_light_diffuse_r,	m_light_diffuse_g,	m_light_diffuse_b;
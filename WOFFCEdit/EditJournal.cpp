@@ -0,0 +1,287 @@
+#include "EditJournal.h"
+
+
+EditJournal::EditJournal()
+{
+	m_open = false;
+	m_overflow = false;
+	SetBudget(EDIT_JOURNAL_DEFAULT_BYTES);
+}
+
+
+EditJournal::~EditJournal()
+{
+}
+
+void EditJournal::SetBudget(size_t bytes)
+{
+	size_t objectSlots = bytes / EDIT_JOURNAL_OBJECT_SHARE / sizeof(SceneObject);
+	if (objectSlots == 0)
+	{
+		objectSlots = 1;
+	}
+	const size_t objectBytes = objectSlots * sizeof(SceneObject);
+	size_t slots = bytes > objectBytes ? (bytes - objectBytes) / (sizeof(EditDelta) + sizeof(Command)) : 0;
+	if (slots == 0)
+	{
+		slots = 1;
+	}
+	m_deltas.assign(slots, EditDelta());
+	m_commands.assign(slots, Command());
+	m_objects.assign(objectSlots, SceneObject());
+	Clear();
+}
+
+size_t EditJournal::GetBudget() const
+{
+	return m_deltas.size() * sizeof(EditDelta) + m_commands.size() * sizeof(Command) + m_objects.size() * sizeof(SceneObject);
+}
+
+void EditJournal::Clear()
+{
+	m_deltaBegin = 0;
+	m_deltaEnd = 0;
+	m_objectBegin = 0;
+	m_objectEnd = 0;
+	m_commandBegin = 0;
+	m_commandCurrent = 0;
+	m_commandEnd = 0;
+	m_open = false;
+	m_overflow = false;
+	m_droppedCount = 0;
+}
+
+void EditJournal::BeginCommand(unsigned int mergeKey)
+{
+	if (m_open)
+	{
+		EndCommand();
+	}
+	m_open = true;
+	m_overflow = false;
+
+	//the next frame of the same drag carries on with the command it started, as long as nothing was undone since
+	if (mergeKey != 0 && m_commandCurrent == m_commandEnd && m_commandEnd > m_commandBegin
+		&& GetCommand(m_commandEnd - 1).mergeKey == mergeKey)
+	{
+		return;
+	}
+
+	//a new edit makes the undone commands unreachable
+	m_commandEnd = m_commandCurrent;
+	if (m_commandEnd > m_commandBegin)
+	{
+		const Command & last = GetCommand(m_commandEnd - 1);
+		m_deltaEnd = last.firstDelta + last.deltaCount;
+		m_objectEnd = last.firstObject + last.objectCount;
+	}
+	else
+	{
+		m_deltaEnd = m_deltaBegin;
+		m_objectEnd = m_objectBegin;
+	}
+
+	if (m_commandEnd - m_commandBegin == m_commands.size())
+	{
+		DropOldestCommand();
+	}
+	Command & command = GetCommand(m_commandEnd);
+	command.firstDelta = m_deltaEnd;
+	command.deltaCount = 0;
+	command.firstObject = m_objectEnd;
+	command.objectCount = 0;
+	command.mergeKey = mergeKey;
+	m_commandEnd++;
+	m_commandCurrent = m_commandEnd;
+}
+
+void EditJournal::Record(int ID, int field, float oldValue, float newValue)
+{
+	if (!m_open || m_overflow || oldValue == newValue)
+	{
+		return;
+	}
+
+	//only a merged command can see the same field twice in a row often enough to be worth searching for it.
+	//elsewhere a repeat is just replayed in order, which ends in the same place
+	Command & command = GetCommand(m_commandEnd - 1);
+	if (command.mergeKey != 0)
+	{
+		for (int i = 0; i < command.deltaCount; i++)
+		{
+			EditDelta & delta = GetDelta(command.firstDelta + i);
+			if (delta.ID == ID && delta.field == field)
+			{
+				delta.newValue = newValue;
+				return;
+			}
+		}
+	}
+
+	if (!MakeRoom(false))
+	{
+		return;
+	}
+
+	EditDelta & delta = GetDelta(m_deltaEnd);
+	delta.ID = ID;
+	delta.field = field;
+	delta.oldValue = oldValue;
+	delta.newValue = newValue;
+	m_deltaEnd++;
+	command.deltaCount++;
+}
+
+void EditJournal::RecordAdded(const SceneObject & object)
+{
+	RecordObject(EDIT_FIELD_OBJECT_ADDED, object);
+}
+
+void EditJournal::RecordRemoved(const SceneObject & object)
+{
+	RecordObject(EDIT_FIELD_OBJECT_REMOVED, object);
+}
+
+void EditJournal::RecordObject(int field, const SceneObject & object)
+{
+	if (!m_open || m_overflow || !MakeRoom(true))
+	{
+		return;
+	}
+
+	Command & command = GetCommand(m_commandEnd - 1);
+	EditDelta & delta = GetDelta(m_deltaEnd);
+	delta.ID = object.ID;
+	delta.field = field;
+	delta.oldValue = 0.0f;
+	delta.newValue = 0.0f;
+	m_deltaEnd++;
+	command.deltaCount++;
+	GetRow(m_objectEnd) = object;
+	m_objectEnd++;
+	command.objectCount++;
+}
+
+bool EditJournal::MakeRoom(bool object)
+{
+	//commands without objects free no object slots, so it can take more than one
+	while (m_deltaEnd - m_deltaBegin == m_deltas.size() || (object && m_objectEnd - m_objectBegin == m_objects.size()))
+	{
+		if (m_commandEnd - m_commandBegin == 1)
+		{
+			//this command alone is bigger than the budget. It cannot be undone, and nothing before it can be either
+			m_droppedCount++;
+			m_commandBegin = m_commandCurrent = m_commandEnd;
+			m_deltaBegin = m_deltaEnd;
+			m_objectBegin = m_objectEnd;
+			m_overflow = true;
+			return false;
+		}
+		DropOldestCommand();
+	}
+	return true;
+}
+
+void EditJournal::EndCommand()
+{
+	if (!m_open)
+	{
+		return;
+	}
+	m_open = false;
+	if (m_overflow)
+	{
+		m_overflow = false;
+		return;
+	}
+
+	if (GetCommand(m_commandEnd - 1).deltaCount == 0)
+	{
+		m_commandEnd--;
+		m_commandCurrent = m_commandEnd;
+	}
+}
+
+bool EditJournal::Undo(std::vector<EditDelta> & deltas, std::vector<SceneObject> & objects)
+{
+	EndCommand();
+	deltas.clear();
+	objects.clear();
+	if (m_commandCurrent == m_commandBegin)
+	{
+		return false;
+	}
+
+	m_commandCurrent--;
+	const Command & command = GetCommand(m_commandCurrent);
+	for (int i = command.deltaCount - 1; i >= 0; i--)
+	{
+		deltas.push_back(GetDelta(command.firstDelta + i));
+	}
+	for (int i = command.objectCount - 1; i >= 0; i--)
+	{
+		objects.push_back(GetRow(command.firstObject + i));
+	}
+	return true;
+}
+
+bool EditJournal::Redo(std::vector<EditDelta> & deltas, std::vector<SceneObject> & objects)
+{
+	EndCommand();
+	deltas.clear();
+	objects.clear();
+	if (m_commandCurrent == m_commandEnd)
+	{
+		return false;
+	}
+
+	const Command & command = GetCommand(m_commandCurrent);
+	for (int i = 0; i < command.deltaCount; i++)
+	{
+		deltas.push_back(GetDelta(command.firstDelta + i));
+	}
+	for (int i = 0; i < command.objectCount; i++)
+	{
+		objects.push_back(GetRow(command.firstObject + i));
+	}
+	m_commandCurrent++;
+	return true;
+}
+
+int EditJournal::GetUndoCount() const
+{
+	return (int)(m_commandCurrent - m_commandBegin);
+}
+
+int EditJournal::GetRedoCount() const
+{
+	return (int)(m_commandEnd - m_commandCurrent);
+}
+
+int EditJournal::GetDroppedCount() const
+{
+	return m_droppedCount;
+}
+
+EditJournal::Command & EditJournal::GetCommand(unsigned long long position)
+{
+	return m_commands[(size_t)(position % m_commands.size())];
+}
+
+EditDelta & EditJournal::GetDelta(unsigned long long position)
+{
+	return m_deltas[(size_t)(position % m_deltas.size())];
+}
+
+SceneObject & EditJournal::GetRow(unsigned long long position)
+{
+	return m_objects[(size_t)(position % m_objects.size())];
+}
+
+void EditJournal::DropOldestCommand()
+{
+	m_commandBegin++;
+	m_droppedCount++;
+	m_deltaBegin = m_commandBegin < m_commandEnd ? GetCommand(m_commandBegin).firstDelta : m_deltaEnd;
+	m_objectBegin = m_commandBegin < m_commandEnd ? GetCommand(m_commandBegin).firstObject : m_objectEnd;
+}
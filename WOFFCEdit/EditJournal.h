@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SceneObject.h"
+
+//memory for the undo history, split between the delta, command and object rings
+#define EDIT_JOURNAL_DEFAULT_BYTES (4 * 1024 * 1024)
+//the share of it kept for whole objects, added or removed
+#define EDIT_JOURNAL_OBJECT_SHARE 8
+
+//EditDelta fields that are not SceneObjectFields: the whole object was added or removed, and its row is kept with the delta
+#define EDIT_FIELD_OBJECT_ADDED		-1
+#define EDIT_FIELD_OBJECT_REMOVED	-2
+
+//one field of one object, before and after an edit
+struct EditDelta
+{
+	int		ID;				//SceneObject ID, stable across reloads and display list syncs
+	int		field;			//SceneObjectField, or one of the EDIT_FIELD_OBJECT values
+	float	oldValue;
+	float	newValue;
+};
+
+//The undo / redo history. Every edit is recorded as deltas grouped into commands, and undo or redo hands back just
+//the deltas of one command, so applying it costs as many fields as it changed rather than a copy of the scene.
+//Deltas and command headers live in two fixed rings sized from a byte budget, allocated once. Adding or removing an
+//object records a delta too, with a copy of the whole row in a third ring, an eighth of the budget. When the rings are
+//full the oldest commands are dropped to make room, so the history never grows past the budget, strings aside.
+class EditJournal
+{
+public:
+	EditJournal();
+	~EditJournal();
+
+	void	SetBudget(size_t bytes);		//clears the history
+	size_t	GetBudget() const;
+	void	Clear();
+
+	//commands begun one after another with the same nonzero merge key become one, e.g. every frame of a drag.
+	//beginning a command throws away anything that could have been redone
+	void	BeginCommand(unsigned int mergeKey = 0);
+	void	Record(int ID, int field, float oldValue, float newValue);	//a field already in the command keeps its first old value
+	void	RecordAdded(const SceneObject & object);		//undo removes it, redo adds it back
+	void	RecordRemoved(const SceneObject & object);		//undo adds it back, redo removes it
+	void	EndCommand();				//a command with nothing recorded is discarded
+
+	//objects gets the row of each added or removed object among the deltas, in the same order
+	bool	Undo(std::vector<EditDelta> & deltas, std::vector<SceneObject> & objects);	//the last command, newest delta first. apply each old value
+	bool	Redo(std::vector<EditDelta> & deltas, std::vector<SceneObject> & objects);	//the next command, oldest delta first. apply each new value
+	int		GetUndoCount() const;
+	int		GetRedoCount() const;
+	int		GetDroppedCount() const;	//commands lost to the budget since the last Clear
+
+private:
+	struct Command
+	{
+		unsigned long long	firstDelta;		//position in the delta ring, counting from when it was cleared
+		int					deltaCount;
+		unsigned long long	firstObject;	//position in the object ring
+		int					objectCount;
+		unsigned int		mergeKey;
+	};
+
+	Command &		GetCommand(unsigned long long position);
+	EditDelta &		GetDelta(unsigned long long position);
+	SceneObject &	GetRow(unsigned long long position);
+	void			RecordObject(int field, const SceneObject & object);
+	bool			MakeRoom(bool object);		//drops the oldest commands until a delta, and an object if asked, fit. false if the open command overflowed
+	void			DropOldestCommand();
+
+	std::vector<EditDelta>		m_deltas;		//ring
+	std::vector<Command>		m_commands;		//ring. every command holds at least one delta, so it never needs more slots
+	std::vector<SceneObject>	m_objects;		//ring
+
+	//positions only ever increase, and are wrapped into the rings when read
+	unsigned long long	m_deltaBegin;		//first delta of the oldest command
+	unsigned long long	m_deltaEnd;			//one past the last delta recorded
+	unsigned long long	m_objectBegin;		//first object of the oldest command
+	unsigned long long	m_objectEnd;
+	unsigned long long	m_commandBegin;		//oldest command kept
+	unsigned long long	m_commandCurrent;	//commands before this can be undone, from it on redone
+	unsigned long long	m_commandEnd;
+
+	bool	m_open;				//between BeginCommand and EndCommand
+	bool	m_overflow;			//the open command outgrew the whole budget, so it is not kept
+	int		m_droppedCount;
+};
@@ -0,0 +1,277 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_CULL_SSE
+#endif
+
+
+void Frustum::ExtractFromMatrix(const float viewProjection[16])
+{
+	//clip = (x, y, z, 1) * M, so each clip coordinate is the point dotted with a column.
+	//inside is -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	const float * m = viewProjection;
+	for (int i = 0; i < 4; i++)
+	{
+		const float column0 = m[i * 4 + 0];
+		const float column1 = m[i * 4 + 1];
+		const float column2 = m[i * 4 + 2];
+		const float column3 = m[i * 4 + 3];
+		planes[0][i] = column3 + column0;		//left
+		planes[1][i] = column3 - column0;		//right
+		planes[2][i] = column3 + column1;		//bottom
+		planes[3][i] = column3 - column1;		//top
+		planes[4][i] = column2;					//near
+		planes[5][i] = column3 - column2;		//far
+	}
+
+	for (int plane = 0; plane < 6; plane++)
+	{
+		const float length = std::sqrt(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				planes[plane][i] /= length;
+			}
+		}
+	}
+}
+
+bool Frustum::IntersectsBox(const float center[3], const float extents[3]) const
+{
+	for (int plane = 0; plane < 6; plane++)
+	{
+		const float * p = planes[plane];
+		const float distance = p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3];
+		const float radius = std::fabs(p[0]) * extents[0] + std::fabs(p[1]) * extents[1] + std::fabs(p[2]) * extents[2];
+		if (distance + radius < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+FrustumCuller::FrustumCuller()
+{
+	m_count = 0;
+	m_visibleCount = 0;
+	m_blocks = 0;
+	m_sliceCount = 1;
+	m_generation = 0;
+	m_running = 0;
+	m_stopping = false;
+}
+
+
+FrustumCuller::~FrustumCuller()
+{
+	StopWorkers();
+}
+
+void FrustumCuller::Resize(int count)
+{
+	m_count = count;
+	const size_t padded = (size_t)(count + 3) / 4 * 4;
+	m_centerX.Allocate(padded);
+	m_centerY.Allocate(padded);
+	m_centerZ.Allocate(padded);
+	m_extentX.Allocate(padded);
+	m_extentY.Allocate(padded);
+	m_extentZ.Allocate(padded);
+	m_visible.assign(padded, 0);
+	m_visibleCount = 0;
+}
+
+void FrustumCuller::SetBox(int index, const float center[3], const float extents[3])
+{
+	m_centerX[index] = center[0];
+	m_centerY[index] = center[1];
+	m_centerZ[index] = center[2];
+	m_extentX[index] = extents[0];
+	m_extentY[index] = extents[1];
+	m_extentZ[index] = extents[2];
+}
+
+int FrustumCuller::GetCount() const
+{
+	return m_count;
+}
+
+void FrustumCuller::Cull(const Frustum & frustum)
+{
+	const int blocks = (m_count + 3) / 4;
+	const int threadCount = m_count >= FRUSTUM_CULL_PARALLEL_THRESHOLD
+		? std::min((int)std::max(std::thread::hardware_concurrency(), 1u), FRUSTUM_CULL_MAX_THREADS) : 1;
+
+	if (threadCount <= 1)
+	{
+		CullBlocks(frustum, 0, blocks);
+	}
+	else
+	{
+		if ((int)m_workers.size() != threadCount - 1)
+		{
+			StartWorkers(threadCount - 1);
+		}
+
+		//each thread writes its own range of m_visible, nothing is shared
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_frustum = frustum;
+			m_blocks = blocks;
+			m_sliceCount = threadCount;
+			m_running = (int)m_workers.size();
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		int first, last;
+		GetSliceBlocks(0, first, last);
+		CullBlocks(frustum, first, last);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_finished.wait(lock, [this]() { return m_running == 0; });
+	}
+
+	m_visibleCount = 0;
+	for (int i = 0; i < m_count; i++)
+	{
+		m_visibleCount += m_visible[i];
+	}
+}
+
+bool FrustumCuller::IsVisible(int index) const
+{
+	return m_visible[index] != 0;
+}
+
+int FrustumCuller::GetVisibleCount() const
+{
+	return m_visibleCount;
+}
+
+int FrustumCuller::GetCulledCount() const
+{
+	return m_count - m_visibleCount;
+}
+
+void FrustumCuller::GetSliceBlocks(int slice, int & firstBlock, int & lastBlock) const
+{
+	const int blocksPerSlice = (m_blocks + m_sliceCount - 1) / m_sliceCount;
+	firstBlock = std::min(slice * blocksPerSlice, m_blocks);
+	lastBlock = std::min(firstBlock + blocksPerSlice, m_blocks);
+}
+
+void FrustumCuller::StartWorkers(int count)
+{
+	StopWorkers();
+	m_stopping = false;
+	for (int i = 0; i < count; i++)
+	{
+		m_workers.push_back(std::thread(&FrustumCuller::WorkerMain, this, i + 1, m_generation));
+	}
+}
+
+void FrustumCuller::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+void FrustumCuller::WorkerMain(int slice, unsigned int generation)
+{
+	//generation is the last cull before this worker started, read before the thread was, so a cull started while it was still starting up is not missed
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+		if (m_stopping)
+		{
+			return;
+		}
+		generation = m_generation;
+
+		int first, last;
+		GetSliceBlocks(slice, first, last);
+		lock.unlock();
+		CullBlocks(m_frustum, first, last);
+		lock.lock();
+
+		if (--m_running == 0)
+		{
+			m_finished.notify_one();
+		}
+	}
+}
+
+void FrustumCuller::CullBlocks(const Frustum & frustum, int firstBlock, int lastBlock)
+{
+#ifdef FRUSTUM_CULL_SSE
+	//a box is outside if, for any plane, its centre is further outside than its extents reach back in
+	__m128 planes[6][4];
+	__m128 absolutePlanes[6][3];
+	for (int plane = 0; plane < 6; plane++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			planes[plane][i] = _mm_set1_ps(frustum.planes[plane][i]);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			absolutePlanes[plane][i] = _mm_set1_ps(std::fabs(frustum.planes[plane][i]));
+		}
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int block = firstBlock; block < lastBlock; block++)
+	{
+		const size_t first = (size_t)block * 4;
+		const __m128 centerX = _mm_load_ps(&m_centerX[first]);
+		const __m128 centerY = _mm_load_ps(&m_centerY[first]);
+		const __m128 centerZ = _mm_load_ps(&m_centerZ[first]);
+		const __m128 extentX = _mm_load_ps(&m_extentX[first]);
+		const __m128 extentY = _mm_load_ps(&m_extentY[first]);
+		const __m128 extentZ = _mm_load_ps(&m_extentZ[first]);
+
+		__m128 outside = zero;
+		for (int plane = 0; plane < 6; plane++)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, planes[plane][0]), _mm_mul_ps(centerY, planes[plane][1])),
+				_mm_add_ps(_mm_mul_ps(centerZ, planes[plane][2]), planes[plane][3]));
+			const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, absolutePlanes[plane][0]), _mm_mul_ps(extentY, absolutePlanes[plane][1])),
+				_mm_mul_ps(extentZ, absolutePlanes[plane][2]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		const int outsideMask = _mm_movemask_ps(outside);
+		for (int i = 0; i < 4; i++)
+		{
+			m_visible[first + i] = (outsideMask >> i) & 1 ? 0 : 1;
+		}
+	}
+#else
+	for (int block = firstBlock; block < lastBlock; block++)
+	{
+		for (size_t i = (size_t)block * 4; i < (size_t)block * 4 + 4; i++)
+		{
+			const float center[3] = { m_centerX[i], m_centerY[i], m_centerZ[i] };
+			const float extents[3] = { m_extentX[i], m_extentY[i], m_extentZ[i] };
+			m_visible[i] = frustum.IntersectsBox(center, extents) ? 1 : 0;
+		}
+	}
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AlignedArray.h"
+
+//object counts at or above this are culled on several threads
+#define FRUSTUM_CULL_PARALLEL_THRESHOLD 16384
+#define FRUSTUM_CULL_MAX_THREADS 8
+
+//Six planes, pointing inwards and normalised, so a x + b y + c z + d is the distance inside each
+struct Frustum
+{
+	float	planes[6][4];
+
+	//from a view * projection matrix laid out as DirectXMath has it: row major, for row vectors, clip z from 0 to 1
+	void	ExtractFromMatrix(const float viewProjection[16]);
+	bool	IntersectsBox(const float center[3], const float extents[3]) const;		//axis aligned, false only if fully outside one plane
+};
+
+//Culls a list of axis aligned boxes against a frustum, four at a time with SSE.
+//The boxes are kept as separate arrays of centre and extent components, set once and only updated when objects move,
+//and tested again every frame. Long lists are split across a pool of worker threads, started by the first one and
+//kept waiting between frames, so a frame never pays for creating threads.
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	void	Resize(int count);			//discards the boxes
+	void	SetBox(int index, const float center[3], const float extents[3]);
+	int		GetCount() const;
+
+	void	Cull(const Frustum & frustum);
+	bool	IsVisible(int index) const;		//as of the last Cull
+	int		GetVisibleCount() const;
+	int		GetCulledCount() const;
+
+private:
+	void	CullBlocks(const Frustum & frustum, int firstBlock, int lastBlock);		//four boxes per block, lastBlock exclusive
+	void	GetSliceBlocks(int slice, int & firstBlock, int & lastBlock) const;		//of the current cull, slice 0 is the calling thread's
+	void	StartWorkers(int count);
+	void	StopWorkers();
+	void	WorkerMain(int slice, unsigned int generation);
+
+	int						m_count;
+	AlignedArray<float>		m_centerX, m_centerY, m_centerZ;		//padded to a whole number of blocks
+	AlignedArray<float>		m_extentX, m_extentY, m_extentZ;
+	std::vector<unsigned char>	m_visible;		//per box, padded as above
+	int						m_visibleCount;
+
+	//the pool, each worker culling the same slice of the blocks every time
+	std::vector<std::thread>	m_workers;
+	std::mutex					m_mutex;		//guards everything below
+	std::condition_variable		m_wake;			//a new cull, or stopping
+	std::condition_variable		m_finished;		//the last worker is done
+	Frustum						m_frustum;		//of the current cull
+	int							m_blocks;
+	int							m_sliceCount;	//workers and the calling thread
+	unsigned int				m_generation;	//bumped every parallel cull
+	int							m_running;		//workers still culling
+	bool						m_stopping;
+};
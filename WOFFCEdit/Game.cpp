@@ -7,10 +7,19 @@
 #include "DisplayObject.h"
 #include <sstream>
 #include <iomanip>
+#include <cfloat>
 #include <string>
+#include <unordered_map>
 #include "vendor/imgui/imgui.h"
 #include "vendor/imgui/backends/imgui_impl_win32.h"
 #include "vendor/imgui/backends/imgui_impl_dx11.h"
+#include "InstancedObjectVS.inc"
+
+//display objects given their assets per frame while a level streams in. Creating the device objects is the part that
+//has to stay on the render thread, so it is spread over frames
+#define ASSET_RESOLVES_PER_FRAME 64
+#define ERROR_TEXTURE_PATH "database/data/Error.dds"
+#define OBJECT_INSTANCE_BUFFER_SIZE 4096		//instances the per frame buffer holds, bigger batches are drawn in runs of this many
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -66,6 +75,8 @@ void Game::Initialize(HWND window, int width, int height)
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
 
+    m_assetLoader.Start(0);
+
 #ifdef DXTK_AUDIO
     // Create DirectXTK for Audio objects
     AUDIO_ENGINE_FLAGS eflags = AudioEngine_Default;
@@ -106,6 +117,16 @@ void Game::Tick(InputCommands *Input)
 
 	//copy over the input commands so we have a local version to use elsewhere.
 	m_InputCommands = *Input;
+	if (m_InputCommands.undo)
+	{
+		UndoEdit();
+	}
+	if (m_InputCommands.redo)
+	{
+		RedoEdit();
+	}
+	ApplySceneChanges();
+	ResolvePendingAssets();
     m_timer.Tick([&]()
     {
         Update(m_timer);
@@ -206,7 +227,19 @@ void Game::Update(DX::StepTimer const& timer)
     }
 
     bool wasLMBReleased = m_lmbDownLastFrame == true && mouseState.leftButton == false;
-    if (wasLMBReleased && !ImGui::IsAnyItemHovered())
+    if (m_sculpting)
+    {
+        //the left button sculpts instead of picking
+        if (mouseState.leftButton && !ImGui::GetIO().WantCaptureMouse)
+        {
+            SculptTerrain((float)timer.GetElapsedSeconds(), !m_lmbDownLastFrame);
+        }
+        else if (wasLMBReleased)
+        {
+            SnapFlaggedObjectsToGround();   //end of a stroke, put anything standing on the terrain back on it
+        }
+    }
+    else if (wasLMBReleased && !ImGui::IsAnyItemHovered())
     {
         int selected = PickObjectUnderMouse();
         HandleObjectPicking(selected);
@@ -215,8 +248,14 @@ void Game::Update(DX::StepTimer const& timer)
     m_camera->Update();
     m_batchEffect->SetView(m_camera->GetViewMatrix());
     m_batchEffect->SetWorld(Matrix::Identity);
-	m_displayChunk.m_terrainEffect->SetView(m_camera->GetViewMatrix());
-	m_displayChunk.m_terrainEffect->SetWorld(Matrix::Identity);
+	//pixels per metre of terrain error at a metre away, for the LOD selection
+	const float terrainProjectionScale = m_projection._22 * 0.5f * (float)m_deviceResources->GetOutputSize().bottom;
+	for (auto& chunk : m_displayChunks)
+	{
+		chunk.second->m_terrainEffect->SetView(m_camera->GetViewMatrix());
+		chunk.second->m_terrainEffect->SetWorld(Matrix::Identity);
+		chunk.second->UpdateLOD(m_camera->GetCameraPosition(), terrainProjectionScale);
+	}
 
     m_rmbDownLastFrame = mouseState.rightButton;
     m_lmbDownLastFrame = mouseState.leftButton;
@@ -275,23 +314,34 @@ void Game::Render()
 		DrawGrid(xaxis, yaxis, g_XMZero, 512, 512, Colors::Gray);
 	}
 
+	//cull against the planes of view * projection, before anything is queued
+	Frustum frustum;
+	const Matrix viewProjection = m_camera->GetViewMatrix() * m_projection;
+	frustum.ExtractFromMatrix(&viewProjection._11);
+	UpdateCullBounds();
+	m_frustumCuller.Cull(frustum);
+
 	//RENDER OBJECTS FROM SCENEGRAPH
+	//grouped by model so each mesh is set up once and then drawn for every object using it
+	m_renderQueue.Clear();
 	int numRenderObjects = m_displayList.size();
 	for (int i = 0; i < numRenderObjects; i++)
 	{
-		m_deviceResources->PIXBeginEvent(L"Draw model");
-		const XMVECTORF32 scale = { m_displayList[i].m_scale.x, m_displayList[i].m_scale.y, m_displayList[i].m_scale.z };
-		const XMVECTORF32 translate = { m_displayList[i].m_position.x, m_displayList[i].m_position.y, m_displayList[i].m_position.z };
-
-		//convert degrees into radians for rotation matrix
-		XMVECTOR rotate = Quaternion::CreateFromYawPitchRoll(m_displayList[i].m_orientation.y *3.1415 / 180,
-															m_displayList[i].m_orientation.x *3.1415 / 180,
-															m_displayList[i].m_orientation.z *3.1415 / 180);
-
-		XMMATRIX local = m_world * XMMatrixTransformation(g_XMZero, Quaternion::Identity, scale, g_XMZero, rotate, translate);
-
-		m_displayList[i].m_model->Draw(context, *m_states, local, m_camera->GetViewMatrix(), m_projection, false);	//last variable in draw,  make TRUE for wireframe
+		if (m_displayList[i].m_model && m_frustumCuller.IsVisible(i))		//no model while still loading, or if the mesh failed to load
+		{
+			m_renderQueue.Add(m_displayList[i].m_model.get(), i);
+		}
+	}
+	m_renderQueue.Sort();
 
+	m_renderStatistics = RenderStatistics();
+	m_renderStatistics.visibleObjects = m_frustumCuller.GetVisibleCount();
+	m_renderStatistics.culledObjects = m_frustumCuller.GetCulledCount();
+	const std::vector<RenderQueue::Batch>& batches = m_renderQueue.GetBatches();
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		m_deviceResources->PIXBeginEvent(L"Draw model");
+		DrawModelBatch(*m_displayList[m_renderQueue.GetInstances()[batches[i].first]].m_model, &m_renderQueue.GetInstances()[batches[i].first], batches[i].count);
 		m_deviceResources->PIXEndEvent();
 	}
     m_deviceResources->PIXEndEvent();
@@ -303,7 +353,13 @@ void Game::Render()
 //	context->RSSetState(m_states->Wireframe());		//uncomment for wireframe
 
 	//Render the batch,  This is handled in the Display chunk becuase it has the potential to get complex
-	m_displayChunk.RenderBatch(m_deviceResources);
+	for (auto& chunk : m_displayChunks)
+	{
+		chunk.second->SetFrustum(frustum);
+		chunk.second->RenderBatch(m_deviceResources);
+		m_renderStatistics.terrainTriangles += chunk.second->GetTriangleCount();
+		m_renderStatistics.terrainNodesCulled += chunk.second->GetCulledNodeCount();
+	}
 
     DirectX::Mouse::State mouseState = m_mouse->GetState();
     //CAMERA POSITION ON HUD
@@ -433,269 +489,1143 @@ void Game::OnWindowSizeChanged(int width, int height)
     CreateWindowSizeDependentResources();
 }
 
-void Game::BuildDisplayList(std::vector<SceneObject> * SceneGraph)
+void Game::SetSceneGraph(SceneStore * SceneGraph)
 {
-	auto device = m_deviceResources->GetD3DDevice();
-	auto devicecontext = m_deviceResources->GetD3DDeviceContext();
+	m_sceneGraph = SceneGraph;
+}
+
+void Game::SyncDisplayList(const SceneStore * SceneGraph)
+{
+	//objects are matched on ID. While the two lists line up each object is patched where it is, only the fields that
+	//differ, so its model, texture and matrices survive. From the first mismatch on, the old objects are moved aside and
+	//taken back by ID, anything not matched is created, and whatever is left over is released
+	const int numObjects = SceneGraph->GetCount();
+	const int * IDs = SceneGraph->GetIDs();
+	const int previousCount = (int)m_displayList.size();
+	int lined = 0;
+	while (lined < numObjects && lined < previousCount && m_displayList[lined].m_ID == IDs[lined])
+	{
+		lined++;
+	}
 
-	if (!m_displayList.empty())		//is the vector empty
+	std::vector<DisplayObject> previousDisplayList(std::make_move_iterator(m_displayList.begin() + lined), std::make_move_iterator(m_displayList.end()));
+	m_displayList.erase(m_displayList.begin() + lined, m_displayList.end());
+	m_displayList.reserve(SceneGraph->GetCapacity());
+	std::unordered_map<int, int> oldIndices;		//ID to index in previousDisplayList
+	oldIndices.reserve(previousDisplayList.size());
+	for (int i = 0; i < (int)previousDisplayList.size(); i++)
 	{
-		m_displayList.clear();		//if not, empty it
+		oldIndices.insert(std::make_pair(previousDisplayList[i].m_ID, i));
+	}
+	std::vector<int> newIndices(previousCount, -1);		//old display list index to new
+	for (int i = 0; i < lined; i++)
+	{
+		newIndices[i] = i;
 	}
 
-	//for every item in the scenegraph
-	int numObjects = SceneGraph->size();
+	bool structureChanged = numObjects != previousCount || lined < numObjects;
+	bool assetsChanged = false;
+	std::vector<int> moved;
+	std::vector<int> snapObjects;
+	std::vector<int> assetObjects;
 	for (int i = 0; i < numObjects; i++)
 	{
-		
-		//create a temp display object that we will populate then append to the display list.
-		DisplayObject newDisplayObject;
-		
-		//load model
-		std::wstring modelwstr = StringToWCHART(SceneGraph->at(i).model_path);							//convect string to Wchar
-		newDisplayObject.m_model = Model::CreateFromCMO(device, modelwstr.c_str(), *m_fxFactory, true);	//get DXSDK to load model "False" for LH coordinate system (maya)
+		int changes = DISPLAY_OBJECT_ADDED;
+		if (i < lined)
+		{
+			changes = PatchDisplayObject(m_displayList[i], SceneGraph, i);
+		}
+		else
+		{
+			auto found = oldIndices.find(IDs[i]);
+			if (found != oldIndices.end())
+			{
+				m_displayList.push_back(std::move(previousDisplayList[found->second]));
+				newIndices[lined + found->second] = i;
+				oldIndices.erase(found);
+				changes = PatchDisplayObject(m_displayList.back(), SceneGraph, i);
+			}
+			else
+			{
+				m_displayList.push_back(DisplayObject());
+				PatchDisplayObject(m_displayList.back(), SceneGraph, i);
+			}
+		}
 
-		//Load Texture
-		std::wstring texturewstr = StringToWCHART(SceneGraph->at(i).tex_diffuse_path);								//convect string to Wchar
-		HRESULT rs;
-		rs = CreateDDSTextureFromFile(device, texturewstr.c_str(), nullptr, &newDisplayObject.m_texture_diffuse);	//load tex into Shader resource
+		structureChanged |= (changes & DISPLAY_OBJECT_REPARENTED) != 0;
+		if (changes & DISPLAY_OBJECT_MOVED)
+		{
+			moved.push_back(i);
+		}
+		if (changes & (DISPLAY_OBJECT_ADDED | DISPLAY_OBJECT_ASSETS_CHANGED))
+		{
+			assetObjects.push_back(i);
+			assetsChanged |= (changes & DISPLAY_OBJECT_ASSETS_CHANGED) != 0;
+		}
+		if (m_displayList[i].m_snapToGround && (changes & (DISPLAY_OBJECT_ADDED | DISPLAY_OBJECT_MOVED | DISPLAY_OBJECT_SNAPPED)))
+		{
+			snapObjects.push_back(i);
+		}
+	}
 
-		//if texture fails.  load error default
-		if (rs)
+	//selection and anything waiting on the loader follow their objects. a wait for assets the object no longer uses is dropped
+	std::vector<int> picked;
+	for (size_t i = 0; i < m_pickedObjects.size(); i++)
+	{
+		const int index = newIndices[m_pickedObjects[i]];
+		if (index != -1)
 		{
-			CreateDDSTextureFromFile(device, L"database/data/Error.dds", nullptr, &newDisplayObject.m_texture_diffuse);	//load tex into Shader resource
+			picked.push_back(index);
 		}
+	}
+	m_pickedObjects.swap(picked);
 
-		//apply new texture to models effect
-		newDisplayObject.m_model->UpdateEffects([&](IEffect* effect) //This uses a Lambda function,  if you dont understand it: Look it up.
-		{	
-			auto lights = dynamic_cast<BasicEffect*>(effect);
-			if (lights)
-			{
-				lights->SetTexture(newDisplayObject.m_texture_diffuse);			
-			}
-		});
-
-		//set position
-		newDisplayObject.m_position.x = SceneGraph->at(i).posX;
-		newDisplayObject.m_position.y = SceneGraph->at(i).posY;
-		newDisplayObject.m_position.z = SceneGraph->at(i).posZ;
-		
-		//setorientation
-		newDisplayObject.m_orientation.x = SceneGraph->at(i).rotX;
-		newDisplayObject.m_orientation.y = SceneGraph->at(i).rotY;
-		newDisplayObject.m_orientation.z = SceneGraph->at(i).rotZ;
-
-		//set scale
-		newDisplayObject.m_scale.x = SceneGraph->at(i).scaX;
-		newDisplayObject.m_scale.y = SceneGraph->at(i).scaY;
-		newDisplayObject.m_scale.z = SceneGraph->at(i).scaZ;
-
-		//set wireframe / render flags
-		newDisplayObject.m_render		= SceneGraph->at(i).editor_render;
-		newDisplayObject.m_wireframe	= SceneGraph->at(i).editor_wireframe;
-
-		newDisplayObject.m_light_type		= SceneGraph->at(i).light_type;
-		newDisplayObject.m_light_diffuse_r	= SceneGraph->at(i).light_diffuse_r;
-		newDisplayObject.m_light_diffuse_g	= SceneGraph->at(i).light_diffuse_g;
-		newDisplayObject.m_light_diffuse_b	= SceneGraph->at(i).light_diffuse_b;
-		newDisplayObject.m_light_specular_r = SceneGraph->at(i).light_specular_r;
-		newDisplayObject.m_light_specular_g = SceneGraph->at(i).light_specular_g;
-		newDisplayObject.m_light_specular_b = SceneGraph->at(i).light_specular_b;
-		newDisplayObject.m_light_spot_cutoff = SceneGraph->at(i).light_spot_cutoff;
-		newDisplayObject.m_light_constant	= SceneGraph->at(i).light_constant;
-		newDisplayObject.m_light_linear		= SceneGraph->at(i).light_linear;
-		newDisplayObject.m_light_quadratic	= SceneGraph->at(i).light_quadratic;
-		
-		m_displayList.push_back(newDisplayObject);
-		
-	}
-		
-		
-		
+	std::deque<PendingObject> pendingObjects;
+	for (size_t i = 0; i < m_pendingObjects.size(); i++)
+	{
+		PendingObject pending = m_pendingObjects[i];
+		pending.index = newIndices[pending.index];
+		if (pending.index != -1 && pending.modelPath == m_displayList[pending.index].m_modelPath
+			&& pending.texturePath == m_displayList[pending.index].m_texturePath)
+		{
+			pendingObjects.push_back(pending);
+		}
+	}
+	m_pendingObjects.swap(pendingObjects);
+
+	for (size_t i = 0; i < assetObjects.size(); i++)
+	{
+		RequestObjectAssets(assetObjects[i]);
+	}
+
+	if (structureChanged)
+	{
+		RebuildHierarchy();
+		m_objectBVHRebuild = true;
+		m_cullBoundsDirty = true;
+	}
+	else if (!moved.empty())
+	{
+		for (size_t i = 0; i < moved.size(); i++)
+		{
+			m_hierarchy.SetLocal(moved[i], &m_displayList[moved[i]].m_local._11);
+		}
+		std::vector<int> changed;
+		UpdateObjectTransforms(changed);
+	}
+	SnapObjectsToGround(snapObjects);
+
+	//models and textures only the released objects used go with them
+	const bool released = !oldIndices.empty();
+	previousDisplayList.clear();
+	if (released || assetsChanged)
+	{
+		if (m_pendingObjects.empty())
+		{
+			m_assetLoader.ReleaseData();
+		}
+		m_modelCache.Purge();
+		m_textureCache.Purge();
+		PruneInstancedEffects();
+	}
 }
 
-void Game::BuildDisplayChunk(ChunkObject * SceneChunk)
+void Game::AppendDisplayList(const SceneStore * SceneGraph, int firstObject)
 {
-	//populate our local DISPLAYCHUNK with all the chunk info we need from the object stored in toolmain
-	//which, to be honest, is almost all of it. Its mostly rendering related info so...
-	m_displayChunk.PopulateChunkData(SceneChunk);		//migrate chunk data
-	m_displayChunk.LoadHeightMap(m_deviceResources);
-	m_displayChunk.m_terrainEffect->SetProjection(m_projection);
-	m_displayChunk.InitialiseBatch();
+	//for every new item in the scenegraph
+	int numObjects = SceneGraph->GetCount();
+	m_displayList.reserve(SceneGraph->GetCapacity());	//the scenegraph is sized for the whole level, so batches do not reallocate
+	m_objectBVHRebuild = true;
+	m_cullBoundsDirty = true;
+	std::vector<int> snapObjects;
+	const int * IDs = SceneGraph->GetIDs();
+	const int firstIndex = (int)m_displayList.size();
+	m_hierarchy.Reserve(SceneGraph->GetCapacity());
+	for (int i = firstObject; i < numObjects; i++)
+	{
+		//an object displayed before a reload is taken back and patched, keeping its model and texture.
+		//anything else starts from a fresh display object
+		auto detached = m_detachedIndices.find(IDs[i]);
+		int changes = DISPLAY_OBJECT_ADDED;
+		if (detached != m_detachedIndices.end())
+		{
+			m_displayList.push_back(std::move(m_detachedObjects[detached->second]));
+			m_detachedIndices.erase(detached);
+			changes = PatchDisplayObject(m_displayList.back(), SceneGraph, i);
+		}
+		else
+		{
+			m_displayList.push_back(DisplayObject());
+			PatchDisplayObject(m_displayList.back(), SceneGraph, i);
+		}
+
+		const int index = (int)m_displayList.size() - 1;
+		if (m_displayList[index].m_snapToGround)
+		{
+			snapObjects.push_back(index);
+		}
+
+		//assets already in the cache are attached straight away, anything else is read in the background and attached
+		//by ResolvePendingAssets. Until then the object is in the list but has no model, so it is not drawn
+		if ((changes & (DISPLAY_OBJECT_ADDED | DISPLAY_OBJECT_ASSETS_CHANGED)) || !m_displayList[index].m_model)
+		{
+			RequestObjectAssets(index);
+		}
+	}
+
+	//the new objects are linked among themselves and go on the end of the hierarchy, so only they are recomputed.
+	//a link to or from an object appended earlier would move that object's subtree, so it waits for FinishDisplayList
+	//and one rebuild at the end of the load, rather than one per batch
+	const int count = (int)m_displayList.size();
+	for (int i = firstIndex; i < count; i++)
+	{
+		m_objectIndices.insert(std::make_pair(m_displayList[i].m_ID, i));
+	}
+	std::vector<int> parents(count - firstIndex, TRANSFORM_HIERARCHY_NO_PARENT);
+	for (int i = firstIndex; i < count; i++)
+	{
+		const DisplayObject& object = m_displayList[i];
+		m_hierarchyRelink |= m_unlinkedParentIDs.count(object.m_ID) != 0;
+		auto parent = m_objectIndices.find(object.m_parentID);
+		if (parent == m_objectIndices.end())
+		{
+			m_unlinkedParentIDs.insert(object.m_parentID);
+		}
+		else if (parent->second >= firstIndex)
+		{
+			parents[i - firstIndex] = parent->second;
+		}
+		else
+		{
+			m_hierarchyRelink = true;
+		}
+	}
+	m_hierarchy.Append(parents);
+	for (int i = firstIndex; i < count; i++)
+	{
+		m_hierarchy.SetLocal(i, &m_displayList[i].m_local._11);
+	}
+	std::vector<int> moved;
+	UpdateObjectTransforms(moved);
+	SnapObjectsToGround(snapObjects);		//if its chunk is not resident yet, BuildDisplayChunk snaps it when it is
 }
 
-void Game::SaveDisplayChunk(ChunkObject * SceneChunk)
+void Game::DetachDisplayList()
 {
-	m_displayChunk.SaveHeightMap();			//save heightmap to file.
+	//objects are set aside by ID rather than released, so a reload that brings them back only patches them.
+	//anything still detached from an earlier reload is released first
+	m_detachedObjects.clear();
+	m_detachedObjects.swap(m_displayList);
+	m_detachedIndices.clear();
+	m_detachedIndices.reserve(m_detachedObjects.size());
+	for (int i = 0; i < (int)m_detachedObjects.size(); i++)
+	{
+		m_detachedIndices.insert(std::make_pair(m_detachedObjects[i].m_ID, i));
+	}
+	m_pickedObjects.clear();		//selection is by display list index, which is no longer valid
+	m_pendingObjects.clear();		//so is anything still waiting on its assets. a detached object asks again when it returns
+	m_pendingObjectTotal = 0;
+	m_hierarchy.Clear();
+	m_objectIndices.clear();
+	m_unlinkedParentIDs.clear();
+	m_hierarchyRelink = false;
+	m_editJournal.Clear();			//the reload puts back what was saved, which the history no longer leads to
+	m_objectBVHRebuild = true;
+	m_cullBoundsDirty = true;
 }
 
-const std::vector<int>& Game::GetPickedObjects()
+void Game::ReleaseDetachedObjects()
 {
-    return m_pickedObjects;
+	if (m_detachedObjects.empty())
+	{
+		return;
+	}
+
+	m_detachedObjects.clear();
+	m_detachedIndices.clear();
+	if (m_pendingObjects.empty())
+	{
+		m_assetLoader.ReleaseData();	//reads left over from the old list
+	}
+	m_modelCache.Purge();
+	m_textureCache.Purge();
+	PruneInstancedEffects();
 }
 
-#ifdef DXTK_AUDIO
-void Game::NewAudioDevice()
+int Game::PatchDisplayObject(DisplayObject& object, const SceneStore * SceneGraph, int index)
 {
-    if (m_audEngine && !m_audEngine->IsAudioDevicePresent())
-    {
-        // Setup a retry in 1 second
-        m_audioTimerAcc = 1.f;
-        m_retryDefault = true;
-    }
+	int changes = 0;
+	object.m_ID = SceneGraph->GetIDs()[index];
+
+	const Vector3 position(SceneGraph->GetPositionX()[index], SceneGraph->GetPositionY()[index], SceneGraph->GetPositionZ()[index]);
+	const Vector3 orientation(SceneGraph->GetRotationX()[index], SceneGraph->GetRotationY()[index], SceneGraph->GetRotationZ()[index]);
+	const Vector3 scale(SceneGraph->GetScaleX()[index], SceneGraph->GetScaleY()[index], SceneGraph->GetScaleZ()[index]);
+	if (position != object.m_position || orientation != object.m_orientation || scale != object.m_scale)
+	{
+		object.m_position = position;
+		object.m_orientation = orientation;
+		object.m_scale = scale;
+		object.MarkTransformDirty();
+		changes |= DISPLAY_OBJECT_MOVED;
+	}
+
+	const int parentID = SceneGraph->GetParentIDs()[index];
+	if (parentID != object.m_parentID)
+	{
+		object.m_parentID = parentID;
+		changes |= DISPLAY_OBJECT_REPARENTED;
+	}
+
+	//set wireframe / render flags
+	const unsigned int flags = SceneGraph->GetFlags()[index];
+	const bool snapToGround = (flags & SCENE_OBJECT_SNAP_TO_GROUND) != 0;
+	if (snapToGround && !object.m_snapToGround)
+	{
+		changes |= DISPLAY_OBJECT_SNAPPED;
+	}
+	object.m_render			= (flags & SCENE_OBJECT_EDITOR_RENDER) != 0;
+	object.m_wireframe		= (flags & SCENE_OBJECT_EDITOR_WIREFRAME) != 0;
+	object.m_snapToGround	= snapToGround;
+
+	const SceneObjectDetail & detail = SceneGraph->GetDetail(index);
+	object.m_light_type			= detail.light_type;
+	object.m_light_diffuse_r	= detail.light_diffuse_r;
+	object.m_light_diffuse_g	= detail.light_diffuse_g;
+	object.m_light_diffuse_b	= detail.light_diffuse_b;
+	object.m_light_specular_r	= detail.light_specular_r;
+	object.m_light_specular_g	= detail.light_specular_g;
+	object.m_light_specular_b	= detail.light_specular_b;
+	object.m_light_spot_cutoff	= detail.light_spot_cutoff;
+	object.m_light_constant		= detail.light_constant;
+	object.m_light_linear		= detail.light_linear;
+	object.m_light_quadratic	= detail.light_quadratic;
+
+	//the model stays on screen until the new files are read. the paths are interned, so this compares handles, not strings
+	if (detail.model_path != object.m_modelPath || detail.tex_diffuse_path != object.m_texturePath)
+	{
+		object.m_modelPath = detail.model_path;
+		object.m_texturePath = detail.tex_diffuse_path;
+		changes |= DISPLAY_OBJECT_ASSETS_CHANGED;
+	}
+
+	object.UpdateLocalTransform();
+	return changes;
 }
-#endif
 
+void Game::RequestObjectAssets(int index)
+{
+	PendingObject pending;
+	pending.index = index;
+	pending.modelPath = m_displayList[index].m_modelPath;
+	pending.texturePath = m_displayList[index].m_texturePath;
+	if (!ResolveObjectAssets(pending))
+	{
+		const StringPool & strings = StringPool::Global();
+		m_assetLoader.Request(strings.GetString(pending.texturePath));
+		m_assetLoader.Request(strings.GetString(pending.modelPath));
+		m_pendingObjects.push_back(pending);
+		m_pendingObjectTotal++;
+	}
+}
 
-#pragma endregion
+void Game::FinishDisplayList()
+{
+	if (m_hierarchyRelink)
+	{
+		RebuildHierarchy();
+	}
+}
 
-#pragma region Direct3D Resources
-// These are the resources that depend on the device.
-void Game::CreateDeviceDependentResources()
+void Game::RebuildHierarchy()
 {
-    auto context = m_deviceResources->GetD3DDeviceContext();
-    auto device = m_deviceResources->GetD3DDevice();
+	//parents are stored by ID, the hierarchy wants display list indices
+	m_objectIndices.clear();
+	m_objectIndices.reserve(m_displayList.size());
+	for (int i = 0; i < (int)m_displayList.size(); i++)
+	{
+		m_objectIndices.insert(std::make_pair(m_displayList[i].m_ID, i));
+	}
 
-    m_states = std::make_unique<CommonStates>(device);
+	m_unlinkedParentIDs.clear();
+	std::vector<int> parents(m_displayList.size(), TRANSFORM_HIERARCHY_NO_PARENT);
+	for (int i = 0; i < (int)m_displayList.size(); i++)
+	{
+		auto parent = m_objectIndices.find(m_displayList[i].m_parentID);
+		if (parent != m_objectIndices.end())
+		{
+			parents[i] = parent->second;
+		}
+		else
+		{
+			m_unlinkedParentIDs.insert(m_displayList[i].m_parentID);
+		}
+	}
+	m_hierarchyRelink = false;
 
-    m_fxFactory = std::make_unique<EffectFactory>(device);
-	m_fxFactory->SetDirectory(L"database/data/"); //fx Factory will look in the database directory
-	m_fxFactory->SetSharing(false);	//we must set this to false otherwise it will share effects based on the initial tex loaded (When the model loads) rather than what we will change them to.
+	m_hierarchy.Build(parents);
+	for (int i = 0; i < (int)m_displayList.size(); i++)
+	{
+		m_displayList[i].UpdateLocalTransform();
+		m_hierarchy.SetLocal(i, &m_displayList[i].m_local._11);
+	}
+	std::vector<int> moved;
+	UpdateObjectTransforms(moved);
+}
 
-    m_sprites = std::make_unique<SpriteBatch>(context);
+void Game::MoveObject(int index)
+{
+	DisplayObject& object = m_displayList[index];
+	object.MarkTransformDirty();
+	object.UpdateLocalTransform();
+	m_hierarchy.SetLocal(index, &object.m_local._11);
 
-    m_batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(context);
+	std::vector<int> moved;
+	UpdateObjectTransforms(moved);
 
-    m_batchEffect = std::make_unique<BasicEffect>(device);
-    m_batchEffect->SetVertexColorEnabled(true);
+	//children kept on the ground have been carried off it by their parent, so put them back
+	for (size_t i = 0; i < moved.size(); i++)
+	{
+		if (moved[i] != index && m_displayList[moved[i]].m_snapToGround)
+		{
+			SnapToGround(moved[i]);
+		}
+	}
+}
 
-    {
-        void const* shaderByteCode;
-        size_t byteCodeLength;
+void Game::UpdateObjectTransforms(std::vector<int>& moved)
+{
+	//only the subtrees under objects that moved are recomputed
+	const size_t first = moved.size();
+	m_hierarchy.Update(moved);
+	for (size_t i = first; i < moved.size(); i++)
+	{
+		m_displayList[moved[i]].SetWorld(Matrix(m_hierarchy.GetWorld(moved[i])));
+	}
+	if (moved.size() > first)
+	{
+		m_objectBVHRefit = true;
+		m_cullBoundsDirty = true;
+	}
+}
 
-        m_batchEffect->GetVertexShaderBytecode(&shaderByteCode, &byteCodeLength);
+void Game::ResolvePendingAssets()
+{
+	//in request order, which is roughly the order the workers finish in. Stops at the first object still waiting
+	//on a read, and after a fixed number per frame so a big level fills in without stalling the editor
+	int resolved = 0;
+	while (!m_pendingObjects.empty() && resolved < ASSET_RESOLVES_PER_FRAME)
+	{
+		if (!ResolveObjectAssets(m_pendingObjects.front()))
+		{
+			break;
+		}
+		m_pendingObjects.pop_front();
+		resolved++;
+	}
 
-        DX::ThrowIfFailed(
-            device->CreateInputLayout(VertexPositionColor::InputElements,
-                VertexPositionColor::InputElementCount,
-                shaderByteCode, byteCodeLength,
-                m_batchInputLayout.ReleaseAndGetAddressOf())
-        );
-    }
+	if (m_pendingObjects.empty() && m_pendingObjectTotal > 0)
+	{
+		m_pendingObjectTotal = 0;
+		m_assetLoader.ReleaseData();	//everything read has been turned into device objects
+	}
+}
 
-    m_font = std::make_unique<SpriteFont>(device, L"SegoeUI_18.spritefont");
+bool Game::ResolveObjectAssets(const PendingObject& pending)
+{
+	auto device = m_deviceResources->GetD3DDevice();
 
-//    m_shape = GeometricPrimitive::CreateTeapot(context, 4.f, 8);
+	//only the device objects are created here, from bytes the loader has already read
+	AssetCache<ID3D11ShaderResourceView>::Loader textureLoader = [&](const std::string & path, size_t & bytes) -> std::shared_ptr<ID3D11ShaderResourceView>
+	{
+		AssetLoader::FileData data = m_assetLoader.GetData(path);
+		if (!data)
+		{
+			return nullptr;
+		}
 
-    // SDKMESH has to use clockwise winding with right-handed coordinates, so textures are flipped in U
-    m_model = Model::CreateFromSDKMESH(device, L"tiny.sdkmesh", *m_fxFactory);
-	
+		ID3D11ShaderResourceView * texture = NULL;
+		HRESULT rs;
+		rs = CreateDDSTextureFromMemory(device, data->data(), data->size(), nullptr, &texture);	//load tex into Shader resource
+		if (FAILED(rs) || !texture)
+		{
+			return nullptr;
+		}
 
-    // Load textures
-    DX::ThrowIfFailed(
-        CreateDDSTextureFromFile(device, L"seafloor.dds", nullptr, m_texture1.ReleaseAndGetAddressOf())
-    );
+		bytes = data->size();		//a DDS is uploaded as stored, so its size in the file is a fair measure of its size on the GPU
+		return std::shared_ptr<ID3D11ShaderResourceView>(texture, [](ID3D11ShaderResourceView * view) { view->Release(); });
+	};
 
-    DX::ThrowIfFailed(
-        CreateDDSTextureFromFile(device, L"windowslogo.dds", nullptr, m_texture2.ReleaseAndGetAddressOf())
-    );
+	//Load Texture. the cache hands back the same view for every object using the file, and remembers failures
+	const std::string & modelPath = StringPool::Global().GetString(pending.modelPath);
+	std::string texturePath = StringPool::Global().GetString(pending.texturePath);
+	if (!m_textureCache.Contains(texturePath) && !m_assetLoader.IsComplete(texturePath))
+	{
+		return false;
+	}
+	std::shared_ptr<ID3D11ShaderResourceView> texture = m_textureCache.Get(texturePath, textureLoader);
 
-}
+	//if texture fails.  load error default
+	if (!texture)
+	{
+		texturePath = ERROR_TEXTURE_PATH;
+		if (!m_textureCache.Contains(texturePath) && !m_assetLoader.IsComplete(texturePath))
+		{
+			m_assetLoader.Request(texturePath);
+			return false;
+		}
+		texture = m_textureCache.Get(texturePath, textureLoader);
+	}
 
-// Allocate all memory resources that change on a window SizeChanged event.
-void Game::CreateWindowSizeDependentResources()
-{
-    auto size = m_deviceResources->GetOutputSize();
-    float aspectRatio = float(size.right) / float(size.bottom);
-    float fovAngleY = 70.0f * XM_PI / 180.0f;
+	//load model. the texture is baked into the model's effects, so a model is shared only by objects that also share the texture
+	const std::string modelKey = modelPath + "|" + texturePath;
+	if (!m_modelCache.Contains(modelKey) && !m_assetLoader.IsComplete(modelPath))
+	{
+		return false;
+	}
+	std::shared_ptr<Model> model = m_modelCache.Get(modelKey, [&](const std::string &, size_t & bytes) -> std::shared_ptr<Model>
+	{
+		AssetLoader::FileData data = m_assetLoader.GetData(modelPath);
+		if (!data)
+		{
+			return nullptr;
+		}
 
-    // This is a simple example of change that can be made when the app is in
-    // portrait or snapped view.
-    if (aspectRatio < 1.0f)
-    {
-        fovAngleY *= 2.0f;
-    }
+		std::shared_ptr<Model> loadedModel = Model::CreateFromCMO(device, data->data(), data->size(), *m_fxFactory, true);	//get DXSDK to load model "False" for LH coordinate system (maya)
 
-    // This sample makes use of a right-handed coordinate system using row-major matrices.
-    m_projection = Matrix::CreatePerspectiveFieldOfView(
-        fovAngleY,
-        aspectRatio,
-        0.01f,
-        1000.0f
-    );
+		//apply new texture to models effect. Each BasicEffect is also set to what InstancedObjectVS stands in for,
+		//which is what EffectFactory gives a CMO anyway, and remembered so DrawModelBatch knows it may instance it
+		for (size_t i = 0; i < loadedModel->meshes.size(); i++)
+		{
+			for (size_t j = 0; j < loadedModel->meshes[i]->meshParts.size(); j++)
+			{
+				const std::shared_ptr<IEffect>& effect = loadedModel->meshes[i]->meshParts[j]->effect;
+				auto lights = dynamic_cast<BasicEffect*>(effect.get());
+				if (lights)
+				{
+					lights->SetTexture(texture.get());
+					lights->SetLightingEnabled(true);
+					lights->SetPerPixelLighting(false);
+					lights->SetVertexColorEnabled(true);
+					m_instancedEffects[effect.get()] = effect;
+				}
+			}
+		}
 
-    m_batchEffect->SetProjection(m_projection);
-	
+		bytes = GetModelBytes(*loadedModel);
+		return loadedModel;
+	});
+
+	DisplayObject& object = m_displayList[pending.index];
+	object.m_texture_diffuse = texture;
+	object.m_model = model;
+	object.UpdateBounds();		//the bounds come from the model
+	m_objectBVHRefit = true;
+	m_cullBoundsDirty = true;
+	return true;
 }
 
-int Game::PickObjectUnderMouse()
+void Game::GetAssetLoadProgress(int& loaded, int& total) const
 {
-    int selectedID = -1;
-    float pickedDistance = 9999999.f;
+	total = m_pendingObjectTotal;
+	loaded = m_pendingObjectTotal - (int)m_pendingObjects.size();
+}
 
-    const RECT sreenDimensions = m_deviceResources->GetOutputSize();
-    const DirectX::Mouse::State state = m_mouse->GetState();
-    const XMVECTOR nearSource = XMVectorSet(state.x, state.y, 0.f, 1.f);
-    const XMVECTOR farSource = XMVectorSet(state.x, state.y, 1.f, 1.f);
+size_t Game::GetModelBytes(const Model & model)
+{
+	//mesh parts usually share their mesh's buffers, so count each buffer once
+	std::vector<ID3D11Buffer*> buffers;
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		for (size_t j = 0; j < model.meshes[i]->meshParts.size(); j++)
+		{
+			const ModelMeshPart & part = *model.meshes[i]->meshParts[j];
+			buffers.push_back(part.vertexBuffer.Get());
+			buffers.push_back(part.indexBuffer.Get());
+		}
+	}
+	std::sort(buffers.begin(), buffers.end());
+	buffers.erase(std::unique(buffers.begin(), buffers.end()), buffers.end());
+
+	size_t bytes = 0;
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		if (buffers[i])
+		{
+			D3D11_BUFFER_DESC desc;
+			buffers[i]->GetDesc(&desc);
+			bytes += desc.ByteWidth;
+		}
+	}
+	return bytes;
+}
+
+void Game::DrawModelBatch(const Model& model, const int* objectIndices, int count)
+{
+	//the same work as Model::Draw, turned inside out: states, buffers and layout are set once per mesh part.
+	//A part drawn with one of the BasicEffects ResolveObjectAssets set up, which is every part of an unskinned CMO model,
+	//then draws all the objects in one call, their world matrices in the instance buffer and InstancedObjectVS standing in
+	//for the effect's vertex shader. Any other effect, or a device that cannot instance, gets the effect applied and a
+	//draw per object.
+	//Opaque parts first, then alpha, as Model::Draw does
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	const XMMATRIX view = m_camera->GetViewMatrix();
+
+	for (int first = 0; first < count; first += OBJECT_INSTANCE_BUFFER_SIZE)
+	{
+		const int runCount = std::min(count - first, OBJECT_INSTANCE_BUFFER_SIZE);
+		const int* runObjects = objectIndices + first;
+		const int firstInstance = m_instanceBuffer ? WriteObjectInstances(runObjects, runCount) : -1;
+		int parts = 0;
+		int instancedParts = 0;
+
+		for (int alphaPass = 0; alphaPass < 2; alphaPass++)
+		{
+			const bool alpha = alphaPass == 1;
+			for (size_t i = 0; i < model.meshes.size(); i++)
+			{
+				const ModelMesh& mesh = *model.meshes[i];
+				bool prepared = false;
+				for (size_t j = 0; j < mesh.meshParts.size(); j++)
+				{
+					const ModelMeshPart& part = *mesh.meshParts[j];
+					if (part.isAlpha != alpha)
+					{
+						continue;
+					}
+					if (!prepared)
+					{
+						mesh.PrepareForRendering(context, *m_states, alpha, false);	//make TRUE for wireframe
+						prepared = true;
+					}
+
+					ID3D11Buffer* vertexBuffer = part.vertexBuffer.Get();
+					UINT vertexStride = part.vertexStride;
+					UINT vertexOffset = 0;
+					context->IASetInputLayout(part.inputLayout.Get());
+					context->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
+					context->IASetIndexBuffer(part.indexBuffer.Get(), part.indexFormat, 0);
+					context->IASetPrimitiveTopology(part.primitiveType);
+					parts++;
+
+					IEffectMatrices* matrices = dynamic_cast<IEffectMatrices*>(part.effect.get());
+					if (matrices)
+					{
+						matrices->SetView(view);
+						matrices->SetProjection(m_projection);
+					}
+
+					//the effect's constants, texture and pixel shader are used as they are, with an identity world so
+					//its WorldViewProj is view * projection. Only the vertex shader and input layout are swapped
+					BasicEffect* basicEffect = dynamic_cast<BasicEffect*>(part.effect.get());
+					if (basicEffect && firstInstance != -1 && part.vertexStride == sizeof(VertexPositionNormalTangentColorTexture) && IsInstancedEffect(part.effect))
+					{
+						basicEffect->SetWorld(Matrix::Identity);
+						basicEffect->Apply(context);
+						context->VSSetShader(m_instancedVertexShader.Get(), nullptr, 0);
+						context->IASetInputLayout(m_instancedInputLayout.Get());
+
+						ID3D11Buffer* instanceBuffer = m_instanceBuffer.Get();
+						UINT instanceStride = sizeof(ObjectInstance);
+						UINT instanceOffset = firstInstance * instanceStride;
+						context->IASetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &instanceOffset);
+						context->DrawIndexedInstanced(part.indexCount, runCount, part.startIndex, part.vertexOffset, 0);
+						instancedParts++;
+						continue;
+					}
+
+					for (int k = 0; k < runCount; k++)
+					{
+						if (matrices)
+						{
+							matrices->SetWorld(m_displayList[runObjects[k]].m_world);
+						}
+						part.effect->Apply(context);
+						context->DrawIndexed(part.indexCount, part.startIndex, part.vertexOffset);
+					}
+				}
+			}
+		}
+		m_renderStatistics.AddRun(runCount, parts, instancedParts);
+	}
+	m_renderStatistics.AddBatch(count);
+}
+
+bool Game::IsInstancedEffect(const std::shared_ptr<IEffect>& effect) const
+{
+	//the address alone could belong to a new effect, made after the one set up at that address was purged
+	auto found = m_instancedEffects.find(effect.get());
+	return found != m_instancedEffects.end() && found->second.lock() == effect;
+}
+
+void Game::PruneInstancedEffects()
+{
+	for (auto it = m_instancedEffects.begin(); it != m_instancedEffects.end();)
+	{
+		if (it->second.expired())
+		{
+			it = m_instancedEffects.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+int Game::WriteObjectInstances(const int* objectIndices, int count)
+{
+	//each run goes after the ones already written, and the buffer is only discarded once it is full, so a write
+	//never waits on the GPU still drawing an earlier run
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (m_instanceBufferUsed + count > OBJECT_INSTANCE_BUFFER_SIZE)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_instanceBufferUsed = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(m_instanceBuffer.Get(), 0, mapType, 0, &mapped)))
+	{
+		return -1;
+	}
+	ObjectInstance* instances = static_cast<ObjectInstance*>(mapped.pData) + m_instanceBufferUsed;
+	for (int i = 0; i < count; i++)
+	{
+		//normals take the inverse transpose, which is the inverse already kept for picking, read down its columns
+		const DisplayObject& object = m_displayList[objectIndices[i]];
+		XMStoreFloat4x4(&instances[i].world, object.m_world);
+		const XMMATRIX normalMatrix = XMMatrixTranspose(object.m_worldInverse);
+		XMStoreFloat4(&instances[i].normalRows[0], normalMatrix.r[0]);
+		XMStoreFloat4(&instances[i].normalRows[1], normalMatrix.r[1]);
+		XMStoreFloat4(&instances[i].normalRows[2], normalMatrix.r[2]);
+	}
+	context->Unmap(m_instanceBuffer.Get(), 0);
+
+	const int firstInstance = m_instanceBufferUsed;
+	m_instanceBufferUsed += count;
+	return firstInstance;
+}
+
+const RenderStatistics& Game::GetRenderStatistics() const
+{
+	return m_renderStatistics;
+}
+
+void Game::BuildDisplayChunk(ChunkObject * SceneChunk)
+{
+	//populate a DISPLAYCHUNK with all the chunk info we need from the object stored in toolmain
+	//which, to be honest, is almost all of it. Its mostly rendering related info so...
+	std::unique_ptr<DisplayChunk> displayChunk = std::make_unique<DisplayChunk>();
+	displayChunk->PopulateChunkData(SceneChunk);		//migrate chunk data
+	displayChunk->LoadHeightMap(m_deviceResources);
+	displayChunk->m_terrainEffect->SetProjection(m_projection);
+	displayChunk->InitialiseBatch();
+
+	//objects that arrived before their ground did
+	std::vector<int> snapObjects;
+	for (int i = 0; i < (int)m_displayList.size(); i++)
+	{
+		const Vector3 position = m_displayList[i].m_world.Translation();
+		if (m_displayList[i].m_snapToGround && displayChunk->ContainsPoint(position.x, position.z))
+		{
+			snapObjects.push_back(i);
+		}
+	}
+
+	m_displayChunks[SceneChunk->ID] = std::move(displayChunk);
+	SnapObjectsToGround(snapObjects);
+}
+
+void Game::RemoveDisplayChunk(int chunkID)
+{
+	m_displayChunks.erase(chunkID);
+}
+
+void Game::SaveDisplayChunk(ChunkObject * SceneChunk)
+{
+	auto chunk = m_displayChunks.find(SceneChunk->ID);
+	if (chunk != m_displayChunks.end())
+	{
+		chunk->second->SaveHeightMap();			//save heightmap to file.
+	}
+}
+
+const std::vector<int>& Game::GetPickedObjects()
+{
+    return m_pickedObjects;
+}
+
+const Vector3& Game::GetCameraPosition() const
+{
+    return m_camera->GetCameraPosition();
+}
+
+const AssetCache<Model>& Game::GetModelCache() const
+{
+    return m_modelCache;
+}
+
+const AssetCache<ID3D11ShaderResourceView>& Game::GetTextureCache() const
+{
+    return m_textureCache;
+}
+
+#ifdef DXTK_AUDIO
+void Game::NewAudioDevice()
+{
+    if (m_audEngine && !m_audEngine->IsAudioDevicePresent())
+    {
+        // Setup a retry in 1 second
+        m_audioTimerAcc = 1.f;
+        m_retryDefault = true;
+    }
+}
+#endif
+
+
+#pragma endregion
+
+#pragma region Direct3D Resources
+// These are the resources that depend on the device.
+void Game::CreateDeviceDependentResources()
+{
+    auto context = m_deviceResources->GetD3DDeviceContext();
+    auto device = m_deviceResources->GetD3DDevice();
+
+    m_states = std::make_unique<CommonStates>(device);
+
+    m_fxFactory = std::make_unique<EffectFactory>(device);
+	m_fxFactory->SetDirectory(L"database/data/"); //fx Factory will look in the database directory
+	m_fxFactory->SetSharing(false);	//we must set this to false otherwise it will share effects based on the initial tex loaded (When the model loads) rather than what we will change them to.
+
+    m_sprites = std::make_unique<SpriteBatch>(context);
+
+    m_batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(context);
+
+    m_batchEffect = std::make_unique<BasicEffect>(device);
+    m_batchEffect->SetVertexColorEnabled(true);
 
-    for (int i = 0; i < m_displayList.size(); ++i)
     {
-        const XMVECTORF32 scale = 
-        { 
-            m_displayList[i].m_scale.x,
-            m_displayList[i].m_scale.y, 
-            m_displayList[i].m_scale.z 
-        };
-        const XMVECTORF32 translation =
-        {
-            m_displayList[i].m_position.x,
-            m_displayList[i].m_position.y,
-            m_displayList[i].m_position.z
-        };
-
-        const XMVECTOR rotation = Quaternion::CreateFromYawPitchRoll(
-            m_displayList[i].m_orientation.y * 3.1415 / 180,
-            m_displayList[i].m_orientation.x * 3.1415 / 180,
-            m_displayList[i].m_orientation.z * 3.1415 / 180
+        void const* shaderByteCode;
+        size_t byteCodeLength;
+
+        m_batchEffect->GetVertexShaderBytecode(&shaderByteCode, &byteCodeLength);
+
+        DX::ThrowIfFailed(
+            device->CreateInputLayout(VertexPositionColor::InputElements,
+                VertexPositionColor::InputElementCount,
+                shaderByteCode, byteCodeLength,
+                m_batchInputLayout.ReleaseAndGetAddressOf())
         );
+    }
 
-        const XMMATRIX worldSpace = m_world * XMMatrixTransformation(
-            g_XMZero, Quaternion::Identity, scale, g_XMZero,
-            rotation, translation
+    //the instanced path of DrawModelBatch. Feature level 9.1 and 9.2 cannot instance, and draw an object at a time
+    if (device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_9_3)
+    {
+        DX::ThrowIfFailed(
+            device->CreateVertexShader(g_InstancedObjectVS, sizeof(g_InstancedObjectVS), nullptr, m_instancedVertexShader.ReleaseAndGetAddressOf())
         );
- 
-        const XMVECTOR nearPoint = XMVector3Unproject(
-            nearSource, 0.f, 0.f, sreenDimensions.right, sreenDimensions.bottom,
-            m_deviceResources->GetScreenViewport().MinDepth,
-            m_deviceResources->GetScreenViewport().MaxDepth,
-            m_projection, m_camera->GetViewMatrix(), worldSpace
+
+        //the CMO vertex in slot 0, then a world matrix and the rows of its inverse transpose per instance in slot 1
+        std::vector<D3D11_INPUT_ELEMENT_DESC> elements(VertexPositionNormalTangentColorTexture::InputElements,
+            VertexPositionNormalTangentColorTexture::InputElements + VertexPositionNormalTangentColorTexture::InputElementCount);
+        for (UINT row = 0; row < 4; row++)
+        {
+            const D3D11_INPUT_ELEMENT_DESC world = { "WORLD", row, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 };
+            elements.push_back(world);
+        }
+        for (UINT row = 0; row < 3; row++)
+        {
+            const D3D11_INPUT_ELEMENT_DESC normal = { "WORLDIT", row, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 };
+            elements.push_back(normal);
+        }
+        DX::ThrowIfFailed(
+            device->CreateInputLayout(elements.data(), (UINT)elements.size(),
+                g_InstancedObjectVS, sizeof(g_InstancedObjectVS),
+                m_instancedInputLayout.ReleaseAndGetAddressOf())
         );
 
-        const XMVECTOR farPoint = XMVector3Unproject(
-            farSource, 0.f, 0.f, sreenDimensions.right, sreenDimensions.bottom,
-            m_deviceResources->GetScreenViewport().MinDepth,
-            m_deviceResources->GetScreenViewport().MaxDepth,
-            m_projection, m_camera->GetViewMatrix(), worldSpace
+        CD3D11_BUFFER_DESC instanceBufferDesc(sizeof(ObjectInstance) * OBJECT_INSTANCE_BUFFER_SIZE, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        DX::ThrowIfFailed(
+            device->CreateBuffer(&instanceBufferDesc, nullptr, m_instanceBuffer.ReleaseAndGetAddressOf())
         );
+        m_instanceBufferUsed = 0;
+    }
+
+    m_font = std::make_unique<SpriteFont>(device, L"SegoeUI_18.spritefont");
+
+//    m_shape = GeometricPrimitive::CreateTeapot(context, 4.f, 8);
+
+    // SDKMESH has to use clockwise winding with right-handed coordinates, so textures are flipped in U
+    m_model = Model::CreateFromSDKMESH(device, L"tiny.sdkmesh", *m_fxFactory);
+	
+
+    // Load textures
+    DX::ThrowIfFailed(
+        CreateDDSTextureFromFile(device, L"seafloor.dds", nullptr, m_texture1.ReleaseAndGetAddressOf())
+    );
+
+    DX::ThrowIfFailed(
+        CreateDDSTextureFromFile(device, L"windowslogo.dds", nullptr, m_texture2.ReleaseAndGetAddressOf())
+    );
 
-        const XMVECTOR pickingVector = XMVector3Normalize(farPoint - nearPoint);
-        
-        for (int y = 0; y < m_displayList[i].m_model.get()->meshes.size(); ++y)
+}
+
+// Allocate all memory resources that change on a window SizeChanged event.
+void Game::CreateWindowSizeDependentResources()
+{
+    auto size = m_deviceResources->GetOutputSize();
+    float aspectRatio = float(size.right) / float(size.bottom);
+    float fovAngleY = 70.0f * XM_PI / 180.0f;
+
+    // This is a simple example of change that can be made when the app is in
+    // portrait or snapped view.
+    if (aspectRatio < 1.0f)
+    {
+        fovAngleY *= 2.0f;
+    }
+
+    // This sample makes use of a right-handed coordinate system using row-major matrices.
+    m_projection = Matrix::CreatePerspectiveFieldOfView(
+        fovAngleY,
+        aspectRatio,
+        0.01f,
+        1000.0f
+    );
+
+    m_batchEffect->SetProjection(m_projection);
+	for (auto& chunk : m_displayChunks)
+	{
+		chunk.second->m_terrainEffect->SetProjection(m_projection);
+	}
+}
+
+int Game::PickObjectUnderMouse()
+{
+    UpdateObjectBVH();
+
+    //one ray in world space for the whole pick, rather than unprojecting into every object's space
+    XMVECTOR nearPoint, pickingVector;
+    GetMouseRay(nearPoint, pickingVector);
+
+    //the BVH only gets us to candidate objects. Each is then tested exactly against its mesh boxes in its own space,
+    //and the hit is taken back to world space so distances between objects are comparable
+    auto objectTest = [&](int index, float& distance)
+    {
+        const DisplayObject& object = m_displayList[index];
+        if (!object.m_model)
+        {
+            return false;
+        }
+
+        const XMMATRIX worldSpace = object.m_world;
+        const XMMATRIX localSpace = object.m_worldInverse;
+        const XMVECTOR localOrigin = XMVector3TransformCoord(nearPoint, localSpace);
+        const XMVECTOR localDirection = XMVector3Normalize(XMVector3TransformNormal(pickingVector, localSpace));
+
+        bool hit = false;
+        distance = FLT_MAX;
+        for (int y = 0; y < object.m_model->meshes.size(); ++y)
         {
-            float currentPickedDistance = 999999.f;
-            if (m_displayList[i].m_model.get()->meshes[y]->boundingBox.Intersects(
-                nearPoint, pickingVector, currentPickedDistance))
+            float localDistance;
+            if (object.m_model->meshes[y]->boundingBox.Intersects(localOrigin, localDirection, localDistance))
             {
-                if (currentPickedDistance < pickedDistance)
+                const XMVECTOR worldHit = XMVector3TransformCoord(localOrigin + localDirection * localDistance, worldSpace);
+                const float worldDistance = XMVectorGetX(XMVector3Length(worldHit - nearPoint));
+                if (worldDistance < distance)
                 {
-                    selectedID = i;
+                    distance = worldDistance;
+                    hit = true;
                 }
             }
         }
+        return hit;
+    };
+
+    float pickedDistance;
+    const int picked = m_objectBVH.IntersectRay(nearPoint, pickingVector, objectTest, pickedDistance);
+
+    //an object behind the terrain cannot be clicked on
+    m_terrainHitValid = PickTerrain(nearPoint, pickingVector, m_terrainHit);
+    if (picked >= 0 && m_terrainHitValid && m_terrainHit.distance < pickedDistance)
+    {
+        return -1;
+    }
+    return picked;
+}
+
+void Game::GetMouseRay(XMVECTOR& origin, XMVECTOR& direction)
+{
+    const RECT sreenDimensions = m_deviceResources->GetOutputSize();
+    const DirectX::Mouse::State state = m_mouse->GetState();
+    const XMVECTOR nearSource = XMVectorSet(state.x, state.y, 0.f, 1.f);
+    const XMVECTOR farSource = XMVectorSet(state.x, state.y, 1.f, 1.f);
+
+    const XMVECTOR nearPoint = XMVector3Unproject(
+        nearSource, 0.f, 0.f, sreenDimensions.right, sreenDimensions.bottom,
+        m_deviceResources->GetScreenViewport().MinDepth,
+        m_deviceResources->GetScreenViewport().MaxDepth,
+        m_projection, m_camera->GetViewMatrix(), m_world
+    );
+
+    const XMVECTOR farPoint = XMVector3Unproject(
+        farSource, 0.f, 0.f, sreenDimensions.right, sreenDimensions.bottom,
+        m_deviceResources->GetScreenViewport().MinDepth,
+        m_deviceResources->GetScreenViewport().MaxDepth,
+        m_projection, m_camera->GetViewMatrix(), m_world
+    );
+
+    origin = nearPoint;
+    direction = XMVector3Normalize(farPoint - nearPoint);
+}
+
+bool Game::PickTerrain(const Vector3& origin, const Vector3& direction, TerrainRayHit& hit)
+{
+    //each chunk only needs to beat the nearest hit so far
+    bool found = false;
+    float nearest = FLT_MAX;
+    for (auto& chunk : m_displayChunks)
+    {
+        if (chunk.second->IntersectRay(origin, direction, nearest, hit))
+        {
+            nearest = hit.distance;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool Game::PickTerrainUnderMouse(TerrainRayHit& hit)
+{
+    XMVECTOR origin, direction;
+    GetMouseRay(origin, direction);
+    return PickTerrain(origin, direction, hit);
+}
+
+void Game::SculptTerrain(float deltaTime, bool strokeStart)
+{
+    TerrainRayHit hit;
+    if (!PickTerrainUnderMouse(hit))
+    {
+        return;
+    }
+    const Vector3 centre(hit.position[0], hit.position[1], hit.position[2]);
+
+    //flatten levels to wherever the stroke started
+    if (strokeStart)
+    {
+        m_terrainBrush.flattenHeight = centre.y;
+    }
+
+    //every chunk the brush overlaps, so strokes carry across chunk edges
+    for (auto& chunk : m_displayChunks)
+    {
+        chunk.second->ApplyBrush(m_terrainBrush, centre, deltaTime);
+    }
+}
+
+bool Game::SnapToGround(int index)
+{
+    DisplayObject& object = m_displayList[index];
+    const Vector3 position = object.m_world.Translation();
+    for (auto& chunk : m_displayChunks)
+    {
+        if (chunk.second->ContainsPoint(position.x, position.z))
+        {
+            //straight down in world space, which for a child is some other direction in its parent's space
+            Vector3 offset(0.f, chunk.second->GetHeightAt(position.x, position.z) - position.y, 0.f);
+            const int parent = m_hierarchy.GetParent(index);
+            if (parent != TRANSFORM_HIERARCHY_NO_PARENT)
+            {
+                offset = Vector3::TransformNormal(offset, m_displayList[parent].m_worldInverse);
+            }
+            object.m_position += offset;
+            MoveObject(index);
+
+            //the ground position is an edit like any other, saved and autosaved with the object
+            if (m_sceneGraph != NULL && index < m_sceneGraph->GetCount() && m_sceneGraph->GetIDs()[index] == object.m_ID)
+            {
+                m_sceneGraph->SetPosition(index, object.m_position.x, object.m_position.y, object.m_position.z);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+int Game::SnapObjectsToGround(const std::vector<int>& objects)
+{
+    //straight down onto the triangles under each object, no rays needed
+    int snapped = 0;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (SnapToGround(objects[i]))
+        {
+            snapped++;
+        }
+    }
+    return snapped;
+}
+
+void Game::SnapFlaggedObjectsToGround()
+{
+    std::vector<int> objects;
+    for (int i = 0; i < (int)m_displayList.size(); i++)
+    {
+        if (m_displayList[i].m_snapToGround)
+        {
+            objects.push_back(i);
+        }
+    }
+    SnapObjectsToGround(objects);
+}
+
+void Game::UpdateObjectBVH()
+{
+    if (!m_objectBVHRebuild && !m_objectBVHRefit)
+    {
+        return;
+    }
+
+    std::vector<BoundingBox> objectBounds(m_displayList.size());
+    for (int i = 0; i < m_displayList.size(); ++i)
+    {
+        objectBounds[i] = m_displayList[i].m_worldBounds;
+    }
+
+    if (m_objectBVHRebuild)
+    {
+        m_objectBVH.Build(objectBounds);
+    }
+    else
+    {
+        m_objectBVH.Refit(objectBounds);
     }
+    m_objectBVHRebuild = false;
+    m_objectBVHRefit = false;
+}
 
-    return selectedID;
+void Game::UpdateCullBounds()
+{
+    if (!m_cullBoundsDirty && m_frustumCuller.GetCount() == (int)m_displayList.size())
+    {
+        return;
+    }
+
+    //the same world bounds the picking BVH uses, kept by each object and only recomputed when it moves
+    if (m_frustumCuller.GetCount() != (int)m_displayList.size())
+    {
+        m_frustumCuller.Resize((int)m_displayList.size());
+    }
+    for (int i = 0; i < (int)m_displayList.size(); ++i)
+    {
+        const BoundingBox& bounds = m_displayList[i].m_worldBounds;
+        const float center[3] = { bounds.Center.x, bounds.Center.y, bounds.Center.z };
+        const float extents[3] = { bounds.Extents.x, bounds.Extents.y, bounds.Extents.z };
+        m_frustumCuller.SetBox(i, center, extents);
+    }
+    m_cullBoundsDirty = false;
 }
 
 void Game::HandleObjectPicking(int selected)
@@ -746,6 +1676,9 @@ void Game::HandleObjectPicking(int selected)
 void Game::OnDeviceLost()
 {
     m_states.reset();
+    m_modelCache.Clear();		//the cached assets belong to the lost device
+    m_instancedEffects.clear();
+    m_textureCache.Clear();
     m_fxFactory.reset();
     m_sprites.reset();
     m_batch.reset();
@@ -756,6 +1689,9 @@ void Game::OnDeviceLost()
     m_texture1.Reset();
     m_texture2.Reset();
     m_batchInputLayout.Reset();
+    m_instancedVertexShader.Reset();
+    m_instancedInputLayout.Reset();
+    m_instanceBuffer.Reset();
 }
 
 void Game::OnDeviceRestored()
@@ -791,6 +1727,63 @@ void Game::DrawImGui()
         ImGui::End();
     }
 
+    ImGui::Begin("Render Stats");
+    ImGui::Text("Objects: %d in %d batches", m_renderStatistics.instances, m_renderStatistics.batches);
+    ImGui::Text("Draw calls: %d, mesh setups: %d", m_renderStatistics.drawCalls, m_renderStatistics.stateChanges);
+    ImGui::Text("Visible objects: %d, culled: %d", m_renderStatistics.visibleObjects, m_renderStatistics.culledObjects);
+    ImGui::Text("Terrain triangles: %d, nodes culled: %d", m_renderStatistics.terrainTriangles, m_renderStatistics.terrainNodesCulled);
+    ImGui::End();
+
+    ImGui::Begin("Terrain");
+    ImGui::Checkbox("Sculpt", &m_sculpting);
+    static const char* brushNames[TERRAIN_BRUSH_COUNT] = { "Raise", "Lower", "Smooth", "Flatten", "Noise" };
+    int brushType = m_terrainBrush.type;
+    if (ImGui::Combo("Brush", &brushType, brushNames, TERRAIN_BRUSH_COUNT))
+    {
+        m_terrainBrush.type = (TerrainBrushType)brushType;
+    }
+    ImGui::SliderFloat("Radius", &m_terrainBrush.radius, 1.f, 64.f);
+    ImGui::SliderFloat("Strength", &m_terrainBrush.strength, 0.1f, 32.f);
+    if (ImGui::Button("Snap selected to ground"))
+    {
+        //the snap writes the new positions through to the scenegraph, then they are journalled as one command, so a single undo lifts them all
+        std::vector<Vector3> before(m_pickedObjects.size());
+        for (size_t i = 0; i < m_pickedObjects.size(); i++)
+        {
+            const int index = m_pickedObjects[i];
+            before[i] = Vector3(m_sceneGraph->GetField(index, SCENE_FIELD_POSITION_X), m_sceneGraph->GetField(index, SCENE_FIELD_POSITION_Y), m_sceneGraph->GetField(index, SCENE_FIELD_POSITION_Z));
+        }
+        SnapObjectsToGround(m_pickedObjects);
+        m_editJournal.BeginCommand();
+        for (size_t i = 0; i < m_pickedObjects.size(); i++)
+        {
+            const int index = m_pickedObjects[i];
+            const Vector3& position = m_displayList[index].m_position;
+            const int ID = m_sceneGraph->GetIDs()[index];
+            m_editJournal.Record(ID, SCENE_FIELD_POSITION_X, before[i].x, position.x);
+            m_editJournal.Record(ID, SCENE_FIELD_POSITION_Y, before[i].y, position.y);
+            m_editJournal.Record(ID, SCENE_FIELD_POSITION_Z, before[i].z, position.z);
+        }
+        m_editJournal.EndCommand();
+        ApplySceneChanges();
+    }
+    if (m_terrainHitValid)
+    {
+        ImGui::Text("Clicked: %.2f, %.2f, %.2f", m_terrainHit.position[0], m_terrainHit.position[1], m_terrainHit.position[2]);
+        ImGui::Text("Normal: %.2f, %.2f, %.2f", m_terrainHit.normal[0], m_terrainHit.normal[1], m_terrainHit.normal[2]);
+    }
+    ImGui::End();
+
+    if (!m_pendingObjects.empty())
+    {
+        int loaded, total;
+        GetAssetLoadProgress(loaded, total);
+        ImGui::Begin("Loading");
+        ImGui::Text("Loading assets: %d / %d objects", loaded, total);
+        ImGui::ProgressBar(total > 0 ? (float)loaded / total : 0.f);
+        ImGui::End();
+    }
+
 
     ImGui::Render();
     ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
@@ -803,28 +1796,14 @@ void Game::DrawHierarchy()
     ImGui::BeginChild("Hierarchy", contentRegion);
     if (ImGui::CollapsingHeader("Hierarchy")) 
     {
+        //roots in list order, each object under its parent
         ImGui::SetWindowFontScale(1.2f);
-        ImVec2 buttonSize = ImGui::GetContentRegionAvail();
-        buttonSize.x -= 12.f;
-        buttonSize.y = 18.f;
-        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.f, 0.f, 0.f, 1.f));
-        for (int i = 0; i < m_displayList.size(); ++i)
-        {
-            std::string text = std::to_string(i);
-            ImVec4 color = ImVec4(1.f ,1.f, 1.f, 1.f);
-            if (std::find(m_pickedObjects.begin(), m_pickedObjects.end(), i) != m_pickedObjects.end())
-            {
-                color = ImVec4(0.47f, 0.67f, 0.97f, 1.f);
-            }
-            ImGui::PushStyleColor(ImGuiCol_Button, color);
-            if (ImGui::Button(text.c_str(), buttonSize))
-            {
-                HandleObjectPicking(i);
-            }
-            ImGui::PopStyleColor();
+        const std::vector<int>& roots = m_hierarchy.GetRoots();
+        for (size_t i = 0; i < roots.size(); ++i)
+        {
+            DrawHierarchyNode(roots[i]);
         }
         ImGui::SetWindowFontScale(1.f);
-        ImGui::PopStyleColor();
     }
     ImGui::EndChild();
 
@@ -843,32 +1822,39 @@ void Game::DrawHierarchy()
         else
         {
             int index = m_pickedObjects[m_pickedObjects.size() - 1];
+            bool transformChanged = false;
 
             ImGui::SeparatorText("Translation:");
             ImGui::PushID("Translation");
             ImGui::PushItemWidth(ImGui::CalcItemWidth() / 2.1);
-            ImGui::DragFloat("##X", &m_displayList[index].m_position.x, m_transformDragStep, 0.f, 0.f, "X: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Y", &m_displayList[index].m_position.y, 1.f, 0.f, 0.f, "Y: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Z", &m_displayList[index].m_position.z, 1.f, 0.f, 0.f, "Z: %.2f");
+            transformChanged |= EditObjectField("##X", index, SCENE_FIELD_POSITION_X, (float)m_transformDragStep, "X: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Y", index, SCENE_FIELD_POSITION_Y, 1.f, "Y: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Z", index, SCENE_FIELD_POSITION_Z, 1.f, "Z: %.2f");
             ImGui::PopItemWidth();
             ImGui::PopID();
 
             ImGui::SeparatorText("Rotation:");
             ImGui::PushID("Rotation");
             ImGui::PushItemWidth(ImGui::CalcItemWidth() / 2.1);
-            ImGui::DragFloat("##X", &m_displayList[index].m_orientation.x, m_transformDragStep, 0.f, 0.f, "X: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Y", &m_displayList[index].m_orientation.y, 1.f, 0.f, 0.f, "Y: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Z", &m_displayList[index].m_orientation.z, 1.f, 0.f, 0.f, "Z: %.2f");
+            transformChanged |= EditObjectField("##X", index, SCENE_FIELD_ROTATION_X, (float)m_transformDragStep, "X: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Y", index, SCENE_FIELD_ROTATION_Y, 1.f, "Y: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Z", index, SCENE_FIELD_ROTATION_Z, 1.f, "Z: %.2f");
             ImGui::PopItemWidth();
             ImGui::PopID();
 
             ImGui::SeparatorText("Scale:");
             ImGui::PushItemWidth(ImGui::CalcItemWidth() / 2.1);
-            ImGui::DragFloat("##X", &m_displayList[index].m_scale.x, m_transformDragStep, 0.f, 0.f, "X: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Y", &m_displayList[index].m_scale.y, 1.f, 0.f, 0.f, "Y: %.2f");
-            ImGui::SameLine(); ImGui::DragFloat("##Z", &m_displayList[index].m_scale.z, 1.f, 0.f, 0.f, "Z: %.2f");
+            transformChanged |= EditObjectField("##X", index, SCENE_FIELD_SCALE_X, (float)m_transformDragStep, "X: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Y", index, SCENE_FIELD_SCALE_Y, 1.f, "Y: %.2f");
+            ImGui::SameLine(); transformChanged |= EditObjectField("##Z", index, SCENE_FIELD_SCALE_Z, 1.f, "Z: %.2f");
             ImGui::PopItemWidth();
 
+            if (transformChanged)
+            {
+                //only the edited object and its children recompute their matrices, everything else keeps its cached ones
+                ApplySceneChanges();
+            }
+
             ImGui::Text("Step: ");
             ImGui::SameLine(); ImGui::DragInt("##S", &m_transformDragStep, 1.0, 1, 10);
         }
@@ -876,3 +1862,255 @@ void Game::DrawHierarchy()
 
     ImGui::EndChild();
 }
+
+void Game::DrawHierarchyNode(int index)
+{
+    const int firstChild = m_hierarchy.GetFirstChild(index);
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_SpanAvailWidth;
+    if (firstChild == TRANSFORM_HIERARCHY_NO_PARENT)
+    {
+        flags |= ImGuiTreeNodeFlags_Leaf;
+    }
+    if (std::find(m_pickedObjects.begin(), m_pickedObjects.end(), index) != m_pickedObjects.end())
+    {
+        flags |= ImGuiTreeNodeFlags_Selected;
+    }
+
+    //clicking the arrow only opens the node, clicking the label picks the object
+    const bool open = ImGui::TreeNodeEx((void*)(intptr_t)index, flags, "%d", index);
+    if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
+    {
+        HandleObjectPicking(index);
+    }
+    if (open)
+    {
+        for (int child = firstChild; child != TRANSFORM_HIERARCHY_NO_PARENT; child = m_hierarchy.GetNextSibling(child))
+        {
+            DrawHierarchyNode(child);
+        }
+        ImGui::TreePop();
+    }
+}
+
+bool Game::EditObjectField(const char* label, int index, SceneObjectField field, float speed, const char* format)
+{
+    //the widget edits the scenegraph, the display object follows through the change event.
+    //every frame of a drag joins the command its first frame began, so the whole drag is undone in one step
+    float value = m_sceneGraph->GetField(index, field);
+    const float before = value;
+    const bool changed = ImGui::DragFloat(label, &value, speed, 0.f, 0.f, format);
+    if (ImGui::IsItemActivated())
+    {
+        m_editGesture++;
+        if (m_editGesture == 0)
+        {
+            m_editGesture = 1;      //0 never merges
+        }
+    }
+    if (changed)
+    {
+        m_sceneGraph->SetField(index, field, value);
+        m_editJournal.BeginCommand(m_editGesture);
+        m_editJournal.Record(m_sceneGraph->GetIDs()[index], field, before, value);
+        m_editJournal.EndCommand();
+    }
+    return changed;
+}
+
+float& Game::GetObjectField(DisplayObject& object, int field)
+{
+    switch (field)
+    {
+    case SCENE_FIELD_POSITION_X: return object.m_position.x;
+    case SCENE_FIELD_POSITION_Y: return object.m_position.y;
+    case SCENE_FIELD_POSITION_Z: return object.m_position.z;
+    case SCENE_FIELD_ROTATION_X: return object.m_orientation.x;
+    case SCENE_FIELD_ROTATION_Y: return object.m_orientation.y;
+    case SCENE_FIELD_ROTATION_Z: return object.m_orientation.z;
+    case SCENE_FIELD_SCALE_X: return object.m_scale.x;
+    case SCENE_FIELD_SCALE_Y: return object.m_scale.y;
+    default: return object.m_scale.z;
+    }
+}
+
+void Game::UndoEdit()
+{
+    std::vector<EditDelta> deltas;
+    std::vector<SceneObject> objects;
+    if (m_editJournal.Undo(deltas, objects))
+    {
+        ApplyEdits(deltas, objects, true);
+    }
+}
+
+void Game::RedoEdit()
+{
+    std::vector<EditDelta> deltas;
+    std::vector<SceneObject> objects;
+    if (m_editJournal.Redo(deltas, objects))
+    {
+        ApplyEdits(deltas, objects, false);
+    }
+}
+
+void Game::ApplyEdits(const std::vector<EditDelta>& deltas, const std::vector<SceneObject>& objects, bool undo)
+{
+    //written to the scenegraph like any other edit, so they are saved and reach the display list the same way.
+    //an object whose chunk is not resident is skipped
+    std::vector<int> deleted;
+    size_t object = 0;
+    for (size_t i = 0; i < deltas.size(); i++)
+    {
+        const int index = m_sceneGraph->FindIndex(deltas[i].ID);
+        if (deltas[i].field >= 0)
+        {
+            if (index != -1)
+            {
+                m_sceneGraph->SetField(index, (SceneObjectField)deltas[i].field, undo ? deltas[i].oldValue : deltas[i].newValue);
+            }
+            continue;
+        }
+
+        //undoing an add or redoing a remove deletes the object, the other two bring its row back
+        const SceneObject& row = objects[object++];
+        if ((deltas[i].field == EDIT_FIELD_OBJECT_ADDED) == undo)
+        {
+            if (index != -1)
+            {
+                deleted.push_back(index);
+            }
+        }
+        else if (index == -1 && m_displayChunks.count(row.chunk_ID) != 0)
+        {
+            m_sceneGraph->RestoreObject(row);
+        }
+    }
+
+    //deletes are left until last, in one pass, so the indices found above stay valid
+    if (!deleted.empty())
+    {
+        m_sceneGraph->DeleteObjects(deleted);
+    }
+    if (object != 0)
+    {
+        SyncDisplayList(m_sceneGraph);
+    }
+    ApplySceneChanges();
+}
+
+void Game::DuplicateSelection()
+{
+    if (m_sceneGraph == NULL || m_pickedObjects.empty())
+    {
+        return;
+    }
+
+    //display list indices follow the scenegraph
+    const std::vector<int> selection = m_pickedObjects;
+    SceneObject object;
+    m_editJournal.BeginCommand();
+    for (size_t i = 0; i < selection.size(); i++)
+    {
+        m_sceneGraph->Get(selection[i], object);
+        object.ID = m_sceneGraph->NewID();
+        object.dirty = false;
+        object.inserted = true;
+        const int index = m_sceneGraph->Add(object);
+        m_sceneGraph->SetFlag(index, SCENE_OBJECT_AUTOSAVE, true);
+        m_editJournal.RecordAdded(object);
+    }
+    m_editJournal.EndCommand();
+
+    SyncDisplayList(m_sceneGraph);
+}
+
+void Game::DeleteSelection()
+{
+    if (m_sceneGraph == NULL || m_pickedObjects.empty())
+    {
+        return;
+    }
+
+    std::vector<int> selection = m_pickedObjects;
+    std::sort(selection.begin(), selection.end());
+    selection.erase(std::unique(selection.begin(), selection.end()), selection.end());
+
+    //the whole row is journalled, so an undo puts back exactly what went
+    SceneObject object;
+    m_editJournal.BeginCommand();
+    for (size_t i = 0; i < selection.size(); i++)
+    {
+        m_sceneGraph->Get(selection[i], object);
+        m_editJournal.RecordRemoved(object);
+    }
+    m_editJournal.EndCommand();
+    m_sceneGraph->DeleteObjects(selection);		//one pass, however many are selected
+
+    SyncDisplayList(m_sceneGraph);		//drops the selection along with the objects
+}
+
+void Game::ApplySceneChanges()
+{
+    if (m_sceneGraph == NULL)
+    {
+        return;
+    }
+
+    //only the fields each event names are copied, and only those objects recompute their matrices
+    const std::vector<int>& changedIDs = m_sceneGraph->GetChangedIDs();
+    if (changedIDs.empty())
+    {
+        return;
+    }
+    std::vector<int> snapObjects;
+    for (size_t i = 0; i < changedIDs.size(); i++)
+    {
+        //an object not displayed yet is patched when it streams in
+        const int index = m_sceneGraph->FindIndex(changedIDs[i]);
+        if (index == -1 || index >= (int)m_displayList.size() || m_displayList[index].m_ID != changedIDs[i])
+        {
+            continue;
+        }
+
+        DisplayObject& object = m_displayList[index];
+        const unsigned int changes = m_sceneGraph->GetChanges(index);
+        if (changes & SCENE_CHANGE_TRANSFORM)
+        {
+            for (int field = 0; field < SCENE_FIELD_COUNT; field++)
+            {
+                if (changes & SCENE_CHANGE_FIELD(field))
+                {
+                    GetObjectField(object, field) = m_sceneGraph->GetField(index, (SceneObjectField)field);
+                }
+            }
+            object.MarkTransformDirty();
+            object.UpdateLocalTransform();
+            m_hierarchy.SetLocal(index, &object.m_local._11);
+        }
+        if (changes & SCENE_CHANGE_FLAGS)
+        {
+            const unsigned int flags = m_sceneGraph->GetFlags()[index];
+            object.m_render = (flags & SCENE_OBJECT_EDITOR_RENDER) != 0;
+            object.m_wireframe = (flags & SCENE_OBJECT_EDITOR_WIREFRAME) != 0;
+            object.m_snapToGround = (flags & SCENE_OBJECT_SNAP_TO_GROUND) != 0;
+            snapObjects.push_back(index);
+        }
+    }
+
+    //moved objects carry their children, and anything kept on the ground among them is put back on it
+    std::vector<int> changed;
+    UpdateObjectTransforms(changed);
+    snapObjects.insert(snapObjects.end(), changed.begin(), changed.end());
+    std::sort(snapObjects.begin(), snapObjects.end());
+    snapObjects.erase(std::unique(snapObjects.begin(), snapObjects.end()), snapObjects.end());
+    for (size_t i = 0; i < snapObjects.size(); i++)
+    {
+        if (m_displayList[snapObjects[i]].m_snapToGround)
+        {
+            SnapToGround(snapObjects[i]);
+        }
+    }
+
+    //cleared after the snaps, whose own events the display list already reflects
+    m_sceneGraph->ClearChanges();
+}
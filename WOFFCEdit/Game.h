@@ -6,12 +6,23 @@
 
 #include "DeviceResources.h"
 #include "StepTimer.h"
-#include "SceneObject.h"
+#include "SceneStore.h"
 #include "DisplayObject.h"
 #include "DisplayChunk.h"
 #include "ChunkObject.h"
 #include "InputCommands.h"
+#include "ObjectBVH.h"
+#include "AssetCache.h"
+#include "AssetLoader.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+#include "TransformHierarchy.h"
+#include "EditJournal.h"
+#include <deque>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "Camera.h"
 
@@ -49,12 +60,25 @@ public:
 	void OnWindowSizeChanged(int width, int height);
 
 	//tool specific
-	void BuildDisplayList(std::vector<SceneObject> * SceneGraph); //note vector passed by reference 
-	void BuildDisplayChunk(ChunkObject *SceneChunk);
+	void SetSceneGraph(SceneStore * SceneGraph);		//where edits go, and change events come from
+	void SyncDisplayList(const SceneStore * SceneGraph); //note scenegraph passed by pointer. only objects added, removed or changed since the last sync are touched
+	void AppendDisplayList(const SceneStore * SceneGraph, int firstObject);	//adds display objects for SceneGraph[firstObject..end], reusing detached ones with the same ID
+	void FinishDisplayList();			//after the last append of a load, links any parent and child that arrived in different appends
+	void DetachDisplayList();			//empties the display list ahead of a reload, keeping its objects aside by ID
+	void ReleaseDetachedObjects();		//once the reload is done, whatever it did not bring back
+	void BuildDisplayChunk(ChunkObject *SceneChunk);	//builds (or rebuilds) the terrain for one chunk
+	void RemoveDisplayChunk(int chunkID);
 	void SaveDisplayChunk(ChunkObject *SceneChunk);	//saves geometry et al
 	void ClearDisplayList();
+	void DuplicateSelection();			//copies of the selected objects under new IDs, inserted on the next save. journalled
+	void DeleteSelection();				//removes the selected objects, their rows are deleted on the next save. journalled
 
 	const std::vector<int>& GetPickedObjects();
+	const Vector3& GetCameraPosition() const;
+	const AssetCache<DirectX::Model>& GetModelCache() const;
+	const AssetCache<ID3D11ShaderResourceView>& GetTextureCache() const;
+	void GetAssetLoadProgress(int& loaded, int& total) const;	//objects given their assets since the display list started waiting on the loader
+	const RenderStatistics& GetRenderStatistics() const;		//counts for the last frame drawn
 
 #ifdef DXTK_AUDIO
 	void NewAudioDevice();
@@ -68,16 +92,79 @@ private:
 	void CreateWindowSizeDependentResources();
 
 	int PickObjectUnderMouse();
+	void GetMouseRay(DirectX::XMVECTOR& origin, DirectX::XMVECTOR& direction);	//world space, through the cursor
+	bool PickTerrain(const Vector3& origin, const Vector3& direction, TerrainRayHit& hit);	//nearest over every resident chunk
+	bool PickTerrainUnderMouse(TerrainRayHit& hit);
+	void SculptTerrain(float deltaTime, bool strokeStart);		//one dab of m_terrainBrush under the cursor
+	bool SnapToGround(int index);								//false if no resident chunk is under it
+	int SnapObjectsToGround(const std::vector<int>& objects);	//returns how many were over terrain
+	void SnapFlaggedObjectsToGround();							//every object with m_snapToGround set
 	void HandleObjectPicking(int selected);
+	void RebuildHierarchy();									//parent links from every object's parent ID, then all world matrices
+	void MoveObject(int index);									//after editing an object's position, orientation or scale. its children follow
+	void UpdateObjectTransforms(std::vector<int>& moved);		//world matrices of dirty subtrees, appends the objects recomputed
+	void UpdateObjectBVH();										//rebuilds or refits the picking BVH if the display list has changed
+	void UpdateCullBounds();									//refills the frustum culler's boxes if any object has moved
+	static size_t GetModelBytes(const DirectX::Model& model);	//vertex and index buffer memory, for the asset cache
+
+	//what PatchDisplayObject found different
+	enum DisplayObjectChange
+	{
+		DISPLAY_OBJECT_ADDED			= 1 << 0,
+		DISPLAY_OBJECT_MOVED			= 1 << 1,
+		DISPLAY_OBJECT_REPARENTED		= 1 << 2,
+		DISPLAY_OBJECT_SNAPPED			= 1 << 3,		//snap to ground was turned on
+		DISPLAY_OBJECT_ASSETS_CHANGED	= 1 << 4,
+	};
+	int PatchDisplayObject(DisplayObject& object, const SceneStore * SceneGraph, int index);	//copies the scenegraph object's fields, returns DisplayObjectChange bits
+	void RequestObjectAssets(int index);						//attaches cached assets now, or queues the object on the loader
+
+	//a display object waiting on files from the asset loader
+	struct PendingObject
+	{
+		int				index;			//into m_displayList
+		StringHandle	modelPath;
+		StringHandle	texturePath;
+	};
+	void DrawModelBatch(const DirectX::Model& model, const int* objectIndices, int count);	//every listed display object, all using this model
+	int WriteObjectInstances(const int* objectIndices, int count);	//into the instance buffer, returns the first one written or -1
+	bool IsInstancedEffect(const std::shared_ptr<DirectX::IEffect>& effect) const;	//one ResolveObjectAssets set up for InstancedObjectVS
+	void PruneInstancedEffects();								//forgets the effects of purged models
+	void ResolvePendingAssets();								//gives waiting objects their model and texture once the files are read
+	bool ResolveObjectAssets(const PendingObject& pending);		//false if a file it needs has not been read yet
 
 	void DrawImGui();
 	void DrawHierarchy();
+	void DrawHierarchyNode(int index);		//the object and, if expanded, its children
+	bool EditObjectField(const char* label, int index, SceneObjectField field, float speed, const char* format);	//a drag widget for one field, journalled
+	static float& GetObjectField(DisplayObject& object, int field);		//SceneObjectField
+	void UndoEdit();
+	void RedoEdit();
+	void ApplyEdits(const std::vector<EditDelta>& deltas, const std::vector<SceneObject>& objects, bool undo);	//old values if undoing, new ones if redoing
+	void ApplySceneChanges();		//patches display objects from the scenegraph's change events
 
 	void XM_CALLCONV DrawGrid(DirectX::FXMVECTOR xAxis, DirectX::FXMVECTOR yAxis, DirectX::FXMVECTOR origin, size_t xdivs, size_t ydivs, DirectX::GXMVECTOR color);
 
 	//tool specific
 	std::vector<DisplayObject>			m_displayList;
-	DisplayChunk						m_displayChunk;
+	std::vector<DisplayObject>			m_detachedObjects;	//the display list as it was before a reload, until ReleaseDetachedObjects
+	std::unordered_map<int, int>		m_detachedIndices;	//ID to index in m_detachedObjects, for the ones not yet taken back
+	TransformHierarchy					m_hierarchy;		//parent / child world matrices, by display list index
+	std::unordered_map<int, int>		m_objectIndices;	//ID to display list index, for linking parents
+	std::unordered_set<int>				m_unlinkedParentIDs;	//parent IDs no displayed object has, in case one is appended
+	bool								m_hierarchyRelink = false;	//an append left links for FinishDisplayList to make
+	SceneStore *						m_sceneGraph = NULL;	//ToolMain's. edits are written to it and its change events read back
+	EditJournal							m_editJournal;		//undo / redo of object edits, by ID
+	unsigned int						m_editGesture = 0;	//bumped each time an edit widget is grabbed, the journal merge key
+	std::map<int, std::unique_ptr<DisplayChunk>>	m_displayChunks;	//terrain of every resident chunk, keyed on chunk ID
+	AssetCache<DirectX::Model>			m_modelCache;		//keyed on mesh and texture path, the texture is baked into the effects
+	std::unordered_map<const DirectX::IEffect*, std::weak_ptr<DirectX::IEffect>>	m_instancedEffects;	//the cached models' BasicEffects, set up to be instanced
+	AssetCache<ID3D11ShaderResourceView>	m_textureCache;
+	AssetLoader							m_assetLoader;
+	std::deque<PendingObject>			m_pendingObjects;	//in request order
+	int									m_pendingObjectTotal = 0;
+	RenderQueue							m_renderQueue;		//refilled every frame
+	RenderStatistics					m_renderStatistics;
 	InputCommands						m_InputCommands;
 
 	//control variables
@@ -95,12 +182,22 @@ private:
 	std::unique_ptr<Camera>					m_camera;
 
 	std::vector<int> m_pickedObjects;
+	ObjectBVH m_objectBVH;
+	bool m_objectBVHRebuild = true;		//objects were added or removed
+	bool m_objectBVHRefit = false;		//objects only moved
+	FrustumCuller m_frustumCuller;		//one box per display list entry, tested every frame
+	bool m_cullBoundsDirty = true;		//objects were added, removed or moved
 	Vector3 m_lastMouse;
 	HWND m_hwnd;
 	HCURSOR m_cursor;
 
 	int m_transformDragStep = 1;
 
+	bool m_sculpting = false;			//left mouse sculpts the terrain rather than picking objects
+	TerrainBrush m_terrainBrush;
+	TerrainRayHit m_terrainHit;			//where the last pick met the terrain
+	bool m_terrainHitValid = false;
+
     // DirectXTK objects.
     std::unique_ptr<DirectX::CommonStates>                                  m_states;
     std::unique_ptr<DirectX::BasicEffect>                                   m_batchEffect;
@@ -122,6 +219,17 @@ private:
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>                        m_texture1;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>                        m_texture2;
     Microsoft::WRL::ComPtr<ID3D11InputLayout>                               m_batchInputLayout;
+
+	//instanced drawing of display objects, none of it made if the device cannot instance
+	struct ObjectInstance
+	{
+		DirectX::XMFLOAT4X4	world;
+		DirectX::XMFLOAT4	normalRows[3];		//inverse transpose of world, xyz of the first three rows
+	};
+    Microsoft::WRL::ComPtr<ID3D11VertexShader>                              m_instancedVertexShader;	//InstancedObjectVS.hlsl
+    Microsoft::WRL::ComPtr<ID3D11InputLayout>                               m_instancedInputLayout;
+    Microsoft::WRL::ComPtr<ID3D11Buffer>                                    m_instanceBuffer;		//OBJECT_INSTANCE_BUFFER_SIZE ObjectInstances, dynamic
+	int m_instanceBufferUsed = 0;			//instances written since the buffer was last discarded
 	
 	bool m_lmbDownLastFrame = false;
 	bool m_rmbDownLastFrame = false;
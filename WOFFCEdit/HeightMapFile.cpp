@@ -0,0 +1,328 @@
+#include "HeightMapFile.h"
+#include <windows.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+//files at least this big are mapped, smaller ones are cheaper to just read
+#define HEIGHTMAP_MAP_THRESHOLD (4 * 1024 * 1024)
+
+//DDS layout, enough of it to find a single channel heightmap
+#define DDS_MAGIC				0x20534444		//"DDS "
+#define DDS_HEADER_SIZE			128				//magic plus DDS_HEADER
+#define DDS_DX10_HEADER_SIZE	20
+#define DDS_OFFSET_HEIGHT		12
+#define DDS_OFFSET_WIDTH		16
+#define DDS_OFFSET_MIPCOUNT		28
+#define DDS_OFFSET_PF_FLAGS		80
+#define DDS_OFFSET_PF_FOURCC	84
+#define DDS_OFFSET_PF_BITCOUNT	88
+#define DDS_OFFSET_DXGI_FORMAT	128
+#define DDPF_FOURCC				0x4
+#define DDPF_RGB				0x40
+#define DDPF_LUMINANCE			0x20000
+#define FOURCC_DX10				0x30315844		//"DX10"
+#define D3DFMT_R32F				114
+#define DXGI_R32_FLOAT			41
+#define DXGI_R16_UNORM			56
+#define DXGI_R8_UNORM			61
+
+
+HeightMapFile::HeightMapFile()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+	m_format = HEIGHTMAP_R8;
+	m_resolution = 0;
+	m_sampleOffset = 0;
+}
+
+
+HeightMapFile::~HeightMapFile()
+{
+	Close();
+}
+
+bool HeightMapFile::Open(const std::string & path, int expectedResolution)
+{
+	Close();
+
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+
+	if (m_size >= HEIGHTMAP_MAP_THRESHOLD)
+	{
+		//pages are only brought in as the conversion reaches them, and never copied into a second buffer
+		m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mappingHandle)
+		{
+			m_data = (const uint8_t*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+
+	if (!m_data)
+	{
+		//small file, or the mapping failed
+		m_readData.resize(m_size);
+		DWORD bytesRead = 0;
+		if (!ReadFile(m_fileHandle, m_readData.data(), (DWORD)m_size, &bytesRead, NULL) || bytesRead != m_size)
+		{
+			Close();
+			return false;
+		}
+		m_data = m_readData.data();
+	}
+
+	if (!DetectFormat(expectedResolution))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void HeightMapFile::Close()
+{
+	if (m_mappingHandle)
+	{
+		if (m_data)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+	m_data = NULL;
+	m_size = 0;
+	m_readData.clear();
+	m_readData.shrink_to_fit();
+}
+
+int HeightMapFile::GetResolution() const
+{
+	return m_resolution;
+}
+
+HeightMapFormat HeightMapFile::GetFormat() const
+{
+	return m_format;
+}
+
+bool HeightMapFile::IsDDS() const
+{
+	return !m_header.empty();
+}
+
+const std::vector<uint8_t> & HeightMapFile::GetHeader() const
+{
+	return m_header;
+}
+
+void HeightMapFile::ReadHeights(float * heights, float heightScale) const
+{
+	const size_t count = (size_t)m_resolution * m_resolution;
+	const uint8_t * samples = m_data + m_sampleOffset;
+
+	//memcpy each sample out, the data after a DDS header is not guaranteed to be aligned
+	switch (m_format)
+	{
+	case HEIGHTMAP_R8:
+		for (size_t i = 0; i < count; i++)
+		{
+			heights[i] = samples[i] * heightScale;
+		}
+		break;
+	case HEIGHTMAP_R16:
+	{
+		const float scale16 = heightScale / 256.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint16_t sample;
+			memcpy(&sample, samples + i * 2, 2);
+			heights[i] = sample * scale16;
+		}
+		break;
+	}
+	case HEIGHTMAP_R32F:
+		memcpy(heights, samples, count * sizeof(float));
+		break;
+	}
+}
+
+bool HeightMapFile::Save(const std::string & path, const float * heights, int resolution, HeightMapFormat format,
+						const std::vector<uint8_t> & header, float heightScale)
+{
+	const size_t count = (size_t)resolution * resolution;
+	std::vector<uint8_t> samples(count * BytesPerSample(format));
+
+	switch (format)
+	{
+	case HEIGHTMAP_R8:
+		for (size_t i = 0; i < count; i++)
+		{
+			samples[i] = (uint8_t)std::min(std::max(std::floor(heights[i] / heightScale + 0.5f), 0.0f), 255.0f);
+		}
+		break;
+	case HEIGHTMAP_R16:
+	{
+		const float scale16 = heightScale / 256.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint16_t sample = (uint16_t)std::min(std::max(std::floor(heights[i] / scale16 + 0.5f), 0.0f), 65535.0f);
+			memcpy(&samples[i * 2], &sample, 2);
+		}
+		break;
+	}
+	case HEIGHTMAP_R32F:
+		memcpy(samples.data(), heights, count * sizeof(float));
+		break;
+	}
+
+	const std::string tempPath = path + ".tmp";
+	FILE * pFile = fopen(tempPath.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	bool written = header.empty() || fwrite(header.data(), 1, header.size(), pFile) == header.size();
+	written = written && fwrite(samples.data(), 1, samples.size(), pFile) == samples.size();
+	written = written && fflush(pFile) == 0;
+	written = (fclose(pFile) == 0) && written;
+
+	//the original is only replaced once the new file is complete on disk
+	if (!written || !MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool HeightMapFile::DetectFormat(int expectedResolution)
+{
+	m_header.clear();
+	uint32_t magic = 0;
+	if (m_size >= 4)
+	{
+		memcpy(&magic, m_data, 4);
+	}
+
+	if (magic != DDS_MAGIC)
+	{
+		//raw: square, at the chunk's resolution, so the size gives the sample width
+		const size_t samples = (size_t)expectedResolution * expectedResolution;
+		m_resolution = expectedResolution;
+		m_sampleOffset = 0;
+		if (samples == 0)
+		{
+			return false;
+		}
+		if (m_size == samples)
+		{
+			m_format = HEIGHTMAP_R8;
+		}
+		else if (m_size == samples * 2)
+		{
+			m_format = HEIGHTMAP_R16;
+		}
+		else if (m_size == samples * 4)
+		{
+			m_format = HEIGHTMAP_R32F;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	if (m_size < DDS_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	uint32_t width, height, flags, fourCC, bitCount;
+	memcpy(&height, m_data + DDS_OFFSET_HEIGHT, 4);
+	memcpy(&width, m_data + DDS_OFFSET_WIDTH, 4);
+	memcpy(&flags, m_data + DDS_OFFSET_PF_FLAGS, 4);
+	memcpy(&fourCC, m_data + DDS_OFFSET_PF_FOURCC, 4);
+	memcpy(&bitCount, m_data + DDS_OFFSET_PF_BITCOUNT, 4);
+	if (width != height || width < 2)
+	{
+		return false;
+	}
+
+	m_sampleOffset = DDS_HEADER_SIZE;
+	if ((flags & DDPF_FOURCC) && fourCC == FOURCC_DX10)
+	{
+		if (m_size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+		{
+			return false;
+		}
+		uint32_t dxgiFormat;
+		memcpy(&dxgiFormat, m_data + DDS_OFFSET_DXGI_FORMAT, 4);
+		m_sampleOffset += DDS_DX10_HEADER_SIZE;
+
+		if (dxgiFormat == DXGI_R8_UNORM)			m_format = HEIGHTMAP_R8;
+		else if (dxgiFormat == DXGI_R16_UNORM)		m_format = HEIGHTMAP_R16;
+		else if (dxgiFormat == DXGI_R32_FLOAT)		m_format = HEIGHTMAP_R32F;
+		else										return false;
+	}
+	else if ((flags & DDPF_FOURCC) && fourCC == D3DFMT_R32F)
+	{
+		m_format = HEIGHTMAP_R32F;
+	}
+	else if ((flags & (DDPF_LUMINANCE | DDPF_RGB)) && bitCount == 8)
+	{
+		m_format = HEIGHTMAP_R8;
+	}
+	else if ((flags & (DDPF_LUMINANCE | DDPF_RGB)) && bitCount == 16)
+	{
+		m_format = HEIGHTMAP_R16;
+	}
+	else
+	{
+		return false;
+	}
+
+	//only the top mip is read, and written back, as the terrain
+	m_resolution = (int)width;
+	if (m_size < m_sampleOffset + (size_t)m_resolution * m_resolution * BytesPerSample(m_format))
+	{
+		return false;
+	}
+	m_header.assign(m_data, m_data + m_sampleOffset);
+	const uint32_t mipCount = 1;
+	memcpy(&m_header[DDS_OFFSET_MIPCOUNT], &mipCount, 4);		//the saved file holds no more than the top mip
+	return true;
+}
+
+int HeightMapFile::BytesPerSample(HeightMapFormat format)
+{
+	switch (format)
+	{
+	case HEIGHTMAP_R16:		return 2;
+	case HEIGHTMAP_R32F:	return 4;
+	default:				return 1;
+	}
+}
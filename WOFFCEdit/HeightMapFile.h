@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//sample formats a heightmap can be stored in
+enum HeightMapFormat
+{
+	HEIGHTMAP_R8,		//unsigned byte, the original format. one step is the terrain's height scale
+	HEIGHTMAP_R16,		//unsigned short, same range as R8 but 256 times finer
+	HEIGHTMAP_R32F		//float, in metres
+};
+
+//Reads and writes terrain heightmaps as square .raw or .dds files of R8, R16 or R32F samples.
+//Raw files are told apart by size against the chunk's resolution, DDS files by their header.
+//Large files are memory mapped and converted straight out of the mapping instead of being copied into a buffer first.
+class HeightMapFile
+{
+public:
+	HeightMapFile();
+	~HeightMapFile();
+
+	bool	Open(const std::string & path, int expectedResolution);	//maps or reads the file and works out its format
+	void	Close();
+
+	int				GetResolution() const;
+	HeightMapFormat	GetFormat() const;
+	bool			IsDDS() const;
+	const std::vector<uint8_t> & GetHeader() const;		//the DDS header, written back unchanged on save. empty for .raw
+
+	//converts every sample to metres. heights holds GetResolution() squared floats
+	void	ReadHeights(float * heights, float heightScale) const;
+
+	//writes through a temporary file that then replaces the original, so a failed save never leaves a half written heightmap
+	static bool	Save(const std::string & path, const float * heights, int resolution, HeightMapFormat format,
+					const std::vector<uint8_t> & header, float heightScale);
+
+private:
+	bool	DetectFormat(int expectedResolution);
+	static int	BytesPerSample(HeightMapFormat format);
+
+	const uint8_t *			m_data;			//whole file, mapped or read
+	size_t					m_size;
+	std::vector<uint8_t>	m_readData;		//backing store when the file was read rather than mapped
+	void *					m_fileHandle;
+	void *					m_mappingHandle;
+
+	HeightMapFormat			m_format;
+	int						m_resolution;
+	size_t					m_sampleOffset;	//where the samples start, past any header
+	std::vector<uint8_t>	m_header;
+};
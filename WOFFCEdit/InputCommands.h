@@ -14,4 +14,10 @@ struct InputCommands
 	bool lookDown = false;
 
 	bool shiftDown = false;
+
+	//only set for the frame the shortcut was pressed
+	bool undo = false;
+	bool redo = false;
+	bool deleteSelection = false;
+	bool duplicateSelection = false;
 };
@@ -0,0 +1,92 @@
+//Vertex shader for drawing many display objects with one DrawIndexedInstanced call.
+//It stands in for the vertex shader of the BasicEffect Game::ResolveObjectAssets sets up for CMO models: vertex lighting from the
+//three default lights, vertex colour on, texture optional. Everything else stays as the effect's Apply left it, so the
+//constant buffer below is BasicEffect's, with World set to identity. WorldViewProj is then view * projection, and each
+//instance brings its own world matrix and inverse transpose instead.
+//Compiled to InstancedObjectVS.inc by the project, see Game::CreateDeviceDependentResources.
+
+cbuffer Parameters : register(b0)
+{
+	float4 DiffuseColor				: packoffset(c0);
+	float3 EmissiveColor			: packoffset(c1);
+	float3 SpecularColor			: packoffset(c2);
+	float  SpecularPower			: packoffset(c2.w);
+
+	float3 LightDirection[3]		: packoffset(c3);
+	float3 LightDiffuseColor[3]		: packoffset(c6);
+	float3 LightSpecularColor[3]	: packoffset(c9);
+
+	float3 EyePosition				: packoffset(c12);
+
+	float3 FogColor					: packoffset(c13);
+	float4 FogVector				: packoffset(c14);
+
+	float4x4 World					: packoffset(c15);
+	float3x3 WorldInverseTranspose	: packoffset(c19);
+	float4x4 WorldViewProj			: packoffset(c22);
+};
+
+struct VSInput
+{
+	//slot 0, the CMO vertex. the tangent is in the buffer but not read
+	float4 Position		: SV_Position;
+	float3 Normal		: NORMAL;
+	float4 Color		: COLOR;
+	float2 TexCoord		: TEXCOORD0;
+
+	//slot 1, one per instance. rows, as DirectXMath has them
+	float4 World0		: WORLD0;
+	float4 World1		: WORLD1;
+	float4 World2		: WORLD2;
+	float4 World3		: WORLD3;
+	float4 Normal0		: WORLDIT0;
+	float4 Normal1		: WORLDIT1;
+	float4 Normal2		: WORLDIT2;
+};
+
+//the layout BasicEffect's vertex lit pixel shaders read, with or without the texture coordinate
+struct VSOutput
+{
+	float4 Diffuse		: COLOR0;
+	float4 Specular		: COLOR1;		//w is the fog factor
+	float2 TexCoord		: TEXCOORD0;
+	float4 PositionPS	: SV_Position;
+};
+
+VSOutput main(VSInput vin)
+{
+	const float4x4 world = float4x4(vin.World0, vin.World1, vin.World2, vin.World3);
+	const float3x3 worldInverseTranspose = float3x3(vin.Normal0.xyz, vin.Normal1.xyz, vin.Normal2.xyz);
+
+	const float4 positionWS = mul(vin.Position, world);
+	const float3 eyeVector = normalize(EyePosition - positionWS.xyz);
+	const float3 normalWS = normalize(mul(vin.Normal, worldInverseTranspose));
+
+	//the same sums as DirectXTK's ComputeLights
+	float3x3 lightDirections = 0;
+	float3x3 lightDiffuse = 0;
+	float3x3 lightSpecular = 0;
+	float3x3 halfVectors = 0;
+
+	[unroll]
+	for (int i = 0; i < 3; i++)
+	{
+		lightDirections[i] = LightDirection[i];
+		lightDiffuse[i] = LightDiffuseColor[i];
+		lightSpecular[i] = LightSpecularColor[i];
+		halfVectors[i] = normalize(eyeVector - lightDirections[i]);
+	}
+
+	const float3 dotL = mul(-lightDirections, normalWS);
+	const float3 dotH = mul(halfVectors, normalWS);
+	const float3 zeroL = step(0, dotL);
+	const float3 diffuse = zeroL * dotL;
+	const float3 specular = pow(max(dotH, 0) * zeroL, SpecularPower) * dotL;
+
+	VSOutput vout;
+	vout.PositionPS = mul(positionWS, WorldViewProj);
+	vout.Diffuse = float4(mul(diffuse, lightDiffuse) * DiffuseColor.rgb + EmissiveColor, DiffuseColor.a) * vin.Color;
+	vout.Specular = float4(mul(specular, lightSpecular) * SpecularColor, saturate(dot(positionWS, FogVector)));
+	vout.TexCoord = vin.TexCoord;
+	return vout;
+}
@@ -0,0 +1,436 @@
+#include "LevelCache.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#define LEVEL_CACHE_HASH_SEED	14695981039346656037ull
+#define LEVEL_CACHE_HASH_PRIME	1099511628211ull
+#define LEVEL_CACHE_WRITE_BLOCK	(64 * 1024)		//bytes hashed and written at a time, a multiple of 8
+
+//the columns, by type. chunk_ID has to stay second, the writer sorts on it
+static int SceneObject::* const INT_COLUMNS[] =
+{
+	&SceneObject::ID, &SceneObject::chunk_ID, &SceneObject::parent_id,
+	&SceneObject::health_amount, &SceneObject::min_dist, &SceneObject::max_dist, &SceneObject::light_type
+};
+static float SceneObject::* const FLOAT_COLUMNS[] =
+{
+	&SceneObject::posX, &SceneObject::posY, &SceneObject::posZ,
+	&SceneObject::rotX, &SceneObject::rotY, &SceneObject::rotZ,
+	&SceneObject::scaX, &SceneObject::scaY, &SceneObject::scaZ,
+	&SceneObject::pivotX, &SceneObject::pivotY, &SceneObject::pivotZ,
+	&SceneObject::volume, &SceneObject::pitch, &SceneObject::pan,
+	&SceneObject::light_diffuse_r, &SceneObject::light_diffuse_g, &SceneObject::light_diffuse_b,
+	&SceneObject::light_specular_r, &SceneObject::light_specular_g, &SceneObject::light_specular_b,
+	&SceneObject::light_spot_cutoff, &SceneObject::light_constant, &SceneObject::light_linear, &SceneObject::light_quadratic
+};
+static bool SceneObject::* const BOOL_COLUMNS[] =
+{
+	&SceneObject::render, &SceneObject::collision, &SceneObject::collectable, &SceneObject::destructable,
+	&SceneObject::editor_render, &SceneObject::editor_texture_vis, &SceneObject::editor_normals_vis,
+	&SceneObject::editor_collision_vis, &SceneObject::editor_pivot_vis, &SceneObject::snapToGround, &SceneObject::AINode,
+	&SceneObject::one_shot, &SceneObject::play_on_init, &SceneObject::play_in_editor,
+	&SceneObject::camera, &SceneObject::path_node, &SceneObject::path_node_start, &SceneObject::path_node_end,
+	&SceneObject::editor_wireframe
+};
+static std::string SceneObject::* const STRING_COLUMNS[] =
+{
+	&SceneObject::model_path, &SceneObject::tex_diffuse_path, &SceneObject::collision_mesh, &SceneObject::audio_path, &SceneObject::name
+};
+static StringHandle SceneObjectDetail::* const STRING_HANDLE_COLUMNS[] =		//the same columns, as the store keeps them
+{
+	&SceneObjectDetail::model_path, &SceneObjectDetail::tex_diffuse_path, &SceneObjectDetail::collision_mesh, &SceneObjectDetail::audio_path, &SceneObjectDetail::name
+};
+static const int INT_COLUMN_COUNT = sizeof(INT_COLUMNS) / sizeof(INT_COLUMNS[0]);
+static const int FLOAT_COLUMN_COUNT = sizeof(FLOAT_COLUMNS) / sizeof(FLOAT_COLUMNS[0]);
+static const int BOOL_COLUMN_COUNT = sizeof(BOOL_COLUMNS) / sizeof(BOOL_COLUMNS[0]);
+static const int STRING_COLUMN_COUNT = sizeof(STRING_COLUMNS) / sizeof(STRING_COLUMNS[0]);
+static_assert(BOOL_COLUMN_COUNT <= 32, "the bool columns are packed into one uint32 per object");
+
+static size_t Align8(size_t offset)
+{
+	return (offset + 7) & ~(size_t)7;
+}
+
+
+LevelCache::LevelCache()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+	memset(&m_header, 0, sizeof(m_header));
+	memset(&m_layout, 0, sizeof(m_layout));
+}
+
+
+LevelCache::~LevelCache()
+{
+	Close();
+}
+
+bool LevelCache::Open(const std::string & path, uint64_t expectedHash)
+{
+	Close();
+
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_fileHandle, &fileSize) || fileSize.QuadPart < (long long)sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mappingHandle)
+	{
+		m_data = (const uint8_t*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (!m_data)
+	{
+		Close();
+		return false;
+	}
+
+	//the cheap checks first, the hash reads every page
+	memcpy(&m_header, m_data, sizeof(m_header));
+	m_layout = GetLayout(m_header);
+	if (memcmp(m_header.magic, "WLVC", 4) != 0 || m_header.version != LEVEL_CACHE_VERSION || m_layout.size != m_size
+		|| m_header.contentHash != expectedHash || Hash(m_data + sizeof(Header), m_size - sizeof(Header), LEVEL_CACHE_HASH_SEED) != expectedHash)
+	{
+		Close();
+		return false;
+	}
+
+	const Chunk * chunks = (const Chunk*)(m_data + m_layout.chunks);
+	for (uint32_t i = 0; i < m_header.chunkCount; i++)
+	{
+		if ((uint64_t)chunks[i].firstObject + chunks[i].objectCount > m_header.objectCount)
+		{
+			Close();
+			return false;
+		}
+		m_chunkIndex[chunks[i].chunkID] = (int)i;
+	}
+
+	//the objects then take their strings as handles, rather than each interning its own copy
+	const uint32_t * stringOffsets = (const uint32_t*)(m_data + m_layout.stringOffsets);
+	const char * stringData = (const char*)(m_data + m_layout.stringData);
+	StringPool & strings = StringPool::Global();
+	m_stringHandles.resize(m_header.stringCount);
+	for (uint32_t i = 0; i < m_header.stringCount; i++)
+	{
+		if (stringOffsets[i] > stringOffsets[i + 1] || stringOffsets[i + 1] > m_header.stringBytes)
+		{
+			Close();
+			return false;
+		}
+		m_stringHandles[i] = strings.Intern(std::string(stringData + stringOffsets[i], stringOffsets[i + 1] - stringOffsets[i]));
+	}
+	return true;
+}
+
+void LevelCache::Close()
+{
+	if (m_mappingHandle)
+	{
+		if (m_data)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+	m_data = NULL;
+	m_size = 0;
+	m_chunkIndex.clear();
+	m_stringHandles.clear();
+}
+
+bool LevelCache::IsOpen() const
+{
+	return m_data != NULL;
+}
+
+int LevelCache::CountObjects(int chunkID) const
+{
+	auto found = m_chunkIndex.find(chunkID);
+	if (found == m_chunkIndex.end())
+	{
+		return 0;
+	}
+	return (int)((const Chunk*)(m_data + m_layout.chunks))[found->second].objectCount;
+}
+
+int LevelCache::LoadObjects(int chunkID, SceneStore & sceneGraph) const
+{
+	auto found = m_chunkIndex.find(chunkID);
+	if (found == m_chunkIndex.end())
+	{
+		return 0;
+	}
+
+	const Chunk & chunk = ((const Chunk*)(m_data + m_layout.chunks))[found->second];
+	const size_t count = m_header.objectCount;
+	const int32_t * ints = (const int32_t*)(m_data + m_layout.ints);
+	const float * floats = (const float*)(m_data + m_layout.floats);
+	const uint32_t * bools = (const uint32_t*)(m_data + m_layout.bools);
+	const uint32_t * strings = (const uint32_t*)(m_data + m_layout.strings);
+
+	//the row's strings stay empty, the store is given the handles straight after
+	SceneObject object;
+	const size_t end = (size_t)chunk.firstObject + chunk.objectCount;
+	for (size_t row = chunk.firstObject; row < end; row++)
+	{
+		for (int i = 0; i < INT_COLUMN_COUNT; i++)
+		{
+			object.*INT_COLUMNS[i] = ints[i * count + row];
+		}
+		for (int i = 0; i < FLOAT_COLUMN_COUNT; i++)
+		{
+			object.*FLOAT_COLUMNS[i] = floats[i * count + row];
+		}
+		for (int i = 0; i < BOOL_COLUMN_COUNT; i++)
+		{
+			object.*BOOL_COLUMNS[i] = (bools[row] & (1u << i)) != 0;
+		}
+		SceneObjectDetail & detail = sceneGraph.GetDetail(sceneGraph.Add(object));
+		for (int i = 0; i < STRING_COLUMN_COUNT; i++)
+		{
+			const uint32_t string = strings[i * count + row];
+			detail.*STRING_HANDLE_COLUMNS[i] = string < m_header.stringCount ? m_stringHandles[string] : STRING_HANDLE_EMPTY;
+		}
+	}
+	return (int)chunk.objectCount;
+}
+
+LevelCache::Layout LevelCache::GetLayout(const Header & header)
+{
+	const size_t count = header.objectCount;
+	Layout layout;
+	layout.chunks = sizeof(Header);
+	layout.ints = Align8(layout.chunks + header.chunkCount * sizeof(Chunk));
+	layout.floats = Align8(layout.ints + INT_COLUMN_COUNT * count * sizeof(int32_t));
+	layout.bools = Align8(layout.floats + FLOAT_COLUMN_COUNT * count * sizeof(float));
+	layout.strings = Align8(layout.bools + count * sizeof(uint32_t));
+	layout.stringOffsets = Align8(layout.strings + STRING_COLUMN_COUNT * count * sizeof(uint32_t));
+	layout.stringData = layout.stringOffsets + ((size_t)header.stringCount + 1) * sizeof(uint32_t);
+	layout.size = layout.stringData + header.stringBytes;
+	return layout;
+}
+
+uint64_t LevelCache::Hash(const uint8_t * data, size_t size, uint64_t hash)
+{
+	//FNV-1a a word at a time, folded so the high bits reach the low ones. Calling it on consecutive blocks that are
+	//multiples of 8 bytes gives the same result as one call on the whole
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * LEVEL_CACHE_HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * LEVEL_CACHE_HASH_PRIME;
+	}
+	return hash;
+}
+
+
+LevelCacheWriter::LevelCacheWriter()
+{
+}
+
+
+LevelCacheWriter::~LevelCacheWriter()
+{
+}
+
+void LevelCacheWriter::Add(const SceneObject & object)
+{
+	for (int i = 0; i < INT_COLUMN_COUNT; i++)
+	{
+		m_ints.push_back(object.*INT_COLUMNS[i]);
+	}
+	for (int i = 0; i < FLOAT_COLUMN_COUNT; i++)
+	{
+		m_floats.push_back(object.*FLOAT_COLUMNS[i]);
+	}
+	uint32_t bools = 0;
+	for (int i = 0; i < BOOL_COLUMN_COUNT; i++)
+	{
+		if (object.*BOOL_COLUMNS[i])
+		{
+			bools |= 1u << i;
+		}
+	}
+	m_bools.push_back(bools);
+
+	//the same few asset paths are shared by most objects, each is stored once
+	for (int i = 0; i < STRING_COLUMN_COUNT; i++)
+	{
+		const std::string & string = object.*STRING_COLUMNS[i];
+		auto found = m_stringIndex.find(string);
+		if (found == m_stringIndex.end())
+		{
+			found = m_stringIndex.emplace(string, (uint32_t)m_stringTable.size()).first;
+			m_stringTable.push_back(string);
+		}
+		m_strings.push_back(found->second);
+	}
+}
+
+bool LevelCacheWriter::Write(const std::string & path, uint64_t & hash)
+{
+	//a chunk's objects become one run, in the order they were added
+	const uint32_t count = (uint32_t)m_bools.size();
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_ints[a * INT_COLUMN_COUNT + 1] < m_ints[b * INT_COLUMN_COUNT + 1];
+	});
+
+	std::vector<LevelCache::Chunk> chunks;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const int32_t chunkID = m_ints[order[i] * INT_COLUMN_COUNT + 1];
+		if (chunks.empty() || chunks.back().chunkID != chunkID)
+		{
+			LevelCache::Chunk chunk = { chunkID, i, 0 };
+			chunks.push_back(chunk);
+		}
+		chunks.back().objectCount++;
+	}
+
+	LevelCache::Header header;
+	memcpy(header.magic, "WLVC", 4);
+	header.version = LEVEL_CACHE_VERSION;
+	header.contentHash = 0;
+	header.objectCount = count;
+	header.chunkCount = (uint32_t)chunks.size();
+	header.stringCount = (uint32_t)m_stringTable.size();
+	header.stringBytes = 0;
+	for (size_t i = 0; i < m_stringTable.size(); i++)
+	{
+		header.stringBytes += (uint32_t)m_stringTable[i].size();
+	}
+	const LevelCache::Layout layout = LevelCache::GetLayout(header);
+
+	const std::string tempPath = path + ".tmp";
+	FILE * pFile = fopen(tempPath.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	//the sections are streamed out through one block, hashed as each block fills. The header goes last, once the hash is known
+	std::vector<uint8_t> block;
+	block.reserve(LEVEL_CACHE_WRITE_BLOCK);
+	size_t offset = sizeof(header);
+	uint64_t contentHash = LEVEL_CACHE_HASH_SEED;
+	bool written = fseek(pFile, sizeof(header), SEEK_SET) == 0;
+	auto flush = [&]()
+	{
+		contentHash = LevelCache::Hash(block.data(), block.size(), contentHash);
+		written = written && fwrite(block.data(), 1, block.size(), pFile) == block.size();
+		block.clear();
+	};
+	auto append = [&](const void * data, size_t size)
+	{
+		const uint8_t * bytes = (const uint8_t*)data;
+		offset += size;
+		while (size > 0)
+		{
+			const size_t part = std::min(size, (size_t)LEVEL_CACHE_WRITE_BLOCK - block.size());
+			block.insert(block.end(), bytes, bytes + part);
+			bytes += part;
+			size -= part;
+			if (block.size() == LEVEL_CACHE_WRITE_BLOCK)
+			{
+				flush();
+			}
+		}
+	};
+	auto pad = [&](size_t sectionStart)
+	{
+		const uint8_t zeros[8] = {};
+		append(zeros, sectionStart - offset);
+	};
+
+	append(chunks.data(), chunks.size() * sizeof(LevelCache::Chunk));
+	pad(layout.ints);
+	for (int column = 0; column < INT_COLUMN_COUNT; column++)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			append(&m_ints[order[i] * INT_COLUMN_COUNT + column], sizeof(int32_t));
+		}
+	}
+	pad(layout.floats);
+	for (int column = 0; column < FLOAT_COLUMN_COUNT; column++)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			append(&m_floats[order[i] * FLOAT_COLUMN_COUNT + column], sizeof(float));
+		}
+	}
+	pad(layout.bools);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		append(&m_bools[order[i]], sizeof(uint32_t));
+	}
+	pad(layout.strings);
+	for (int column = 0; column < STRING_COLUMN_COUNT; column++)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			append(&m_strings[order[i] * STRING_COLUMN_COUNT + column], sizeof(uint32_t));
+		}
+	}
+	pad(layout.stringOffsets);
+	uint32_t stringOffset = 0;
+	for (size_t i = 0; i < m_stringTable.size(); i++)
+	{
+		append(&stringOffset, sizeof(stringOffset));
+		stringOffset += (uint32_t)m_stringTable[i].size();
+	}
+	append(&stringOffset, sizeof(stringOffset));
+	for (size_t i = 0; i < m_stringTable.size(); i++)
+	{
+		append(m_stringTable[i].data(), m_stringTable[i].size());
+	}
+	flush();
+
+	header.contentHash = contentHash;
+	written = written && offset == layout.size;
+	written = written && fseek(pFile, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), pFile) == sizeof(header);
+	written = written && fflush(pFile) == 0;
+	written = (fclose(pFile) == 0) && written;
+
+	//the original is only replaced once the new file is complete on disk
+	if (!written || !MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	hash = contentHash;
+	return true;
+}
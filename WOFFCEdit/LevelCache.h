@@ -0,0 +1,96 @@
+#pragma once
+
+#include "SceneObject.h"
+#include "SceneStore.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//bumped whenever the layout below changes, older files are then ignored and rebuilt
+#define LEVEL_CACHE_VERSION 1
+
+//A binary snapshot of the Objects table, kept next to the level database so startup can skip the SQL.
+//The file is a header, a chunk table and then one fixed size array per column, each sorted by chunk so a chunk's objects
+//are one contiguous run in every array. Strings are stored once in a table and referenced by index.
+//Nothing in it needs parsing: the file is mapped, checked against its content hash and read in place.
+//The database keeps the hash of the cache that matches it, and clears it whenever the Objects table changes, so a
+//stale or foreign cache is never used.
+class LevelCache
+{
+public:
+	LevelCache();
+	~LevelCache();
+
+	bool	Open(const std::string & path, uint64_t expectedHash);	//maps the file. false if it is missing, damaged or not the expected one
+	void	Close();
+	bool	IsOpen() const;
+
+	int		CountObjects(int chunkID) const;
+	int		LoadObjects(int chunkID, SceneStore & sceneGraph) const;	//adds the chunk's objects in table order, returns how many
+
+private:
+	struct Header
+	{
+		char		magic[4];			//"WLVC"
+		uint32_t	version;
+		uint64_t	contentHash;		//of everything after the header
+		uint32_t	objectCount;
+		uint32_t	chunkCount;
+		uint32_t	stringCount;
+		uint32_t	stringBytes;
+	};
+
+	struct Chunk
+	{
+		int32_t		chunkID;
+		uint32_t	firstObject;
+		uint32_t	objectCount;
+	};
+
+	//where each section starts, worked out from the counts in the header
+	struct Layout
+	{
+		size_t	chunks;
+		size_t	ints;
+		size_t	floats;
+		size_t	bools;
+		size_t	strings;
+		size_t	stringOffsets;
+		size_t	stringData;
+		size_t	size;				//of the whole file
+	};
+
+	static Layout	GetLayout(const Header & header);
+	static uint64_t	Hash(const uint8_t * data, size_t size, uint64_t hash);		//carries hash on over data
+
+	const uint8_t *		m_data;
+	size_t				m_size;
+	void *				m_fileHandle;
+	void *				m_mappingHandle;
+	Header				m_header;
+	Layout				m_layout;
+	std::unordered_map<int, int>	m_chunkIndex;		//chunk ID to index in the chunk table
+	std::vector<StringHandle>		m_stringHandles;	//the string table, interned once when the file is opened
+
+	friend class LevelCacheWriter;
+};
+
+//Builds a level cache from the rows of the Objects table, in table order
+class LevelCacheWriter
+{
+public:
+	LevelCacheWriter();
+	~LevelCacheWriter();
+
+	void	Add(const SceneObject & object);
+	bool	Write(const std::string & path, uint64_t & hash);		//writes through a temporary file, hash is the new file's content hash
+
+private:
+	std::vector<int32_t>	m_ints;			//rows of INT_COLUMN_COUNT
+	std::vector<float>		m_floats;		//rows of FLOAT_COLUMN_COUNT
+	std::vector<uint32_t>	m_bools;		//a bit per bool column
+	std::vector<uint32_t>	m_strings;		//rows of STRING_COLUMN_COUNT indices into the string table
+	std::vector<std::string>	m_stringTable;
+	std::unordered_map<std::string, uint32_t>	m_stringIndex;
+};
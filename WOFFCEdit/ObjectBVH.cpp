@@ -0,0 +1,277 @@
+#include "ObjectBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+//objects per leaf. Small leaves keep the exact per-mesh tests down to a handful per pick
+#define BVH_LEAF_SIZE 4
+
+
+ObjectBVH::ObjectBVH()
+{
+}
+
+
+ObjectBVH::~ObjectBVH()
+{
+}
+
+void ObjectBVH::Build(const std::vector<BoundingBox> & objectBounds)
+{
+	Clear();
+	const int numObjects = (int)objectBounds.size();
+	if (numObjects == 0)
+	{
+		return;
+	}
+
+	//split on box centres, worked out once rather than at every level
+	std::vector<XMFLOAT3> centres(numObjects);
+	m_objectIndices.resize(numObjects);
+	for (int i = 0; i < numObjects; i++)
+	{
+		centres[i] = objectBounds[i].Center;
+		m_objectIndices[i] = i;
+	}
+
+	m_nodes.reserve(2 * (numObjects / BVH_LEAF_SIZE + 1));
+	m_nodes.emplace_back();
+	BuildNode(0, 0, numObjects, objectBounds, centres);
+}
+
+void ObjectBVH::Refit(const std::vector<BoundingBox> & objectBounds)
+{
+	if (m_nodes.empty() || (int)objectBounds.size() != GetObjectCount())
+	{
+		Build(objectBounds);	//the set of objects changed, a refit would leave some out
+		return;
+	}
+	RefitNode(0, objectBounds);
+}
+
+void ObjectBVH::Clear()
+{
+	m_nodes.clear();
+	m_objectIndices.clear();
+}
+
+int ObjectBVH::GetObjectCount() const
+{
+	return (int)m_objectIndices.size();
+}
+
+int ObjectBVH::IntersectRay(FXMVECTOR origin, FXMVECTOR direction, const ObjectRayTest & objectTest, float & distance) const
+{
+	int nearestObject = -1;
+	distance = FLT_MAX;
+	if (m_nodes.empty())
+	{
+		return nearestObject;
+	}
+
+	float rayOrigin[3];
+	float inverseDirection[3];
+	XMFLOAT3 directionValues;
+	XMStoreFloat3(&directionValues, direction);
+	rayOrigin[0] = XMVectorGetX(origin);
+	rayOrigin[1] = XMVectorGetY(origin);
+	rayOrigin[2] = XMVectorGetZ(origin);
+	const float directionComponents[3] = { directionValues.x, directionValues.y, directionValues.z };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		//a large finite value rather than infinity, so a ray lying on a slab plane does not produce NaN
+		inverseDirection[axis] = fabsf(directionComponents[axis]) > 1e-12f ? 1.0f / directionComponents[axis] : 1e30f;
+	}
+
+	float rootEntry;
+	if (!RayHitsNode(m_nodes[0], rayOrigin, inverseDirection, distance, rootEntry))
+	{
+		return nearestObject;
+	}
+
+	//explicit stack of (node, entry distance). Nearer children are pushed last so they are visited first
+	std::vector<std::pair<int, float>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0, rootEntry));
+
+	while (!stack.empty())
+	{
+		const std::pair<int, float> entry = stack.back();
+		stack.pop_back();
+		if (entry.second > distance)
+		{
+			continue;		//something nearer has already been hit
+		}
+
+		const Node & node = m_nodes[entry.first];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float objectDistance;
+				if (objectTest(m_objectIndices[i], objectDistance) && objectDistance < distance)
+				{
+					distance = objectDistance;
+					nearestObject = m_objectIndices[i];
+				}
+			}
+			continue;
+		}
+
+		float leftEntry, rightEntry;
+		const bool hitLeft = RayHitsNode(m_nodes[node.first], rayOrigin, inverseDirection, distance, leftEntry);
+		const bool hitRight = RayHitsNode(m_nodes[node.first + 1], rayOrigin, inverseDirection, distance, rightEntry);
+		if (hitLeft && hitRight)
+		{
+			if (leftEntry < rightEntry)
+			{
+				stack.push_back(std::make_pair(node.first + 1, rightEntry));
+				stack.push_back(std::make_pair(node.first, leftEntry));
+			}
+			else
+			{
+				stack.push_back(std::make_pair(node.first, leftEntry));
+				stack.push_back(std::make_pair(node.first + 1, rightEntry));
+			}
+		}
+		else if (hitLeft)
+		{
+			stack.push_back(std::make_pair(node.first, leftEntry));
+		}
+		else if (hitRight)
+		{
+			stack.push_back(std::make_pair(node.first + 1, rightEntry));
+		}
+	}
+
+	return nearestObject;
+}
+
+void ObjectBVH::BuildNode(int nodeIndex, int first, int count, const std::vector<BoundingBox> & objectBounds, const std::vector<XMFLOAT3> & centres)
+{
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centreMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 centreMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		const BoundingBox & box = objectBounds[m_objectIndices[i]];
+		const XMFLOAT3 & centre = centres[m_objectIndices[i]];
+		boundsMin.x = std::min(boundsMin.x, box.Center.x - box.Extents.x);
+		boundsMin.y = std::min(boundsMin.y, box.Center.y - box.Extents.y);
+		boundsMin.z = std::min(boundsMin.z, box.Center.z - box.Extents.z);
+		boundsMax.x = std::max(boundsMax.x, box.Center.x + box.Extents.x);
+		boundsMax.y = std::max(boundsMax.y, box.Center.y + box.Extents.y);
+		boundsMax.z = std::max(boundsMax.z, box.Center.z + box.Extents.z);
+		centreMin.x = std::min(centreMin.x, centre.x);	centreMax.x = std::max(centreMax.x, centre.x);
+		centreMin.y = std::min(centreMin.y, centre.y);	centreMax.y = std::max(centreMax.y, centre.y);
+		centreMin.z = std::min(centreMin.z, centre.z);	centreMax.z = std::max(centreMax.z, centre.z);
+	}
+	m_nodes[nodeIndex].boundsMin = boundsMin;
+	m_nodes[nodeIndex].boundsMax = boundsMax;
+
+	if (count <= BVH_LEAF_SIZE)
+	{
+		m_nodes[nodeIndex].first = first;
+		m_nodes[nodeIndex].count = count;
+		return;
+	}
+
+	//median split along the axis the centres are most spread out on
+	const float extentX = centreMax.x - centreMin.x;
+	const float extentY = centreMax.y - centreMin.y;
+	const float extentZ = centreMax.z - centreMin.z;
+	int axis = 0;
+	if (extentY > extentX && extentY >= extentZ)
+	{
+		axis = 1;
+	}
+	else if (extentZ > extentX && extentZ > extentY)
+	{
+		axis = 2;
+	}
+
+	auto centreOnAxis = [&](int objectIndex) -> float
+	{
+		const XMFLOAT3 & centre = centres[objectIndex];
+		return axis == 0 ? centre.x : (axis == 1 ? centre.y : centre.z);
+	};
+	const int half = count / 2;
+	std::nth_element(m_objectIndices.begin() + first, m_objectIndices.begin() + first + half, m_objectIndices.begin() + first + count,
+		[&](int a, int b) { return centreOnAxis(a) < centreOnAxis(b); });
+
+	//children are allocated as a pair. Indices rather than references, the array grows while they are built
+	const int leftChild = (int)m_nodes.size();
+	m_nodes[nodeIndex].first = leftChild;
+	m_nodes[nodeIndex].count = 0;
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+
+	BuildNode(leftChild, first, half, objectBounds, centres);
+	BuildNode(leftChild + 1, first + half, count - half, objectBounds, centres);
+}
+
+void ObjectBVH::RefitNode(int nodeIndex, const std::vector<BoundingBox> & objectBounds)
+{
+	Node & node = m_nodes[nodeIndex];
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	if (node.count > 0)
+	{
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			const BoundingBox & box = objectBounds[m_objectIndices[i]];
+			boundsMin.x = std::min(boundsMin.x, box.Center.x - box.Extents.x);
+			boundsMin.y = std::min(boundsMin.y, box.Center.y - box.Extents.y);
+			boundsMin.z = std::min(boundsMin.z, box.Center.z - box.Extents.z);
+			boundsMax.x = std::max(boundsMax.x, box.Center.x + box.Extents.x);
+			boundsMax.y = std::max(boundsMax.y, box.Center.y + box.Extents.y);
+			boundsMax.z = std::max(boundsMax.z, box.Center.z + box.Extents.z);
+		}
+	}
+	else
+	{
+		RefitNode(node.first, objectBounds);
+		RefitNode(node.first + 1, objectBounds);
+		const Node & left = m_nodes[node.first];
+		const Node & right = m_nodes[node.first + 1];
+		boundsMin.x = std::min(left.boundsMin.x, right.boundsMin.x);
+		boundsMin.y = std::min(left.boundsMin.y, right.boundsMin.y);
+		boundsMin.z = std::min(left.boundsMin.z, right.boundsMin.z);
+		boundsMax.x = std::max(left.boundsMax.x, right.boundsMax.x);
+		boundsMax.y = std::max(left.boundsMax.y, right.boundsMax.y);
+		boundsMax.z = std::max(left.boundsMax.z, right.boundsMax.z);
+	}
+
+	node.boundsMin = boundsMin;
+	node.boundsMax = boundsMax;
+}
+
+bool ObjectBVH::RayHitsNode(const Node & node, const float origin[3], const float inverseDirection[3], float maxDistance, float & entryDistance) const
+{
+	//slab test against the node box
+	const float boundsMin[3] = { node.boundsMin.x, node.boundsMin.y, node.boundsMin.z };
+	const float boundsMax[3] = { node.boundsMax.x, node.boundsMax.y, node.boundsMax.z };
+	float tNear = 0.0f;
+	float tFar = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		tNear = std::max(tNear, t0);
+		tFar = std::min(tFar, t1);
+		if (tNear > tFar)
+		{
+			return false;
+		}
+	}
+	entryDistance = tNear;
+	return true;
+}
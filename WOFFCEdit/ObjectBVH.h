@@ -0,0 +1,44 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <functional>
+#include <vector>
+
+//Bounding volume hierarchy over the world space bounds of the display list, used for picking.
+//Nodes live in one flat array, children of an inner node are stored next to each other.
+//Build when objects are added or removed, Refit when they only move.
+class ObjectBVH
+{
+public:
+	//exact test for one object, given the world ray. Returns true and the world distance on a hit
+	typedef std::function<bool(int objectIndex, float & distance)> ObjectRayTest;
+
+	ObjectBVH();
+	~ObjectBVH();
+
+	void	Build(const std::vector<DirectX::BoundingBox> & objectBounds);		//one box per display list index
+	void	Refit(const std::vector<DirectX::BoundingBox> & objectBounds);		//same objects, new bounds. Keeps the tree shape
+	void	Clear();
+	int		GetObjectCount() const;
+
+	//walks the tree front to back, skipping anything further away than the best hit so far.
+	//returns the nearest object index or -1, and its distance
+	int		IntersectRay(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, const ObjectRayTest & objectTest, float & distance) const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3	boundsMin;
+		DirectX::XMFLOAT3	boundsMax;
+		int					first;		//leaf: first entry in m_objectIndices. inner: index of the left child, right is first + 1
+		int					count;		//number of objects in a leaf, 0 for an inner node
+	};
+
+	void	BuildNode(int nodeIndex, int first, int count, const std::vector<DirectX::BoundingBox> & objectBounds, const std::vector<DirectX::XMFLOAT3> & centres);
+	void	RefitNode(int nodeIndex, const std::vector<DirectX::BoundingBox> & objectBounds);
+	bool	RayHitsNode(const Node & node, const float origin[3], const float inverseDirection[3], float maxDistance, float & entryDistance) const;
+
+	std::vector<Node>	m_nodes;			//m_nodes[0] is the root
+	std::vector<int>	m_objectIndices;	//display list indices, grouped by leaf
+};
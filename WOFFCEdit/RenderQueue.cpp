@@ -0,0 +1,70 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+
+RenderQueue::RenderQueue()
+{
+}
+
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+	//keeps the capacity, the queue is refilled every frame with much the same number of objects
+	m_items.clear();
+	m_batches.clear();
+	m_instances.clear();
+}
+
+void RenderQueue::Add(const void * key, int objectIndex)
+{
+	m_items.push_back(std::make_pair(key, objectIndex));
+}
+
+void RenderQueue::Sort()
+{
+	//pairs compare on the key first and the object index second, so this groups by key and keeps display list order within a group
+	std::sort(m_items.begin(), m_items.end());
+
+	m_batches.clear();
+	m_instances.resize(m_items.size());
+	for (int i = 0; i < (int)m_items.size(); i++)
+	{
+		if (m_batches.empty() || m_batches.back().key != m_items[i].first)
+		{
+			Batch batch;
+			batch.key = m_items[i].first;
+			batch.first = i;
+			batch.count = 0;
+			m_batches.push_back(batch);
+		}
+		m_batches.back().count++;
+		m_instances[i] = m_items[i].second;
+	}
+}
+
+const std::vector<RenderQueue::Batch> & RenderQueue::GetBatches() const
+{
+	return m_batches;
+}
+
+const std::vector<int> & RenderQueue::GetInstances() const
+{
+	return m_instances;
+}
+
+void RenderStatistics::AddRun(int objects, int parts, int instancedParts)
+{
+	//a part that cannot be instanced is drawn once per object
+	stateChanges += parts;
+	drawCalls += instancedParts + (parts - instancedParts) * objects;
+}
+
+void RenderStatistics::AddBatch(int objects)
+{
+	batches++;
+	instances += objects;
+}
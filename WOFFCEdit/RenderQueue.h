@@ -0,0 +1,50 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+//per frame draw and state counts, filled in by Game::Render
+struct RenderStatistics
+{
+	int		batches = 0;		//unique (model, texture) pairs drawn
+	int		instances = 0;		//objects drawn
+	int		drawCalls = 0;		//one per mesh part per batch when drawn instanced, otherwise one per mesh part per instance
+	int		stateChanges = 0;	//mesh part setups, one per mesh part per batch
+	int		terrainTriangles = 0;	//after LOD, across all chunks
+	int		visibleObjects = 0;		//inside the view frustum
+	int		culledObjects = 0;		//outside it, never queued
+	int		terrainNodesCulled = 0;	//LOD nodes, or whole chunks without LOD, outside it
+
+	void	AddRun(int objects, int parts, int instancedParts);	//objects drawn with parts mesh parts set up once, instancedParts of them in one draw each
+	void	AddBatch(int objects);
+};
+
+//Groups the objects to draw by the asset they are drawn with, so the renderer sets each mesh up once per frame
+//and then draws every object using it. The key is whatever identifies the asset. The asset cache shares one model
+//per (mesh, texture) pair, so the model pointer is enough for the display list.
+//Holds no device objects, only keys and display list indices.
+class RenderQueue
+{
+public:
+	struct Batch
+	{
+		const void *	key;
+		int				first;		//into GetInstances()
+		int				count;
+	};
+
+	RenderQueue();
+	~RenderQueue();
+
+	void	Clear();
+	void	Add(const void * key, int objectIndex);
+	void	Sort();			//builds the batches. Objects in a batch keep the order they were added in
+
+	const std::vector<Batch> &	GetBatches() const;
+	const std::vector<int> &	GetInstances() const;		//object indices, grouped by batch
+
+private:
+	std::vector<std::pair<const void*, int>>	m_items;	//key, object index, in the order added
+	std::vector<Batch>							m_batches;
+	std::vector<int>							m_instances;
+};
@@ -0,0 +1,781 @@
+#include "SceneDatabase.h"
+#include "LevelCache.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+
+//columns of the Objects table in the order they are bound.  Note the schema names differ from the SceneObject members.
+static const char * const OBJECT_COLUMNS[] =
+{
+	"ID", "chunk_ID", "mesh", "tex_diffuse",
+	"position_x", "position_y", "position_z",
+	"rotation_x", "rotation_y", "rotation_z",
+	"scale_x", "scale_y", "scale_z",
+	"render", "collision", "collision_mesh", "collectable", "destructable", "health_amount",
+	"editor_render", "editor_texture_vis", "editor_normals_vis", "editor_collision_vis", "editor_pivot_vis",
+	"pivot_x", "pivot_y", "pivot_z",
+	"snap_to_ground", "AI_node", "audio_file", "volume", "pitch", "pan",
+	"one_shot", "play_on_init", "play_in_editor", "min_dist", "max_dist",
+	"camera", "path_node", "path_node_start", "path_node_end", "parent_ID",
+	"editor_wireframe", "name",
+	"light_type", "light_diffuse_r", "light_diffuse_g", "light_diffuse_b",
+	"light_specular_r", "light_specular_g", "light_specular_b",
+	"light_spot_cutoff", "light_constant", "light_linear", "light_quadratic"
+};
+static const int OBJECT_COLUMN_COUNT = sizeof(OBJECT_COLUMNS) / sizeof(OBJECT_COLUMNS[0]);
+
+
+SceneDatabase::SceneDatabase()
+{
+	m_databaseConnection = NULL;
+	m_insertObject = NULL;
+	m_updateObject = NULL;
+	m_deleteObject = NULL;
+	m_insertAutosave = NULL;
+	m_deleteAutosave = NULL;
+	m_insertAutosaveDeleted = NULL;
+	m_deleteAutosaveDeleted = NULL;
+	m_selectObjects = NULL;
+}
+
+
+SceneDatabase::~SceneDatabase()
+{
+	Close();
+}
+
+bool SceneDatabase::Open(const char * path)
+{
+	Close();
+
+	int rc = sqlite3_open_v2(path, &m_databaseConnection, SQLITE_OPEN_READWRITE, NULL);
+	if (rc != SQLITE_OK)
+	{
+		Close();
+		return false;
+	}
+
+	//readers no longer block the writer, so the autosave thread can commit while a chunk streams in.
+	//NORMAL only syncs at checkpoints, a crash can lose the last commits but never corrupts the file
+	Execute("PRAGMA journal_mode = WAL");
+	Execute("PRAGMA synchronous = NORMAL");
+	sqlite3_busy_timeout(m_databaseConnection, 2000);	//two connections now write, wait for the other rather than fail
+
+	//incremental saves look rows up by ID. The table has no key so give it an index to keep that O(log n)
+	Execute("CREATE INDEX IF NOT EXISTS Objects_ID ON Objects (ID)");
+	//chunks are loaded one at a time with WHERE chunk_ID = ?
+	Execute("CREATE INDEX IF NOT EXISTS Objects_chunk_ID ON Objects (chunk_ID)");
+
+	//the recovery tables, with the same columns as Objects
+	std::string columns;
+	for (int i = 0; i < OBJECT_COLUMN_COUNT; i++)
+	{
+		columns += (i > 0 ? ", " : "") + std::string(OBJECT_COLUMNS[i]);
+	}
+	Execute(("CREATE TABLE IF NOT EXISTS AutosaveObjects (" + columns + ")").c_str());
+	Execute("CREATE INDEX IF NOT EXISTS AutosaveObjects_ID ON AutosaveObjects (ID)");
+	Execute("CREATE TABLE IF NOT EXISTS AutosaveDeleted (ID INTEGER PRIMARY KEY)");
+
+	//the level cache is only trusted while this holds its hash
+	Execute("CREATE TABLE IF NOT EXISTS LevelCache (content_hash INTEGER)");
+	Execute("CREATE TRIGGER IF NOT EXISTS LevelCache_insert AFTER INSERT ON Objects BEGIN DELETE FROM LevelCache; END");
+	Execute("CREATE TRIGGER IF NOT EXISTS LevelCache_update AFTER UPDATE ON Objects BEGIN DELETE FROM LevelCache; END");
+	Execute("CREATE TRIGGER IF NOT EXISTS LevelCache_delete AFTER DELETE ON Objects BEGIN DELETE FROM LevelCache; END");
+
+	return PrepareStatements();
+}
+
+void SceneDatabase::Close()
+{
+	//statements have to be finalized before the connection will close
+	FinalizeStatements();
+	sqlite3_close(m_databaseConnection);
+	m_databaseConnection = NULL;
+}
+
+bool SceneDatabase::IsOpen() const
+{
+	return m_databaseConnection != NULL;
+}
+
+sqlite3 * SceneDatabase::GetConnection() const
+{
+	return m_databaseConnection;
+}
+
+bool SceneDatabase::LoadChunks(std::vector<ChunkObject> & chunks)
+{
+	chunks.clear();
+
+	sqlite3_stmt * chunkStatement = NULL;
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT * FROM Chunks", -1, &chunkStatement, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+
+	//the Chunks schema names (chunk_z_size_metres, heightmap, diffuse_tiling...) differ from ChunkObject, so look them up by name
+	const int resultColumns = sqlite3_column_count(chunkStatement);
+	auto findColumn = [&](const char * name)
+	{
+		const int nameLength = (int)strlen(name);
+		for (int column = 0; column < resultColumns; column++)
+		{
+			const char * columnName = sqlite3_column_name(chunkStatement, column);
+			if ((int)strlen(columnName) == nameLength && sqlite3_strnicmp(columnName, name, nameLength) == 0)
+			{
+				return column;
+			}
+		}
+		return -1;
+	};
+	const int idColumn				= findColumn("ID");
+	const int nameColumn			= findColumn("name");
+	const int xSizeColumn			= findColumn("chunk_x_size_metres");
+	const int zSizeColumn			= findColumn("chunk_z_size_metres");
+	const int resolutionColumn		= findColumn("chunk_base_resolution");
+	const int heightmapColumn		= findColumn("heightmap");
+	const int diffuseColumn			= findColumn("tex_diffuse");
+	const int splatAlphaColumn		= findColumn("tex_spat_alpha");
+	const int splat1Column			= findColumn("tex_splat_1");
+	const int splat2Column			= findColumn("tex_splat_2");
+	const int splat3Column			= findColumn("tex_splat_3");
+	const int splat4Column			= findColumn("tex_splat_4");
+	const int wireframeColumn		= findColumn("render_wireframe");
+	const int normalsColumn			= findColumn("render_normals");
+	const int diffuseTilingColumn	= findColumn("diffuse_tiling");
+	const int splat1TilingColumn	= findColumn("tex_splat_1_tiling");
+	const int splat2TilingColumn	= findColumn("tex_splat_2_tiling");
+	const int splat3TilingColumn	= findColumn("tex_splat_3_tiling");
+	const int splat4TilingColumn	= findColumn("tex_splat_4_tiling");
+	const int originXColumn			= findColumn("origin_x");
+	const int originZColumn			= findColumn("origin_z");
+
+	auto readInt = [&](int column, int fallback) { return column >= 0 ? sqlite3_column_int(chunkStatement, column) : fallback; };
+	auto readFloat = [&](int column) { return column >= 0 ? (float)sqlite3_column_double(chunkStatement, column) : 0.0f; };
+	auto readText = [&](int column, std::string & value)
+	{
+		const char * text = column >= 0 ? reinterpret_cast<const char*>(sqlite3_column_text(chunkStatement, column)) : NULL;
+		value = text ? text : "";
+	};
+
+	while (sqlite3_step(chunkStatement) == SQLITE_ROW)
+	{
+		chunks.emplace_back();
+		ChunkObject & chunk = chunks.back();
+		chunk.ID = readInt(idColumn, 0);
+		readText(nameColumn, chunk.name);
+		chunk.chunk_x_size_metres = readInt(xSizeColumn, 0);
+		chunk.chunk_y_size_metres = readInt(zSizeColumn, 0);
+		chunk.chunk_base_resolution = readInt(resolutionColumn, 0);
+		readText(heightmapColumn, chunk.heightmap_path);
+		readText(diffuseColumn, chunk.tex_diffuse_path);
+		readText(splatAlphaColumn, chunk.tex_splat_alpha_path);
+		readText(splat1Column, chunk.tex_splat_1_path);
+		readText(splat2Column, chunk.tex_splat_2_path);
+		readText(splat3Column, chunk.tex_splat_3_path);
+		readText(splat4Column, chunk.tex_splat_4_path);
+		chunk.render_wireframe = readInt(wireframeColumn, 0) != 0;
+		chunk.render_normals = readInt(normalsColumn, 0) != 0;
+		chunk.tex_diffuse_tiling = readInt(diffuseTilingColumn, 1);
+		chunk.tex_splat_1_tiling = readInt(splat1TilingColumn, 1);
+		chunk.tex_splat_2_tiling = readInt(splat2TilingColumn, 1);
+		chunk.tex_splat_3_tiling = readInt(splat3TilingColumn, 1);
+		chunk.tex_splat_4_tiling = readInt(splat4TilingColumn, 1);
+		chunk.origin_x = readFloat(originXColumn);
+		chunk.origin_z = readFloat(originZColumn);
+	}
+
+	sqlite3_finalize(chunkStatement);
+	return true;
+}
+
+int SceneDatabase::CountObjects(int chunkID)
+{
+	sqlite3_stmt * countStatement = NULL;
+	int count = 0;
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT COUNT(*) FROM Objects WHERE chunk_ID = ?1", -1, &countStatement, 0) == SQLITE_OK
+		&& sqlite3_bind_int(countStatement, 1, chunkID) == SQLITE_OK
+		&& sqlite3_step(countStatement) == SQLITE_ROW)
+	{
+		count = sqlite3_column_int(countStatement, 0);
+	}
+	sqlite3_finalize(countStatement);
+	return count;
+}
+
+int SceneDatabase::GetMaxObjectID()
+{
+	sqlite3_stmt * maxStatement = NULL;
+	int maxID = 0;
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT MAX(ID) FROM Objects", -1, &maxStatement, 0) == SQLITE_OK
+		&& sqlite3_step(maxStatement) == SQLITE_ROW)
+	{
+		maxID = sqlite3_column_int(maxStatement, 0);
+	}
+	sqlite3_finalize(maxStatement);
+	return maxID;
+}
+
+bool SceneDatabase::BeginLoadObjects(int chunkID)
+{
+	EndLoadObjects();
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT * FROM Objects WHERE chunk_ID = ?1", -1, &m_selectObjects, 0) != SQLITE_OK
+		|| sqlite3_bind_int(m_selectObjects, 1, chunkID) != SQLITE_OK)
+	{
+		EndLoadObjects();
+		return false;
+	}
+
+	MapSelectColumns(m_selectObjects);
+	return true;
+}
+
+int SceneDatabase::LoadObjectBatch(SceneStore & sceneGraph, int maxRows)
+{
+	if (!IsLoadingObjects())
+	{
+		return 0;
+	}
+
+	int rowsRead = 0;
+	while (rowsRead < maxRows)
+	{
+		if (sqlite3_step(m_selectObjects) != SQLITE_ROW)
+		{
+			EndLoadObjects();		//finished, or the read failed. Either way there is nothing more to stream
+			break;
+		}
+
+		//a fresh row each time, so columns missing from the table keep their defaults
+		SceneObject object;
+		ReadSceneObject(m_selectObjects, object);
+		sceneGraph.Add(object);
+		rowsRead++;
+	}
+	return rowsRead;
+}
+
+bool SceneDatabase::IsLoadingObjects() const
+{
+	return m_selectObjects != NULL;
+}
+
+void SceneDatabase::EndLoadObjects()
+{
+	sqlite3_finalize(m_selectObjects);
+	m_selectObjects = NULL;
+}
+
+SaveStatistics SceneDatabase::SaveChanges(SceneStore & sceneGraph)
+{
+	SaveStatistics stats;
+	if (!IsOpen())
+	{
+		return stats;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (!Execute("BEGIN IMMEDIATE TRANSACTION"))
+	{
+		return stats;
+	}
+
+	bool ok = true;
+	const std::vector<int> & deletedObjectIDs = sceneGraph.GetDeletedIDs();
+	for (size_t i = 0; ok && i < deletedObjectIDs.size(); i++)
+	{
+		ok = sqlite3_bind_int(m_deleteObject, 1, deletedObjectIDs[i]) == SQLITE_OK && sqlite3_step(m_deleteObject) == SQLITE_DONE;
+		sqlite3_reset(m_deleteObject);
+		if (ok)
+		{
+			stats.rowsDeleted++;
+		}
+	}
+
+	//the flags are checked from their own array, only the objects being written are put back together as rows
+	SceneObject object;
+	const int numObjects = sceneGraph.GetCount();
+	const unsigned int * flags = sceneGraph.GetFlags();
+	for (int i = 0; ok && i < numObjects; i++)
+	{
+		if (!(flags[i] & (SCENE_OBJECT_DIRTY | SCENE_OBJECT_INSERTED)))
+		{
+			continue;
+		}
+		sceneGraph.Get(i, object);
+
+		//upsert keyed on ID. Try the update first, fall back to an insert if no row had that ID
+		bool needsInsert = object.inserted;
+		if (!needsInsert)
+		{
+			ok = BindSceneObject(m_updateObject, object) && sqlite3_step(m_updateObject) == SQLITE_DONE;
+			sqlite3_reset(m_updateObject);
+			needsInsert = ok && sqlite3_changes(m_databaseConnection) == 0;
+		}
+		if (ok && needsInsert)
+		{
+			ok = BindSceneObject(m_insertObject, object) && sqlite3_step(m_insertObject) == SQLITE_DONE;
+			sqlite3_reset(m_insertObject);
+		}
+		if (ok)
+		{
+			stats.rowsWritten++;
+		}
+	}
+	sqlite3_clear_bindings(m_updateObject);
+	sqlite3_clear_bindings(m_insertObject);
+
+	if (ok)
+	{
+		ok = Execute("COMMIT TRANSACTION");
+	}
+	if (!ok)
+	{
+		//keep the flags so nothing is lost, the next save will try the same delta again
+		Execute("ROLLBACK TRANSACTION");
+		stats.rowsWritten = 0;
+		stats.rowsDeleted = 0;
+	}
+	else
+	{
+		for (int i = 0; i < numObjects; i++)
+		{
+			sceneGraph.SetFlag(i, SCENE_OBJECT_DIRTY, false);
+			sceneGraph.SetFlag(i, SCENE_OBJECT_INSERTED, false);
+			sceneGraph.SetFlag(i, SCENE_OBJECT_AUTOSAVE, false);		//the save has it, the recovery tables are cleared after
+		}
+		sceneGraph.ClearDeletedIDs();
+	}
+
+	stats.succeeded = ok;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.seconds > 0.0)
+	{
+		stats.rowsPerSecond = (stats.rowsWritten + stats.rowsDeleted) / stats.seconds;
+	}
+	return stats;
+}
+
+SaveStatistics SceneDatabase::WriteAutosave(const std::vector<SceneObject> & objects, const std::vector<int> & deletedObjectIDs)
+{
+	SaveStatistics stats;
+	if (!IsOpen())
+	{
+		return stats;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	if (!Execute("BEGIN IMMEDIATE TRANSACTION"))
+	{
+		return stats;
+	}
+
+	//a deleted object takes its autosaved row with it, so one inserted and deleted before any save is not brought back
+	bool ok = true;
+	for (size_t i = 0; ok && i < deletedObjectIDs.size(); i++)
+	{
+		ok = sqlite3_bind_int(m_deleteAutosave, 1, deletedObjectIDs[i]) == SQLITE_OK && sqlite3_step(m_deleteAutosave) == SQLITE_DONE;
+		sqlite3_reset(m_deleteAutosave);
+		ok = ok && sqlite3_bind_int(m_insertAutosaveDeleted, 1, deletedObjectIDs[i]) == SQLITE_OK && sqlite3_step(m_insertAutosaveDeleted) == SQLITE_DONE;
+		sqlite3_reset(m_insertAutosaveDeleted);
+		if (ok)
+		{
+			stats.rowsDeleted++;
+		}
+	}
+
+	//each row replaces any earlier autosave of the same object
+	for (size_t i = 0; ok && i < objects.size(); i++)
+	{
+		const int ID = objects[i].ID;
+		ok = sqlite3_bind_int(m_deleteAutosave, 1, ID) == SQLITE_OK && sqlite3_step(m_deleteAutosave) == SQLITE_DONE;
+		sqlite3_reset(m_deleteAutosave);
+		ok = ok && sqlite3_bind_int(m_deleteAutosaveDeleted, 1, ID) == SQLITE_OK && sqlite3_step(m_deleteAutosaveDeleted) == SQLITE_DONE;
+		sqlite3_reset(m_deleteAutosaveDeleted);
+		ok = ok && BindSceneObject(m_insertAutosave, objects[i]) && sqlite3_step(m_insertAutosave) == SQLITE_DONE;
+		sqlite3_reset(m_insertAutosave);
+		if (ok)
+		{
+			stats.rowsWritten++;
+		}
+	}
+	sqlite3_clear_bindings(m_insertAutosave);
+
+	ok = ok && Execute("COMMIT TRANSACTION");
+	if (!ok)
+	{
+		Execute("ROLLBACK TRANSACTION");
+		stats.rowsWritten = 0;
+		stats.rowsDeleted = 0;
+	}
+
+	stats.succeeded = ok;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.seconds > 0.0)
+	{
+		stats.rowsPerSecond = (stats.rowsWritten + stats.rowsDeleted) / stats.seconds;
+	}
+	return stats;
+}
+
+bool SceneDatabase::ClearAutosave()
+{
+	return IsOpen() && Execute("BEGIN IMMEDIATE TRANSACTION; DELETE FROM AutosaveObjects; DELETE FROM AutosaveDeleted; COMMIT TRANSACTION");
+}
+
+bool SceneDatabase::HasAutosave()
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	sqlite3_stmt * countStatement = NULL;
+	bool found = false;
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT EXISTS (SELECT 1 FROM AutosaveObjects) OR EXISTS (SELECT 1 FROM AutosaveDeleted)", -1, &countStatement, 0) == SQLITE_OK
+		&& sqlite3_step(countStatement) == SQLITE_ROW)
+	{
+		found = sqlite3_column_int(countStatement, 0) != 0;
+	}
+	sqlite3_finalize(countStatement);
+	return found;
+}
+
+SaveStatistics SceneDatabase::RecoverAutosave()
+{
+	SaveStatistics stats;
+	if (!IsOpen())
+	{
+		return stats;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	if (!Execute("BEGIN IMMEDIATE TRANSACTION"))
+	{
+		return stats;
+	}
+
+	//deleted and autosaved objects leave Objects, then the autosaved rows go back in
+	std::string columns;
+	for (int i = 0; i < OBJECT_COLUMN_COUNT; i++)
+	{
+		columns += (i > 0 ? ", " : "") + std::string(OBJECT_COLUMNS[i]);
+	}
+	bool ok = Execute("DELETE FROM Objects WHERE ID IN (SELECT ID FROM AutosaveDeleted)");
+	stats.rowsDeleted = ok ? sqlite3_changes(m_databaseConnection) : 0;
+	ok = ok && Execute("DELETE FROM Objects WHERE ID IN (SELECT ID FROM AutosaveObjects)");
+	ok = ok && Execute(("INSERT INTO Objects (" + columns + ") SELECT " + columns + " FROM AutosaveObjects").c_str());
+	stats.rowsWritten = ok ? sqlite3_changes(m_databaseConnection) : 0;
+	ok = ok && Execute("DELETE FROM AutosaveObjects") && Execute("DELETE FROM AutosaveDeleted");
+
+	ok = ok && Execute("COMMIT TRANSACTION");
+	if (!ok)
+	{
+		Execute("ROLLBACK TRANSACTION");
+		stats.rowsWritten = 0;
+		stats.rowsDeleted = 0;
+	}
+
+	stats.succeeded = ok;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.seconds > 0.0)
+	{
+		stats.rowsPerSecond = (stats.rowsWritten + stats.rowsDeleted) / stats.seconds;
+	}
+	return stats;
+}
+
+bool SceneDatabase::GetLevelCacheHash(uint64_t & hash)
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	sqlite3_stmt * hashStatement = NULL;
+	bool found = false;
+	if (sqlite3_prepare_v2(m_databaseConnection, "SELECT content_hash FROM LevelCache", -1, &hashStatement, 0) == SQLITE_OK
+		&& sqlite3_step(hashStatement) == SQLITE_ROW)
+	{
+		hash = (uint64_t)sqlite3_column_int64(hashStatement, 0);
+		found = true;
+	}
+	sqlite3_finalize(hashStatement);
+	return found;
+}
+
+bool SceneDatabase::WriteLevelCache(const char * path)
+{
+	EndLoadObjects();
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	//a deferred transaction reads one snapshot of the table. Recording the hash upgrades it to a write, which WAL
+	//refuses if another connection has committed since, so a cache of rows that have already changed is never recorded
+	if (!Execute("BEGIN TRANSACTION"))
+	{
+		return false;
+	}
+
+	sqlite3_stmt * selectStatement = NULL;
+	bool ok = sqlite3_prepare_v2(m_databaseConnection, "SELECT * FROM Objects", -1, &selectStatement, 0) == SQLITE_OK;
+	LevelCacheWriter writer;
+	if (ok)
+	{
+		MapSelectColumns(selectStatement);
+		int rc;
+		while ((rc = sqlite3_step(selectStatement)) == SQLITE_ROW)
+		{
+			SceneObject object;
+			ReadSceneObject(selectStatement, object);
+			writer.Add(object);
+		}
+		ok = rc == SQLITE_DONE;
+	}
+	sqlite3_finalize(selectStatement);
+
+	uint64_t hash = 0;
+	ok = ok && writer.Write(path, hash);
+
+	sqlite3_stmt * hashStatement = NULL;
+	ok = ok && Execute("DELETE FROM LevelCache")
+		&& sqlite3_prepare_v2(m_databaseConnection, "INSERT INTO LevelCache (content_hash) VALUES (?1)", -1, &hashStatement, 0) == SQLITE_OK
+		&& sqlite3_bind_int64(hashStatement, 1, (sqlite3_int64)hash) == SQLITE_OK
+		&& sqlite3_step(hashStatement) == SQLITE_DONE;
+	sqlite3_finalize(hashStatement);
+
+	ok = ok && Execute("COMMIT TRANSACTION");
+	if (!ok)
+	{
+		Execute("ROLLBACK TRANSACTION");
+	}
+	return ok;
+}
+
+bool SceneDatabase::PrepareStatements()
+{
+	//build "INSERT INTO Objects (ID, chunk_ID, ...) VALUES (?1, ?2, ...)" from the column list
+	std::string columns;
+	std::string parameters;
+	for (int i = 0; i < OBJECT_COLUMN_COUNT; i++)
+	{
+		if (i > 0)
+		{
+			columns += ", ";
+			parameters += ", ";
+		}
+		columns += OBJECT_COLUMNS[i];
+		parameters += "?" + std::to_string(i + 1);
+	}
+	const std::string insertCommand = "INSERT INTO Objects (" + columns + ") VALUES (" + parameters + ")";
+	const std::string insertAutosaveCommand = "INSERT INTO AutosaveObjects (" + columns + ") VALUES (" + parameters + ")";
+
+	//"UPDATE Objects SET chunk_ID = ?2, mesh = ?3, ... WHERE ID = ?1", same parameter numbers as the insert
+	std::string assignments;
+	for (int i = 1; i < OBJECT_COLUMN_COUNT; i++)
+	{
+		if (i > 1)
+		{
+			assignments += ", ";
+		}
+		assignments += std::string(OBJECT_COLUMNS[i]) + " = ?" + std::to_string(i + 1);
+	}
+	const std::string updateCommand = "UPDATE Objects SET " + assignments + " WHERE ID = ?1";
+
+	if (sqlite3_prepare_v2(m_databaseConnection, insertCommand.c_str(), -1, &m_insertObject, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	if (sqlite3_prepare_v2(m_databaseConnection, updateCommand.c_str(), -1, &m_updateObject, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	if (sqlite3_prepare_v2(m_databaseConnection, "DELETE FROM Objects WHERE ID = ?1", -1, &m_deleteObject, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	if (sqlite3_prepare_v2(m_databaseConnection, insertAutosaveCommand.c_str(), -1, &m_insertAutosave, 0) != SQLITE_OK
+		|| sqlite3_prepare_v2(m_databaseConnection, "DELETE FROM AutosaveObjects WHERE ID = ?1", -1, &m_deleteAutosave, 0) != SQLITE_OK
+		|| sqlite3_prepare_v2(m_databaseConnection, "INSERT OR IGNORE INTO AutosaveDeleted (ID) VALUES (?1)", -1, &m_insertAutosaveDeleted, 0) != SQLITE_OK
+		|| sqlite3_prepare_v2(m_databaseConnection, "DELETE FROM AutosaveDeleted WHERE ID = ?1", -1, &m_deleteAutosaveDeleted, 0) != SQLITE_OK)
+	{
+		return false;
+	}
+	return true;
+}
+
+void SceneDatabase::FinalizeStatements()
+{
+	sqlite3_finalize(m_insertObject);		//finalize on NULL is a harmless no-op
+	sqlite3_finalize(m_updateObject);
+	sqlite3_finalize(m_deleteObject);
+	sqlite3_finalize(m_insertAutosave);
+	sqlite3_finalize(m_deleteAutosave);
+	sqlite3_finalize(m_insertAutosaveDeleted);
+	sqlite3_finalize(m_deleteAutosaveDeleted);
+	EndLoadObjects();
+	m_insertObject = NULL;
+	m_updateObject = NULL;
+	m_deleteObject = NULL;
+	m_insertAutosave = NULL;
+	m_deleteAutosave = NULL;
+	m_insertAutosaveDeleted = NULL;
+	m_deleteAutosaveDeleted = NULL;
+}
+
+bool SceneDatabase::Execute(const char * sqlCommand)
+{
+	return sqlite3_exec(m_databaseConnection, sqlCommand, NULL, NULL, NULL) == SQLITE_OK;
+}
+
+bool SceneDatabase::BindSceneObject(sqlite3_stmt * statement, const SceneObject & object)
+{
+	//strings are bound SQLITE_STATIC, the object outlives the step that reads them.
+	//floats are bound as doubles so nothing is lost to text formatting.
+	int column = 1;
+	int rc = SQLITE_OK;
+	auto bindInt = [&](int value) { if (rc == SQLITE_OK) rc = sqlite3_bind_int(statement, column++, value); };
+	auto bindDouble = [&](double value) { if (rc == SQLITE_OK) rc = sqlite3_bind_double(statement, column++, value); };
+	auto bindText = [&](const std::string & value) { if (rc == SQLITE_OK) rc = sqlite3_bind_text(statement, column++, value.c_str(), (int)value.size(), SQLITE_STATIC); };
+
+	bindInt(object.ID);
+	bindInt(object.chunk_ID);
+	bindText(object.model_path);
+	bindText(object.tex_diffuse_path);
+	bindDouble(object.posX);	bindDouble(object.posY);	bindDouble(object.posZ);
+	bindDouble(object.rotX);	bindDouble(object.rotY);	bindDouble(object.rotZ);
+	bindDouble(object.scaX);	bindDouble(object.scaY);	bindDouble(object.scaZ);
+	bindInt(object.render);
+	bindInt(object.collision);
+	bindText(object.collision_mesh);
+	bindInt(object.collectable);
+	bindInt(object.destructable);
+	bindInt(object.health_amount);
+	bindInt(object.editor_render);
+	bindInt(object.editor_texture_vis);
+	bindInt(object.editor_normals_vis);
+	bindInt(object.editor_collision_vis);
+	bindInt(object.editor_pivot_vis);
+	bindDouble(object.pivotX);	bindDouble(object.pivotY);	bindDouble(object.pivotZ);
+	bindInt(object.snapToGround);
+	bindInt(object.AINode);
+	bindText(object.audio_path);
+	bindDouble(object.volume);
+	bindDouble(object.pitch);
+	bindDouble(object.pan);
+	bindInt(object.one_shot);
+	bindInt(object.play_on_init);
+	bindInt(object.play_in_editor);
+	bindInt(object.min_dist);
+	bindInt(object.max_dist);
+	bindInt(object.camera);
+	bindInt(object.path_node);
+	bindInt(object.path_node_start);
+	bindInt(object.path_node_end);
+	bindInt(object.parent_id);
+	bindInt(object.editor_wireframe);
+	bindText(object.name);
+	bindInt(object.light_type);
+	bindDouble(object.light_diffuse_r);		bindDouble(object.light_diffuse_g);		bindDouble(object.light_diffuse_b);
+	bindDouble(object.light_specular_r);	bindDouble(object.light_specular_g);	bindDouble(object.light_specular_b);
+	bindDouble(object.light_spot_cutoff);
+	bindDouble(object.light_constant);
+	bindDouble(object.light_linear);
+	bindDouble(object.light_quadratic);
+
+	return rc == SQLITE_OK && column == OBJECT_COLUMN_COUNT + 1;
+}
+
+void SceneDatabase::MapSelectColumns(sqlite3_stmt * statement)
+{
+	//resolve every column we know about by name, so reordered or added columns in the table do not shift the data
+	m_selectColumns.assign(OBJECT_COLUMN_COUNT, -1);
+	const int resultColumns = sqlite3_column_count(statement);
+	for (int column = 0; column < resultColumns; column++)
+	{
+		const std::string columnName = sqlite3_column_name(statement, column);
+		for (int i = 0; i < OBJECT_COLUMN_COUNT; i++)
+		{
+			if (columnName.size() == strlen(OBJECT_COLUMNS[i]) && sqlite3_strnicmp(columnName.c_str(), OBJECT_COLUMNS[i], (int)columnName.size()) == 0)
+			{
+				m_selectColumns[i] = column;
+				break;
+			}
+		}
+	}
+}
+
+void SceneDatabase::ReadSceneObject(sqlite3_stmt * statement, SceneObject & object) const
+{
+	//walks the columns in the same order as BindSceneObject. Columns missing from the table keep the SceneObject default
+	int column = 0;
+	auto readInt = [&](int & value) { const int index = m_selectColumns[column++]; if (index >= 0) value = sqlite3_column_int(statement, index); };
+	auto readBool = [&](bool & value) { const int index = m_selectColumns[column++]; if (index >= 0) value = sqlite3_column_int(statement, index) != 0; };
+	auto readFloat = [&](float & value) { const int index = m_selectColumns[column++]; if (index >= 0) value = (float)sqlite3_column_double(statement, index); };
+	auto readText = [&](std::string & value)
+	{
+		const int index = m_selectColumns[column++];
+		if (index < 0)
+		{
+			return;
+		}
+		const char * text = reinterpret_cast<const char*>(sqlite3_column_text(statement, index));
+		if (text)		//NULL in the table leaves the string empty rather than crashing
+		{
+			value.assign(text, sqlite3_column_bytes(statement, index));
+		}
+	};
+
+	readInt(object.ID);
+	readInt(object.chunk_ID);
+	readText(object.model_path);
+	readText(object.tex_diffuse_path);
+	readFloat(object.posX);	readFloat(object.posY);	readFloat(object.posZ);
+	readFloat(object.rotX);	readFloat(object.rotY);	readFloat(object.rotZ);
+	readFloat(object.scaX);	readFloat(object.scaY);	readFloat(object.scaZ);
+	readBool(object.render);
+	readBool(object.collision);
+	readText(object.collision_mesh);
+	readBool(object.collectable);
+	readBool(object.destructable);
+	readInt(object.health_amount);
+	readBool(object.editor_render);
+	readBool(object.editor_texture_vis);
+	readBool(object.editor_normals_vis);
+	readBool(object.editor_collision_vis);
+	readBool(object.editor_pivot_vis);
+	readFloat(object.pivotX);	readFloat(object.pivotY);	readFloat(object.pivotZ);
+	readBool(object.snapToGround);
+	readBool(object.AINode);
+	readText(object.audio_path);
+	readFloat(object.volume);
+	readFloat(object.pitch);
+	readFloat(object.pan);
+	readBool(object.one_shot);
+	readBool(object.play_on_init);
+	readBool(object.play_in_editor);
+	readInt(object.min_dist);
+	readInt(object.max_dist);
+	readBool(object.camera);
+	readBool(object.path_node);
+	readBool(object.path_node_start);
+	readBool(object.path_node_end);
+	readInt(object.parent_id);
+	readBool(object.editor_wireframe);
+	readText(object.name);
+	readInt(object.light_type);
+	readFloat(object.light_diffuse_r);	readFloat(object.light_diffuse_g);	readFloat(object.light_diffuse_b);
+	readFloat(object.light_specular_r);	readFloat(object.light_specular_g);	readFloat(object.light_specular_b);
+	readFloat(object.light_spot_cutoff);
+	readFloat(object.light_constant);
+	readFloat(object.light_linear);
+	readFloat(object.light_quadratic);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "sqlite3.h"
+#include "SceneObject.h"
+#include "SceneStore.h"
+#include "ChunkObject.h"
+#include <cstdint>
+#include <vector>
+
+//counts and timings for one save so the tool can report throughput
+struct SaveStatistics
+{
+	bool	succeeded = false;
+	int		rowsWritten = 0;		//rows inserted or updated
+	int		rowsDeleted = 0;
+	double	seconds = 0.0;
+	double	rowsPerSecond = 0.0;
+};
+
+//Wraps the sqlite connection for the level database.
+//Statements are prepared once when the database is opened and reused for every row, so a save is
+//one transaction with bound values rather than one autocommitted, string formatted INSERT per object.
+//The database is put in WAL mode, so the autosave thread's connection can write while this one reads.
+//Edits not yet saved are kept in two recovery tables, AutosaveObjects (same columns as Objects) and AutosaveDeleted.
+//The LevelCache table holds the content hash of the binary level cache written from Objects. Triggers on Objects empty it,
+//so any change to the table, from the editor or anything else, marks the cache stale.
+class SceneDatabase
+{
+public:
+	SceneDatabase();
+	~SceneDatabase();
+
+	bool	Open(const char * path);		//opens the database read/write and prepares the statements
+	void	Close();
+	bool	IsOpen() const;
+	sqlite3 * GetConnection() const;
+
+	bool	LoadChunks(std::vector<ChunkObject> & chunks);		//every row of the Chunks table, columns matched by name
+
+	int		CountObjects(int chunkID);
+	int		GetMaxObjectID();				//0 if the table is empty
+	bool	BeginLoadObjects(int chunkID);	//starts streaming the objects of one chunk. Columns are matched by name once, not by position
+	int		LoadObjectBatch(SceneStore & sceneGraph, int maxRows);	//adds up to maxRows objects to the scenegraph, returns how many were read
+	bool	IsLoadingObjects() const;
+	void	EndLoadObjects();
+
+	SaveStatistics	SaveChanges(SceneStore & sceneGraph);	//deletes the scenegraph's deleted IDs and writes only dirty/inserted objects, then clears the flags
+
+	SaveStatistics	WriteAutosave(const std::vector<SceneObject> & objects, const std::vector<int> & deletedObjectIDs);	//upserts into the recovery tables in one transaction
+	bool	ClearAutosave();
+	bool	HasAutosave();					//the recovery tables hold edits that never reached a save, so the last session did not end cleanly
+	SaveStatistics	RecoverAutosave();		//replays the recovery tables into Objects and clears them, in one transaction
+
+	bool	GetLevelCacheHash(uint64_t & hash);		//false if no cache matches the Objects table
+	bool	WriteLevelCache(const char * path);		//writes a level cache from Objects and records its hash. fails if Objects changes meanwhile
+
+private:
+	bool	PrepareStatements();
+	void	FinalizeStatements();
+	bool	Execute(const char * sqlCommand);
+	void	MapSelectColumns(sqlite3_stmt * statement);	//fills m_selectColumns for a SELECT * FROM Objects
+	bool	BindSceneObject(sqlite3_stmt * statement, const SceneObject & object);
+	void	ReadSceneObject(sqlite3_stmt * statement, SceneObject & object) const;
+
+	sqlite3 *		m_databaseConnection;
+	sqlite3_stmt *	m_insertObject;			//INSERT INTO Objects with one parameter per column
+	sqlite3_stmt *	m_updateObject;			//UPDATE Objects ... WHERE ID = ?1, bound the same way as the insert
+	sqlite3_stmt *	m_deleteObject;			//DELETE FROM Objects WHERE ID = ?1
+	sqlite3_stmt *	m_insertAutosave;		//INSERT INTO AutosaveObjects, bound like the insert
+	sqlite3_stmt *	m_deleteAutosave;		//DELETE FROM AutosaveObjects WHERE ID = ?1
+	sqlite3_stmt *	m_insertAutosaveDeleted;	//INSERT OR IGNORE INTO AutosaveDeleted
+	sqlite3_stmt *	m_deleteAutosaveDeleted;
+	sqlite3_stmt *	m_selectObjects;		//live while a load is streaming
+	std::vector<int> m_selectColumns;		//result column of each Objects column in the select, -1 if the table lacks it
+};
@@ -48,6 +48,9 @@ SceneObject::SceneObject()
 	light_constant = 1;
 	light_linear = 1;
 	light_quadratic = 1;
+
+	dirty = false;
+	inserted = false;
 }
 
 
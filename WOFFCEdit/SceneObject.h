@@ -52,5 +52,8 @@ public:
 	float light_linear;
 	float light_quadratic;
 
+	//editor bookkeeping for incremental saves. Not columns in the object table.
+	bool dirty;			//changed since it was loaded or last saved
+	bool inserted;		//created in the editor, not yet written to the table
 };
 
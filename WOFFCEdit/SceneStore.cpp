@@ -0,0 +1,488 @@
+#include "SceneStore.h"
+#include <algorithm>
+
+
+//SceneObject bools and the flag each is kept in
+struct SceneObjectFlagField
+{
+	bool SceneObject::*	member;
+	SceneObjectFlag		flag;
+};
+
+static const SceneObjectFlagField FLAG_FIELDS[] =
+{
+	{ &SceneObject::render,					SCENE_OBJECT_RENDER },
+	{ &SceneObject::collision,				SCENE_OBJECT_COLLISION },
+	{ &SceneObject::collectable,			SCENE_OBJECT_COLLECTABLE },
+	{ &SceneObject::destructable,			SCENE_OBJECT_DESTRUCTABLE },
+	{ &SceneObject::editor_render,			SCENE_OBJECT_EDITOR_RENDER },
+	{ &SceneObject::editor_texture_vis,		SCENE_OBJECT_EDITOR_TEXTURE_VIS },
+	{ &SceneObject::editor_normals_vis,		SCENE_OBJECT_EDITOR_NORMALS_VIS },
+	{ &SceneObject::editor_collision_vis,	SCENE_OBJECT_EDITOR_COLLISION_VIS },
+	{ &SceneObject::editor_pivot_vis,		SCENE_OBJECT_EDITOR_PIVOT_VIS },
+	{ &SceneObject::snapToGround,			SCENE_OBJECT_SNAP_TO_GROUND },
+	{ &SceneObject::AINode,					SCENE_OBJECT_AI_NODE },
+	{ &SceneObject::one_shot,				SCENE_OBJECT_ONE_SHOT },
+	{ &SceneObject::play_on_init,			SCENE_OBJECT_PLAY_ON_INIT },
+	{ &SceneObject::play_in_editor,			SCENE_OBJECT_PLAY_IN_EDITOR },
+	{ &SceneObject::camera,					SCENE_OBJECT_CAMERA },
+	{ &SceneObject::path_node,				SCENE_OBJECT_PATH_NODE },
+	{ &SceneObject::path_node_start,		SCENE_OBJECT_PATH_NODE_START },
+	{ &SceneObject::path_node_end,			SCENE_OBJECT_PATH_NODE_END },
+	{ &SceneObject::editor_wireframe,		SCENE_OBJECT_EDITOR_WIREFRAME },
+	{ &SceneObject::dirty,					SCENE_OBJECT_DIRTY },
+	{ &SceneObject::inserted,				SCENE_OBJECT_INSERTED },
+};
+static const int FLAG_FIELD_COUNT = sizeof(FLAG_FIELDS) / sizeof(FLAG_FIELDS[0]);
+
+
+SceneStore::SceneStore()
+{
+	m_nextID = 1;
+}
+
+
+SceneStore::~SceneStore()
+{
+}
+
+int SceneStore::Add(const SceneObject & object)
+{
+	const int index = GetCount();
+	m_ID.push_back(0);
+	m_chunkID.push_back(0);
+	m_parentID.push_back(0);
+	m_posX.push_back(0.0f);	m_posY.push_back(0.0f);	m_posZ.push_back(0.0f);
+	m_rotX.push_back(0.0f);	m_rotY.push_back(0.0f);	m_rotZ.push_back(0.0f);
+	m_scaX.push_back(0.0f);	m_scaY.push_back(0.0f);	m_scaZ.push_back(0.0f);
+	m_flags.push_back(0);
+	m_changes.push_back(0);
+	m_detail.emplace_back();
+	Set(index, object);
+	return index;
+}
+
+void SceneStore::Get(int index, SceneObject & object) const
+{
+	object.ID = m_ID[index];
+	object.chunk_ID = m_chunkID[index];
+	object.parent_id = m_parentID[index];
+	object.posX = m_posX[index];	object.posY = m_posY[index];	object.posZ = m_posZ[index];
+	object.rotX = m_rotX[index];	object.rotY = m_rotY[index];	object.rotZ = m_rotZ[index];
+	object.scaX = m_scaX[index];	object.scaY = m_scaY[index];	object.scaZ = m_scaZ[index];
+	for (int i = 0; i < FLAG_FIELD_COUNT; i++)
+	{
+		object.*FLAG_FIELDS[i].member = (m_flags[index] & FLAG_FIELDS[i].flag) != 0;
+	}
+
+	const SceneObjectDetail & detail = m_detail[index];
+	const StringPool & strings = StringPool::Global();
+	object.model_path = strings.GetString(detail.model_path);
+	object.tex_diffuse_path = strings.GetString(detail.tex_diffuse_path);
+	object.collision_mesh = strings.GetString(detail.collision_mesh);
+	object.audio_path = strings.GetString(detail.audio_path);
+	object.name = strings.GetString(detail.name);
+	object.health_amount = detail.health_amount;
+	object.pivotX = detail.pivotX;	object.pivotY = detail.pivotY;	object.pivotZ = detail.pivotZ;
+	object.volume = detail.volume;
+	object.pitch = detail.pitch;
+	object.pan = detail.pan;
+	object.min_dist = detail.min_dist;
+	object.max_dist = detail.max_dist;
+	object.light_type = detail.light_type;
+	object.light_diffuse_r = detail.light_diffuse_r;	object.light_diffuse_g = detail.light_diffuse_g;	object.light_diffuse_b = detail.light_diffuse_b;
+	object.light_specular_r = detail.light_specular_r;	object.light_specular_g = detail.light_specular_g;	object.light_specular_b = detail.light_specular_b;
+	object.light_spot_cutoff = detail.light_spot_cutoff;
+	object.light_constant = detail.light_constant;
+	object.light_linear = detail.light_linear;
+	object.light_quadratic = detail.light_quadratic;
+}
+
+void SceneStore::Set(int index, const SceneObject & object)
+{
+	auto previous = m_indexOfID.find(m_ID[index]);
+	if (previous != m_indexOfID.end() && previous->second == index)
+	{
+		m_indexOfID.erase(previous);
+	}
+	m_indexOfID[object.ID] = index;
+
+	m_ID[index] = object.ID;
+	m_chunkID[index] = object.chunk_ID;
+	m_parentID[index] = object.parent_id;
+	m_posX[index] = object.posX;	m_posY[index] = object.posY;	m_posZ[index] = object.posZ;
+	m_rotX[index] = object.rotX;	m_rotY[index] = object.rotY;	m_rotZ[index] = object.rotZ;
+	m_scaX[index] = object.scaX;	m_scaY[index] = object.scaY;	m_scaZ[index] = object.scaZ;
+	unsigned int flags = 0;
+	for (int i = 0; i < FLAG_FIELD_COUNT; i++)
+	{
+		if (object.*FLAG_FIELDS[i].member)
+		{
+			flags |= FLAG_FIELDS[i].flag;
+		}
+	}
+	m_flags[index] = flags;
+
+	SceneObjectDetail & detail = m_detail[index];
+	StringPool & strings = StringPool::Global();
+	detail.model_path = strings.Intern(object.model_path);
+	detail.tex_diffuse_path = strings.Intern(object.tex_diffuse_path);
+	detail.collision_mesh = strings.Intern(object.collision_mesh);
+	detail.audio_path = strings.Intern(object.audio_path);
+	detail.name = strings.Intern(object.name);
+	detail.health_amount = object.health_amount;
+	detail.pivotX = object.pivotX;	detail.pivotY = object.pivotY;	detail.pivotZ = object.pivotZ;
+	detail.volume = object.volume;
+	detail.pitch = object.pitch;
+	detail.pan = object.pan;
+	detail.min_dist = object.min_dist;
+	detail.max_dist = object.max_dist;
+	detail.light_type = object.light_type;
+	detail.light_diffuse_r = object.light_diffuse_r;	detail.light_diffuse_g = object.light_diffuse_g;	detail.light_diffuse_b = object.light_diffuse_b;
+	detail.light_specular_r = object.light_specular_r;	detail.light_specular_g = object.light_specular_g;	detail.light_specular_b = object.light_specular_b;
+	detail.light_spot_cutoff = object.light_spot_cutoff;
+	detail.light_constant = object.light_constant;
+	detail.light_linear = object.light_linear;
+	detail.light_quadratic = object.light_quadratic;
+}
+
+void SceneStore::Remove(int index)
+{
+	auto removed = m_indexOfID.find(m_ID[index]);
+	if (removed != m_indexOfID.end() && removed->second == index)
+	{
+		m_indexOfID.erase(removed);
+	}
+
+	m_ID.erase(m_ID.begin() + index);
+	m_chunkID.erase(m_chunkID.begin() + index);
+	m_parentID.erase(m_parentID.begin() + index);
+	m_posX.erase(m_posX.begin() + index);	m_posY.erase(m_posY.begin() + index);	m_posZ.erase(m_posZ.begin() + index);
+	m_rotX.erase(m_rotX.begin() + index);	m_rotY.erase(m_rotY.begin() + index);	m_rotZ.erase(m_rotZ.begin() + index);
+	m_scaX.erase(m_scaX.begin() + index);	m_scaY.erase(m_scaY.begin() + index);	m_scaZ.erase(m_scaZ.begin() + index);
+	m_flags.erase(m_flags.begin() + index);
+	m_changes.erase(m_changes.begin() + index);
+	m_detail.erase(m_detail.begin() + index);
+	Reindex(index);
+}
+
+template <typename Predicate>
+int SceneStore::RemoveIf(Predicate isRemoved)
+{
+	//one pass, sliding each kept object down over the removed ones
+	const int count = GetCount();
+	int firstRemoved = count;
+	int kept = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (isRemoved(i))
+		{
+			auto removed = m_indexOfID.find(m_ID[i]);
+			if (removed != m_indexOfID.end() && removed->second == i)
+			{
+				m_indexOfID.erase(removed);
+			}
+			firstRemoved = std::min(firstRemoved, i);
+			continue;
+		}
+		if (kept != i)
+		{
+			m_ID[kept] = m_ID[i];
+			m_chunkID[kept] = m_chunkID[i];
+			m_parentID[kept] = m_parentID[i];
+			m_posX[kept] = m_posX[i];	m_posY[kept] = m_posY[i];	m_posZ[kept] = m_posZ[i];
+			m_rotX[kept] = m_rotX[i];	m_rotY[kept] = m_rotY[i];	m_rotZ[kept] = m_rotZ[i];
+			m_scaX[kept] = m_scaX[i];	m_scaY[kept] = m_scaY[i];	m_scaZ[kept] = m_scaZ[i];
+			m_flags[kept] = m_flags[i];
+			m_changes[kept] = m_changes[i];
+			m_detail[kept] = std::move(m_detail[i]);
+		}
+		kept++;
+	}
+	if (kept == count)
+	{
+		return 0;
+	}
+
+	m_ID.resize(kept);
+	m_chunkID.resize(kept);
+	m_parentID.resize(kept);
+	m_posX.resize(kept);	m_posY.resize(kept);	m_posZ.resize(kept);
+	m_rotX.resize(kept);	m_rotY.resize(kept);	m_rotZ.resize(kept);
+	m_scaX.resize(kept);	m_scaY.resize(kept);	m_scaZ.resize(kept);
+	m_flags.resize(kept);
+	m_changes.resize(kept);
+	m_detail.resize(kept);
+	Reindex(firstRemoved);		//objects before the first removed one kept their index
+	return count - kept;
+}
+
+int SceneStore::Remove(const std::vector<int> & indices)
+{
+	std::vector<bool> removed(GetCount(), false);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		removed[indices[i]] = true;
+	}
+	return RemoveIf([&](int index) { return removed[index]; });
+}
+
+int SceneStore::RemoveChunk(int chunkID)
+{
+	return RemoveIf([&](int index) { return m_chunkID[index] == chunkID; });
+}
+
+void SceneStore::Clear()
+{
+	m_ID.clear();
+	m_chunkID.clear();
+	m_parentID.clear();
+	m_posX.clear();	m_posY.clear();	m_posZ.clear();
+	m_rotX.clear();	m_rotY.clear();	m_rotZ.clear();
+	m_scaX.clear();	m_scaY.clear();	m_scaZ.clear();
+	m_flags.clear();
+	m_changes.clear();
+	m_detail.clear();
+	m_indexOfID.clear();
+	m_changedIDs.clear();
+	m_deletedIDs.clear();
+	m_deletedChunkIDs.clear();
+	m_autosaveDeletedIDs.clear();
+	m_nextID = 1;
+}
+
+void SceneStore::Reserve(int count)
+{
+	m_ID.reserve(count);
+	m_chunkID.reserve(count);
+	m_parentID.reserve(count);
+	m_posX.reserve(count);	m_posY.reserve(count);	m_posZ.reserve(count);
+	m_rotX.reserve(count);	m_rotY.reserve(count);	m_rotZ.reserve(count);
+	m_scaX.reserve(count);	m_scaY.reserve(count);	m_scaZ.reserve(count);
+	m_flags.reserve(count);
+	m_changes.reserve(count);
+	m_detail.reserve(count);
+	m_indexOfID.reserve(count);
+}
+
+int SceneStore::GetCount() const
+{
+	return (int)m_ID.size();
+}
+
+int SceneStore::GetCapacity() const
+{
+	return (int)m_ID.capacity();
+}
+
+bool SceneStore::IsEmpty() const
+{
+	return m_ID.empty();
+}
+
+int SceneStore::FindIndex(int ID) const
+{
+	auto found = m_indexOfID.find(ID);
+	return found != m_indexOfID.end() ? found->second : -1;
+}
+
+int SceneStore::DeleteObjects(const std::vector<int> & indices)
+{
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		const int ID = m_ID[indices[i]];
+
+		//an object that was never saved has no row to delete
+		if (!HasFlag(indices[i], SCENE_OBJECT_INSERTED))
+		{
+			m_deletedIDs.push_back(ID);
+			m_deletedChunkIDs.push_back(m_chunkID[indices[i]]);
+		}
+		m_autosaveDeletedIDs.push_back(ID);		//it may have been autosaved since it was added
+	}
+	return Remove(indices);
+}
+
+int SceneStore::RestoreObject(const SceneObject & object)
+{
+	//a row still waiting to be deleted is kept and updated. if it is gone, or never was, the object goes back in as new
+	auto deleted = std::find(m_deletedIDs.begin(), m_deletedIDs.end(), object.ID);
+	const bool hasRow = deleted != m_deletedIDs.end();
+	if (hasRow)
+	{
+		m_deletedChunkIDs.erase(m_deletedChunkIDs.begin() + (deleted - m_deletedIDs.begin()));
+		m_deletedIDs.erase(deleted);
+	}
+	m_autosaveDeletedIDs.erase(std::remove(m_autosaveDeletedIDs.begin(), m_autosaveDeletedIDs.end(), object.ID), m_autosaveDeletedIDs.end());
+
+	SceneObject restored = object;
+	restored.dirty = hasRow;
+	restored.inserted = !hasRow;
+	const int index = Add(restored);
+	SetFlag(index, SCENE_OBJECT_AUTOSAVE, true);
+	return index;
+}
+
+const std::vector<int> & SceneStore::GetDeletedIDs() const
+{
+	return m_deletedIDs;
+}
+
+bool SceneStore::HasDeletedObjects(int chunkID) const
+{
+	return std::find(m_deletedChunkIDs.begin(), m_deletedChunkIDs.end(), chunkID) != m_deletedChunkIDs.end();
+}
+
+void SceneStore::ClearDeletedIDs()
+{
+	m_deletedIDs.clear();
+	m_deletedChunkIDs.clear();
+	m_autosaveDeletedIDs.clear();
+}
+
+void SceneStore::TakeAutosaveDeletedIDs(std::vector<int> & IDs)
+{
+	IDs.swap(m_autosaveDeletedIDs);
+	m_autosaveDeletedIDs.clear();
+}
+
+int SceneStore::NewID()
+{
+	return m_nextID++;
+}
+
+void SceneStore::SetNextID(int ID)
+{
+	m_nextID = ID;
+}
+
+bool SceneStore::HasFlag(int index, SceneObjectFlag flag) const
+{
+	return (m_flags[index] & flag) != 0;
+}
+
+void SceneStore::SetFlag(int index, SceneObjectFlag flag, bool value)
+{
+	const unsigned int flags = value ? m_flags[index] | flag : m_flags[index] & ~(unsigned int)flag;
+	if (flags == m_flags[index])
+	{
+		return;
+	}
+	m_flags[index] = flags;
+
+	//the save bookkeeping is not an edit
+	if (flag != SCENE_OBJECT_DIRTY && flag != SCENE_OBJECT_INSERTED && flag != SCENE_OBJECT_AUTOSAVE)
+	{
+		MarkChanged(index, SCENE_CHANGE_FLAGS);
+	}
+}
+
+float SceneStore::GetField(int index, SceneObjectField field) const
+{
+	return (*GetFieldArray(field))[index];
+}
+
+void SceneStore::SetField(int index, SceneObjectField field, float value)
+{
+	float & current = (*GetFieldArray(field))[index];
+	if (current == value)
+	{
+		return;
+	}
+	current = value;
+	MarkChanged(index, SCENE_CHANGE_FIELD(field));
+}
+
+void SceneStore::SetPosition(int index, float x, float y, float z)
+{
+	SetField(index, SCENE_FIELD_POSITION_X, x);
+	SetField(index, SCENE_FIELD_POSITION_Y, y);
+	SetField(index, SCENE_FIELD_POSITION_Z, z);
+}
+
+void SceneStore::SetRotation(int index, float x, float y, float z)
+{
+	SetField(index, SCENE_FIELD_ROTATION_X, x);
+	SetField(index, SCENE_FIELD_ROTATION_Y, y);
+	SetField(index, SCENE_FIELD_ROTATION_Z, z);
+}
+
+void SceneStore::SetScale(int index, float x, float y, float z)
+{
+	SetField(index, SCENE_FIELD_SCALE_X, x);
+	SetField(index, SCENE_FIELD_SCALE_Y, y);
+	SetField(index, SCENE_FIELD_SCALE_Z, z);
+}
+
+const std::vector<int> & SceneStore::GetChangedIDs() const
+{
+	return m_changedIDs;
+}
+
+unsigned int SceneStore::GetChanges(int index) const
+{
+	return m_changes[index];
+}
+
+void SceneStore::ClearChanges()
+{
+	for (size_t i = 0; i < m_changedIDs.size(); i++)
+	{
+		const int index = FindIndex(m_changedIDs[i]);
+		if (index != -1)
+		{
+			m_changes[index] = 0;
+		}
+	}
+	m_changedIDs.clear();
+}
+
+const SceneObjectDetail & SceneStore::GetDetail(int index) const
+{
+	return m_detail[index];
+}
+
+SceneObjectDetail & SceneStore::GetDetail(int index)
+{
+	return m_detail[index];
+}
+
+void SceneStore::MarkChanged(int index, unsigned int changes)
+{
+	//every edit is saved and autosaved, so the flags are set here rather than by whoever made it
+	m_flags[index] |= SCENE_OBJECT_DIRTY | SCENE_OBJECT_AUTOSAVE;
+	if (m_changes[index] == 0)
+	{
+		m_changedIDs.push_back(m_ID[index]);
+	}
+	m_changes[index] |= changes;
+}
+
+std::vector<float> * SceneStore::GetFieldArray(SceneObjectField field)
+{
+	switch (field)
+	{
+	case SCENE_FIELD_POSITION_X:	return &m_posX;
+	case SCENE_FIELD_POSITION_Y:	return &m_posY;
+	case SCENE_FIELD_POSITION_Z:	return &m_posZ;
+	case SCENE_FIELD_ROTATION_X:	return &m_rotX;
+	case SCENE_FIELD_ROTATION_Y:	return &m_rotY;
+	case SCENE_FIELD_ROTATION_Z:	return &m_rotZ;
+	case SCENE_FIELD_SCALE_X:		return &m_scaX;
+	case SCENE_FIELD_SCALE_Y:		return &m_scaY;
+	default:						return &m_scaZ;
+	}
+}
+
+const std::vector<float> * SceneStore::GetFieldArray(SceneObjectField field) const
+{
+	return const_cast<SceneStore *>(this)->GetFieldArray(field);
+}
+
+void SceneStore::Reindex(int firstIndex)
+{
+	for (int i = firstIndex; i < GetCount(); i++)
+	{
+		m_indexOfID[m_ID[i]] = i;
+	}
+}
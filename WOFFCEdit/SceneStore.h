@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SceneObject.h"
+#include "StringPool.h"
+
+//one bit per bool column of the Objects table, plus the save bookkeeping
+enum SceneObjectFlag
+{
+	SCENE_OBJECT_RENDER					= 1 << 0,
+	SCENE_OBJECT_COLLISION				= 1 << 1,
+	SCENE_OBJECT_COLLECTABLE			= 1 << 2,
+	SCENE_OBJECT_DESTRUCTABLE			= 1 << 3,
+	SCENE_OBJECT_EDITOR_RENDER			= 1 << 4,
+	SCENE_OBJECT_EDITOR_TEXTURE_VIS		= 1 << 5,
+	SCENE_OBJECT_EDITOR_NORMALS_VIS		= 1 << 6,
+	SCENE_OBJECT_EDITOR_COLLISION_VIS	= 1 << 7,
+	SCENE_OBJECT_EDITOR_PIVOT_VIS		= 1 << 8,
+	SCENE_OBJECT_SNAP_TO_GROUND			= 1 << 9,
+	SCENE_OBJECT_AI_NODE				= 1 << 10,
+	SCENE_OBJECT_ONE_SHOT				= 1 << 11,
+	SCENE_OBJECT_PLAY_ON_INIT			= 1 << 12,
+	SCENE_OBJECT_PLAY_IN_EDITOR			= 1 << 13,
+	SCENE_OBJECT_CAMERA					= 1 << 14,
+	SCENE_OBJECT_PATH_NODE				= 1 << 15,
+	SCENE_OBJECT_PATH_NODE_START		= 1 << 16,
+	SCENE_OBJECT_PATH_NODE_END			= 1 << 17,
+	SCENE_OBJECT_EDITOR_WIREFRAME		= 1 << 18,
+	SCENE_OBJECT_DIRTY					= 1 << 19,		//changed since it was loaded or last saved
+	SCENE_OBJECT_INSERTED				= 1 << 20,		//created in the editor, not yet written to the table
+	SCENE_OBJECT_AUTOSAVE				= 1 << 21,		//changed since the autosave last copied it
+};
+
+//the fields an edit can change, as the edit journal records them
+enum SceneObjectField
+{
+	SCENE_FIELD_POSITION_X,
+	SCENE_FIELD_POSITION_Y,
+	SCENE_FIELD_POSITION_Z,
+	SCENE_FIELD_ROTATION_X,
+	SCENE_FIELD_ROTATION_Y,
+	SCENE_FIELD_ROTATION_Z,
+	SCENE_FIELD_SCALE_X,
+	SCENE_FIELD_SCALE_Y,
+	SCENE_FIELD_SCALE_Z,
+	SCENE_FIELD_COUNT
+};
+
+//what a change event says was edited: a bit per SceneObjectField, and one for the flags
+#define SCENE_CHANGE_FIELD(field)	(1u << (field))
+#define SCENE_CHANGE_FLAGS			(1u << SCENE_FIELD_COUNT)
+#define SCENE_CHANGE_TRANSFORM		(SCENE_CHANGE_FLAGS - 1)		//any of the fields
+
+//The columns nothing walks every frame: asset paths, names, pivot, gameplay, audio and light settings.
+//Kept one record per object, apart from the transform arrays. The strings are handles into the global StringPool,
+//most objects share a handful of asset paths
+struct SceneObjectDetail
+{
+	StringHandle model_path;
+	StringHandle tex_diffuse_path;
+	StringHandle collision_mesh;
+	StringHandle audio_path;
+	StringHandle name;
+	int		health_amount;
+	float	pivotX, pivotY, pivotZ;
+	float	volume, pitch, pan;
+	int		min_dist, max_dist;
+	int		light_type;
+	float	light_diffuse_r, light_diffuse_g, light_diffuse_b;
+	float	light_specular_r, light_specular_g, light_specular_b;
+	float	light_spot_cutoff;
+	float	light_constant;
+	float	light_linear;
+	float	light_quadratic;
+};
+
+//The scenegraph, stored a field at a time. IDs, chunk and parent IDs, position, rotation, scale and flags each have
+//their own contiguous array, so anything walking transforms reads 4 bytes per field per object rather than a whole
+//SceneObject. The rest is split off into SceneObjectDetail.
+//Objects keep the order they were added in, and their ID maps to their index in every array.
+//SceneObject is still the whole row, for the database and for adding objects.
+//The store is where edits are made. Each setter marks the object dirty for the next save and raises a change event,
+//an object ID and the fields it changed, until the renderer has read them and calls ClearChanges. Add, Set and the
+//removals raise none, they change which objects there are and are followed by a SyncDisplayList.
+//Objects deleted in the editor, rather than unloaded with their chunk, are remembered by ID until the save and the
+//autosave have deleted their rows.
+class SceneStore
+{
+public:
+	SceneStore();
+	~SceneStore();
+
+	int		Add(const SceneObject & object);				//appends, returns the new index
+	void	Get(int index, SceneObject & object) const;		//the whole row. reusing one object between calls reuses its strings
+	void	Set(int index, const SceneObject & object);		//every field, the ID included
+	void	Remove(int index);								//objects after it move down one
+	int		Remove(const std::vector<int> & indices);		//all of them in one pass, returns how many
+	int		RemoveChunk(int chunkID);						//every object in the chunk, returns how many
+	void	Clear();
+	void	Reserve(int count);
+
+	int		GetCount() const;
+	int		GetCapacity() const;			//objects that fit before the arrays reallocate
+	bool	IsEmpty() const;
+	int		FindIndex(int ID) const;		//-1 if no object has that ID
+
+	//editor deletes, which are saved, as against removals, which only unload
+	int		DeleteObjects(const std::vector<int> & indices);	//removes them, their rows are deleted on the next save. returns how many
+	int		RestoreObject(const SceneObject & object);			//puts a deleted object back, e.g. on undo, and no longer deletes its row. returns its index
+	const std::vector<int> &	GetDeletedIDs() const;			//rows the next save deletes
+	bool	HasDeletedObjects(int chunkID) const;				//any of them in the chunk
+	void	ClearDeletedIDs();									//once a save has deleted them, which leaves the autosave none to delete either
+	void	TakeAutosaveDeletedIDs(std::vector<int> & IDs);		//deleted since the last call, never-saved objects included
+	int		NewID();							//for an object made in the editor
+	void	SetNextID(int ID);					//above every ID in the table, loaded or not
+
+	//hot fields, GetCount() entries each
+	const int *		GetIDs() const				{ return m_ID.data(); }
+	const int *		GetChunkIDs() const			{ return m_chunkID.data(); }
+	const int *		GetParentIDs() const		{ return m_parentID.data(); }
+	const float *	GetPositionX() const		{ return m_posX.data(); }
+	const float *	GetPositionY() const		{ return m_posY.data(); }
+	const float *	GetPositionZ() const		{ return m_posZ.data(); }
+	const float *	GetRotationX() const		{ return m_rotX.data(); }
+	const float *	GetRotationY() const		{ return m_rotY.data(); }
+	const float *	GetRotationZ() const		{ return m_rotZ.data(); }
+	const float *	GetScaleX() const			{ return m_scaX.data(); }
+	const float *	GetScaleY() const			{ return m_scaY.data(); }
+	const float *	GetScaleZ() const			{ return m_scaZ.data(); }
+	const unsigned int *	GetFlags() const	{ return m_flags.data(); }
+
+	bool	HasFlag(int index, SceneObjectFlag flag) const;
+	void	SetFlag(int index, SceneObjectFlag flag, bool value);		//the dirty, inserted and autosave flags are not edits, and raise nothing
+	float	GetField(int index, SceneObjectField field) const;
+	void	SetField(int index, SceneObjectField field, float value);	//nothing happens if the value is unchanged
+	void	SetPosition(int index, float x, float y, float z);
+	void	SetRotation(int index, float x, float y, float z);
+	void	SetScale(int index, float x, float y, float z);
+
+	//change events, oldest first. an ID is listed once however often it changes, and may since have been removed
+	const std::vector<int> &	GetChangedIDs() const;
+	unsigned int	GetChanges(int index) const;		//SCENE_CHANGE bits
+	void			ClearChanges();
+
+	const SceneObjectDetail &	GetDetail(int index) const;
+	SceneObjectDetail &			GetDetail(int index);
+
+private:
+	template <typename Predicate>
+	int		RemoveIf(Predicate isRemoved);	//compacts every array in one pass, isRemoved(index) picks the objects to drop
+	void	Reindex(int firstIndex);		//ID map for every object from firstIndex on
+	void	MarkChanged(int index, unsigned int changes);
+	std::vector<float> *		GetFieldArray(SceneObjectField field);
+	const std::vector<float> *	GetFieldArray(SceneObjectField field) const;
+
+	std::vector<int>			m_ID;
+	std::vector<int>			m_chunkID;
+	std::vector<int>			m_parentID;
+	std::vector<float>			m_posX, m_posY, m_posZ;
+	std::vector<float>			m_rotX, m_rotY, m_rotZ;
+	std::vector<float>			m_scaX, m_scaY, m_scaZ;
+	std::vector<unsigned int>	m_flags;
+	std::vector<unsigned int>	m_changes;		//SCENE_CHANGE bits not yet cleared
+	std::vector<SceneObjectDetail>	m_detail;
+	std::unordered_map<int, int>	m_indexOfID;
+	std::vector<int>			m_changedIDs;
+	std::vector<int>			m_deletedIDs;			//saved objects deleted since the last save
+	std::vector<int>			m_deletedChunkIDs;		//the chunk each of them was in
+	std::vector<int>			m_autosaveDeletedIDs;	//every object deleted since the autosave last took them
+	int							m_nextID;
+};
@@ -16,7 +16,7 @@ BEGIN_MESSAGE_MAP(SelectDialogue, CDialogEx)
 END_MESSAGE_MAP()
 
 
-SelectDialogue::SelectDialogue(CWnd* pParent, std::vector<SceneObject>* SceneGraph)		//constructor used in modal
+SelectDialogue::SelectDialogue(CWnd* pParent, SceneStore* SceneGraph)		//constructor used in modal
 	: CDialogEx(IDD_DIALOG1, pParent)
 {
 	m_sceneGraph = SceneGraph;
@@ -32,17 +32,17 @@ SelectDialogue::~SelectDialogue()
 }
 
 ///pass through pointers to the data in the tool we want to manipulate
-void SelectDialogue::SetObjectData(std::vector<SceneObject>* SceneGraph, int * selection)
+void SelectDialogue::SetObjectData(SceneStore* SceneGraph, int * selection)
 {
 	m_sceneGraph = SceneGraph;
 	m_currentSelection = selection;
 
 	//roll through all the objects in the scene graph and put an entry for each in the listbox
-	int numSceneObjects = m_sceneGraph->size();
+	int numSceneObjects = m_sceneGraph->GetCount();
 	for (int i = 0; i < numSceneObjects; i++)
 	{
 		//easily possible to make the data string presented more complex. showing other columns.
-		std::wstring listBoxEntry = std::to_wstring(m_sceneGraph->at(i).ID);
+		std::wstring listBoxEntry = std::to_wstring(m_sceneGraph->GetIDs()[i]);
 		m_listBox.AddString(listBoxEntry.c_str());
 	}
 }
@@ -76,11 +76,11 @@ BOOL SelectDialogue::OnInitDialog()
 
 	//uncomment for modal only
 /*	//roll through all the objects in the scene graph and put an entry for each in the listbox
-	int numSceneObjects = m_sceneGraph->size();
-	for (size_t i = 0; i < numSceneObjects; i++)
+	int numSceneObjects = m_sceneGraph->GetCount();
+	for (int i = 0; i < numSceneObjects; i++)
 	{
 		//easily possible to make the data string presented more complex. showing other columns.
-		std::wstring listBoxEntry = std::to_wstring(m_sceneGraph->at(i).ID);
+		std::wstring listBoxEntry = std::to_wstring(m_sceneGraph->GetIDs()[i]);
 		m_listBox.AddString(listBoxEntry.c_str());
 	}*/
 	
@@ -2,7 +2,7 @@
 #include "afxdialogex.h"
 #include "resource.h"
 #include "afxwin.h"
-#include "SceneObject.h"
+#include "SceneStore.h"
 #include <vector>
 
 // SelectDialogue dialog
@@ -12,10 +12,10 @@ class SelectDialogue : public CDialogEx
 	DECLARE_DYNAMIC(SelectDialogue)
 
 public:
-	SelectDialogue(CWnd* pParent, std::vector<SceneObject>* SceneGraph);   // modal // takes in out scenegraph in the constructor
+	SelectDialogue(CWnd* pParent, SceneStore* SceneGraph);   // modal // takes in out scenegraph in the constructor
 	SelectDialogue(CWnd* pParent = NULL);
 	virtual ~SelectDialogue();
-	void SetObjectData(std::vector<SceneObject>* SceneGraph, int * Selection);	//passing in pointers to the data the class will operate on.
+	void SetObjectData(SceneStore* SceneGraph, int * Selection);	//passing in pointers to the data the class will operate on.
 	
 // Dialog Data
 #ifdef AFX_DESIGN_TIME
@@ -27,7 +27,7 @@ protected:
 	afx_msg void End();		//kill the dialogue
 	afx_msg void Select();	//Item has been selected
 
-	std::vector<SceneObject> * m_sceneGraph;
+	SceneStore * m_sceneGraph;
 	int * m_currentSelection;
 	
 
@@ -0,0 +1,103 @@
+#include "StringPool.h"
+#include <windows.h>
+
+//the handle used for lookups, never given out
+#define STRING_HANDLE_PROBE 0xffffffffu
+
+
+StringPool & StringPool::Global()
+{
+	static StringPool pool;
+	return pool;
+}
+
+StringPool::StringPool()
+	: m_handles(0, HandleHash{ this }, HandleEqual{ this })
+{
+	m_probe = NULL;
+	m_probeHash = 0;
+	Intern(std::string());		//STRING_HANDLE_EMPTY
+}
+
+StringHandle StringPool::Intern(const std::string & string)
+{
+	m_probe = &string;
+	m_probeHash = std::hash<std::string>()(string);
+	auto found = m_handles.find(STRING_HANDLE_PROBE);
+	if (found != m_handles.end())
+	{
+		return *found;
+	}
+
+	const StringHandle handle = (StringHandle)m_entries.size();
+	m_entries.emplace_back();
+	Entry & entry = m_entries.back();
+	entry.string = string;
+	entry.hash = m_probeHash;
+	m_handles.insert(handle);
+	return handle;
+}
+
+const std::string & StringPool::GetString(StringHandle handle) const
+{
+	return m_entries[handle].string;
+}
+
+const std::wstring & StringPool::GetWideString(StringHandle handle) const
+{
+	auto found = m_wideStrings.find(handle);
+	if (found != m_wideStrings.end())
+	{
+		return found->second;
+	}
+
+	//same conversion as StringToWCHART, done once per string rather than once per use
+	const std::string & string = m_entries[handle].string;
+	std::wstring & wideString = m_wideStrings[handle];
+	const int length = MultiByteToWideChar(CP_ACP, 0, string.c_str(), (int)string.size(), NULL, 0);
+	wideString.resize(length);
+	if (length > 0)
+	{
+		MultiByteToWideChar(CP_ACP, 0, string.c_str(), (int)string.size(), &wideString[0], length);
+	}
+	return wideString;
+}
+
+int StringPool::GetCount() const
+{
+	return (int)m_entries.size();
+}
+
+size_t StringPool::GetBytes() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		bytes += m_entries[i].string.capacity();
+	}
+	for (auto wideString = m_wideStrings.begin(); wideString != m_wideStrings.end(); ++wideString)
+	{
+		bytes += wideString->second.capacity() * sizeof(wchar_t);
+	}
+	return bytes;
+}
+
+const std::string & StringPool::GetKey(StringHandle handle) const
+{
+	return handle == STRING_HANDLE_PROBE ? *m_probe : m_entries[handle].string;
+}
+
+size_t StringPool::GetKeyHash(StringHandle handle) const
+{
+	return handle == STRING_HANDLE_PROBE ? m_probeHash : m_entries[handle].hash;
+}
+
+size_t StringPool::HandleHash::operator()(StringHandle handle) const
+{
+	return pool->GetKeyHash(handle);
+}
+
+bool StringPool::HandleEqual::operator()(StringHandle a, StringHandle b) const
+{
+	return a == b || pool->GetKey(a) == pool->GetKey(b);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+//a string in the StringPool. 0 is always the empty string, so a zeroed handle is valid
+typedef uint32_t StringHandle;
+#define STRING_HANDLE_EMPTY 0
+
+//Every distinct asset path and name is stored once, and referred to by a 32 bit handle.
+//Two handles are equal exactly when their strings are, so comparing or hashing them never touches the characters.
+//Each string's wide form is made the first time it is asked for and kept, for the Win32 and DirectX calls that want one.
+//Strings are never removed, so handles and the references handed out stay valid for the life of the tool.
+//Not thread safe: only the UI thread interns. The database and autosave threads work on SceneObject rows, which keep std::string.
+class StringPool
+{
+public:
+	static StringPool &	Global();
+
+	StringHandle	Intern(const std::string & string);
+	const std::string &		GetString(StringHandle handle) const;
+	const std::wstring &	GetWideString(StringHandle handle) const;
+
+	int		GetCount() const;
+	size_t	GetBytes() const;		//characters held, narrow and wide, for memory reports
+
+private:
+	StringPool();
+
+	struct Entry
+	{
+		std::string		string;
+		size_t			hash;
+	};
+
+	//the set holds handles, hashed and compared through the entries. A lookup goes through m_probe,
+	//a handle no entry has, so the string being interned does not have to be copied into an entry first
+	struct HandleHash
+	{
+		const StringPool * pool;
+		size_t operator()(StringHandle handle) const;
+	};
+	struct HandleEqual
+	{
+		const StringPool * pool;
+		bool operator()(StringHandle a, StringHandle b) const;
+	};
+	const std::string &	GetKey(StringHandle handle) const;
+	size_t				GetKeyHash(StringHandle handle) const;
+
+	std::deque<Entry>	m_entries;		//by handle. a deque so references survive it growing
+	std::unordered_set<StringHandle, HandleHash, HandleEqual>	m_handles;
+	const std::string *	m_probe;
+	size_t				m_probeHash;
+	mutable std::unordered_map<StringHandle, std::wstring>	m_wideStrings;		//only the few strings ever asked for
+};
@@ -0,0 +1,118 @@
+#include "TerrainBrush.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+//-1 to 1, fixed per vertex and seed
+static float GetNoise(int column, int row, unsigned int seed)
+{
+	unsigned int hash = (unsigned int)column * 73856093u ^ (unsigned int)row * 19349663u ^ seed * 83492791u;
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return (hash & 0xffff) / 32767.5f - 1.0f;
+}
+
+float GetTerrainBrushFalloff(float normalisedDistance)
+{
+	if (normalisedDistance >= 1.0f)
+	{
+		return 0.0f;
+	}
+	const float falloff = 1.0f - normalisedDistance * normalisedDistance;
+	return falloff * falloff;
+}
+
+bool ApplyTerrainBrush(float * heights, int resolution, float spacing, float centreColumn, float centreRow,
+					   const TerrainBrush & brush, float deltaTime, TerrainRect & dirty)
+{
+	dirty = TerrainRect();
+	if (resolution < 2 || spacing <= 0.0f || brush.radius <= 0.0f)
+	{
+		return false;
+	}
+
+	//the square around the brush circle, clipped to the heightfield
+	const float radius = brush.radius / spacing;		//in vertices
+	dirty.firstColumn = std::max((int)std::ceil(centreColumn - radius), 0);
+	dirty.lastColumn = std::min((int)std::floor(centreColumn + radius), resolution - 1);
+	dirty.firstRow = std::max((int)std::ceil(centreRow - radius), 0);
+	dirty.lastRow = std::min((int)std::floor(centreRow + radius), resolution - 1);
+	if (dirty.IsEmpty())
+	{
+		return false;
+	}
+
+	//smoothing reads the neighbours as they were before this dab, so take a copy of the square plus a vertex all round
+	std::vector<float> source;
+	int sourceFirstColumn = 0, sourceFirstRow = 0, sourceWidth = 0;
+	if (brush.type == TERRAIN_BRUSH_SMOOTH)
+	{
+		sourceFirstColumn = std::max(dirty.firstColumn - 1, 0);
+		sourceFirstRow = std::max(dirty.firstRow - 1, 0);
+		const int sourceLastColumn = std::min(dirty.lastColumn + 1, resolution - 1);
+		const int sourceLastRow = std::min(dirty.lastRow + 1, resolution - 1);
+		sourceWidth = sourceLastColumn - sourceFirstColumn + 1;
+		source.resize((size_t)sourceWidth * (sourceLastRow - sourceFirstRow + 1));
+		for (int row = sourceFirstRow; row <= sourceLastRow; row++)
+		{
+			std::copy(heights + (size_t)row * resolution + sourceFirstColumn, heights + (size_t)row * resolution + sourceLastColumn + 1,
+				source.begin() + (size_t)(row - sourceFirstRow) * sourceWidth);
+		}
+	}
+
+	const float inverseRadius = 1.0f / radius;
+	const float amount = brush.strength * deltaTime;
+	const float blend = std::min(amount, 1.0f);
+	for (int row = dirty.firstRow; row <= dirty.lastRow; row++)
+	{
+		const float rowDistance = (row - centreRow) * inverseRadius;
+		float * rowHeights = heights + (size_t)row * resolution;
+		for (int column = dirty.firstColumn; column <= dirty.lastColumn; column++)
+		{
+			const float columnDistance = (column - centreColumn) * inverseRadius;
+			const float weight = GetTerrainBrushFalloff(std::sqrt(rowDistance * rowDistance + columnDistance * columnDistance));
+			if (weight <= 0.0f)
+			{
+				continue;		//corner of the square, outside the circle
+			}
+
+			float & height = rowHeights[column];
+			switch (brush.type)
+			{
+			case TERRAIN_BRUSH_RAISE:
+				height += amount * weight;
+				break;
+			case TERRAIN_BRUSH_LOWER:
+				height -= amount * weight;
+				break;
+			case TERRAIN_BRUSH_SMOOTH:
+			{
+				float sum = 0.0f;
+				int count = 0;
+				for (int y = std::max(row - 1, 0); y <= std::min(row + 1, resolution - 1); y++)
+				{
+					for (int x = std::max(column - 1, 0); x <= std::min(column + 1, resolution - 1); x++)
+					{
+						sum += source[(size_t)(y - sourceFirstRow) * sourceWidth + x - sourceFirstColumn];
+						count++;
+					}
+				}
+				height += (sum / count - height) * blend * weight;
+				break;
+			}
+			case TERRAIN_BRUSH_FLATTEN:
+				height += (brush.flattenHeight - height) * blend * weight;
+				break;
+			case TERRAIN_BRUSH_NOISE:
+				height += amount * weight * GetNoise(column, row, brush.seed);
+				break;
+			default:
+				break;
+			}
+			height = std::min(std::max(height, brush.minHeight), brush.maxHeight);
+		}
+	}
+	return true;
+}
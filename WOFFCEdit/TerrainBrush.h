@@ -0,0 +1,45 @@
+#pragma once
+
+//what a brush does to the heights under it
+enum TerrainBrushType
+{
+	TERRAIN_BRUSH_RAISE,
+	TERRAIN_BRUSH_LOWER,
+	TERRAIN_BRUSH_SMOOTH,		//towards the average of the 3 x 3 neighbourhood
+	TERRAIN_BRUSH_FLATTEN,		//towards flattenHeight
+	TERRAIN_BRUSH_NOISE,		//up and down by a fixed pattern, so repeated dabs build on each other
+	TERRAIN_BRUSH_COUNT
+};
+
+struct TerrainBrush
+{
+	TerrainBrushType	type = TERRAIN_BRUSH_RAISE;
+	float	radius = 8.0f;			//metres
+	float	strength = 4.0f;		//metres per second for raise, lower and noise. blend per second for smooth and flatten
+	float	flattenHeight = 0.0f;	//metres
+	float	minHeight = 0.0f;		//heights are clamped to what the heightmap format can hold
+	float	maxHeight = 64.0f;
+	unsigned int	seed = 0;		//noise pattern
+};
+
+//vertices an edit touched, inclusive. empty when firstRow > lastRow
+struct TerrainRect
+{
+	int		firstRow = 0;
+	int		lastRow = -1;
+	int		firstColumn = 0;
+	int		lastColumn = -1;
+
+	bool	IsEmpty() const		{ return firstRow > lastRow || firstColumn > lastColumn; }
+};
+
+//One dab of a brush on a square heightfield, resolution squared floats in metres, row major.
+//centreColumn / centreRow are in vertices, fractional, and may lie outside the heightfield when a brush overlaps a chunk edge.
+//Only the vertices inside the brush's square are read or written, and that square is returned in dirty.
+//Returns false if the brush missed the heightfield entirely.
+//Nothing here knows about the device or the editor, the chunk turns the dirty rectangle into normal and vertex updates.
+bool ApplyTerrainBrush(float * heights, int resolution, float spacing, float centreColumn, float centreRow,
+					   const TerrainBrush & brush, float deltaTime, TerrainRect & dirty);
+
+//brush weight at distance / radius, 1 at the centre easing to 0 at the edge
+float GetTerrainBrushFalloff(float normalisedDistance);
@@ -0,0 +1,490 @@
+#include "TerrainLOD.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+//fraction of the way to the next level's switch distance at which vertices start morphing towards it
+#define TERRAIN_LOD_MORPH_START 0.7f
+
+
+TerrainLOD::TerrainLOD()
+{
+	m_heights = NULL;
+	m_resolution = 0;
+	m_levelCount = 0;
+	m_cornerX = 0.0f;
+	m_cornerZ = 0.0f;
+	m_spacing = 1.0f;
+	m_tilesPerSide = 0;
+}
+
+
+TerrainLOD::~TerrainLOD()
+{
+}
+
+bool TerrainLOD::IsSupported(int resolution)
+{
+	const int quads = resolution - 1;
+	if (quads < TERRAIN_LOD_NODE_QUADS || quads % TERRAIN_LOD_NODE_QUADS != 0)
+	{
+		return false;
+	}
+	const int tiles = quads / TERRAIN_LOD_NODE_QUADS;
+	return (tiles & (tiles - 1)) == 0;		//power of two, so the quadtree halves evenly all the way down
+}
+
+bool TerrainLOD::Build(const float * heights, int resolution, float cornerX, float cornerZ, float spacing)
+{
+	Clear();
+	if (!IsSupported(resolution))
+	{
+		return false;
+	}
+
+	m_heights = heights;
+	m_resolution = resolution;
+	m_cornerX = cornerX;
+	m_cornerZ = cornerZ;
+	m_spacing = spacing;
+	m_tilesPerSide = (resolution - 1) / TERRAIN_LOD_NODE_QUADS;
+
+	m_levelCount = 1;
+	while ((1 << (m_levelCount - 1)) < m_tilesPerSide)
+	{
+		m_levelCount++;
+	}
+
+	//a full quadtree: 1 + 4 + 16 ... nodes
+	int nodeCount = 0;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		nodeCount += 1 << (2 * level);
+	}
+	m_nodes.reserve(nodeCount);
+	m_nodes.emplace_back();
+	BuildNode(0, 0, 0, resolution - 1, m_levelCount - 1);
+
+	m_levelError.assign(m_levelCount, 0.0f);
+	m_splitDistance.assign(m_levelCount, 0.0f);
+	m_tileLevel.assign(m_tilesPerSide * m_tilesPerSide, 0);
+	UpdateHeights(heights);
+	return true;
+}
+
+void TerrainLOD::UpdateHeights(const float * heights)
+{
+	if (!IsBuilt())
+	{
+		return;
+	}
+	m_heights = heights;
+	const int quads = m_resolution - 1;
+	UpdateNodeBounds(0, 0, quads, 0, quads);
+	m_levelError.assign(m_levelCount, 0.0f);
+	ComputeLevelErrors(0, quads, 0, quads);
+}
+
+void TerrainLOD::UpdateHeights(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	if (!IsBuilt())
+	{
+		return;
+	}
+	firstRow = std::max(firstRow, 0);
+	lastRow = std::min(lastRow, m_resolution - 1);
+	firstColumn = std::max(firstColumn, 0);
+	lastColumn = std::min(lastColumn, m_resolution - 1);
+	if (firstRow > lastRow || firstColumn > lastColumn)
+	{
+		return;
+	}
+
+	//errors elsewhere are unchanged, so they can only grow here. a smoothed area keeps its old error until the next full update
+	UpdateNodeBounds(0, firstRow, lastRow, firstColumn, lastColumn);
+	ComputeLevelErrors(firstRow, lastRow, firstColumn, lastColumn);
+}
+
+void TerrainLOD::Clear()
+{
+	m_nodes.clear();
+	m_levelError.clear();
+	m_splitDistance.clear();
+	m_heights = NULL;
+	m_resolution = 0;
+	m_levelCount = 0;
+	m_tilesPerSide = 0;
+}
+
+bool TerrainLOD::IsBuilt() const
+{
+	return !m_nodes.empty();
+}
+
+int TerrainLOD::GetLevelCount() const
+{
+	return m_levelCount;
+}
+
+void TerrainLOD::Select(const float cameraPosition[3], float projectionScale, float pixelError, std::vector<TerrainLODDraw> & draws)
+{
+	draws.clear();
+	if (!IsBuilt())
+	{
+		return;
+	}
+
+	//a level is split into the next finer one while its error would cover more than pixelError pixels
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		m_splitDistance[level] = m_levelError[level] * projectionScale / std::max(pixelError, 0.001f);
+	}
+
+	//select on distance, then split whatever sits next to something more than one level finer, until nothing does
+	m_forceSplit.assign(m_nodes.size(), 0);
+	bool balanced = false;
+	while (!balanced)
+	{
+		m_selected.clear();
+		SelectNode(0, cameraPosition);
+		for (size_t i = 0; i < m_selected.size(); i++)
+		{
+			MarkSelected(m_selected[i]);
+		}
+
+		balanced = true;
+		for (size_t i = 0; i < m_selected.size(); i++)
+		{
+			const Node & node = m_nodes[m_selected[i]];
+			if (node.level < 2)
+			{
+				continue;
+			}
+
+			//tiles along the outside of each edge
+			const int firstTileX = node.x / TERRAIN_LOD_NODE_QUADS;
+			const int firstTileZ = node.z / TERRAIN_LOD_NODE_QUADS;
+			const int tiles = node.size / TERRAIN_LOD_NODE_QUADS;
+			bool split = false;
+			for (int t = 0; t < tiles && !split; t++)
+			{
+				const int neighbours[4][2] = {
+					{ firstTileX + t, firstTileZ - 1 }, { firstTileX + t, firstTileZ + tiles },
+					{ firstTileX - 1, firstTileZ + t }, { firstTileX + tiles, firstTileZ + t } };
+				for (int n = 0; n < 4; n++)
+				{
+					const int tileX = neighbours[n][0];
+					const int tileZ = neighbours[n][1];
+					if (tileX >= 0 && tileZ >= 0 && tileX < m_tilesPerSide && tileZ < m_tilesPerSide
+						&& m_tileLevel[tileZ * m_tilesPerSide + tileX] < node.level - 1)
+					{
+						split = true;
+						break;
+					}
+				}
+			}
+
+			if (split)
+			{
+				m_forceSplit[m_selected[i]] = 1;
+				balanced = false;
+			}
+		}
+	}
+
+	draws.reserve(m_selected.size());
+	for (size_t i = 0; i < m_selected.size(); i++)
+	{
+		const Node & node = m_nodes[m_selected[i]];
+		const int firstTileX = node.x / TERRAIN_LOD_NODE_QUADS;
+		const int firstTileZ = node.z / TERRAIN_LOD_NODE_QUADS;
+		const int tiles = node.size / TERRAIN_LOD_NODE_QUADS;
+
+		//a coarser neighbour covers the whole edge, so one tile is enough to tell
+		TerrainLODDraw draw;
+		draw.node = m_selected[i];
+		draw.level = node.level;
+		draw.stitchMask = 0;
+		draw.baseVertex = node.z * m_resolution + node.x;
+		if (firstTileZ + tiles < m_tilesPerSide && m_tileLevel[(firstTileZ + tiles) * m_tilesPerSide + firstTileX] > node.level)
+		{
+			draw.stitchMask |= TERRAIN_LOD_EDGE_NORTH;
+		}
+		if (firstTileX + tiles < m_tilesPerSide && m_tileLevel[firstTileZ * m_tilesPerSide + firstTileX + tiles] > node.level)
+		{
+			draw.stitchMask |= TERRAIN_LOD_EDGE_EAST;
+		}
+		if (firstTileZ > 0 && m_tileLevel[(firstTileZ - 1) * m_tilesPerSide + firstTileX] > node.level)
+		{
+			draw.stitchMask |= TERRAIN_LOD_EDGE_SOUTH;
+		}
+		if (firstTileX > 0 && m_tileLevel[firstTileZ * m_tilesPerSide + firstTileX - 1] > node.level)
+		{
+			draw.stitchMask |= TERRAIN_LOD_EDGE_WEST;
+		}
+		draws.push_back(draw);
+	}
+}
+
+float TerrainLOD::GetMorphFactor(int level, float distance) const
+{
+	if (level + 1 >= m_levelCount)
+	{
+		return 0.0f;		//nothing coarser to morph to
+	}
+
+	const float switchDistance = m_splitDistance[level + 1];
+	if (switchDistance <= 0.0f)
+	{
+		return 1.0f;		//the coarser level is exact, flat ground
+	}
+	const float start = switchDistance * TERRAIN_LOD_MORPH_START;
+	return std::min(std::max((distance - start) / (switchDistance - start), 0.0f), 1.0f);
+}
+
+float TerrainLOD::GetNodeFarDistance(int node, const float cameraPosition[3]) const
+{
+	const Node & n = m_nodes[node];
+	const float minX = m_cornerX + n.x * m_spacing;
+	const float minZ = m_cornerZ + n.z * m_spacing;
+	const float maxX = minX + n.size * m_spacing;
+	const float maxZ = minZ + n.size * m_spacing;
+	const float dx = std::max(std::fabs(cameraPosition[0] - minX), std::fabs(cameraPosition[0] - maxX));
+	const float dy = std::max(std::fabs(cameraPosition[1] - n.minHeight), std::fabs(cameraPosition[1] - n.maxHeight));
+	const float dz = std::max(std::fabs(cameraPosition[2] - minZ), std::fabs(cameraPosition[2] - maxZ));
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void TerrainLOD::GetNodeRect(int node, int & x, int & z, int & size) const
+{
+	x = m_nodes[node].x;
+	z = m_nodes[node].z;
+	size = m_nodes[node].size;
+}
+
+void TerrainLOD::GetNodeBounds(int node, float center[3], float extents[3]) const
+{
+	const Node & n = m_nodes[node];
+	const float halfSize = n.size * m_spacing * 0.5f;
+	center[0] = m_cornerX + n.x * m_spacing + halfSize;
+	center[1] = (n.minHeight + n.maxHeight) * 0.5f;
+	center[2] = m_cornerZ + n.z * m_spacing + halfSize;
+	extents[0] = halfSize;
+	extents[1] = (n.maxHeight - n.minHeight) * 0.5f;
+	extents[2] = halfSize;
+}
+
+int TerrainLOD::GetNodeLevel(int node) const
+{
+	return m_nodes[node].level;
+}
+
+void TerrainLOD::BuildIndices(int level, int stitchMask, int rowStride, std::vector<unsigned int> & indices)
+{
+	//the same two triangles per quad as the full resolution grid, bottom left to top right diagonal
+	const int step = 1 << level;
+	const int n = TERRAIN_LOD_NODE_QUADS;
+	auto vertexIndex = [&](int row, int column) -> unsigned int
+	{
+		//on an edge facing a coarser neighbour, odd vertices fold onto the even one before them
+		if ((stitchMask & TERRAIN_LOD_EDGE_SOUTH) && row == 0 && (column & 1))		column--;
+		if ((stitchMask & TERRAIN_LOD_EDGE_NORTH) && row == n && (column & 1))		column--;
+		if ((stitchMask & TERRAIN_LOD_EDGE_WEST) && column == 0 && (row & 1))		row--;
+		if ((stitchMask & TERRAIN_LOD_EDGE_EAST) && column == n && (row & 1))		row--;
+		return (unsigned int)(row * step * rowStride + column * step);
+	};
+	auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c)
+	{
+		if (a != b && b != c && a != c)		//folded edges leave degenerate triangles, drop them
+		{
+			indices.push_back(a);	indices.push_back(b);	indices.push_back(c);
+		}
+	};
+
+	for (int row = 0; row < n; row++)
+	{
+		for (int column = 0; column < n; column++)
+		{
+			const unsigned int bottomLeft = vertexIndex(row, column);
+			const unsigned int bottomRight = vertexIndex(row, column + 1);
+			const unsigned int topRight = vertexIndex(row + 1, column + 1);
+			const unsigned int topLeft = vertexIndex(row + 1, column);
+			addTriangle(bottomLeft, bottomRight, topRight);
+			addTriangle(bottomLeft, topRight, topLeft);
+		}
+	}
+}
+
+int TerrainLOD::CountTriangles(const std::vector<TerrainLODDraw> & draws, int rowStride)
+{
+	//the count only depends on the stitch mask
+	int trianglesPerMask[TERRAIN_LOD_STITCH_MASKS];
+	std::vector<unsigned int> indices;
+	for (int mask = 0; mask < TERRAIN_LOD_STITCH_MASKS; mask++)
+	{
+		indices.clear();
+		BuildIndices(0, mask, rowStride, indices);
+		trianglesPerMask[mask] = (int)indices.size() / 3;
+	}
+
+	int triangles = 0;
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		triangles += trianglesPerMask[draws[i].stitchMask];
+	}
+	return triangles;
+}
+
+void TerrainLOD::BuildNode(int node, int x, int z, int size, int level)
+{
+	m_nodes[node].x = x;
+	m_nodes[node].z = z;
+	m_nodes[node].size = size;
+	m_nodes[node].level = level;
+	m_nodes[node].firstChild = -1;
+	m_nodes[node].minHeight = 0.0f;
+	m_nodes[node].maxHeight = 0.0f;
+	if (level == 0)
+	{
+		return;
+	}
+
+	//children are allocated as a block of four. indices rather than references, the array grows while they are built
+	const int firstChild = (int)m_nodes.size();
+	const int half = size / 2;
+	m_nodes[node].firstChild = firstChild;
+	m_nodes.resize(firstChild + 4);
+	BuildNode(firstChild, x, z, half, level - 1);
+	BuildNode(firstChild + 1, x + half, z, half, level - 1);
+	BuildNode(firstChild + 2, x, z + half, half, level - 1);
+	BuildNode(firstChild + 3, x + half, z + half, half, level - 1);
+}
+
+void TerrainLOD::UpdateNodeBounds(int node, int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	Node & n = m_nodes[node];
+	if (n.x > lastColumn || n.x + n.size < firstColumn || n.z > lastRow || n.z + n.size < firstRow)
+	{
+		return;		//none of its heights changed
+	}
+
+	float minHeight = FLT_MAX;
+	float maxHeight = -FLT_MAX;
+	if (n.firstChild < 0)
+	{
+		for (int z = n.z; z <= n.z + n.size; z++)
+		{
+			const float * row = m_heights + (size_t)z * m_resolution;
+			for (int x = n.x; x <= n.x + n.size; x++)
+			{
+				minHeight = std::min(minHeight, row[x]);
+				maxHeight = std::max(maxHeight, row[x]);
+			}
+		}
+	}
+	else
+	{
+		for (int child = n.firstChild; child < n.firstChild + 4; child++)
+		{
+			UpdateNodeBounds(child, firstRow, lastRow, firstColumn, lastColumn);
+			minHeight = std::min(minHeight, m_nodes[child].minHeight);
+			maxHeight = std::max(maxHeight, m_nodes[child].maxHeight);
+		}
+	}
+	n.minHeight = minHeight;
+	n.maxHeight = maxHeight;
+}
+
+void TerrainLOD::ComputeLevelErrors(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	//each level drops the vertices between its own, twice as far apart as the level below. the error of a level is the
+	//furthest any of those dropped vertices sits from the coarser surface, carried up so coarser levels are never better.
+	//a dropped vertex depends on heights up to half a step away, so the rectangle grows by that much at each level
+	const int quads = m_resolution - 1;
+	for (int level = 1; level < m_levelCount; level++)
+	{
+		const int step = 1 << level;
+		const int half = step / 2;
+		const int startZ = std::max(firstRow - half, 0) / half * half;
+		const int endZ = std::min(lastRow + half, quads);
+		const int startX = std::max(firstColumn - half, 0) / half * half;
+		const int endX = std::min(lastColumn + half, quads);
+		float error = m_levelError[level];
+		for (int z = startZ; z <= endZ; z += half)
+		{
+			for (int x = startX; x <= endX; x += half)
+			{
+				const bool onRow = (z % step) == 0;
+				const bool onColumn = (x % step) == 0;
+				if (onRow && onColumn)
+				{
+					continue;
+				}
+
+				float target;
+				if (onRow)
+				{
+					target = 0.5f * (m_heights[(size_t)z * m_resolution + x - half] + m_heights[(size_t)z * m_resolution + x + half]);
+				}
+				else if (onColumn)
+				{
+					target = 0.5f * (m_heights[(size_t)(z - half) * m_resolution + x] + m_heights[(size_t)(z + half) * m_resolution + x]);
+				}
+				else
+				{
+					target = 0.5f * (m_heights[(size_t)(z - half) * m_resolution + x - half] + m_heights[(size_t)(z + half) * m_resolution + x + half]);
+				}
+				error = std::max(error, std::fabs(m_heights[(size_t)z * m_resolution + x] - target));
+			}
+		}
+		m_levelError[level] = std::max(m_levelError[level - 1], error);
+	}
+}
+
+void TerrainLOD::SelectNode(int node, const float cameraPosition[3])
+{
+	const Node & n = m_nodes[node];
+	if (n.firstChild >= 0 && (m_forceSplit[node] || GetNodeDistance(node, cameraPosition) < m_splitDistance[n.level]))
+	{
+		for (int child = n.firstChild; child < n.firstChild + 4; child++)
+		{
+			SelectNode(child, cameraPosition);
+		}
+		return;
+	}
+	m_selected.push_back(node);
+}
+
+float TerrainLOD::GetNodeDistance(int node, const float cameraPosition[3]) const
+{
+	//to the nearest point of the node's bounds, 0 inside
+	const Node & n = m_nodes[node];
+	const float minX = m_cornerX + n.x * m_spacing;
+	const float minZ = m_cornerZ + n.z * m_spacing;
+	const float maxX = minX + n.size * m_spacing;
+	const float maxZ = minZ + n.size * m_spacing;
+	const float dx = std::max(std::max(minX - cameraPosition[0], cameraPosition[0] - maxX), 0.0f);
+	const float dy = std::max(std::max(n.minHeight - cameraPosition[1], cameraPosition[1] - n.maxHeight), 0.0f);
+	const float dz = std::max(std::max(minZ - cameraPosition[2], cameraPosition[2] - maxZ), 0.0f);
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void TerrainLOD::MarkSelected(int node)
+{
+	const Node & n = m_nodes[node];
+	const int firstTileX = n.x / TERRAIN_LOD_NODE_QUADS;
+	const int firstTileZ = n.z / TERRAIN_LOD_NODE_QUADS;
+	const int tiles = n.size / TERRAIN_LOD_NODE_QUADS;
+	for (int z = firstTileZ; z < firstTileZ + tiles; z++)
+	{
+		for (int x = firstTileX; x < firstTileX + tiles; x++)
+		{
+			m_tileLevel[z * m_tilesPerSide + x] = n.level;
+		}
+	}
+}
+
+float TerrainLOD::GetSplitDistance(int level) const
+{
+	return m_splitDistance[level];
+}
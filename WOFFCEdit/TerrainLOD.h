@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+//quads along each side of a LOD node, whatever its level. every node draws the same 32 x 32 grid, spaced out more at coarser levels
+#define TERRAIN_LOD_NODE_QUADS 32
+
+//edges of a node, as bits of a stitch mask
+#define TERRAIN_LOD_EDGE_NORTH	1		//last row
+#define TERRAIN_LOD_EDGE_EAST	2		//last column
+#define TERRAIN_LOD_EDGE_SOUTH	4		//first row
+#define TERRAIN_LOD_EDGE_WEST	8		//first column
+#define TERRAIN_LOD_STITCH_MASKS 16
+
+//one node to draw this frame
+struct TerrainLODDraw
+{
+	int		node;
+	int		level;			//0 is full resolution, each level up doubles the vertex spacing
+	int		stitchMask;		//edges whose neighbour is one level coarser, and so only has every other vertex
+	int		baseVertex;		//first vertex of the node in the full resolution vertex grid
+};
+
+//Chunked quadtree level of detail over a square heightfield of 2^n + 1 vertices per side.
+//Each level is a node size: the root covers the whole terrain, leaves cover TERRAIN_LOD_NODE_QUADS quads.
+//Nodes are split while the projected error of their level is above a pixel threshold, and the result is balanced so
+//neighbours differ by at most one level. The edge of a finer node facing a coarser one skips its odd vertices, so there are no cracks.
+//Works on the full resolution vertex grid only through indices and heights, nothing here touches the device.
+class TerrainLOD
+{
+public:
+	TerrainLOD();
+	~TerrainLOD();
+
+	static bool	IsSupported(int resolution);	//2^n + 1 vertices, at least one node's worth
+
+	//heights is resolution squared, row major. corner is the world x / z of vertex 0, spacing the metres between vertices
+	bool	Build(const float * heights, int resolution, float cornerX, float cornerZ, float spacing);
+	void	UpdateHeights(const float * heights);		//recompute bounds and errors after the heights change
+	void	UpdateHeights(int firstRow, int lastRow, int firstColumn, int lastColumn);	//after an edit to that rectangle of vertices, inclusive
+	void	Clear();
+	bool	IsBuilt() const;
+	int		GetLevelCount() const;
+
+	//projectionScale is the viewport height in pixels over 2 tan(fovY / 2), so world error / distance * projectionScale is pixels
+	void	Select(const float cameraPosition[3], float projectionScale, float pixelError, std::vector<TerrainLODDraw> & draws);
+
+	//how far a vertex at this distance has morphed towards the next coarser level, 0 to 1. only odd vertices of a level morph
+	float	GetMorphFactor(int level, float distance) const;
+	float	GetNodeFarDistance(int node, const float cameraPosition[3]) const;		//to the furthest corner of the node bounds
+	void	GetNodeRect(int node, int & x, int & z, int & size) const;			//vertex origin and size in quads
+	void	GetNodeBounds(int node, float center[3], float extents[3]) const;	//world box around the node's heights
+	int		GetNodeLevel(int node) const;
+
+	//index list for one node at a level, relative to the node's first vertex in a grid rowStride vertices wide
+	static void	BuildIndices(int level, int stitchMask, int rowStride, std::vector<unsigned int> & indices);
+	static int	CountTriangles(const std::vector<TerrainLODDraw> & draws, int rowStride);
+
+private:
+	struct Node
+	{
+		int		x, z;				//first vertex
+		int		size;				//in quads
+		int		level;
+		int		firstChild;			//four in a row, -1 for a leaf
+		float	minHeight, maxHeight;
+	};
+
+	void	BuildNode(int node, int x, int z, int size, int level);
+	void	UpdateNodeBounds(int node, int firstRow, int lastRow, int firstColumn, int lastColumn);
+	void	ComputeLevelErrors(int firstRow, int lastRow, int firstColumn, int lastColumn);		//raises the errors to cover the rectangle
+	void	SelectNode(int node, const float cameraPosition[3]);
+	float	GetNodeDistance(int node, const float cameraPosition[3]) const;
+	void	MarkSelected(int node);
+	float	GetSplitDistance(int level) const;
+
+	const float *		m_heights;			//not owned, the chunk's heightmap
+	int					m_resolution;
+	int					m_levelCount;
+	float				m_cornerX, m_cornerZ;
+	float				m_spacing;
+	std::vector<Node>	m_nodes;			//m_nodes[0] is the root
+	std::vector<float>	m_levelError;		//worst height error in metres of drawing a level instead of full resolution
+	std::vector<float>	m_splitDistance;	//per level, for the current projection
+
+	//selection scratch, kept between frames to avoid reallocating
+	std::vector<char>	m_forceSplit;		//per node, split to keep neighbours within one level
+	std::vector<int>	m_selected;
+	std::vector<int>	m_tileLevel;		//per leaf sized tile, the level drawn over it
+	int					m_tilesPerSide;
+};
@@ -0,0 +1,124 @@
+#include "TerrainNormals.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define TERRAIN_NORMALS_SSE
+#endif
+
+
+//one row of the rectangle, a vertex at a time. neighbours are clamped to the heightmap, and the span shrinks to match
+static void ComputeRowScalar(const float * heights, int resolution, float spacing, int row, int firstColumn, int lastColumn,
+							 float * normals, size_t normalStride)
+{
+	const int rowDown = std::max(row - 1, 0);
+	const int rowUp = std::min(row + 1, resolution - 1);
+	const float inverseZSpan = 1.0f / ((rowUp - rowDown) * spacing);
+	const float * centre = heights + (size_t)row * resolution;
+	const float * down = heights + (size_t)rowDown * resolution;
+	const float * up = heights + (size_t)rowUp * resolution;
+
+	for (int column = firstColumn; column <= lastColumn; column++)
+	{
+		const int left = std::max(column - 1, 0);
+		const int right = std::min(column + 1, resolution - 1);
+
+		//the surface's slope along x and z. the normal is (-slope x, 1, -slope z), normalised
+		const float slopeX = (centre[right] - centre[left]) / ((right - left) * spacing);
+		const float slopeZ = (up[column] - down[column]) * inverseZSpan;
+		const float inverseLength = 1.0f / std::sqrt(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+
+		float * normal = (float*)((char*)normals + ((size_t)row * resolution + column) * normalStride);
+		normal[0] = -slopeX * inverseLength;
+		normal[1] = inverseLength;
+		normal[2] = -slopeZ * inverseLength;
+	}
+}
+
+void ComputeTerrainNormalsScalar(const float * heights, int resolution, float spacing,
+								 int firstRow, int lastRow, int firstColumn, int lastColumn,
+								 float * normals, size_t normalStride)
+{
+	if (resolution < 2)
+	{
+		return;
+	}
+	firstRow = std::max(firstRow, 0);
+	lastRow = std::min(lastRow, resolution - 1);
+	firstColumn = std::max(firstColumn, 0);
+	lastColumn = std::min(lastColumn, resolution - 1);
+
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		ComputeRowScalar(heights, resolution, spacing, row, firstColumn, lastColumn, normals, normalStride);
+	}
+}
+
+void ComputeTerrainNormals(const float * heights, int resolution, float spacing,
+						   int firstRow, int lastRow, int firstColumn, int lastColumn,
+						   float * normals, size_t normalStride)
+{
+#ifdef TERRAIN_NORMALS_SSE
+	if (resolution < 2)
+	{
+		return;
+	}
+	firstRow = std::max(firstRow, 0);
+	lastRow = std::min(lastRow, resolution - 1);
+	firstColumn = std::max(firstColumn, 0);
+	lastColumn = std::min(lastColumn, resolution - 1);
+
+	//the vector loop covers interior columns only, where both x neighbours exist. border columns and the leftovers go through the scalar row
+	const int firstVectorColumn = std::max(firstColumn, 1);
+	const int lastVectorColumn = std::min(lastColumn, resolution - 2);
+	const __m128 inverseXSpan = _mm_set1_ps(1.0f / (2.0f * spacing));
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 negate = _mm_set1_ps(-0.0f);
+
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		//a strip of three rows, clamped at the top and bottom of the heightmap
+		const int rowDown = std::max(row - 1, 0);
+		const int rowUp = std::min(row + 1, resolution - 1);
+		const __m128 inverseZSpan = _mm_set1_ps(1.0f / ((rowUp - rowDown) * spacing));
+		const float * centre = heights + (size_t)row * resolution;
+		const float * down = heights + (size_t)rowDown * resolution;
+		const float * up = heights + (size_t)rowUp * resolution;
+
+		if (firstColumn < firstVectorColumn)
+		{
+			ComputeRowScalar(heights, resolution, spacing, row, firstColumn, firstVectorColumn - 1, normals, normalStride);
+		}
+
+		int column = firstVectorColumn;
+		for (; column + 3 <= lastVectorColumn; column += 4)
+		{
+			const __m128 slopeX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(centre + column + 1), _mm_loadu_ps(centre + column - 1)), inverseXSpan);
+			const __m128 slopeZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(up + column), _mm_loadu_ps(down + column)), inverseZSpan);
+			const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(slopeX, slopeX), _mm_mul_ps(slopeZ, slopeZ)), one);
+			const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+			//the vertices are interleaved position / normal / uv, so the four results are written out one vertex at a time
+			float normalX[4], normalY[4], normalZ[4];
+			_mm_storeu_ps(normalX, _mm_xor_ps(_mm_mul_ps(slopeX, inverseLength), negate));
+			_mm_storeu_ps(normalY, inverseLength);
+			_mm_storeu_ps(normalZ, _mm_xor_ps(_mm_mul_ps(slopeZ, inverseLength), negate));
+			char * normal = (char*)normals + ((size_t)row * resolution + column) * normalStride;
+			for (int i = 0; i < 4; i++, normal += normalStride)
+			{
+				((float*)normal)[0] = normalX[i];
+				((float*)normal)[1] = normalY[i];
+				((float*)normal)[2] = normalZ[i];
+			}
+		}
+
+		if (column <= lastColumn)
+		{
+			ComputeRowScalar(heights, resolution, spacing, row, column, lastColumn, normals, normalStride);
+		}
+	}
+#else
+	ComputeTerrainNormalsScalar(heights, resolution, spacing, firstRow, lastRow, firstColumn, lastColumn, normals, normalStride);
+#endif
+}
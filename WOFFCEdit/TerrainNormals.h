@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+//Vertex normals of a square heightfield, straight from the heights rather than from the vertex positions.
+//Central differences inside, one sided differences on the border, so every vertex gets a normal and nothing is read
+//outside the heightmap. Only the vertices in the given rectangle (inclusive) are written, so an edit can recompute
+//just the normals it changed: its own rectangle grown by one vertex on each side.
+//normals points at the x of the first vertex's normal, normalStride is the bytes between consecutive vertices' normals.
+
+//four vertices at a time with SSE, falls back to the scalar version where there is no SSE
+void ComputeTerrainNormals(const float * heights, int resolution, float spacing,
+						   int firstRow, int lastRow, int firstColumn, int lastColumn,
+						   float * normals, size_t normalStride);
+
+//one vertex at a time. the SSE version's reference, and what it uses for the columns it cannot fit four to a register
+void ComputeTerrainNormalsScalar(const float * heights, int resolution, float spacing,
+								 int firstRow, int lastRow, int firstColumn, int lastColumn,
+								 float * normals, size_t normalStride);
@@ -0,0 +1,314 @@
+#include "TerrainRaycast.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+TerrainRaycast::TerrainRaycast()
+{
+	m_heights = NULL;
+	m_resolution = 0;
+	m_cornerX = 0.0f;
+	m_cornerZ = 0.0f;
+	m_spacing = 1.0f;
+}
+
+
+TerrainRaycast::~TerrainRaycast()
+{
+}
+
+void TerrainRaycast::Build(const float * heights, int resolution, float cornerX, float cornerZ, float spacing)
+{
+	Clear();
+	if (resolution < 2)
+	{
+		return;
+	}
+
+	m_heights = heights;
+	m_resolution = resolution;
+	m_cornerX = cornerX;
+	m_cornerZ = cornerZ;
+	m_spacing = spacing;
+
+	//halve the cells per side, rounding up, until there is one. single cells are read straight from their corners, so
+	//the bottom level stores nothing, which is most of the memory a full pyramid would take
+	int cells = resolution - 1;
+	while (true)
+	{
+		Level level;
+		level.cells = cells;
+		if (!m_levels.empty())
+		{
+			level.minHeight.resize((size_t)cells * cells);
+			level.maxHeight.resize((size_t)cells * cells);
+		}
+		m_levels.push_back(std::move(level));
+		if (cells == 1)
+		{
+			break;
+		}
+		cells = (cells + 1) / 2;
+	}
+
+	UpdateRect(0, resolution - 1, 0, resolution - 1);
+}
+
+void TerrainRaycast::UpdateRect(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	if (!IsBuilt())
+	{
+		return;
+	}
+
+	//a vertex belongs to the cells either side of it
+	firstRow = std::max(firstRow - 1, 0);
+	firstColumn = std::max(firstColumn - 1, 0);
+	lastRow = std::min(lastRow, m_levels[0].cells - 1);
+	lastColumn = std::min(lastColumn, m_levels[0].cells - 1);
+	for (int level = 1; level < (int)m_levels.size(); level++)
+	{
+		firstRow /= 2;
+		lastRow /= 2;
+		firstColumn /= 2;
+		lastColumn /= 2;
+		if (firstRow > lastRow || firstColumn > lastColumn)
+		{
+			return;
+		}
+		UpdateCells(level, firstRow, lastRow, firstColumn, lastColumn);
+	}
+}
+
+void TerrainRaycast::Clear()
+{
+	m_levels.clear();
+	m_heights = NULL;
+	m_resolution = 0;
+}
+
+bool TerrainRaycast::IsBuilt() const
+{
+	return !m_levels.empty();
+}
+
+void TerrainRaycast::GetHeightRange(float & minHeight, float & maxHeight) const
+{
+	if (!IsBuilt())
+	{
+		minHeight = 0.0f;
+		maxHeight = 0.0f;
+		return;
+	}
+	GetCellRange((int)m_levels.size() - 1, 0, 0, minHeight, maxHeight);
+}
+
+bool TerrainRaycast::IntersectRay(const float origin[3], const float direction[3], float maxDistance, TerrainRayHit & hit) const
+{
+	if (!IsBuilt())
+	{
+		return false;
+	}
+
+	//clip to the box around the whole terrain, its height range is the top of the pyramid
+	float minHeight, maxHeight;
+	GetCellRange((int)m_levels.size() - 1, 0, 0, minHeight, maxHeight);
+	const float size = (m_resolution - 1) * m_spacing;
+	const float boxMin[3] = { m_cornerX, minHeight, m_cornerZ };
+	const float boxMax[3] = { m_cornerX + size, maxHeight, m_cornerZ + size };
+	float start = 0.0f;
+	float end = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (direction[axis] == 0.0f)
+		{
+			if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+		float t0 = (boxMin[axis] - origin[axis]) / direction[axis];
+		float t1 = (boxMax[axis] - origin[axis]) / direction[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		start = std::max(start, t0);
+		end = std::min(end, t1);
+	}
+	if (start > end)
+	{
+		return false;
+	}
+
+	//the walk is in doubles: on a 4096 cell terrain a float cannot tell a point from one a small step further on
+	const double rayOrigin[3] = { origin[0] - m_cornerX, origin[1], origin[2] - m_cornerZ };
+	const double rayDirection[3] = { direction[0], direction[1], direction[2] };
+
+	//a small step past a cell's edge so the next lookup lands in the next cell. a ray straight up or down stays in its cell
+	const double horizontal = std::max(std::fabs(rayDirection[0]), std::fabs(rayDirection[2]));
+	const double nudge = horizontal > 0.0 ? 1e-6 * m_spacing / horizontal : 0.0;
+
+	//hierarchical DDA: test the ray's height over the cell it is in at the current level. if it passes clear of the
+	//cell's height range, step to the cell's far edge and try the coarser level, otherwise go down a level.
+	//at the bottom the cell's two triangles are tested
+	int levelIndex = (int)m_levels.size() - 1;
+	double t = start;
+	while (t <= end)
+	{
+		const Level & level = m_levels[levelIndex];
+		const double cellSize = m_spacing * (double)(1 << levelIndex);
+		const double lookup = t + nudge;
+		const int column = std::min(std::max((int)std::floor((rayOrigin[0] + rayDirection[0] * lookup) / cellSize), 0), level.cells - 1);
+		const int row = std::min(std::max((int)std::floor((rayOrigin[2] + rayDirection[2] * lookup) / cellSize), 0), level.cells - 1);
+
+		//where the ray leaves the cell
+		double cellEnd = end;
+		const double cellMin[2] = { column * cellSize, row * cellSize };
+		const int axes[2] = { 0, 2 };
+		for (int i = 0; i < 2; i++)
+		{
+			const int axis = axes[i];
+			if (rayDirection[axis] > 0.0)
+			{
+				cellEnd = std::min(cellEnd, (cellMin[i] + cellSize - rayOrigin[axis]) / rayDirection[axis]);
+			}
+			else if (rayDirection[axis] < 0.0)
+			{
+				cellEnd = std::min(cellEnd, (cellMin[i] - rayOrigin[axis]) / rayDirection[axis]);
+			}
+		}
+		cellEnd = std::max(cellEnd, t);
+
+		const double startHeight = rayOrigin[1] + rayDirection[1] * t;
+		const double endHeight = rayOrigin[1] + rayDirection[1] * cellEnd;
+		GetCellRange(levelIndex, row, column, minHeight, maxHeight);
+		const bool clear = std::min(startHeight, endHeight) > maxHeight || std::max(startHeight, endHeight) < minHeight;
+		if (!clear && levelIndex > 0)
+		{
+			levelIndex--;
+			continue;
+		}
+		if (!clear && IntersectCell(row, column, origin, direction, (float)std::max(t - nudge, 0.0), (float)(cellEnd + nudge), hit))
+		{
+			return true;
+		}
+
+		t = std::max(cellEnd, t + nudge);
+		if (nudge == 0.0)
+		{
+			break;		//vertical, and the one cell it is in has been tested
+		}
+		levelIndex = std::min(levelIndex + 1, (int)m_levels.size() - 1);
+	}
+	return false;
+}
+
+void TerrainRaycast::UpdateCells(int level, int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	//from the up to four cells below, fewer on the last row and column when the level below had an odd count
+	Level & cells = m_levels[level];
+	const int belowCells = m_levels[level - 1].cells;
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int column = firstColumn; column <= lastColumn; column++)
+		{
+			float minHeight = FLT_MAX;
+			float maxHeight = -FLT_MAX;
+			for (int y = row * 2; y <= std::min(row * 2 + 1, belowCells - 1); y++)
+			{
+				for (int x = column * 2; x <= std::min(column * 2 + 1, belowCells - 1); x++)
+				{
+					float belowMin, belowMax;
+					GetCellRange(level - 1, y, x, belowMin, belowMax);
+					minHeight = std::min(minHeight, belowMin);
+					maxHeight = std::max(maxHeight, belowMax);
+				}
+			}
+			cells.minHeight[(size_t)row * cells.cells + column] = minHeight;
+			cells.maxHeight[(size_t)row * cells.cells + column] = maxHeight;
+		}
+	}
+}
+
+void TerrainRaycast::GetCellRange(int level, int row, int column, float & minHeight, float & maxHeight) const
+{
+	if (level > 0)
+	{
+		const Level & cells = m_levels[level];
+		minHeight = cells.minHeight[(size_t)row * cells.cells + column];
+		maxHeight = cells.maxHeight[(size_t)row * cells.cells + column];
+		return;
+	}
+
+	//a single cell, its triangles never go outside its four corners
+	const float * corner = m_heights + (size_t)row * m_resolution + column;
+	minHeight = std::min(std::min(corner[0], corner[1]), std::min(corner[m_resolution], corner[m_resolution + 1]));
+	maxHeight = std::max(std::max(corner[0], corner[1]), std::max(corner[m_resolution], corner[m_resolution + 1]));
+}
+
+bool TerrainRaycast::IntersectCell(int row, int column, const float origin[3], const float direction[3], float minDistance, float maxDistance, TerrainRayHit & hit) const
+{
+	//split bottom left to top right, as the terrain is drawn
+	const float x0 = m_cornerX + column * m_spacing;
+	const float z0 = m_cornerZ + row * m_spacing;
+	const float * corner = m_heights + (size_t)row * m_resolution + column;
+	const float bottomLeft[3] = { x0, corner[0], z0 };
+	const float bottomRight[3] = { x0 + m_spacing, corner[1], z0 };
+	const float topRight[3] = { x0 + m_spacing, corner[m_resolution + 1], z0 + m_spacing };
+	const float topLeft[3] = { x0, corner[m_resolution], z0 + m_spacing };
+	const float * triangles[2][3] = { { bottomLeft, bottomRight, topRight }, { bottomLeft, topRight, topLeft } };
+
+	bool found = false;
+	for (int i = 0; i < 2; i++)
+	{
+		//Moller Trumbore, from either side
+		const float * a = triangles[i][0];
+		const float * b = triangles[i][1];
+		const float * c = triangles[i][2];
+		const float edge1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const float edge2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		const float p[3] = { direction[1] * edge2[2] - direction[2] * edge2[1], direction[2] * edge2[0] - direction[0] * edge2[2], direction[0] * edge2[1] - direction[1] * edge2[0] };
+		const float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+		if (std::fabs(determinant) < 1e-12f)
+		{
+			continue;		//parallel to the triangle
+		}
+		const float inverseDeterminant = 1.0f / determinant;
+		const float s[3] = { origin[0] - a[0], origin[1] - a[1], origin[2] - a[2] };
+		const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+		if (u < 0.0f || u > 1.0f)
+		{
+			continue;
+		}
+		const float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+		const float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			continue;
+		}
+		const float distance = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+		if (distance < minDistance || distance > maxDistance || (found && distance >= hit.distance))
+		{
+			continue;
+		}
+
+		found = true;
+		hit.distance = distance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			hit.position[axis] = origin[axis] + direction[axis] * distance;
+		}
+
+		//edge1 x edge2 faces down for these windings, so the other way round
+		float normal[3] = { edge2[1] * edge1[2] - edge2[2] * edge1[1], edge2[2] * edge1[0] - edge2[0] * edge1[2], edge2[0] * edge1[1] - edge2[1] * edge1[0] };
+		const float inverseLength = 1.0f / std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			hit.normal[axis] = normal[axis] * inverseLength;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+//where a ray met the terrain
+struct TerrainRayHit
+{
+	float	distance;			//along the ray, in units of its direction
+	float	position[3];
+	float	normal[3];			//of the triangle hit, facing up
+};
+
+//Ray queries against a square heightfield of resolution x resolution vertices, split into triangles the way the
+//terrain is drawn. A min / max pyramid over the cells lets the walk step over whole blocks of cells the ray passes
+//above, and only the cells it might touch are walked one at a time and tested against their two triangles.
+//Reads the heights in place, the owner keeps them alive and calls UpdateRect after editing them.
+class TerrainRaycast
+{
+public:
+	TerrainRaycast();
+	~TerrainRaycast();
+
+	//heights is resolution squared, row major. corner is the world x / z of vertex 0, spacing the metres between vertices
+	void	Build(const float * heights, int resolution, float cornerX, float cornerZ, float spacing);
+	void	UpdateRect(int firstRow, int lastRow, int firstColumn, int lastColumn);	//vertices edited, inclusive
+	void	Clear();
+	bool	IsBuilt() const;
+	void	GetHeightRange(float & minHeight, float & maxHeight) const;		//of the whole terrain, 0 to 0 if not built
+
+	//nearest hit no further than maxDistance. direction need not be normalised, distance is in units of it
+	bool	IntersectRay(const float origin[3], const float direction[3], float maxDistance, TerrainRayHit & hit) const;
+
+private:
+	struct Level
+	{
+		int					cells;			//along each side
+		std::vector<float>	minHeight;		//cells squared, row major. empty at level 0
+		std::vector<float>	maxHeight;
+	};
+
+	void	UpdateCells(int level, int firstRow, int lastRow, int firstColumn, int lastColumn);		//level 1 and up
+	void	GetCellRange(int level, int row, int column, float & minHeight, float & maxHeight) const;
+	bool	IntersectCell(int row, int column, const float origin[3], const float direction[3], float minDistance, float maxDistance, TerrainRayHit & hit) const;
+
+	const float *		m_heights;			//not owned
+	int					m_resolution;
+	float				m_cornerX, m_cornerZ;
+	float				m_spacing;
+	std::vector<Level>	m_levels;			//m_levels[0] is one cell per quad and stores nothing, each level up halves the cells per side, down to one
+};
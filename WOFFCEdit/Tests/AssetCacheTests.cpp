@@ -0,0 +1,114 @@
+#include "Test.h"
+#include "AssetCache.h"
+#include <string>
+#include <vector>
+
+//stands in for a model or texture: the path it was loaded from
+struct TestAsset
+{
+	std::string		path;
+};
+
+//counts its loads, fails any path with "missing" in it, and says each asset takes 100 bytes
+struct TestLoader
+{
+	std::vector<std::string>	loads;
+
+	AssetCache<TestAsset>::Loader Get()
+	{
+		return [this](const std::string & path, size_t & bytes) -> std::shared_ptr<TestAsset>
+		{
+			loads.push_back(path);
+			if (path.find("missing") != std::string::npos)
+			{
+				bytes = 100;		//ignored for a failure
+				return nullptr;
+			}
+			bytes = 100;
+			std::shared_ptr<TestAsset> asset = std::make_shared<TestAsset>();
+			asset->path = path;
+			return asset;
+		};
+	}
+};
+
+TEST(AssetPathNormalize)
+{
+	CHECK(NormalizeAssetPath("database/data/rock.dds") == "database/data/rock.dds");
+	CHECK(NormalizeAssetPath("Database\\Data\\Rock.DDS") == "database/data/rock.dds");
+	CHECK(NormalizeAssetPath("./database//data/./rock.dds") == "database/data/rock.dds");
+	CHECK(NormalizeAssetPath("database\\\\data\\.\\rock.dds") == "database/data/rock.dds");
+	CHECK(NormalizeAssetPath("database/data/../data/rock.dds") != "database/data/rock.dds");	//parent segments are left alone
+	CHECK(NormalizeAssetPath("database/data/rock.dds") != NormalizeAssetPath("database/data/rock2.dds"));
+	CHECK(NormalizeAssetPath("my.model/rock.dds") == "my.model/rock.dds");
+	CHECK(NormalizeAssetPath("") == "");
+}
+
+//every object using a file gets the one asset, loaded once, whichever way its path is spelt
+TEST(AssetCacheShares)
+{
+	AssetCache<TestAsset> cache;
+	TestLoader loader;
+	std::shared_ptr<TestAsset> first = cache.Get("database/data/rock.cmo", loader.Get());
+	std::shared_ptr<TestAsset> second = cache.Get("database/data/rock.cmo", loader.Get());
+	std::shared_ptr<TestAsset> aliased = cache.Get("Database\\Data\\.\\Rock.CMO", loader.Get());
+	std::shared_ptr<TestAsset> other = cache.Get("database/data/tree.cmo", loader.Get());
+	CHECK(first && first == second && first == aliased);
+	CHECK(other && other != first);
+	CHECK(loader.loads.size() == 2);
+	CHECK(loader.loads[0] == "database/data/rock.cmo");		//the loader is given the path as asked for
+	CHECK(cache.GetHits() == 2);
+	CHECK(cache.GetMisses() == 2);
+	CHECK(cache.GetCount() == 2);
+	CHECK(cache.GetResidentBytes() == 200);
+	CHECK(cache.Contains("DATABASE/DATA/TREE.CMO"));
+	CHECK(!cache.Contains("database/data/bush.cmo"));
+
+	//a missing file is tried once, and takes no memory
+	CHECK(!cache.Get("database/data/missing.cmo", loader.Get()));
+	CHECK(!cache.Get("Database/Data/Missing.cmo", loader.Get()));
+	CHECK(loader.loads.size() == 3);
+	CHECK(cache.Contains("database/data/missing.cmo"));
+	CHECK(cache.GetResidentBytes() == 200);
+
+	cache.ResetCounters();
+	CHECK(cache.GetHits() == 0 && cache.GetMisses() == 0);
+	CHECK(cache.GetCount() == 3);
+}
+
+//Purge keeps what is still in use and drops the rest, which is then loaded again if asked for
+TEST(AssetCachePurge)
+{
+	AssetCache<TestAsset> cache;
+	TestLoader loader;
+	std::shared_ptr<TestAsset> rock = cache.Get("database/data/rock.cmo", loader.Get());
+	std::shared_ptr<TestAsset> tree = cache.Get("database/data/tree.cmo", loader.Get());
+	std::shared_ptr<TestAsset> treeAgain = cache.Get("Database/Data/Tree.cmo", loader.Get());
+	cache.Get("database/data/missing.cmo", loader.Get());
+	cache.Purge();
+	CHECK(cache.GetCount() == 2);		//the failure goes, so the next load tries the file again
+	CHECK(cache.GetResidentBytes() == 200);
+
+	//released by one user of the tree, it is still held by the other
+	tree.reset();
+	cache.Purge();
+	CHECK(cache.Contains("database/data/tree.cmo"));
+	treeAgain.reset();
+	cache.Purge();
+	CHECK(!cache.Contains("database/data/tree.cmo"));
+	CHECK(cache.Contains("database/data/rock.cmo"));
+	CHECK(cache.GetCount() == 1);
+	CHECK(cache.GetResidentBytes() == 100);
+
+	const size_t loads = loader.loads.size();
+	tree = cache.Get("database/data/tree.cmo", loader.Get());
+	CHECK(tree && tree->path == "database/data/tree.cmo");
+	CHECK(loader.loads.size() == loads + 1);
+	CHECK(cache.GetResidentBytes() == 200);
+
+	//Clear forgets everything, even what is in use, and the users keep their copies
+	cache.Clear();
+	CHECK(cache.GetCount() == 0);
+	CHECK(cache.GetResidentBytes() == 0);
+	CHECK(rock && rock->path == "database/data/rock.cmo");
+}
@@ -0,0 +1,113 @@
+#include "Test.h"
+#include "AssetLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+//files written next to the test database, each filled with its own index so a mix-up shows
+static void MakeTestAssets(int count, size_t bytes, std::vector<std::string> & paths)
+{
+	paths.clear();
+	std::vector<uint8_t> contents(bytes);
+	for (int i = 0; i < count; i++)
+	{
+		char path[64];
+		sprintf(path, "database/loadertest_%d.bin", i);
+		std::fill(contents.begin(), contents.end(), (uint8_t)i);
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char*)contents.data(), contents.size());
+		paths.push_back(path);
+	}
+}
+
+static void DeleteTestAssets(const std::vector<std::string> & paths)
+{
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		std::remove(paths[i].c_str());
+	}
+}
+
+static void WaitForLoader(const AssetLoader & loader)
+{
+	while (loader.GetPendingCount() > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+//every request is read once, whichever way its path is spelt, and a missing file completes with no data
+TEST(AssetLoaderReads)
+{
+	std::vector<std::string> paths;
+	MakeTestAssets(8, 1000, paths);
+	AssetLoader loader;
+	loader.Start(3);
+	CHECK(loader.GetThreadCount() == 3);
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		loader.Request(paths[i]);
+	}
+	loader.Request("Database\\LoaderTest_0.bin");
+	loader.Request("database/missing.bin");
+	WaitForLoader(loader);
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		AssetLoader::FileData data = loader.GetData(paths[i]);
+		CHECK(loader.IsComplete(paths[i]));
+		CHECK(data && data->size() == 1000 && (*data)[0] == (uint8_t)i && (*data)[999] == (uint8_t)i);
+	}
+	CHECK(loader.GetData("DATABASE/loadertest_0.bin") == loader.GetData(paths[0]));
+	CHECK(loader.IsComplete("database/missing.bin"));
+	CHECK(!loader.GetData("database/missing.bin"));
+	CHECK(!loader.IsComplete("database/never_asked.bin"));
+
+	//released reads are forgotten, and read again if asked for
+	AssetLoader::FileData held = loader.GetData(paths[1]);
+	loader.ReleaseData();
+	CHECK(!loader.IsComplete(paths[1]));
+	CHECK(held && held->size() == 1000);
+	loader.Request(paths[1]);
+	WaitForLoader(loader);
+	CHECK(loader.GetData(paths[1]) && loader.GetData(paths[1]) != held);
+
+	loader.Stop();
+	CHECK(loader.GetThreadCount() == 0);
+	DeleteTestAssets(paths);
+}
+
+//user-008: time to read a level's worth of assets on 1 to 8 workers. The files were just written, so they come from
+//the OS cache, and this measures how well the workers overlap rather than the disk
+BENCHMARK(AssetLoaderBenchmark)
+{
+	const int counts[] = { 1, 2, 4, 8 };
+	const int fileCount = 256;
+	const size_t fileBytes = 256 * 1024;
+	std::vector<std::string> paths;
+	MakeTestAssets(fileCount, fileBytes, paths);
+	for (int threads : counts)
+	{
+		AssetLoader loader;
+		loader.Start(threads);
+		TestTimer timer;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			loader.Request(paths[i]);
+		}
+		WaitForLoader(loader);
+		const double seconds = timer.GetSeconds();
+
+		size_t bytes = 0;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			AssetLoader::FileData data = loader.GetData(paths[i]);
+			bytes += data ? data->size() : 0;
+		}
+		CHECK(bytes == fileCount * fileBytes);
+		printf("  %d threads: %d files in %.1f ms, %.0f MB/s\n", threads, fileCount, seconds * 1e3, bytes / seconds / (1024.0 * 1024.0));
+	}
+	printf("  (%u cores)\n", std::thread::hardware_concurrency());
+	DeleteTestAssets(paths);
+}
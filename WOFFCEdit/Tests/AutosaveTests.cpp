@@ -0,0 +1,157 @@
+#include "Test.h"
+#include "TestScene.h"
+#include "Autosave.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+//the UI thread's share of an autosave, as ToolMain::AutosaveChanges does it: copy out the changed rows and hand them over
+static int SubmitChanges(SceneStore & sceneGraph, Autosave & autosave)
+{
+	const unsigned int * flags = sceneGraph.GetFlags();
+	int changedCount = 0;
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		changedCount += (flags[i] & SCENE_OBJECT_AUTOSAVE) != 0;
+	}
+	const bool complete = changedCount <= AUTOSAVE_MAX_ROWS;
+	changedCount = std::min(changedCount, AUTOSAVE_MAX_ROWS);
+
+	std::vector<SceneObject> changedObjects(changedCount);
+	int changed = 0;
+	for (int i = 0; changed < changedCount; i++)
+	{
+		if (flags[i] & SCENE_OBJECT_AUTOSAVE)
+		{
+			sceneGraph.Get(i, changedObjects[changed++]);
+			sceneGraph.SetFlag(i, SCENE_OBJECT_AUTOSAVE, false);
+		}
+	}
+	std::vector<int> deletedObjectIDs;
+	sceneGraph.TakeAutosaveDeletedIDs(deletedObjectIDs);
+	autosave.Submit(changedObjects, deletedObjectIDs, complete);
+	return changedCount;
+}
+
+static void ClearAutosaveFlags(SceneStore & sceneGraph)
+{
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		sceneGraph.SetFlag(i, SCENE_OBJECT_AUTOSAVE, false);
+	}
+	std::vector<int> deletedObjectIDs;
+	sceneGraph.TakeAutosaveDeletedIDs(deletedObjectIDs);
+}
+
+//submitted edits reach the recovery tables by the time Stop returns, and a recovery writes them into Objects
+TEST(AutosaveRecovers)
+{
+	const std::string path = CopyTestDatabase("autosave_test");
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+	CHECK(!database.HasAutosave());
+
+	//as if every object had been created in the editor since the last save
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, 2000, true);
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		sceneGraph.SetFlag(i, SCENE_OBJECT_AUTOSAVE, true);
+	}
+	Autosave autosave;
+	CHECK(autosave.Start(path.c_str(), 3600));
+	CHECK(!autosave.IsDue());
+
+	//more than one snapshot holds, so the rest is left for the next
+	CHECK(SubmitChanges(sceneGraph, autosave) == AUTOSAVE_MAX_ROWS);
+	CHECK(SubmitChanges(sceneGraph, autosave) == 2000 - AUTOSAVE_MAX_ROWS);
+	CHECK(SubmitChanges(sceneGraph, autosave) == 0);
+	autosave.Stop();
+	CHECK(database.HasAutosave());
+
+	const SaveStatistics recovered = database.RecoverAutosave();
+	CHECK(recovered.succeeded);
+	CHECK(recovered.rowsWritten == 2000);
+	CHECK(database.CountObjects(TEST_SCENE_CHUNK) == 2000);
+	CHECK(!database.HasAutosave());
+
+	//a save discards what the autosave wrote
+	CHECK(autosave.Start(path.c_str(), 3600));
+	sceneGraph.SetPosition(0, 1.0f, 2.0f, 3.0f);
+	CHECK(SubmitChanges(sceneGraph, autosave) == 1);
+	autosave.Discard();
+	autosave.Stop();
+	CHECK(!database.HasAutosave());
+
+	database.Close();
+	DeleteTestDatabase(path);
+}
+
+//user-023: frame time on a 100k object scene while a selection of 500 objects is dragged about, with autosave off and
+//with it snapshotting as often as the worker keeps up. Each frame is the edit plus the UI thread's autosave work, and
+//frames are paced 4 ms apart so the worker gets to write between them, as it would between real frames
+BENCHMARK(AutosaveFrameBenchmark)
+{
+	const int count = 100000;
+	const int frames = 300;
+	const int selection = 500;
+	const std::string path = CopyTestDatabase("autosave_benchmark");
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, count, true);
+	ClearAutosaveFlags(sceneGraph);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const bool autosaving = pass == 1;
+		Autosave autosave;
+		if (autosaving)
+		{
+			CHECK(autosave.Start(path.c_str(), 0));
+		}
+
+		std::vector<double> frameSeconds(frames);
+		double snapshotSeconds = 0.0, longestSnapshot = 0.0;
+		int snapshots = 0, rows = 0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			TestTimer timer;
+			for (int i = 0; i < selection; i++)
+			{
+				const int index = (frame * 97 + i * 199) % count;
+				sceneGraph.SetPosition(index, (float)frame, (float)i, 0.0f);
+			}
+			if (autosaving && autosave.IsDue())
+			{
+				TestTimer snapshotTimer;
+				rows += SubmitChanges(sceneGraph, autosave);
+				const double seconds = snapshotTimer.GetSeconds();
+				snapshotSeconds += seconds;
+				longestSnapshot = std::max(longestSnapshot, seconds);
+				snapshots++;
+			}
+			frameSeconds[frame] = timer.GetSeconds();
+			std::this_thread::sleep_for(std::chrono::microseconds(4000) - std::chrono::microseconds((int)(frameSeconds[frame] * 1e6)));
+		}
+		TestTimer stopTimer;
+		autosave.Stop();
+		const double stopSeconds = stopTimer.GetSeconds();
+		ClearAutosaveFlags(sceneGraph);
+
+		double total = 0.0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			total += frameSeconds[frame];
+		}
+		std::sort(frameSeconds.begin(), frameSeconds.end());
+		printf("  autosave %s: frame mean %6.3f ms, 99th %6.3f ms, worst %6.3f ms",
+			autosaving ? "on " : "off", total / frames * 1e3, frameSeconds[frames * 99 / 100] * 1e3, frameSeconds.back() * 1e3);
+		if (autosaving)
+		{
+			printf(", %d snapshots of %d rows, copy mean %.3f ms, worst %.3f ms, final write %.3f s",
+				snapshots, rows, snapshots > 0 ? snapshotSeconds / snapshots * 1e3 : 0.0, longestSnapshot * 1e3, stopSeconds);
+		}
+		printf("\n");
+	}
+	DeleteTestDatabase(path);
+}
@@ -0,0 +1,87 @@
+#include "Test.h"
+#include "DisplayChunk.h"
+#include <cmath>
+
+using namespace DirectX::SimpleMath;
+
+//a chunk row for a square of resolution vertices a metre apart, centred on origin
+static void MakeTestChunk(ChunkObject & chunk, int resolution, float originX, float originZ)
+{
+	chunk.name = "test";
+	chunk.chunk_x_size_metres = resolution - 1;
+	chunk.chunk_y_size_metres = resolution - 1;
+	chunk.chunk_base_resolution = resolution;
+	chunk.origin_x = originX;
+	chunk.origin_z = originZ;
+}
+
+//the terrain sits where its chunk row says, and a brush dab reaches the heights, the rays and the ground height
+TEST(DisplayChunkFromChunkRow)
+{
+	ChunkObject chunk;
+	MakeTestChunk(chunk, 257, 1000.0f, -2000.0f);
+	DisplayChunk terrain;
+	terrain.PopulateChunkData(&chunk);
+	terrain.InitialiseBatch();
+	CHECK(terrain.ContainsPoint(1000.0f, -2000.0f));
+	CHECK(terrain.ContainsPoint(1128.0f, -1872.0f));
+	CHECK(!terrain.ContainsPoint(1129.0f, -2000.0f));
+	CHECK(!terrain.ContainsPoint(0.0f, 0.0f));
+	CHECK(terrain.GetHeightAt(1000.0f, -2000.0f) == 0.0f);
+
+	TerrainBrush brush;
+	brush.radius = 20.0f;
+	terrain.ApplyBrush(brush, Vector3(1000.0f, 0.0f, -2000.0f), 1.0f);
+	const float height = terrain.GetHeightAt(1000.0f, -2000.0f);
+	CHECK(height > 0.0f);
+	CHECK(terrain.GetHeightAt(1050.0f, -2000.0f) == 0.0f);
+
+	TerrainRayHit hit;
+	CHECK(terrain.IntersectRay(Vector3(1000.0f, 100.0f, -2000.0f), Vector3(0.0f, -1.0f, 0.0f), 1000.0f, hit));
+	CHECK_CLOSE(hit.position[1], height, 1e-3f);
+}
+
+//user-011: InitialiseBatch, a full UpdateTerrain and a brush sized update, over the resolutions levels use.
+//All three should grow with the number of vertices and no faster
+BENCHMARK(TerrainBatchBenchmark)
+{
+	const int resolutions[] = { 129, 513, 1025, 2049, 4097 };
+	for (int resolution : resolutions)
+	{
+		ChunkObject chunk;
+		MakeTestChunk(chunk, resolution, 0.0f, 0.0f);
+		DisplayChunk terrain;
+		TestTimer timer;
+		terrain.PopulateChunkData(&chunk);
+		const double allocateSeconds = timer.GetSeconds();
+
+		timer.Restart();
+		terrain.InitialiseBatch();
+		const double initialiseSeconds = timer.GetSeconds();
+
+		//some hills, so the update has real normals to work out
+		TerrainBrush brush;
+		brush.radius = 40.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			terrain.ApplyBrush(brush, Vector3((i % 4 - 1.5f) * resolution * 0.2f, 0.0f, (i / 4 - 1.5f) * resolution * 0.2f), 1.0f);
+		}
+		timer.Restart();
+		terrain.UpdateTerrain();
+		const double updateSeconds = timer.GetSeconds();
+
+		//64 x 64 vertices in the middle, about what one dab of a large brush dirties
+		const int passes = 100;
+		const int first = resolution / 2 - 32;
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			terrain.UpdateTerrainRect(first, first + 63, first, first + 63);
+		}
+		const double rectSeconds = timer.GetSeconds() / passes;
+
+		const double vertices = (double)resolution * resolution;
+		printf("  %4d^2: allocate %8.2f ms, InitialiseBatch %8.2f ms (%5.1f ns/vertex), UpdateTerrain %8.2f ms (%5.1f ns/vertex), 64^2 rect %6.3f ms\n",
+			resolution, allocateSeconds * 1e3, initialiseSeconds * 1e3, initialiseSeconds * 1e9 / vertices, updateSeconds * 1e3, updateSeconds * 1e9 / vertices, rectSeconds * 1e3);
+	}
+}
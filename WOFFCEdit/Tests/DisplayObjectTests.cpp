@@ -0,0 +1,128 @@
+#include "Test.h"
+#include "DisplayObject.h"
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+//what Game did for every object every frame before the matrices were cached
+static Matrix GetObjectWorldMatrix(const DisplayObject & object, const Matrix & world)
+{
+	const XMVECTORF32 scale = { object.m_scale.x, object.m_scale.y, object.m_scale.z };
+	const XMVECTORF32 translate = { object.m_position.x, object.m_position.y, object.m_position.z };
+	const XMVECTOR rotate = Quaternion::CreateFromYawPitchRoll(object.m_orientation.y * 3.1415 / 180, object.m_orientation.x * 3.1415 / 180, object.m_orientation.z * 3.1415 / 180);
+	return world * XMMatrixTransformation(g_XMZero, Quaternion::Identity, scale, g_XMZero, rotate, translate);
+}
+
+static bool SameMatrix(const Matrix & a, const Matrix & b, float tolerance)
+{
+	const float * left = &a._11;
+	const float * right = &b._11;
+	for (int i = 0; i < 16; i++)
+	{
+		if (std::fabs(left[i] - right[i]) > tolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//objects spread over a grid, each turned and scaled a little differently
+static void MakeTestObjects(int count, std::vector<DisplayObject> & objects)
+{
+	objects.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		DisplayObject & object = objects[i];
+		object.m_ID = i + 1;
+		object.m_position = Vector3((float)(i % 250) * 4.0f, (float)(i % 7), (float)(i / 250) * 4.0f);
+		object.m_orientation = Vector3((float)(i % 30), (float)(i % 360), (float)(i % 11));
+		object.m_scale = Vector3(1.0f + (i % 3) * 0.5f, 1.0f, 1.0f + (i % 5) * 0.25f);
+		object.MarkTransformDirty();
+		object.UpdateLocalTransform();
+		object.SetWorld(object.m_local);
+	}
+}
+
+//the cached matrix is what the old per-frame rebuild gave, and only changes once it is marked dirty
+TEST(DisplayObjectTransformCache)
+{
+	DisplayObject object;
+	CHECK(object.m_transformDirty);
+	object.m_position = Vector3(10.0f, -2.0f, 35.0f);
+	object.m_orientation = Vector3(15.0f, 120.0f, -30.0f);
+	object.m_scale = Vector3(2.0f, 1.0f, 0.5f);
+	object.UpdateLocalTransform();
+	CHECK(!object.m_transformDirty);
+	CHECK(SameMatrix(object.m_local, GetObjectWorldMatrix(object, Matrix::Identity), 1e-5f));
+
+	//moved but not marked, the cache is left alone
+	const Matrix before = object.m_local;
+	object.m_position.x = 50.0f;
+	object.UpdateLocalTransform();
+	CHECK(SameMatrix(object.m_local, before, 0.0f));
+	object.MarkTransformDirty();
+	object.UpdateLocalTransform();
+	CHECK(SameMatrix(object.m_local, GetObjectWorldMatrix(object, Matrix::Identity), 1e-5f));
+	CHECK(std::fabs(object.m_local._41 - 50.0f) < 1e-5f);
+
+	//the world from the hierarchy, with its inverse, and a model-less object's bounds at its position
+	Matrix parent = Matrix::Identity;
+	parent._41 = 100.0f;
+	parent._43 = -20.0f;
+	object.SetWorld(object.m_local * parent);
+	CHECK(SameMatrix(object.m_world * object.m_worldInverse, Matrix::Identity, 1e-4f));
+	CHECK(std::fabs(object.m_worldBounds.Center.x - 150.0f) < 1e-4f);
+	CHECK(std::fabs(object.m_worldBounds.Center.z - 15.0f) < 1e-4f);
+	CHECK(object.m_worldBounds.Extents.x == 0.0f);
+}
+
+//user-006: per-frame CPU time for 50k static objects, rebuilding every matrix as before against reading the cached ones
+BENCHMARK(DisplayObjectFrameBenchmark)
+{
+	const int count = 50000;
+	const int frames = 20;
+	std::vector<DisplayObject> objects;
+	MakeTestObjects(count, objects);
+	std::vector<Matrix> instances(count);		//stands in for the instance buffer the worlds are written to
+
+	float checksum = 0.0f;
+	TestTimer timer;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			instances[i] = GetObjectWorldMatrix(objects[i], Matrix::Identity);
+		}
+		checksum += instances[frame]._41;
+	}
+	const double rebuildSeconds = timer.GetSeconds() / frames;
+
+	timer.Restart();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			instances[i] = objects[i].m_world;
+		}
+		checksum += instances[frame]._41;
+	}
+	const double cachedSeconds = timer.GetSeconds() / frames;
+
+	//the frame after everything has moved pays for the rebuild once, plus the inverse and bounds
+	timer.Restart();
+	for (int i = 0; i < count; i++)
+	{
+		objects[i].MarkTransformDirty();
+		objects[i].UpdateLocalTransform();
+		objects[i].SetWorld(objects[i].m_local);
+		instances[i] = objects[i].m_world;
+	}
+	const double movedSeconds = timer.GetSeconds();
+
+	CHECK(SameMatrix(instances[count - 1], GetObjectWorldMatrix(objects[count - 1], Matrix::Identity), 1e-4f));
+	printf("  %d objects: rebuilt %.3f ms/frame, cached %.3f ms/frame, all moved %.3f ms (%g)\n",
+		count, rebuildSeconds * 1e3, cachedSeconds * 1e3, movedSeconds * 1e3, checksum);
+}
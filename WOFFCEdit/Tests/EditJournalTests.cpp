@@ -0,0 +1,294 @@
+#include "Test.h"
+#include "TestScene.h"
+#include "EditJournal.h"
+#include "SceneStore.h"
+#include <cstring>
+
+//added and removed objects come back with their rows, in delta order, and count against the object ring
+TEST(JournalObjectRecords)
+{
+	EditJournal journal;
+	SceneObject first, second;
+	MakeTestObject(TEST_SCENE_FIRST_ID, first);
+	MakeTestObject(TEST_SCENE_FIRST_ID + 1, second);
+
+	journal.BeginCommand();
+	journal.RecordRemoved(first);
+	journal.Record(TEST_SCENE_FIRST_ID + 5, 0, 1.0f, 2.0f);
+	journal.RecordRemoved(second);
+	journal.EndCommand();
+
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(deltas.size() == 3 && objects.size() == 2);
+	CHECK(deltas[0].field == EDIT_FIELD_OBJECT_REMOVED && deltas[0].ID == second.ID);
+	CHECK(deltas[2].field == EDIT_FIELD_OBJECT_REMOVED && deltas[2].ID == first.ID);
+	CHECK(SameObject(objects[0], second) && SameObject(objects[1], first));
+
+	CHECK(journal.Redo(deltas, objects));
+	CHECK(deltas[0].ID == first.ID && SameObject(objects[0], first) && SameObject(objects[1], second));
+
+	//a budget with room for one object row: the second command's row pushes out the first command
+	journal.SetBudget(sizeof(SceneObject) * EDIT_JOURNAL_OBJECT_SHARE);
+	journal.BeginCommand();
+	journal.RecordAdded(first);
+	journal.EndCommand();
+	journal.BeginCommand();
+	journal.RecordAdded(second);
+	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 1);
+	CHECK(journal.GetDroppedCount() == 1);
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(deltas.size() == 1 && deltas[0].field == EDIT_FIELD_OBJECT_ADDED && SameObject(objects[0], second));
+
+	//and one command with two rows cannot be kept at all
+	journal.Clear();
+	journal.BeginCommand();
+	journal.RecordAdded(first);
+	journal.RecordAdded(second);
+	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 0);
+	CHECK(journal.GetDroppedCount() == 1);
+}
+
+//edits against a grid of object fields, replayed from a seed
+struct JournalScene
+{
+	static const int objectCount = 1000;
+	std::vector<float>	values;
+	unsigned long long	hash;		//sum of a mix of every cell, kept up to date as cells change
+
+	JournalScene() : values(objectCount * SCENE_FIELD_COUNT, 0.0f), hash(0)
+	{
+		for (int cell = 0; cell < (int)values.size(); cell++)
+		{
+			hash += Mix(cell, values[cell]);
+		}
+	}
+
+	static unsigned long long Mix(int cell, float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		unsigned long long x = ((unsigned long long)cell << 32 | bits) + 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	float & Get(int ID, int field)	{ return values[ID * SCENE_FIELD_COUNT + field]; }
+
+	void Set(int ID, int field, float value)
+	{
+		const int cell = ID * SCENE_FIELD_COUNT + field;
+		hash -= Mix(cell, values[cell]);
+		values[cell] = value;
+		hash += Mix(cell, value);
+	}
+
+	void Apply(const std::vector<EditDelta> & deltas, bool undo)
+	{
+		for (size_t i = 0; i < deltas.size(); i++)
+		{
+			Set(deltas[i].ID, deltas[i].field, undo ? deltas[i].oldValue : deltas[i].newValue);
+		}
+	}
+};
+
+//a million edits in commands of one to four fields, a quarter of them drags that merge over several frames.
+//the budget drops most of them. Undoing everything left must land exactly where the oldest kept command began,
+//and redoing it all must come back to the end
+static void ReplayEdits(EditJournal & journal, JournalScene & scene, int editCount, std::vector<unsigned long long> & commandStartHashes)
+{
+	unsigned int random = 12345;
+	auto next = [&]() { random = random * 1664525u + 1013904223u; return random >> 8; };
+	unsigned int mergeKey = 0;
+	int edits = 0;
+	while (edits < editCount)
+	{
+		const bool drag = next() % 4 == 0;
+		const int frames = drag ? 2 + next() % 6 : 1;
+		const int ID = next() % JournalScene::objectCount;
+		mergeKey += drag;
+		for (int frame = 0; frame < frames && edits < editCount; frame++)
+		{
+			const int before = journal.GetUndoCount() + journal.GetDroppedCount();
+			const unsigned long long hash = scene.hash;
+			journal.BeginCommand(drag ? mergeKey : 0);
+			if (journal.GetUndoCount() + journal.GetDroppedCount() != before)
+			{
+				commandStartHashes.push_back(hash);
+			}
+			const int fieldCount = 1 + next() % 4;
+			for (int i = 0; i < fieldCount; i++)
+			{
+				const int field = drag ? i % 3 : next() % SCENE_FIELD_COUNT;
+				const float oldValue = scene.Get(ID, field);
+				const float newValue = oldValue + 1.0f + (float)(next() % 100);
+				journal.Record(ID, field, oldValue, newValue);
+				scene.Set(ID, field, newValue);
+				edits++;
+			}
+			journal.EndCommand();
+		}
+	}
+}
+
+TEST(JournalReplayMillionEdits)
+{
+	EditJournal journal;
+	JournalScene scene;
+	std::vector<unsigned long long> commandStartHashes;
+	ReplayEdits(journal, scene, 1000000, commandStartHashes);
+	CHECK(journal.GetDroppedCount() > 0);
+	CHECK(journal.GetUndoCount() + journal.GetDroppedCount() == (int)commandStartHashes.size());
+	const std::vector<float> end = scene.values;
+	const unsigned long long endHash = scene.hash;
+
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+	const int undoCount = journal.GetUndoCount();
+	int undone = 0;
+	while (journal.Undo(deltas, objects))
+	{
+		scene.Apply(deltas, true);
+		undone++;
+	}
+	CHECK(undone == undoCount);
+	CHECK(journal.GetRedoCount() == undoCount);
+	CHECK(scene.hash == commandStartHashes[journal.GetDroppedCount()]);
+
+	while (journal.Redo(deltas, objects))
+	{
+		scene.Apply(deltas, false);
+	}
+	CHECK(scene.hash == endHash);
+	CHECK(scene.values == end);
+}
+
+TEST(JournalMergeKeys)
+{
+	EditJournal journal;
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+
+	//three frames of one drag: one command, the repeated field keeping its first old value
+	journal.BeginCommand(7);	journal.Record(1, SCENE_FIELD_POSITION_X, 0.0f, 1.0f);	journal.EndCommand();
+	journal.BeginCommand(7);	journal.Record(1, SCENE_FIELD_POSITION_X, 1.0f, 2.0f);	journal.EndCommand();
+	journal.BeginCommand(7);	journal.Record(2, SCENE_FIELD_POSITION_X, 0.0f, 5.0f);	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 1);
+
+	//another key, or none, starts a new command
+	journal.BeginCommand(8);	journal.Record(1, SCENE_FIELD_POSITION_Y, 0.0f, 1.0f);	journal.EndCommand();
+	journal.BeginCommand();		journal.Record(1, SCENE_FIELD_POSITION_Z, 0.0f, 1.0f);	journal.EndCommand();
+	journal.BeginCommand();		journal.Record(1, SCENE_FIELD_POSITION_Z, 1.0f, 2.0f);	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 4);
+
+	//an edit that changes nothing is not a command
+	journal.BeginCommand();		journal.Record(1, SCENE_FIELD_SCALE_X, 1.0f, 1.0f);		journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 4);
+
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(deltas.size() == 2);
+	CHECK(deltas[0].ID == 2 && deltas[0].oldValue == 0.0f && deltas[0].newValue == 5.0f);
+	CHECK(deltas[1].ID == 1 && deltas[1].oldValue == 0.0f && deltas[1].newValue == 2.0f);
+
+	//once undone, the same key does not reopen the command. the redo history goes instead
+	CHECK(journal.Redo(deltas, objects));
+	journal.BeginCommand(7);	journal.Record(3, SCENE_FIELD_POSITION_X, 0.0f, 1.0f);	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 2);
+	CHECK(journal.GetRedoCount() == 0);
+}
+
+TEST(JournalDropOldestCommand)
+{
+	//a budget of a few kilobytes, filled far past what it holds
+	EditJournal journal;
+	journal.SetBudget(4096);
+	const int commandCount = 1000;
+	for (int i = 0; i < commandCount; i++)
+	{
+		journal.BeginCommand();
+		journal.Record(i, SCENE_FIELD_POSITION_X, 0.0f, 1.0f);
+		journal.EndCommand();
+	}
+	const int kept = journal.GetUndoCount();
+	CHECK(kept > 0 && kept < commandCount);
+	CHECK(kept + journal.GetDroppedCount() == commandCount);
+	CHECK(journal.GetBudget() <= 4096);
+
+	//the newest are the ones kept, newest first
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+	for (int i = 0; i < kept; i++)
+	{
+		CHECK(journal.Undo(deltas, objects));
+		CHECK(deltas.size() == 1 && deltas[0].ID == commandCount - 1 - i);
+	}
+	CHECK(!journal.Undo(deltas, objects));
+}
+
+TEST(JournalBudgetOverflow)
+{
+	EditJournal journal;
+	journal.SetBudget(4096);
+	journal.BeginCommand();
+	journal.Record(0, SCENE_FIELD_POSITION_X, 0.0f, 1.0f);
+	journal.EndCommand();
+
+	//one command bigger than the whole budget cannot be undone, and takes everything before it too
+	journal.BeginCommand();
+	for (int i = 0; i < 10000; i++)
+	{
+		journal.Record(i, SCENE_FIELD_POSITION_Y, 0.0f, 1.0f);
+	}
+	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 0);
+	CHECK(journal.GetDroppedCount() == 2);
+
+	//and the journal carries on afterwards
+	journal.BeginCommand();
+	journal.Record(5, SCENE_FIELD_POSITION_Z, 0.0f, 1.0f);
+	journal.EndCommand();
+	CHECK(journal.GetUndoCount() == 1);
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+	CHECK(journal.Undo(deltas, objects));
+	CHECK(deltas.size() == 1 && deltas[0].ID == 5);
+}
+
+//user-021: recording, undoing and redoing a million edits
+BENCHMARK(JournalThroughput)
+{
+	EditJournal journal;
+	JournalScene scene;
+	std::vector<unsigned long long> commandStartHashes;
+	TestTimer timer;
+	ReplayEdits(journal, scene, 1000000, commandStartHashes);
+	const double recordSeconds = timer.GetSeconds();
+
+	std::vector<EditDelta> deltas;
+	std::vector<SceneObject> objects;
+	int commands = 0;
+	size_t deltaCount = 0;
+	timer.Restart();
+	while (journal.Undo(deltas, objects))
+	{
+		scene.Apply(deltas, true);
+		commands++;
+		deltaCount += deltas.size();
+	}
+	while (journal.Redo(deltas, objects))
+	{
+		scene.Apply(deltas, false);
+	}
+	const double undoRedoSeconds = timer.GetSeconds();
+
+	printf("  recorded 1000000 edits in %.3f s (%.0f edits/s), %d commands kept of %zu in %zu bytes\n",
+		recordSeconds, 1000000 / recordSeconds, commands, commandStartHashes.size(), journal.GetBudget());
+	printf("  undid and redid %d commands, %zu deltas, in %.3f s\n", commands, deltaCount, undoRedoSeconds);
+}
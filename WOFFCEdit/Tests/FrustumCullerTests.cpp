@@ -0,0 +1,181 @@
+#include "Test.h"
+#include "FrustumCuller.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+//row major, for row vectors, as SimpleMath builds them: a right handed look at and a perspective with clip z from 0 to 1
+static void MakeViewProjection(const float eye[3], const float target[3], float viewProjection[16])
+{
+	float z[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+	float length = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	for (int i = 0; i < 3; i++)
+	{
+		z[i] /= length;
+	}
+	float x[3] = { z[2], 0.0f, -z[0] };		//up cross z, up being y
+	length = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+	x[0] /= length;
+	x[2] /= length;
+	const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+	const float view[16] = {
+		x[0], y[0], z[0], 0.0f,
+		x[1], y[1], z[1], 0.0f,
+		x[2], y[2], z[2], 0.0f,
+		-(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f };
+
+	//45 degrees high, 16:9, from 0.01 to 1000 metres
+	const float nearZ = 0.01f, farZ = 1000.0f;
+	const float yScale = 1.0f / std::tan(0.785398f / 2.0f);
+	const float xScale = yScale / (16.0f / 9.0f);
+	const float range = farZ / (nearZ - farZ);
+	const float projection[16] = {
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, -1.0f,
+		0.0f, 0.0f, range * nearZ, 0.0f };
+
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += view[row * 4 + k] * projection[k * 4 + column];
+			}
+			viewProjection[row * 4 + column] = sum;
+		}
+	}
+}
+
+static Frustum MakeFrustum(const float eye[3], const float target[3])
+{
+	float viewProjection[16];
+	MakeViewProjection(eye, target, viewProjection);
+	Frustum frustum;
+	frustum.ExtractFromMatrix(viewProjection);
+	return frustum;
+}
+
+//boxes scattered around the origin, the same every run
+static void FillBoxes(FrustumCuller & culler, int count, std::vector<float> & centers, std::vector<float> & extents)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-600.0f, 600.0f);
+	std::uniform_real_distribution<float> size(0.1f, 20.0f);
+	culler.Resize(count);
+	centers.resize((size_t)count * 3);
+	extents.resize((size_t)count * 3);
+	for (int i = 0; i < count; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			centers[(size_t)i * 3 + axis] = position(random);
+			extents[(size_t)i * 3 + axis] = size(random);
+		}
+		culler.SetBox(i, &centers[(size_t)i * 3], &extents[(size_t)i * 3]);
+	}
+}
+
+//a camera 10 metres up, looking down -z
+TEST(FrustumIntersectsBox)
+{
+	const float eye[3] = { 0.0f, 10.0f, 0.0f };
+	const float target[3] = { 0.0f, 10.0f, -1.0f };
+	const Frustum frustum = MakeFrustum(eye, target);
+	const float extents[3] = { 1.0f, 1.0f, 1.0f };
+	const float ahead[3] = { 0.0f, 10.0f, -50.0f };
+	const float behind[3] = { 0.0f, 10.0f, 50.0f };
+	const float beyondFar[3] = { 0.0f, 10.0f, -1500.0f };
+	const float offToTheSide[3] = { 200.0f, 10.0f, -50.0f };
+	const float aroundTheEye[3] = { 0.0f, 10.0f, 0.5f };
+	CHECK(frustum.IntersectsBox(ahead, extents));
+	CHECK(!frustum.IntersectsBox(behind, extents));
+	CHECK(!frustum.IntersectsBox(beyondFar, extents));
+	CHECK(!frustum.IntersectsBox(offToTheSide, extents));
+	CHECK(frustum.IntersectsBox(aroundTheEye, extents));
+
+	//a box far off to the side but big enough to reach back in
+	const float huge[3] = { 200.0f, 200.0f, 200.0f };
+	CHECK(frustum.IntersectsBox(offToTheSide, huge));
+}
+
+//the SSE blocks, on one thread or on the pool, agree box for box with IntersectsBox, over several frames and cameras
+TEST(FrustumCullerMatchesScalar)
+{
+	const int counts[] = { 7, 1000, FRUSTUM_CULL_PARALLEL_THRESHOLD - 1, FRUSTUM_CULL_PARALLEL_THRESHOLD, 100003 };
+	const float eyes[3][3] = { { 0.0f, 10.0f, 0.0f }, { 300.0f, 50.0f, 300.0f }, { -100.0f, 500.0f, 20.0f } };
+	const float targets[3][3] = { { 0.0f, 10.0f, -1.0f }, { 0.0f, 0.0f, 0.0f }, { -100.0f, 0.0f, 0.0f } };
+	FrustumCuller culler;
+	std::vector<float> centers, extents;
+	for (int count : counts)
+	{
+		FillBoxes(culler, count, centers, extents);
+		CHECK(culler.GetCount() == count);
+		for (int frame = 0; frame < 6; frame++)
+		{
+			const Frustum frustum = MakeFrustum(eyes[frame % 3], targets[frame % 3]);
+			culler.Cull(frustum);
+			int mismatches = 0;
+			int visible = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const bool expected = frustum.IntersectsBox(&centers[(size_t)i * 3], &extents[(size_t)i * 3]);
+				mismatches += expected != culler.IsVisible(i);
+				visible += expected;
+			}
+			CHECK(mismatches == 0);
+			CHECK(culler.GetVisibleCount() == visible);
+			CHECK(culler.GetVisibleCount() + culler.GetCulledCount() == count);
+			CHECK(count < 1000 || (visible > 0 && visible < count));		//the cameras see some boxes and not others
+		}
+	}
+
+	//back down to a count one thread culls, with the pool already started
+	FillBoxes(culler, 100, centers, extents);
+	const Frustum frustum = MakeFrustum(eyes[0], targets[0]);
+	culler.Cull(frustum);
+	for (int i = 0; i < 100; i++)
+	{
+		CHECK(culler.IsVisible(i) == frustum.IntersectsBox(&centers[(size_t)i * 3], &extents[(size_t)i * 3]));
+	}
+}
+
+//user-017: a cull of every box against IntersectsBox one at a time
+BENCHMARK(FrustumCullBenchmark)
+{
+	const int counts[] = { 10000, FRUSTUM_CULL_PARALLEL_THRESHOLD, 100000, 1000000 };
+	const float eye[3] = { 0.0f, 10.0f, 0.0f };
+	const float target[3] = { 0.0f, 10.0f, -1.0f };
+	const Frustum frustum = MakeFrustum(eye, target);
+	FrustumCuller culler;
+	std::vector<float> centers, extents;
+	for (int count : counts)
+	{
+		FillBoxes(culler, count, centers, extents);
+		const int passes = count >= 100000 ? 50 : 500;
+		culler.Cull(frustum);		//starts the pool
+		TestTimer timer;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			culler.Cull(frustum);
+		}
+		const double cullSeconds = timer.GetSeconds() / passes;
+
+		int visible = 0;
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			visible = 0;
+			for (int i = 0; i < count; i++)
+			{
+				visible += frustum.IntersectsBox(&centers[(size_t)i * 3], &extents[(size_t)i * 3]);
+			}
+		}
+		const double scalarSeconds = timer.GetSeconds() / passes;
+
+		CHECK(visible == culler.GetVisibleCount());
+		printf("  %7d boxes: Cull %8.1f us, IntersectsBox %8.1f us\n", count, cullSeconds * 1e6, scalarSeconds * 1e6);
+	}
+}
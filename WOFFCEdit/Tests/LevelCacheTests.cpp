@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "TestScene.h"
+#include "LevelCache.h"
+#include "SceneDatabase.h"
+#include <fstream>
+
+//a copy of test.db with count synthetic objects saved into it, and a level cache written from it
+static std::string MakeCachedDatabase(const char * name, int count, const std::string & cachePath)
+{
+	const std::string path = CopyTestDatabase(name);
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+	SceneStore saved;
+	FillTestScene(saved, count, true);
+	CHECK(database.SaveChanges(saved).rowsWritten == count);
+	CHECK(database.WriteLevelCache(cachePath.c_str()));
+	database.Close();
+	return path;
+}
+
+//the cache holds what the table does, is only opened with the hash the database has for it, and is disowned once the table changes
+TEST(LevelCacheRoundTrip)
+{
+	const std::string cachePath = "database/level_cache_test.cache";
+	const std::string path = MakeCachedDatabase("level_cache_test", 3000, cachePath);
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+	uint64_t hash = 0;
+	CHECK(database.GetLevelCacheHash(hash));
+
+	LevelCache cache;
+	CHECK(!cache.Open(cachePath, hash + 1));
+	CHECK(!cache.IsOpen());
+	CHECK(cache.Open(cachePath, hash));
+	CHECK(cache.CountObjects(TEST_SCENE_CHUNK) == 3000);
+	CHECK(cache.CountObjects(-12345) == 0);
+
+	SceneStore sceneGraph;
+	CHECK(cache.LoadObjects(TEST_SCENE_CHUNK, sceneGraph) == 3000);
+	CHECK(sceneGraph.GetCount() == 3000);
+	SceneObject expected, actual;
+	int mismatches = 0;
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		sceneGraph.Get(i, actual);
+		MakeTestObject(TEST_SCENE_FIRST_ID + i, expected);
+		mismatches += !SameObject(expected, actual);
+	}
+	CHECK(mismatches == 0);
+	cache.Close();
+
+	//the same chunk from SQL, as a chunk is loaded when there is no cache
+	SceneStore fromTable;
+	CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+	while (database.LoadObjectBatch(fromTable, 512) > 0)
+	{
+	}
+	database.EndLoadObjects();
+	CHECK(fromTable.GetCount() == sceneGraph.GetCount());
+
+	//one byte changed and the content hash no longer matches
+	{
+		std::fstream file(cachePath.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-1, std::ios::end);
+		file.put('\x5a');
+	}
+	CHECK(!cache.Open(cachePath, hash));
+
+	//a save changes Objects, and the database forgets the cache
+	sceneGraph.SetPosition(0, 1.0f, 2.0f, 3.0f);
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == 1);
+	CHECK(!database.GetLevelCacheHash(hash));
+
+	database.Close();
+	DeleteTestDatabase(path);
+	std::remove(cachePath.c_str());
+}
+
+//user-024: opening a level and loading a chunk of 100k or 1M objects, from SQL and from the level cache. Cold is a new
+//connection or mapping, checks and all, warm loads the chunk again through the one already open.
+//The files were just written, so the OS has them cached either way, and what differs is the work of reading them
+BENCHMARK(LevelCacheOpenBenchmark)
+{
+	const int counts[] = { 100000, 1000000 };
+	const std::string cachePath = "database/level_cache_benchmark.cache";
+	const int batchSize = 512;		//as ToolMain streams them, one batch a frame
+	for (int count : counts)
+	{
+		const std::string path = MakeCachedDatabase("level_cache_benchmark", count, cachePath);
+		SceneStore sceneGraph;
+
+		TestTimer timer;
+		SceneDatabase database;
+		CHECK(database.Open(path.c_str()));
+		sceneGraph.Reserve(database.CountObjects(TEST_SCENE_CHUNK));
+		CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+		while (database.LoadObjectBatch(sceneGraph, batchSize) > 0)
+		{
+		}
+		database.EndLoadObjects();
+		const double sqlColdSeconds = timer.GetSeconds();
+		CHECK(sceneGraph.GetCount() == count);
+
+		sceneGraph.Clear();
+		timer.Restart();
+		sceneGraph.Reserve(database.CountObjects(TEST_SCENE_CHUNK));
+		CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+		while (database.LoadObjectBatch(sceneGraph, batchSize) > 0)
+		{
+		}
+		database.EndLoadObjects();
+		const double sqlWarmSeconds = timer.GetSeconds();
+		database.Close();
+
+		sceneGraph.Clear();
+		timer.Restart();
+		CHECK(database.Open(path.c_str()));
+		uint64_t hash = 0;
+		CHECK(database.GetLevelCacheHash(hash));
+		LevelCache cache;
+		CHECK(cache.Open(cachePath, hash));
+		sceneGraph.Reserve(cache.CountObjects(TEST_SCENE_CHUNK));
+		cache.LoadObjects(TEST_SCENE_CHUNK, sceneGraph);
+		const double cacheColdSeconds = timer.GetSeconds();
+		CHECK(sceneGraph.GetCount() == count);
+
+		sceneGraph.Clear();
+		timer.Restart();
+		sceneGraph.Reserve(cache.CountObjects(TEST_SCENE_CHUNK));
+		cache.LoadObjects(TEST_SCENE_CHUNK, sceneGraph);
+		const double cacheWarmSeconds = timer.GetSeconds();
+		CHECK(sceneGraph.GetCount() == count);
+
+		printf("  %7d objects: SQL cold %8.3f s, warm %8.3f s; level cache cold %8.3f s, warm %8.3f s\n",
+			count, sqlColdSeconds, sqlWarmSeconds, cacheColdSeconds, cacheWarmSeconds);
+
+		cache.Close();
+		database.Close();
+		DeleteTestDatabase(path);
+		std::remove(cachePath.c_str());
+	}
+}
@@ -0,0 +1,186 @@
+#include "Test.h"
+#include "ObjectBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+//a ray from high above the level, angled down into it
+struct TestRay
+{
+	float	origin[3];
+	float	direction[3];		//normalised
+};
+
+//objects scattered over a 1 km square, a little up and down, a few metres across
+static void MakeTestBounds(int count, std::vector<BoundingBox> & bounds)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+	bounds.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		bounds[i].Center = XMFLOAT3(position(random), position(random) * 0.1f, position(random));
+		bounds[i].Extents = XMFLOAT3(size(random), size(random), size(random));
+	}
+}
+
+static void MakeTestRays(int count, std::vector<TestRay> & rays)
+{
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	rays.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		TestRay & ray = rays[i];
+		ray.origin[0] = position(random);
+		ray.origin[1] = 50.0f;
+		ray.origin[2] = position(random);
+		ray.direction[0] = position(random);
+		ray.direction[1] = -100.0f;
+		ray.direction[2] = position(random);
+		const float length = std::sqrt(ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1] + ray.direction[2] * ray.direction[2]);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			ray.direction[axis] /= length;
+		}
+	}
+}
+
+//the exact test Game gives the BVH is against the mesh, here the box itself stands in for it
+static bool RayHitsBox(const BoundingBox & box, const TestRay & ray, float & distance)
+{
+	const float center[3] = { box.Center.x, box.Center.y, box.Center.z };
+	const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+	float entry = 0.0f;
+	float exit = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float inverse = std::fabs(ray.direction[axis]) > 1e-12f ? 1.0f / ray.direction[axis] : 1e30f;
+		float slabEntry = (center[axis] - extents[axis] - ray.origin[axis]) * inverse;
+		float slabExit = (center[axis] + extents[axis] - ray.origin[axis]) * inverse;
+		if (slabEntry > slabExit)
+		{
+			std::swap(slabEntry, slabExit);
+		}
+		entry = std::max(entry, slabEntry);
+		exit = std::min(exit, slabExit);
+		if (entry > exit)
+		{
+			return false;
+		}
+	}
+	distance = entry;
+	return true;
+}
+
+//what picking did before the BVH: every object, keeping the nearest
+static int PickLinear(const std::vector<BoundingBox> & bounds, const TestRay & ray, float & distance)
+{
+	int nearest = -1;
+	distance = FLT_MAX;
+	for (int i = 0; i < (int)bounds.size(); i++)
+	{
+		float hit;
+		if (RayHitsBox(bounds[i], ray, hit) && hit < distance)
+		{
+			distance = hit;
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+static int PickBVH(const ObjectBVH & bvh, const std::vector<BoundingBox> & bounds, const TestRay & ray, float & distance)
+{
+	return bvh.IntersectRay(XMVectorSet(ray.origin[0], ray.origin[1], ray.origin[2], 1.0f), XMVectorSet(ray.direction[0], ray.direction[1], ray.direction[2], 0.0f),
+		[&](int objectIndex, float & hit) { return RayHitsBox(bounds[objectIndex], ray, hit); }, distance);
+}
+
+//the BVH finds the same nearest hit as testing every object, after a build and after a refit
+TEST(BVHNearestHit)
+{
+	const int counts[] = { 1, 3, 7, 1000, 20000 };
+	std::vector<BoundingBox> bounds;
+	std::vector<TestRay> rays;
+	MakeTestRays(500, rays);
+	for (int count : counts)
+	{
+		MakeTestBounds(count, bounds);
+		ObjectBVH bvh;
+		bvh.Build(bounds);
+		CHECK(bvh.GetObjectCount() == count);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			int hits = 0;
+			for (size_t i = 0; i < rays.size(); i++)
+			{
+				float expectedDistance, distance;
+				const int expected = PickLinear(bounds, rays[i], expectedDistance);
+				const int picked = PickBVH(bvh, bounds, rays[i], distance);
+				CHECK(picked == expected || (picked >= 0 && expected >= 0 && std::fabs(distance - expectedDistance) < 1e-4f));
+				hits += picked >= 0;
+			}
+			CHECK(count < 1000 || hits > 0);
+
+			//everything moves, and the tree keeps its shape
+			for (int i = 0; i < count; i++)
+			{
+				bounds[i].Center.x += (i % 5) * 3.0f;
+				bounds[i].Center.y -= (i % 3) * 2.0f;
+			}
+			bvh.Refit(bounds);
+		}
+	}
+
+	ObjectBVH empty;
+	float distance;
+	CHECK(PickBVH(empty, bounds, rays[0], distance) == -1);
+}
+
+//user-005: picks per second at 1k, 100k and 1M objects, against the linear scan the BVH replaced
+BENCHMARK(BVHPickBenchmark)
+{
+	const int counts[] = { 1000, 100000, 1000000 };
+	std::vector<BoundingBox> bounds;
+	std::vector<TestRay> rays;
+	MakeTestRays(1000, rays);
+	for (int count : counts)
+	{
+		MakeTestBounds(count, bounds);
+		ObjectBVH bvh;
+		TestTimer timer;
+		bvh.Build(bounds);
+		const double buildSeconds = timer.GetSeconds();
+		timer.Restart();
+		bvh.Refit(bounds);
+		const double refitSeconds = timer.GetSeconds();
+
+		int bvhHits = 0;
+		timer.Restart();
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			float distance;
+			bvhHits += PickBVH(bvh, bounds, rays[i], distance) >= 0;
+		}
+		const double bvhSeconds = timer.GetSeconds();
+
+		//the scan is slow enough at 1M to take a tenth of the rays
+		const size_t linearRays = count >= 1000000 ? rays.size() / 10 : rays.size();
+		int linearHits = 0;
+		timer.Restart();
+		for (size_t i = 0; i < linearRays; i++)
+		{
+			float distance;
+			linearHits += PickLinear(bounds, rays[i], distance) >= 0;
+		}
+		const double linearSeconds = timer.GetSeconds();
+
+		printf("  %7d objects: BVH %10.0f picks/s (build %.3f s, refit %.3f s), linear %8.0f picks/s, %d / %d hits\n",
+			count, rays.size() / bvhSeconds, buildSeconds, refitSeconds, linearRays / linearSeconds, bvhHits, linearHits);
+	}
+}
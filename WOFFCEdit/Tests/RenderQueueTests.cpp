@@ -0,0 +1,108 @@
+#include "Test.h"
+#include "RenderQueue.h"
+#include <algorithm>
+
+//the instance buffer size Game draws big batches in runs of
+#define TEST_RUN_SIZE 4096
+
+//what Game::Render counts for a frame of the queue, each model standing in for one with these mesh parts
+struct TestModel
+{
+	int		parts;
+	int		instancedParts;
+};
+
+static RenderStatistics CountFrame(const RenderQueue & queue)
+{
+	RenderStatistics statistics;
+	const std::vector<RenderQueue::Batch> & batches = queue.GetBatches();
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		const TestModel & model = *(const TestModel *)batches[i].key;
+		for (int first = 0; first < batches[i].count; first += TEST_RUN_SIZE)
+		{
+			statistics.AddRun(std::min(batches[i].count - first, TEST_RUN_SIZE), model.parts, model.instancedParts);
+		}
+		statistics.AddBatch(batches[i].count);
+	}
+	return statistics;
+}
+
+//every object lands in its model's batch once, in display list order, however the models were interleaved
+TEST(RenderQueueGrouping)
+{
+	TestModel models[3] = { { 1, 1 }, { 1, 1 }, { 1, 1 } };
+	RenderQueue queue;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		//refilled as every frame does, with the same queue
+		queue.Clear();
+		const int count = 100 + pass * 50;
+		for (int i = 0; i < count; i++)
+		{
+			queue.Add(&models[(i * 7) % 3], i);
+		}
+		queue.Sort();
+
+		const std::vector<RenderQueue::Batch> & batches = queue.GetBatches();
+		const std::vector<int> & instances = queue.GetInstances();
+		CHECK(batches.size() == 3);
+		CHECK((int)instances.size() == count);
+		std::vector<bool> seen(count, false);
+		int next = 0;
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			CHECK(batches[i].first == next);
+			next += batches[i].count;
+			for (size_t j = 0; j < i; j++)
+			{
+				CHECK(batches[j].key != batches[i].key);
+			}
+			for (int k = 0; k < batches[i].count; k++)
+			{
+				const int object = instances[batches[i].first + k];
+				CHECK(&models[(object * 7) % 3] == batches[i].key);
+				CHECK(!seen[object]);
+				seen[object] = true;
+				if (k > 0)
+				{
+					CHECK(object > instances[batches[i].first + k - 1]);
+				}
+			}
+		}
+		CHECK(next == count);
+	}
+
+	queue.Clear();
+	queue.Sort();
+	CHECK(queue.GetBatches().empty());
+	CHECK(queue.GetInstances().empty());
+}
+
+//instanced parts are a draw per run, the rest a draw per object, and every part is set up once per run
+TEST(RenderQueueCounters)
+{
+	TestModel instanced = { 2, 2 };
+	TestModel mixed = { 3, 1 };
+	TestModel single = { 1, 0 };
+	RenderQueue queue;
+	for (int i = 0; i < 10000; i++)
+	{
+		queue.Add(&instanced, i);
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		queue.Add(&mixed, 10000 + i);
+	}
+	for (int i = 0; i < 7; i++)
+	{
+		queue.Add(&single, 10005 + i);
+	}
+	queue.Sort();
+
+	const RenderStatistics statistics = CountFrame(queue);
+	CHECK(statistics.batches == 3);
+	CHECK(statistics.instances == 10012);
+	CHECK(statistics.stateChanges == 3 * 2 + 3 + 1);		//10000 objects are three runs
+	CHECK(statistics.drawCalls == 3 * 2 + (1 + 2 * 5) + 7);
+}
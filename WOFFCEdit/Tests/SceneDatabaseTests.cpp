@@ -0,0 +1,242 @@
+#include "Test.h"
+#include "TestScene.h"
+#include "SceneDatabase.h"
+
+//saves what it was given and loads it back exactly, floats included
+TEST(SaveRoundTrip)
+{
+	const std::string path = CopyTestDatabase("save_round_trip");
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+
+	SceneStore saved;
+	FillTestScene(saved, 1000, true);
+	const SaveStatistics statistics = database.SaveChanges(saved);
+	CHECK(statistics.succeeded);
+	CHECK(statistics.rowsWritten == 1000);
+	CHECK(database.CountObjects(TEST_SCENE_CHUNK) == 1000);
+	CHECK(database.GetMaxObjectID() == TEST_SCENE_FIRST_ID + 999);
+
+	SceneStore loaded;
+	CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+	while (database.LoadObjectBatch(loaded, 256) > 0)
+	{
+	}
+	database.EndLoadObjects();
+	CHECK(loaded.GetCount() == 1000);
+
+	SceneObject expected, actual;
+	for (int i = 0; i < loaded.GetCount(); i++)
+	{
+		loaded.Get(i, actual);
+		const int index = saved.FindIndex(actual.ID);
+		CHECK(index >= 0);
+		saved.Get(index, expected);
+		CHECK(SameObject(expected, actual));
+	}
+
+	database.Close();
+	DeleteTestDatabase(path);
+}
+
+//a second save of the same objects has nothing to write
+TEST(SaveClearsFlags)
+{
+	const std::string path = CopyTestDatabase("save_clears_flags");
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, 100, true);
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == 100);
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == 0);
+	CHECK(database.CountObjects(TEST_SCENE_CHUNK) == 100);
+
+	database.Close();
+	DeleteTestDatabase(path);
+}
+
+//user-001: one transaction with a reused, bound INSERT, at 10k, 100k and 1M new objects
+BENCHMARK(SaveBenchmark)
+{
+	const int counts[] = { 10000, 100000, 1000000 };
+	for (int count : counts)
+	{
+		const std::string path = CopyTestDatabase("save_benchmark");
+		SceneDatabase database;
+		CHECK(database.Open(path.c_str()));
+
+		SceneStore sceneGraph;
+		FillTestScene(sceneGraph, count, true);
+		const SaveStatistics statistics = database.SaveChanges(sceneGraph);
+		CHECK(statistics.succeeded);
+		CHECK(statistics.rowsWritten == count);
+		printf("  %7d objects: %8.3f s, %10.0f rows/s\n", count, statistics.seconds, statistics.rowsPerSecond);
+
+		database.Close();
+		DeleteTestDatabase(path);
+	}
+}
+
+//the WAL hook is told how many pages the log holds after each commit
+static int CountLogPages(void * pages, sqlite3 *, const char *, int count)
+{
+	*(int *)pages = count;
+	return SQLITE_OK;
+}
+
+//bytes a save writes to the log. A checkpoint first empties it, so the log then holds only that save's pages
+template <typename Save>
+static long long MeasureBytesWritten(SceneDatabase & database, Save save)
+{
+	sqlite3 * connection = database.GetConnection();
+	sqlite3_wal_checkpoint(connection, NULL);
+	int pages = 0;
+	sqlite3_wal_hook(connection, CountLogPages, &pages);
+	save();
+	sqlite3_wal_hook(connection, NULL, NULL);
+
+	int pageSize = 0;
+	sqlite3_stmt * statement = NULL;
+	if (sqlite3_prepare_v2(connection, "PRAGMA page_size", -1, &statement, NULL) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW)
+	{
+		pageSize = sqlite3_column_int(statement, 0);
+	}
+	sqlite3_finalize(statement);
+	return (long long)pages * pageSize;
+}
+
+//deletes, re-adds and edits reach the table, and a deleted row that is restored before the save is kept
+TEST(SaveDeletesAndRestores)
+{
+	const std::string path = CopyTestDatabase("save_deletes");
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, 10, true);
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == 10);
+
+	//a saved object deleted, another deleted then restored, and a new one deleted before it was ever saved
+	SceneObject restored, unsaved;
+	sceneGraph.Get(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 1), restored);
+	MakeTestObject(TEST_SCENE_FIRST_ID + 20, unsaved);
+	unsaved.inserted = true;
+	sceneGraph.Add(unsaved);
+	std::vector<int> indices = { sceneGraph.FindIndex(TEST_SCENE_FIRST_ID), sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 1), sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 20) };
+	CHECK(sceneGraph.DeleteObjects(indices) == 3);
+	CHECK(sceneGraph.GetDeletedIDs().size() == 2);
+	const int index = sceneGraph.RestoreObject(restored);
+	CHECK(sceneGraph.GetDeletedIDs().size() == 1);
+	CHECK(sceneGraph.HasFlag(index, SCENE_OBJECT_DIRTY));
+	CHECK(!sceneGraph.HasFlag(index, SCENE_OBJECT_INSERTED));
+	sceneGraph.SetPosition(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 2), 1.0f, 2.0f, 3.0f);
+
+	const SaveStatistics statistics = database.SaveChanges(sceneGraph);
+	CHECK(statistics.succeeded);
+	CHECK(statistics.rowsDeleted == 1);
+	CHECK(statistics.rowsWritten == 2);
+	CHECK(sceneGraph.GetDeletedIDs().empty());
+	CHECK(database.CountObjects(TEST_SCENE_CHUNK) == 9);
+
+	//restoring after the save has deleted the row puts it back in as new
+	indices = { sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 1) };
+	sceneGraph.DeleteObjects(indices);
+	CHECK(database.SaveChanges(sceneGraph).rowsDeleted == 1);
+	CHECK(sceneGraph.HasFlag(sceneGraph.RestoreObject(restored), SCENE_OBJECT_INSERTED));
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == 1);
+	CHECK(database.CountObjects(TEST_SCENE_CHUNK) == 9);
+
+	SceneStore loaded;
+	CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+	while (database.LoadObjectBatch(loaded, 256) > 0)
+	{
+	}
+	database.EndLoadObjects();
+	SceneObject object;
+	loaded.Get(loaded.FindIndex(TEST_SCENE_FIRST_ID + 2), object);
+	CHECK(object.posX == 1.0f && object.posY == 2.0f && object.posZ == 3.0f);
+	CHECK(loaded.FindIndex(TEST_SCENE_FIRST_ID) == -1);
+	CHECK(loaded.FindIndex(TEST_SCENE_FIRST_ID + 1) != -1);
+	CHECK(loaded.FindIndex(TEST_SCENE_FIRST_ID + 20) == -1);
+
+	database.Close();
+	DeleteTestDatabase(path);
+}
+
+//user-002: a save of 1% of 100k objects moved, against the full save it replaced, which deleted and reinserted every row
+BENCHMARK(IncrementalSaveBenchmark)
+{
+	const int count = 100000;
+	const std::string path = CopyTestDatabase("incremental_save_benchmark");
+	SceneDatabase database;
+	CHECK(database.Open(path.c_str()));
+
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, count, true);
+	CHECK(database.SaveChanges(sceneGraph).rowsWritten == count);
+
+	for (int i = 0; i < count; i += 100)
+	{
+		sceneGraph.SetPosition(i, 0.0f, (float)i, 0.0f);
+	}
+	SaveStatistics incremental;
+	const long long incrementalBytes = MeasureBytesWritten(database, [&]() { incremental = database.SaveChanges(sceneGraph); });
+	CHECK(incremental.rowsWritten == count / 100);
+
+	for (int i = 0; i < count; i++)
+	{
+		sceneGraph.SetFlag(i, SCENE_OBJECT_INSERTED, true);
+	}
+	SaveStatistics full;
+	const long long fullBytes = MeasureBytesWritten(database, [&]()
+	{
+		TestTimer timer;
+		CHECK(sqlite3_exec(database.GetConnection(), "DELETE FROM Objects", NULL, NULL, NULL) == SQLITE_OK);
+		full = database.SaveChanges(sceneGraph);
+		full.seconds = timer.GetSeconds();
+	});
+	CHECK(full.rowsWritten == count);
+
+	printf("  incremental: %6d rows, %8.3f s, %10lld bytes\n", incremental.rowsWritten, incremental.seconds, incrementalBytes);
+	printf("  full:        %6d rows, %8.3f s, %10lld bytes\n", full.rowsWritten, full.seconds, fullBytes);
+
+	database.Close();
+	DeleteTestDatabase(path);
+}
+
+//user-003: streaming one chunk's objects into a presized scenegraph, from databases of 10k, 100k and 1M objects
+BENCHMARK(LoadBenchmark)
+{
+	const int counts[] = { 10000, 100000, 1000000 };
+	const int batchSize = 512;		//as ToolMain streams them, one batch a frame
+	for (int count : counts)
+	{
+		const std::string path = CopyTestDatabase("load_benchmark");
+		SceneDatabase database;
+		CHECK(database.Open(path.c_str()));
+		{
+			SceneStore saved;
+			FillTestScene(saved, count, true);
+			CHECK(database.SaveChanges(saved).rowsWritten == count);
+		}
+
+		SceneStore sceneGraph;
+		TestTimer timer;
+		sceneGraph.Reserve(database.CountObjects(TEST_SCENE_CHUNK));
+		CHECK(database.BeginLoadObjects(TEST_SCENE_CHUNK));
+		database.LoadObjectBatch(sceneGraph, batchSize);
+		const double firstBatchSeconds = timer.GetSeconds();
+		while (database.LoadObjectBatch(sceneGraph, batchSize) > 0)
+		{
+		}
+		database.EndLoadObjects();
+		const double seconds = timer.GetSeconds();
+
+		CHECK(sceneGraph.GetCount() == count);
+		printf("  %7d objects: first batch %7.3f ms, all %8.3f s, %10.0f rows/s\n", count, firstBatchSeconds * 1000.0, seconds, count / seconds);
+
+		database.Close();
+		DeleteTestDatabase(path);
+	}
+}
@@ -0,0 +1,188 @@
+#include "Test.h"
+#include "TestScene.h"
+#include "SceneStore.h"
+#include <vector>
+
+//every ID still finds its own index
+static bool IndexMatches(const SceneStore & sceneGraph)
+{
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		if (sceneGraph.FindIndex(sceneGraph.GetIDs()[i]) != i)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(StoreRoundTrip)
+{
+	SceneStore sceneGraph;
+	SceneObject expected, actual;
+	MakeTestObject(TEST_SCENE_FIRST_ID, expected);
+	const int index = sceneGraph.Add(expected);
+	sceneGraph.Get(index, actual);
+	CHECK(SameObject(expected, actual));
+	CHECK(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID) == index);
+	CHECK(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 1) == -1);
+}
+
+TEST(StoreRemoveBatch)
+{
+	SceneStore sceneGraph;
+	FillTestScene(sceneGraph, 100, false);
+
+	//unsorted and with a repeat, as a selection can be
+	std::vector<int> indices = { 50, 0, 99, 7, 50, 8 };
+	CHECK(sceneGraph.Remove(indices) == 5);
+	CHECK(sceneGraph.GetCount() == 95);
+	CHECK(IndexMatches(sceneGraph));
+	CHECK(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID) == -1);
+	CHECK(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 50) == -1);
+	CHECK(sceneGraph.FindIndex(TEST_SCENE_FIRST_ID + 99) == -1);
+
+	//the rest keep their order and their fields
+	SceneObject expected, actual;
+	int previousID = 0;
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		sceneGraph.Get(i, actual);
+		MakeTestObject(actual.ID, expected);
+		CHECK(SameObject(expected, actual));
+		CHECK(actual.ID > previousID);
+		previousID = actual.ID;
+	}
+
+	std::vector<int> none;
+	CHECK(sceneGraph.Remove(none) == 0);
+	CHECK(sceneGraph.GetCount() == 95);
+}
+
+TEST(StoreRemoveChunk)
+{
+	SceneStore sceneGraph;
+	SceneObject object;
+	for (int i = 0; i < 30; i++)
+	{
+		MakeTestObject(TEST_SCENE_FIRST_ID + i, object);
+		object.chunk_ID = i % 3;
+		sceneGraph.Add(object);
+	}
+	CHECK(sceneGraph.RemoveChunk(1) == 10);
+	CHECK(sceneGraph.RemoveChunk(1) == 0);
+	CHECK(sceneGraph.GetCount() == 20);
+	CHECK(IndexMatches(sceneGraph));
+	for (int i = 0; i < sceneGraph.GetCount(); i++)
+	{
+		CHECK(sceneGraph.GetChunkIDs()[i] != 1);
+	}
+}
+
+//user-019: walking every transform, from SceneStore's arrays and from the old vector<SceneObject>
+BENCHMARK(StoreTransformIteration)
+{
+	const int counts[] = { 100000, 1000000 };
+	for (int count : counts)
+	{
+		SceneStore sceneGraph;
+		FillTestScene(sceneGraph, count, false);
+		std::vector<SceneObject> objects(count);
+		for (int i = 0; i < count; i++)
+		{
+			sceneGraph.Get(i, objects[i]);
+		}
+
+		const int passes = 20;
+		float storeSum = 0.0f;
+		TestTimer timer;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			const float * posX = sceneGraph.GetPositionX();		const float * posY = sceneGraph.GetPositionY();		const float * posZ = sceneGraph.GetPositionZ();
+			const float * rotX = sceneGraph.GetRotationX();		const float * rotY = sceneGraph.GetRotationY();		const float * rotZ = sceneGraph.GetRotationZ();
+			const float * scaX = sceneGraph.GetScaleX();		const float * scaY = sceneGraph.GetScaleY();		const float * scaZ = sceneGraph.GetScaleZ();
+			for (int i = 0; i < count; i++)
+			{
+				storeSum += posX[i] + posY[i] + posZ[i] + rotX[i] + rotY[i] + rotZ[i] + scaX[i] + scaY[i] + scaZ[i];
+			}
+		}
+		const double storeSeconds = timer.GetSeconds() / passes;
+
+		float objectSum = 0.0f;
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				const SceneObject & object = objects[i];
+				objectSum += object.posX + object.posY + object.posZ + object.rotX + object.rotY + object.rotZ + object.scaX + object.scaY + object.scaZ;
+			}
+		}
+		const double objectSeconds = timer.GetSeconds() / passes;
+
+		CHECK(storeSum == objectSum);
+		printf("  %7d objects: SceneStore %7.3f ms, vector<SceneObject> %7.3f ms (%zu bytes each)\n",
+			count, storeSeconds * 1000.0, objectSeconds * 1000.0, sizeof(SceneObject));
+	}
+}
+
+//user-019: deleting a large selection, one Remove per object against one batched Remove
+BENCHMARK(StoreRemoveSelection)
+{
+	const int count = 100000;
+	std::vector<int> selection;
+	for (int i = 0; i < count; i += 10)
+	{
+		selection.push_back(i);
+	}
+
+	SceneStore single;
+	FillTestScene(single, count, false);
+	TestTimer timer;
+	for (int i = (int)selection.size() - 1; i >= 0; i--)
+	{
+		single.Remove(selection[i]);
+	}
+	const double singleSeconds = timer.GetSeconds();
+
+	SceneStore batched;
+	FillTestScene(batched, count, false);
+	timer.Restart();
+	batched.Remove(selection);
+	const double batchedSeconds = timer.GetSeconds();
+
+	CHECK(single.GetCount() == batched.GetCount());
+	printf("  %zu of %d objects: one at a time %.3f s, batched %.3f s\n", selection.size(), count, singleSeconds, batchedSeconds);
+}
+
+//a chunk holds on to its deletes until they are saved or undone, so it is not unloaded and reloaded with them
+TEST(StoreDeletedChunks)
+{
+	SceneStore sceneGraph;
+	SceneObject object;
+	for (int i = 0; i < 4; i++)
+	{
+		MakeTestObject(TEST_SCENE_FIRST_ID + i, object);
+		object.chunk_ID = i;
+		sceneGraph.Add(object);
+	}
+	MakeTestObject(TEST_SCENE_FIRST_ID + 10, object);
+	object.chunk_ID = 3;
+	object.inserted = true;
+	sceneGraph.Add(object);
+
+	SceneObject deleted;
+	sceneGraph.Get(1, deleted);
+	std::vector<int> indices = { 1, 2, 4 };
+	sceneGraph.DeleteObjects(indices);
+	CHECK(!sceneGraph.HasDeletedObjects(0));
+	CHECK(sceneGraph.HasDeletedObjects(1));
+	CHECK(sceneGraph.HasDeletedObjects(2));
+	CHECK(!sceneGraph.HasDeletedObjects(3));		//never saved, so there is no row to bring it back
+
+	sceneGraph.RestoreObject(deleted);
+	CHECK(!sceneGraph.HasDeletedObjects(1));
+	CHECK(sceneGraph.HasDeletedObjects(2));
+	sceneGraph.ClearDeletedIDs();
+	CHECK(!sceneGraph.HasDeletedObjects(2));
+}
@@ -0,0 +1,276 @@
+#include "Test.h"
+#include "TerrainBrush.h"
+#include <cmath>
+#include <vector>
+
+//a small heightfield, 1 metre between vertices
+#define TEST_BRUSH_RESOLUTION 65
+
+static TerrainBrush MakeTestBrush(TerrainBrushType type)
+{
+	TerrainBrush brush;
+	brush.type = type;
+	brush.radius = 8.0f;
+	brush.strength = 4.0f;
+	brush.flattenHeight = 2.0f;
+	brush.minHeight = 0.0f;
+	brush.maxHeight = 64.0f;
+	brush.seed = 7;
+	return brush;
+}
+
+static float & HeightAt(std::vector<float> & heights, int column, int row)
+{
+	return heights[(size_t)row * TEST_BRUSH_RESOLUTION + column];
+}
+
+//nothing outside the dirty rectangle was touched
+static bool OnlyInside(const std::vector<float> & before, const std::vector<float> & after, const TerrainRect & dirty)
+{
+	for (int row = 0; row < TEST_BRUSH_RESOLUTION; row++)
+	{
+		for (int column = 0; column < TEST_BRUSH_RESOLUTION; column++)
+		{
+			const bool inside = row >= dirty.firstRow && row <= dirty.lastRow && column >= dirty.firstColumn && column <= dirty.lastColumn;
+			const size_t i = (size_t)row * TEST_BRUSH_RESOLUTION + column;
+			if (!inside && before[i] != after[i])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//each brush on flat ground at 10 metres, half a second at 4 per second, centred on a vertex so the centre weight is 1
+TEST(TerrainBrushTypes)
+{
+	const int centre = TEST_BRUSH_RESOLUTION / 2;
+	const std::vector<float> flat((size_t)TEST_BRUSH_RESOLUTION * TEST_BRUSH_RESOLUTION, 10.0f);
+	TerrainRect dirty;
+
+	std::vector<float> heights = flat;
+	CHECK(ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_RAISE), 0.5f, dirty));
+	CHECK_CLOSE(HeightAt(heights, centre, centre), 12.0f, 1e-5f);
+	CHECK(HeightAt(heights, centre + 4, centre) > 10.0f && HeightAt(heights, centre + 4, centre) < HeightAt(heights, centre + 2, centre));
+	CHECK(HeightAt(heights, centre + 8, centre) == 10.0f);		//on the edge of the circle, no weight left
+	CHECK(HeightAt(heights, centre + 6, centre + 6) == 10.0f);	//in the square, outside the circle
+	CHECK(dirty.firstColumn == centre - 8 && dirty.lastColumn == centre + 8 && dirty.firstRow == centre - 8 && dirty.lastRow == centre + 8);
+	CHECK(OnlyInside(flat, heights, dirty));
+
+	heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_LOWER), 0.5f, dirty);
+	CHECK_CLOSE(HeightAt(heights, centre, centre), 8.0f, 1e-5f);
+	CHECK(HeightAt(heights, centre, centre + 4) < 10.0f && HeightAt(heights, centre, centre + 4) > 8.0f);
+
+	//blend is strength * deltaTime, capped at 1, so the centre lands on the flatten height and the rest part of the way
+	heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_FLATTEN), 0.5f, dirty);
+	CHECK_CLOSE(HeightAt(heights, centre, centre), 2.0f, 1e-5f);
+	CHECK(HeightAt(heights, centre - 4, centre) > 2.0f && HeightAt(heights, centre - 4, centre) < 10.0f);
+
+	//the same pattern every dab, so two dabs move each vertex twice as far as one
+	heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_NOISE), 0.5f, dirty);
+	std::vector<float> twice = heights;
+	ApplyTerrainBrush(twice.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_NOISE), 0.5f, dirty);
+	int raised = 0, lowered = 0;
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		CHECK_CLOSE(twice[i] - 10.0f, 2.0f * (heights[i] - 10.0f), 1e-4f);
+		CHECK(std::fabs(heights[i] - 10.0f) <= 2.0f);
+		raised += heights[i] > 10.0f;
+		lowered += heights[i] < 10.0f;
+	}
+	CHECK(raised > 0 && lowered > 0);
+	TerrainBrush reseeded = MakeTestBrush(TERRAIN_BRUSH_NOISE);
+	reseeded.seed++;
+	std::vector<float> other = flat;
+	ApplyTerrainBrush(other.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, reseeded, 0.5f, dirty);
+	CHECK(other != heights);
+
+	//a spike is pulled down to the average of its 3 x 3 neighbourhood, and lifts its neighbours a little
+	heights = flat;
+	HeightAt(heights, centre, centre) = 28.0f;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_SMOOTH), 0.5f, dirty);
+	CHECK_CLOSE(HeightAt(heights, centre, centre), 12.0f, 1e-5f);
+	CHECK(HeightAt(heights, centre + 1, centre) > 10.0f);
+	CHECK(HeightAt(heights, centre + 2, centre) == 10.0f);
+
+	//no time, no change
+	heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, MakeTestBrush(TERRAIN_BRUSH_RAISE), 0.0f, dirty);
+	CHECK(heights == flat);
+}
+
+//every brush keeps the heights within what the heightmap format holds
+TEST(TerrainBrushClamp)
+{
+	const int centre = TEST_BRUSH_RESOLUTION / 2;
+	const std::vector<float> flat((size_t)TEST_BRUSH_RESOLUTION * TEST_BRUSH_RESOLUTION, 10.0f);
+	TerrainRect dirty;
+	for (int type = 0; type < TERRAIN_BRUSH_COUNT; type++)
+	{
+		TerrainBrush brush = MakeTestBrush((TerrainBrushType)type);
+		brush.strength = 1000.0f;
+		brush.minHeight = 5.0f;
+		brush.maxHeight = 20.0f;
+		brush.flattenHeight = type == TERRAIN_BRUSH_FLATTEN ? 100.0f : 2.0f;
+		std::vector<float> heights = flat;
+		HeightAt(heights, centre, centre) = 500.0f;		//already out of range, smoothing pulls from it
+		for (int dab = 0; dab < 3; dab++)
+		{
+			ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, brush, 1.0f, dirty);
+		}
+		for (int row = dirty.firstRow; row <= dirty.lastRow; row++)
+		{
+			for (int column = dirty.firstColumn; column <= dirty.lastColumn; column++)
+			{
+				const float height = HeightAt(heights, column, row);
+				if (column != centre || row != centre || type != TERRAIN_BRUSH_SMOOTH)
+				{
+					CHECK(height == 10.0f || (height >= 5.0f && height <= 20.0f));
+				}
+			}
+		}
+		CHECK(HeightAt(heights, centre, centre) >= 5.0f && HeightAt(heights, centre, centre) <= 20.0f);
+	}
+
+	TerrainBrush raise = MakeTestBrush(TERRAIN_BRUSH_RAISE);
+	raise.strength = 1000.0f;
+	std::vector<float> heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, raise, 1.0f, dirty);
+	CHECK(HeightAt(heights, centre, centre) == raise.maxHeight);
+	TerrainBrush lower = MakeTestBrush(TERRAIN_BRUSH_LOWER);
+	lower.strength = 1000.0f;
+	heights = flat;
+	ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, (float)centre, (float)centre, lower, 1.0f, dirty);
+	CHECK(HeightAt(heights, centre, centre) == lower.minHeight);
+}
+
+//a brush hanging over the edge of the chunk is clipped to it, and one that misses it entirely does nothing
+TEST(TerrainBrushDirtyEdges)
+{
+	const int last = TEST_BRUSH_RESOLUTION - 1;
+	const std::vector<float> flat((size_t)TEST_BRUSH_RESOLUTION * TEST_BRUSH_RESOLUTION, 10.0f);
+	const TerrainBrush brush = MakeTestBrush(TERRAIN_BRUSH_RAISE);
+	TerrainRect dirty;
+
+	//west edge, centre off the heightfield
+	std::vector<float> heights = flat;
+	CHECK(ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, -2.0f, 30.0f, brush, 0.5f, dirty));
+	CHECK(dirty.firstColumn == 0 && dirty.lastColumn == 6 && dirty.firstRow == 22 && dirty.lastRow == 38);
+	CHECK(HeightAt(heights, 0, 30) > 10.0f);
+	CHECK(OnlyInside(flat, heights, dirty));
+
+	//north east corner, between vertices
+	heights = flat;
+	CHECK(ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, last + 0.5f, last + 0.5f, brush, 0.5f, dirty));
+	CHECK(dirty.firstColumn == last - 7 && dirty.lastColumn == last && dirty.firstRow == last - 7 && dirty.lastRow == last);
+	CHECK(HeightAt(heights, last, last) > 10.0f);
+	CHECK(OnlyInside(flat, heights, dirty));
+
+	//spacing scales the radius from metres to vertices
+	heights = flat;
+	CHECK(ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 2.0f, 10.0f, 10.0f, brush, 0.5f, dirty));
+	CHECK(dirty.firstColumn == 6 && dirty.lastColumn == 14 && dirty.firstRow == 6 && dirty.lastRow == 14);
+
+	//just off the edge, the circle reaches no vertex
+	heights = flat;
+	CHECK(!ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, -8.5f, 30.0f, brush, 0.5f, dirty));
+	CHECK(dirty.IsEmpty());
+	CHECK(!ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, 30.0f, last + 20.0f, brush, 0.5f, dirty));
+	CHECK(dirty.IsEmpty());
+	CHECK(heights == flat);
+}
+
+//every vertex averages its neighbours as they were before the dab, not as already smoothed by it
+TEST(TerrainBrushSmoothReadsBefore)
+{
+	std::vector<float> before((size_t)TEST_BRUSH_RESOLUTION * TEST_BRUSH_RESOLUTION);
+	for (int row = 0; row < TEST_BRUSH_RESOLUTION; row++)
+	{
+		for (int column = 0; column < TEST_BRUSH_RESOLUTION; column++)
+		{
+			HeightAt(before, column, row) = 10.0f + ((row + column) & 1) * 8.0f + column * 0.25f;
+		}
+	}
+
+	//near the edge too, where the neighbourhood is clipped
+	const float centres[2][2] = { { 32.0f, 32.0f }, { 2.0f, 1.5f } };
+	for (int c = 0; c < 2; c++)
+	{
+		TerrainBrush brush = MakeTestBrush(TERRAIN_BRUSH_SMOOTH);
+		brush.strength = 1.2f;		//a blend of 0.6
+		std::vector<float> heights = before;
+		TerrainRect dirty;
+		CHECK(ApplyTerrainBrush(heights.data(), TEST_BRUSH_RESOLUTION, 1.0f, centres[c][0], centres[c][1], brush, 0.5f, dirty));
+
+		for (int row = dirty.firstRow; row <= dirty.lastRow; row++)
+		{
+			for (int column = dirty.firstColumn; column <= dirty.lastColumn; column++)
+			{
+				float sum = 0.0f;
+				int count = 0;
+				for (int y = row - 1; y <= row + 1; y++)
+				{
+					for (int x = column - 1; x <= column + 1; x++)
+					{
+						if (x >= 0 && y >= 0 && x < TEST_BRUSH_RESOLUTION && y < TEST_BRUSH_RESOLUTION)
+						{
+							sum += HeightAt(before, x, y);
+							count++;
+						}
+					}
+				}
+				const float dx = (column - centres[c][0]) / brush.radius;
+				const float dy = (row - centres[c][1]) / brush.radius;
+				const float weight = GetTerrainBrushFalloff(std::sqrt(dx * dx + dy * dy));
+				const float original = HeightAt(before, column, row);
+				const float expected = original + (sum / count - original) * 0.6f * weight;
+				CHECK_CLOSE(HeightAt(heights, column, row), expected, 1e-4f);
+			}
+		}
+	}
+}
+
+//user-015: strokes across a 1025 x 1025 chunk, each one second of dabs at 60 frames a second, at two brush sizes
+BENCHMARK(TerrainBrushStrokes)
+{
+	const int resolution = 1025;
+	const int dabsPerStroke = 60;
+	const float radii[] = { 8.0f, 32.0f };
+	const char * names[TERRAIN_BRUSH_COUNT] = { "raise", "lower", "smooth", "flatten", "noise" };
+	std::vector<float> heights((size_t)resolution * resolution);
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		heights[i] = 20.0f + 10.0f * sinf(i * 0.001f);
+	}
+
+	for (float radius : radii)
+	{
+		for (int type = 0; type < TERRAIN_BRUSH_COUNT; type++)
+		{
+			TerrainBrush brush = MakeTestBrush((TerrainBrushType)type);
+			brush.radius = radius;
+			TerrainRect dirty;
+			int strokes = 0;
+			long long vertices = 0;
+			TestTimer timer;
+			while (timer.GetSeconds() < 0.5)
+			{
+				//a diagonal drag across the chunk
+				for (int dab = 0; dab < dabsPerStroke; dab++)
+				{
+					const float along = 50.0f + (resolution - 100.0f) * dab / dabsPerStroke;
+					ApplyTerrainBrush(heights.data(), resolution, 1.0f, along, along + strokes % 7, brush, 1.0f / 60.0f, dirty);
+					vertices += (long long)(dirty.lastRow - dirty.firstRow + 1) * (dirty.lastColumn - dirty.firstColumn + 1);
+				}
+				strokes++;
+			}
+			const double seconds = timer.GetSeconds();
+			printf("  radius %4.0f %-8s %8.0f strokes/s, %10.0f dabs/s, %6.1f M vertices/s\n",
+				radius, names[type], strokes / seconds, strokes * dabsPerStroke / seconds, vertices / seconds / 1e6);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+#include "Test.h"
+#include "TerrainLOD.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//2^5 nodes along a side, so six levels
+#define TEST_LOD_RESOLUTION (32 * TERRAIN_LOD_NODE_QUADS + 1)
+//a 1080 pixel high view with a 45 degree field of view
+#define TEST_LOD_PROJECTION_SCALE (1080.0f / (2.0f * 0.41421356f))
+
+//rolling hills, the same every run
+static void MakeTestHeights(std::vector<float> & heights, int resolution)
+{
+	heights.resize((size_t)resolution * resolution);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			heights[(size_t)z * resolution + x] = 40.0f * sinf(x * 0.02f) * cosf(z * 0.017f) + 2.0f * sinf(x * 0.31f + z * 0.23f);
+		}
+	}
+}
+
+//every quad drawn once, and every triangle edge shared by two triangles unless it lies on the border, so there are no cracks
+static bool IsWatertight(const TerrainLOD & lod, const std::vector<TerrainLODDraw> & draws, int resolution)
+{
+	const int quads = resolution - 1;
+	std::vector<int> cover((size_t)quads * quads, 0);
+	std::vector<unsigned long long> edges;		//lower vertex in the high half
+	std::vector<unsigned int> indices;
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		int x, z, size;
+		lod.GetNodeRect(draws[i].node, x, z, size);
+		for (int row = z; row < z + size; row++)
+		{
+			for (int column = x; column < x + size; column++)
+			{
+				cover[(size_t)row * quads + column]++;
+			}
+		}
+
+		indices.clear();
+		TerrainLOD::BuildIndices(draws[i].level, draws[i].stitchMask, resolution, indices);
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned long long a = draws[i].baseVertex + indices[t + k];
+				const unsigned long long b = draws[i].baseVertex + indices[t + (k + 1) % 3];
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < cover.size(); i++)
+	{
+		if (cover[i] != 1)
+		{
+			return false;
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t end = i;
+		while (end < edges.size() && edges[end] == edges[i])
+		{
+			end++;
+		}
+		const int a = (int)(edges[i] >> 32), b = (int)(edges[i] & 0xFFFFFFFF);
+		const int ax = a % resolution, az = a / resolution;
+		const int bx = b % resolution, bz = b / resolution;
+		const bool border = (ax == bx && (ax == 0 || ax == quads)) || (az == bz && (az == 0 || az == quads));
+		if (end - i != (border ? 1u : 2u))
+		{
+			return false;
+		}
+		i = end;
+	}
+	return true;
+}
+
+//neighbouring nodes are never more than one level apart
+static bool IsBalanced(const TerrainLOD & lod, const std::vector<TerrainLODDraw> & draws, int resolution)
+{
+	const int tilesPerSide = (resolution - 1) / TERRAIN_LOD_NODE_QUADS;
+	std::vector<int> tileLevel((size_t)tilesPerSide * tilesPerSide, -1);
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		int x, z, size;
+		lod.GetNodeRect(draws[i].node, x, z, size);
+		for (int row = z / TERRAIN_LOD_NODE_QUADS; row < (z + size) / TERRAIN_LOD_NODE_QUADS; row++)
+		{
+			for (int column = x / TERRAIN_LOD_NODE_QUADS; column < (x + size) / TERRAIN_LOD_NODE_QUADS; column++)
+			{
+				tileLevel[(size_t)row * tilesPerSide + column] = draws[i].level;
+			}
+		}
+	}
+	for (int row = 0; row < tilesPerSide; row++)
+	{
+		for (int column = 0; column < tilesPerSide; column++)
+		{
+			const int level = tileLevel[(size_t)row * tilesPerSide + column];
+			if ((column + 1 < tilesPerSide && std::abs(level - tileLevel[(size_t)row * tilesPerSide + column + 1]) > 1)
+				|| (row + 1 < tilesPerSide && std::abs(level - tileLevel[(size_t)(row + 1) * tilesPerSide + column]) > 1))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//the level the node drawn under a point uses
+static int GetLevelAt(const TerrainLOD & lod, const std::vector<TerrainLODDraw> & draws, int vertexX, int vertexZ)
+{
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		int x, z, size;
+		lod.GetNodeRect(draws[i].node, x, z, size);
+		if (vertexX >= x && vertexX < x + size && vertexZ >= z && vertexZ < z + size)
+		{
+			return draws[i].level;
+		}
+	}
+	return -1;
+}
+
+TEST(TerrainLODSupported)
+{
+	CHECK(TerrainLOD::IsSupported(TERRAIN_LOD_NODE_QUADS + 1));
+	CHECK(TerrainLOD::IsSupported(2 * TERRAIN_LOD_NODE_QUADS + 1));
+	CHECK(TerrainLOD::IsSupported(TEST_LOD_RESOLUTION));
+	CHECK(!TerrainLOD::IsSupported(TERRAIN_LOD_NODE_QUADS));
+	CHECK(!TerrainLOD::IsSupported(3 * TERRAIN_LOD_NODE_QUADS + 1));		//not a power of two nodes along a side
+	CHECK(!TerrainLOD::IsSupported(128));
+
+	std::vector<float> heights;
+	MakeTestHeights(heights, 128);
+	TerrainLOD lod;
+	CHECK(!lod.Build(heights.data(), 128, 0.0f, 0.0f, 1.0f));
+	CHECK(!lod.IsBuilt());
+}
+
+//the selection at fixed camera poses: no cracks, balanced, finest under the camera, and fewer triangles the further away it is
+TEST(TerrainLODSelect)
+{
+	const int resolution = TEST_LOD_RESOLUTION;
+	const int quads = resolution - 1;
+	std::vector<float> heights;
+	MakeTestHeights(heights, resolution);
+	TerrainLOD lod;
+	CHECK(lod.Build(heights.data(), resolution, 0.0f, 0.0f, 1.0f));
+	CHECK(lod.GetLevelCount() == 6);
+
+	//low over the middle, low over a corner, high over the middle, and far above everything
+	const float cameras[4][3] = {
+		{ quads * 0.5f, 50.0f, quads * 0.5f },
+		{ 10.0f, 50.0f, 10.0f },
+		{ quads * 0.5f, 400.0f, quads * 0.5f },
+		{ quads * 0.5f, 100000.0f, quads * 0.5f } };
+	const int fullTriangles = 2 * quads * quads;
+	int triangles[4];
+	std::vector<TerrainLODDraw> draws;
+	for (int i = 0; i < 4; i++)
+	{
+		lod.Select(cameras[i], TEST_LOD_PROJECTION_SCALE, 2.0f, draws);
+		CHECK(!draws.empty());
+		CHECK(IsWatertight(lod, draws, resolution));
+		CHECK(IsBalanced(lod, draws, resolution));
+
+		//CountTriangles agrees with the index lists the nodes are drawn with
+		std::vector<unsigned int> indices;
+		int counted = 0;
+		for (size_t j = 0; j < draws.size(); j++)
+		{
+			indices.clear();
+			TerrainLOD::BuildIndices(draws[j].level, draws[j].stitchMask, resolution, indices);
+			counted += (int)indices.size() / 3;
+		}
+		triangles[i] = TerrainLOD::CountTriangles(draws, resolution);
+		CHECK(triangles[i] == counted);
+		CHECK(triangles[i] <= fullTriangles);
+	}
+
+	lod.Select(cameras[0], TEST_LOD_PROJECTION_SCALE, 2.0f, draws);
+	CHECK(GetLevelAt(lod, draws, quads / 2, quads / 2) == 0);
+	CHECK(GetLevelAt(lod, draws, 0, 0) > 0);
+	lod.Select(cameras[1], TEST_LOD_PROJECTION_SCALE, 2.0f, draws);
+	CHECK(GetLevelAt(lod, draws, 10, 10) == 0);
+	CHECK(GetLevelAt(lod, draws, quads - 1, quads - 1) > 0);
+
+	CHECK(triangles[0] < fullTriangles);
+	CHECK(triangles[2] < triangles[0]);
+	CHECK(triangles[3] <= triangles[2]);
+	CHECK(triangles[3] == 2 * TERRAIN_LOD_NODE_QUADS * TERRAIN_LOD_NODE_QUADS);		//the root alone
+
+	//a looser error threshold never draws more
+	lod.Select(cameras[0], TEST_LOD_PROJECTION_SCALE, 8.0f, draws);
+	CHECK(TerrainLOD::CountTriangles(draws, resolution) <= triangles[0]);
+}
+
+//flat ground has no error at any level, so the root is enough from anywhere
+TEST(TerrainLODFlat)
+{
+	const int resolution = TEST_LOD_RESOLUTION;
+	std::vector<float> heights((size_t)resolution * resolution, 5.0f);
+	TerrainLOD lod;
+	CHECK(lod.Build(heights.data(), resolution, -512.0f, -512.0f, 1.0f));
+	const float camera[3] = { 0.0f, 6.0f, 0.0f };
+	std::vector<TerrainLODDraw> draws;
+	lod.Select(camera, TEST_LOD_PROJECTION_SCALE, 1.0f, draws);
+	CHECK(draws.size() == 1);
+	CHECK(draws.size() == 1 && draws[0].level == lod.GetLevelCount() - 1 && draws[0].stitchMask == 0);
+
+	//a spike raises the error, and the ground around it is drawn finer again
+	heights[(size_t)(resolution / 2) * resolution + resolution / 2] = 50.0f;
+	lod.UpdateHeights(resolution / 2, resolution / 2, resolution / 2, resolution / 2);
+	lod.Select(camera, TEST_LOD_PROJECTION_SCALE, 1.0f, draws);
+	CHECK(draws.size() > 1);
+	CHECK(IsWatertight(lod, draws, resolution));
+}
@@ -0,0 +1,135 @@
+#include "Test.h"
+#include "TerrainNormals.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+//the normal's offset and stride in VertexPositionNormalTexture, which is what the terrain writes into
+#define TEST_NORMAL_OFFSET 3
+#define TEST_VERTEX_FLOATS 8
+
+//rough ground, the same every run
+static void MakeTestHeights(std::vector<float> & heights, int resolution)
+{
+	std::mt19937 random(4);
+	std::uniform_real_distribution<float> bump(-0.5f, 0.5f);
+	heights.resize((size_t)resolution * resolution);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			heights[(size_t)z * resolution + x] = 20.0f * sinf(x * 0.05f) * cosf(z * 0.03f) + bump(random);
+		}
+	}
+}
+
+static float GetLargestDifference(const std::vector<float> & a, const std::vector<float> & b)
+{
+	float largest = 0.0f;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		largest = std::max(largest, std::fabs(a[i] - b[i]));
+	}
+	return largest;
+}
+
+//the SSE version writes the same normals as the scalar one, to within rounding, and only inside the rectangle asked for
+TEST(TerrainNormalsMatchScalar)
+{
+	const int resolution = 67;		//not a multiple of four, so the vector loop leaves columns over
+	std::vector<float> heights;
+	MakeTestHeights(heights, resolution);
+	const int rects[][4] = {
+		{ 0, resolution - 1, 0, resolution - 1 },
+		{ -3, 5, -3, 5 },
+		{ 60, 80, 58, 70 },
+		{ 10, 12, 7, 8 },
+		{ 30, 30, 1, 1 },
+		{ 20, 40, 33, 52 } };
+	const float sentinel = -99.0f;
+	for (const int * rect : rects)
+	{
+		std::vector<float> scalar((size_t)resolution * resolution * TEST_VERTEX_FLOATS, sentinel);
+		std::vector<float> vector(scalar);
+		ComputeTerrainNormalsScalar(heights.data(), resolution, 0.5f, rect[0], rect[1], rect[2], rect[3], &scalar[TEST_NORMAL_OFFSET], TEST_VERTEX_FLOATS * sizeof(float));
+		ComputeTerrainNormals(heights.data(), resolution, 0.5f, rect[0], rect[1], rect[2], rect[3], &vector[TEST_NORMAL_OFFSET], TEST_VERTEX_FLOATS * sizeof(float));
+		CHECK(GetLargestDifference(scalar, vector) < 1e-5f);
+
+		//unit length inside the rectangle, untouched outside it
+		int written = 0;
+		for (int row = 0; row < resolution; row++)
+		{
+			for (int column = 0; column < resolution; column++)
+			{
+				const float * normal = &vector[((size_t)row * resolution + column) * TEST_VERTEX_FLOATS + TEST_NORMAL_OFFSET];
+				const bool inside = row >= rect[0] && row <= rect[1] && column >= rect[2] && column <= rect[3];
+				if (inside)
+				{
+					CHECK_CLOSE(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2], 1.0f, 1e-5f);
+					CHECK(normal[1] > 0.0f);
+					written++;
+				}
+				else
+				{
+					CHECK(normal[0] == sentinel && normal[1] == sentinel && normal[2] == sentinel);
+				}
+			}
+		}
+		CHECK(written > 0);
+	}
+}
+
+//flat ground points straight up, and a slope along x leans the other way
+TEST(TerrainNormalsSlope)
+{
+	const int resolution = 9;
+	std::vector<float> heights((size_t)resolution * resolution);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			heights[(size_t)z * resolution + x] = (float)x;
+		}
+	}
+	std::vector<float> normals((size_t)resolution * resolution * 3);
+	ComputeTerrainNormals(heights.data(), resolution, 1.0f, 0, resolution - 1, 0, resolution - 1, normals.data(), 3 * sizeof(float));
+	const float expected = 1.0f / std::sqrt(2.0f);
+	for (int i = 0; i < resolution * resolution; i++)
+	{
+		CHECK_CLOSE(normals[i * 3], -expected, 1e-5f);
+		CHECK_CLOSE(normals[i * 3 + 1], expected, 1e-5f);
+		CHECK_CLOSE(normals[i * 3 + 2], 0.0f, 1e-5f);
+	}
+}
+
+//user-014: the whole terrain's normals, SSE against scalar, written into vertices as the terrain lays them out
+BENCHMARK(TerrainNormalsBenchmark)
+{
+	const int resolutions[] = { 128, 1024, 4096 };
+	for (int resolution : resolutions)
+	{
+		std::vector<float> heights;
+		MakeTestHeights(heights, resolution);
+		std::vector<float> vertices((size_t)resolution * resolution * TEST_VERTEX_FLOATS);
+		const int passes = resolution >= 4096 ? 3 : resolution >= 1024 ? 20 : 500;
+
+		TestTimer timer;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			ComputeTerrainNormalsScalar(heights.data(), resolution, 1.0f, 0, resolution - 1, 0, resolution - 1, &vertices[TEST_NORMAL_OFFSET], TEST_VERTEX_FLOATS * sizeof(float));
+		}
+		const double scalarSeconds = timer.GetSeconds() / passes;
+
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			ComputeTerrainNormals(heights.data(), resolution, 1.0f, 0, resolution - 1, 0, resolution - 1, &vertices[TEST_NORMAL_OFFSET], TEST_VERTEX_FLOATS * sizeof(float));
+		}
+		const double vectorSeconds = timer.GetSeconds() / passes;
+
+		const double count = (double)resolution * resolution;
+		printf("  %4d^2: scalar %8.3f ms (%4.1f ns/vertex), SSE %8.3f ms (%4.1f ns/vertex), %.2fx\n",
+			resolution, scalarSeconds * 1e3, scalarSeconds * 1e9 / count, vectorSeconds * 1e3, vectorSeconds * 1e9 / count, scalarSeconds / vectorSeconds);
+	}
+}
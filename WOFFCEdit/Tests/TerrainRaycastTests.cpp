@@ -0,0 +1,193 @@
+#include "Test.h"
+#include "TerrainRaycast.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+//hills with some roughness, the same every run
+static void MakeTestHeights(std::vector<float> & heights, int resolution)
+{
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> bump(0.0f, 1.0f);
+	heights.resize((size_t)resolution * resolution);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			heights[(size_t)z * resolution + x] = 30.0f + 25.0f * sinf(x * 0.013f) * cosf(z * 0.021f) + bump(random);
+		}
+	}
+}
+
+//a ray and a triangle, from either side. the distance along the ray, or a negative number for a miss
+static float IntersectTriangle(const float origin[3], const float direction[3], const float a[3], const float b[3], const float c[3])
+{
+	const float edge1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const float edge2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	const float p[3] = { direction[1] * edge2[2] - direction[2] * edge2[1], direction[2] * edge2[0] - direction[0] * edge2[2], direction[0] * edge2[1] - direction[1] * edge2[0] };
+	const float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+	if (std::fabs(determinant) < 1e-12f)
+	{
+		return -1.0f;
+	}
+	const float s[3] = { origin[0] - a[0], origin[1] - a[1], origin[2] - a[2] };
+	const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / determinant;
+	const float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+	const float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) / determinant;
+	if (u < 0.0f || v < 0.0f || u + v > 1.0f)
+	{
+		return -1.0f;
+	}
+	return (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) / determinant;
+}
+
+//every triangle of the terrain, keeping the nearest hit. what picking the terrain would cost without the walk
+static bool IntersectEveryCell(const std::vector<float> & heights, int resolution, float cornerX, float cornerZ, float spacing,
+							   const float origin[3], const float direction[3], float maxDistance, float & distance)
+{
+	distance = FLT_MAX;
+	for (int row = 0; row < resolution - 1; row++)
+	{
+		for (int column = 0; column < resolution - 1; column++)
+		{
+			const float x0 = cornerX + column * spacing;
+			const float z0 = cornerZ + row * spacing;
+			const float * corner = &heights[(size_t)row * resolution + column];
+			const float bottomLeft[3] = { x0, corner[0], z0 };
+			const float bottomRight[3] = { x0 + spacing, corner[1], z0 };
+			const float topRight[3] = { x0 + spacing, corner[resolution + 1], z0 + spacing };
+			const float topLeft[3] = { x0, corner[resolution], z0 + spacing };
+			const float first = IntersectTriangle(origin, direction, bottomLeft, bottomRight, topRight);
+			const float second = IntersectTriangle(origin, direction, bottomLeft, topRight, topLeft);
+			if (first >= 0.0f && first < distance)
+			{
+				distance = first;
+			}
+			if (second >= 0.0f && second < distance)
+			{
+				distance = second;
+			}
+		}
+	}
+	return distance <= maxDistance;
+}
+
+//rays from above the terrain at a spread of angles, from straight down to nearly level, some pointing away from it
+static void MakeTestRays(int count, float size, std::vector<float> & origins, std::vector<float> & directions)
+{
+	std::mt19937 random(6);
+	std::uniform_real_distribution<float> position(-0.2f * size, 1.2f * size);
+	std::uniform_real_distribution<float> height(60.0f, 200.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	origins.resize((size_t)count * 3);
+	directions.resize((size_t)count * 3);
+	for (int i = 0; i < count; i++)
+	{
+		origins[i * 3] = position(random);
+		origins[i * 3 + 1] = height(random);
+		origins[i * 3 + 2] = position(random);
+		directions[i * 3] = unit(random);
+		directions[i * 3 + 1] = -std::fabs(unit(random)) - 0.02f;
+		directions[i * 3 + 2] = unit(random);
+	}
+}
+
+//the walk finds the same nearest hit as testing every triangle, before and after an edit
+TEST(TerrainRaycastMatchesEveryCell)
+{
+	const int resolution = 65;
+	const float spacing = 2.0f;
+	const float cornerX = -64.0f, cornerZ = 10.0f;
+	std::vector<float> heights;
+	MakeTestHeights(heights, resolution);
+	TerrainRaycast raycast;
+	CHECK(!raycast.IsBuilt());
+	raycast.Build(heights.data(), resolution, cornerX, cornerZ, spacing);
+	CHECK(raycast.IsBuilt());
+
+	std::vector<float> origins, directions;
+	MakeTestRays(400, (resolution - 1) * spacing, origins, directions);
+	for (int i = 0; i < 400; i++)
+	{
+		origins[i * 3] += cornerX;
+		origins[i * 3 + 2] += cornerZ;
+	}
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int hits = 0, mismatches = 0;
+		for (int i = 0; i < 400; i++)
+		{
+			float expected;
+			TerrainRayHit hit;
+			const bool expectHit = IntersectEveryCell(heights, resolution, cornerX, cornerZ, spacing, &origins[i * 3], &directions[i * 3], 1000.0f, expected);
+			const bool found = raycast.IntersectRay(&origins[i * 3], &directions[i * 3], 1000.0f, hit);
+			mismatches += found != expectHit || (found && std::fabs(hit.distance - expected) > 1e-3f * std::max(expected, 1.0f));
+			hits += found;
+			if (found)
+			{
+				CHECK(hit.normal[1] > 0.0f);
+				CHECK_CLOSE(hit.position[1], origins[i * 3 + 1] + directions[i * 3 + 1] * hit.distance, 1e-2f);
+			}
+		}
+		CHECK(mismatches == 0);
+		CHECK(hits > 40 && hits < 400);		//some of each
+
+		//a pit dug in the middle, which the pyramid has to see
+		for (int row = 20; row < 40; row++)
+		{
+			for (int column = 25; column < 45; column++)
+			{
+				heights[(size_t)row * resolution + column] -= 25.0f;
+			}
+		}
+		raycast.UpdateRect(20, 39, 25, 44);
+	}
+
+	//straight down onto a known height, as snapping an object to the ground does
+	const float origin[3] = { cornerX + 10 * spacing, 500.0f, cornerZ + 10 * spacing };
+	const float down[3] = { 0.0f, -1.0f, 0.0f };
+	TerrainRayHit hit;
+	CHECK(raycast.IntersectRay(origin, down, 1000.0f, hit));
+	CHECK_CLOSE(hit.position[1], heights[10 * resolution + 10], 1e-3f);
+	CHECK(!raycast.IntersectRay(origin, down, 100.0f, hit));		//too short to reach
+}
+
+//user-016: rays per second on a 4096^2 heightmap, for snapping straight down and for picks at any angle
+BENCHMARK(TerrainRaycastBenchmark)
+{
+	const int resolution = 4096;
+	const float spacing = 1.0f;
+	std::vector<float> heights;
+	MakeTestHeights(heights, resolution);
+	TerrainRaycast raycast;
+	TestTimer timer;
+	raycast.Build(heights.data(), resolution, 0.0f, 0.0f, spacing);
+	const double buildSeconds = timer.GetSeconds();
+
+	const int count = 100000;
+	std::vector<float> origins, directions;
+	MakeTestRays(count, (resolution - 1) * spacing, origins, directions);
+	int hits = 0;
+	timer.Restart();
+	for (int i = 0; i < count; i++)
+	{
+		TerrainRayHit hit;
+		hits += raycast.IntersectRay(&origins[i * 3], &directions[i * 3], 1e6f, hit);
+	}
+	const double pickSeconds = timer.GetSeconds();
+
+	const float down[3] = { 0.0f, -1.0f, 0.0f };
+	int snapped = 0;
+	timer.Restart();
+	for (int i = 0; i < count; i++)
+	{
+		TerrainRayHit hit;
+		snapped += raycast.IntersectRay(&origins[i * 3], down, 1e6f, hit);
+	}
+	const double snapSeconds = timer.GetSeconds();
+
+	printf("  %d^2: build %.1f ms, picks %.0f rays/s (%d / %d hit), straight down %.0f rays/s (%d / %d hit)\n",
+		resolution, buildSeconds * 1e3, count / pickSeconds, hits, count, count / snapSeconds, snapped, count);
+}
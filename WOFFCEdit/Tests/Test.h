@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//A test or benchmark, registered by the macros below and run by TestMain.
+//Tests check behaviour and run every time. Benchmarks print timings, and only run when asked for, as some take minutes.
+typedef void (*TestFunction)();
+
+struct TestCase
+{
+	const char *	name;
+	TestFunction	function;
+	bool			benchmark;
+};
+
+std::vector<TestCase> &	GetTestCases();
+
+struct TestRegistrar
+{
+	TestRegistrar(const char * name, TestFunction function, bool benchmark)
+	{
+		TestCase testCase = { name, function, benchmark };
+		GetTestCases().push_back(testCase);
+	}
+};
+
+#define TEST(name)		static void name(); static TestRegistrar name##Registrar(#name, name, false); static void name()
+#define BENCHMARK(name)	static void name(); static TestRegistrar name##Registrar(#name, name, true); static void name()
+
+//a failed check is reported and counted, and the test carries on
+void	ReportFailure(const char * file, int line, const char * expression);
+#define CHECK(expression)	do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
+#define CHECK_CLOSE(a, b, tolerance)	CHECK(((a) - (b)) <= (tolerance) && ((b) - (a)) <= (tolerance))
+
+//wall clock seconds since it was made or last restarted
+class TestTimer
+{
+public:
+	TestTimer()				{ Restart(); }
+	void	Restart()		{ m_start = std::chrono::steady_clock::now(); }
+	double	GetSeconds() const	{ return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count(); }
+
+private:
+	std::chrono::steady_clock::time_point	m_start;
+};
+
+//a copy of database/test.db to work on, so nothing touches the level itself. The tests run from the WOFFCEdit directory, as the editor does
+std::string	CopyTestDatabase(const char * name);
+void		DeleteTestDatabase(const std::string & path);		//with its WAL and shared memory files
@@ -0,0 +1,78 @@
+#include "Test.h"
+#include <cstring>
+#include <fstream>
+
+//Runs every test, then the benchmarks too if "bench" is on the command line. Anything else on the command line
+//picks the tests and benchmarks whose names contain it. Returns the number of failed checks, so 0 is a pass.
+
+static int s_failures = 0;
+
+std::vector<TestCase> & GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void ReportFailure(const char * file, int line, const char * expression)
+{
+	printf("  FAILED %s(%d): %s\n", file, line, expression);
+	s_failures++;
+}
+
+std::string CopyTestDatabase(const char * name)
+{
+	const std::string path = std::string("database/") + name + ".db";
+	DeleteTestDatabase(path);
+	std::ifstream source("database/test.db", std::ios::binary);
+	std::ofstream copy(path.c_str(), std::ios::binary);
+	copy << source.rdbuf();
+	return path;
+}
+
+void DeleteTestDatabase(const std::string & path)
+{
+	std::remove(path.c_str());
+	std::remove((path + "-wal").c_str());
+	std::remove((path + "-shm").c_str());
+}
+
+int main(int argc, char * argv[])
+{
+	bool benchmarks = false;
+	const char * filter = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "bench") == 0)
+		{
+			benchmarks = true;
+		}
+		else
+		{
+			filter = argv[i];
+		}
+	}
+
+	const std::vector<TestCase> & testCases = GetTestCases();
+	int run = 0;
+	int failed = 0;
+	for (size_t i = 0; i < testCases.size(); i++)
+	{
+		const TestCase & testCase = testCases[i];
+		if ((testCase.benchmark && !benchmarks) || (filter != NULL && strstr(testCase.name, filter) == NULL))
+		{
+			continue;
+		}
+
+		printf("%s\n", testCase.name);
+		fflush(stdout);
+		const int failuresBefore = s_failures;
+		TestTimer timer;
+		testCase.function();
+		printf("  %s in %.3f s\n", s_failures == failuresBefore ? "ok" : "FAILED", timer.GetSeconds());
+		run++;
+		failed += s_failures != failuresBefore;
+	}
+
+	printf("%d run, %d failed\n", run, failed);
+	return s_failures;
+}
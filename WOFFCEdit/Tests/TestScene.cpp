@@ -0,0 +1,71 @@
+#include "TestScene.h"
+#include <string>
+
+void MakeTestObject(int ID, SceneObject & object)
+{
+	static const char * const models[] = { "database/data/placeholder.cmo", "database/data/rock.cmo", "database/data/tree.cmo", "database/data/crate.cmo" };
+	static const char * const textures[] = { "database/data/placeholder.dds", "database/data/rock.dds", "database/data/bark.dds" };
+
+	//values that do not round trip through text, so a lossy save shows up
+	const float value = ID * 0.1f + 1.0f / 3.0f;
+	object = SceneObject();
+	object.ID = ID;
+	object.chunk_ID = TEST_SCENE_CHUNK;
+	object.model_path = models[ID % 4];
+	object.tex_diffuse_path = textures[ID % 3];
+	object.posX = value;			object.posY = value * 0.5f;		object.posZ = -value;
+	object.rotX = (float)(ID % 360);	object.rotY = value * 0.01f;	object.rotZ = 0.0f;
+	object.scaX = 1.0f;				object.scaY = 1.0f + (ID % 7) * 0.125f;	object.scaZ = 1.0f;
+	object.collision = ID % 2 == 0;
+	object.collision_mesh = object.model_path;
+	object.health_amount = ID % 100;
+	object.pivotX = 0.25f;
+	object.snapToGround = ID % 5 == 0;
+	object.audio_path = ID % 10 == 0 ? "database/data/ambience.wav" : "";
+	object.volume = 0.5f;
+	object.min_dist = 1;
+	object.max_dist = 50;
+	object.parent_id = ID % 8 == 0 ? 0 : ID - ID % 8;		//small families, the first of every eight is a root
+	object.name = "Object " + std::to_string(ID % 1000);
+	object.light_type = ID % 3;
+	object.light_diffuse_r = value;
+	object.light_quadratic = 0.125f;
+}
+
+void FillTestScene(SceneStore & sceneGraph, int count, bool inserted)
+{
+	sceneGraph.Reserve(sceneGraph.GetCount() + count);
+	SceneObject object;
+	for (int i = 0; i < count; i++)
+	{
+		MakeTestObject(TEST_SCENE_FIRST_ID + i, object);
+		object.inserted = inserted;
+		sceneGraph.Add(object);
+	}
+}
+
+bool SameObject(const SceneObject & a, const SceneObject & b)
+{
+	return a.ID == b.ID && a.chunk_ID == b.chunk_ID && a.model_path == b.model_path && a.tex_diffuse_path == b.tex_diffuse_path
+		&& a.posX == b.posX && a.posY == b.posY && a.posZ == b.posZ
+		&& a.rotX == b.rotX && a.rotY == b.rotY && a.rotZ == b.rotZ
+		&& a.scaX == b.scaX && a.scaY == b.scaY && a.scaZ == b.scaZ
+		&& a.render == b.render && a.collision == b.collision && a.collision_mesh == b.collision_mesh
+		&& a.collectable == b.collectable && a.destructable == b.destructable && a.health_amount == b.health_amount
+		&& a.editor_render == b.editor_render && a.editor_texture_vis == b.editor_texture_vis
+		&& a.editor_normals_vis == b.editor_normals_vis && a.editor_collision_vis == b.editor_collision_vis
+		&& a.editor_pivot_vis == b.editor_pivot_vis
+		&& a.pivotX == b.pivotX && a.pivotY == b.pivotY && a.pivotZ == b.pivotZ
+		&& a.snapToGround == b.snapToGround && a.AINode == b.AINode && a.audio_path == b.audio_path
+		&& a.volume == b.volume && a.pitch == b.pitch && a.pan == b.pan
+		&& a.one_shot == b.one_shot && a.play_on_init == b.play_on_init && a.play_in_editor == b.play_in_editor
+		&& a.min_dist == b.min_dist && a.max_dist == b.max_dist
+		&& a.camera == b.camera && a.path_node == b.path_node && a.path_node_start == b.path_node_start
+		&& a.path_node_end == b.path_node_end && a.parent_id == b.parent_id
+		&& a.editor_wireframe == b.editor_wireframe && a.name == b.name
+		&& a.light_type == b.light_type
+		&& a.light_diffuse_r == b.light_diffuse_r && a.light_diffuse_g == b.light_diffuse_g && a.light_diffuse_b == b.light_diffuse_b
+		&& a.light_specular_r == b.light_specular_r && a.light_specular_g == b.light_specular_g && a.light_specular_b == b.light_specular_b
+		&& a.light_spot_cutoff == b.light_spot_cutoff && a.light_constant == b.light_constant
+		&& a.light_linear == b.light_linear && a.light_quadratic == b.light_quadratic;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "SceneObject.h"
+#include "SceneStore.h"
+
+//chunk the synthetic objects are put in, so they never mix with the rows test.db already has
+#define TEST_SCENE_CHUNK 99
+//first ID of the synthetic objects, above anything in test.db
+#define TEST_SCENE_FIRST_ID 100000
+
+//a level's worth of objects: a handful of shared asset paths, varied transforms, every column set to something
+void	MakeTestObject(int ID, SceneObject & object);
+void	FillTestScene(SceneStore & sceneGraph, int count, bool inserted);		//IDs from TEST_SCENE_FIRST_ID on
+bool	SameObject(const SceneObject & a, const SceneObject & b);				//every column, not the save bookkeeping
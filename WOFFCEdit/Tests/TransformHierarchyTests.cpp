@@ -0,0 +1,239 @@
+#include "Test.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+//a small turn about y and a step, different for every node
+static void MakeTestLocal(int node, float local[16])
+{
+	const float angle = (node % 17) * 0.05f;
+	const float matrix[16] = {
+		cosf(angle), 0.0f, -sinf(angle), 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		sinf(angle), 0.0f, cosf(angle), 0.0f,
+		(float)(node % 5), (float)(node % 3) * 0.5f, 1.0f, 1.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		local[i] = matrix[i];
+	}
+}
+
+//the world matrix by walking up the parents one at a time, what the hierarchy saves doing
+static void GetWorldByWalking(const TransformHierarchy & hierarchy, const std::vector<std::vector<float>> & locals, int node, float world[16])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		world[i] = locals[node][i];
+	}
+	for (int parent = hierarchy.GetParent(node); parent != TRANSFORM_HIERARCHY_NO_PARENT; parent = hierarchy.GetParent(parent))
+	{
+		float result[16];
+		TransformHierarchy::Multiply(world, locals[parent].data(), result);
+		for (int i = 0; i < 16; i++)
+		{
+			world[i] = result[i];
+		}
+	}
+}
+
+static bool MatchesWalking(const TransformHierarchy & hierarchy, const std::vector<std::vector<float>> & locals)
+{
+	for (int node = 0; node < hierarchy.GetCount(); node++)
+	{
+		float expected[16];
+		GetWorldByWalking(hierarchy, locals, node, expected);
+		const float * world = hierarchy.GetWorld(node);
+		for (int i = 0; i < 16; i++)
+		{
+			if (std::fabs(world[i] - expected[i]) > 1e-3f * std::max(1.0f, std::fabs(expected[i])))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//parents[i] picked at random from the nodes before it, or a root one time in rootEvery
+static void MakeTestParents(int count, int rootEvery, std::vector<int> & parents)
+{
+	std::mt19937 random(7);
+	parents.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		parents[i] = i == 0 || random() % rootEvery == 0 ? TRANSFORM_HIERARCHY_NO_PARENT : (int)(random() % i);
+	}
+}
+
+TEST(TransformHierarchyLinks)
+{
+	//0 <- 1 <- 2, 3 <- 4 <- 3 is a loop, 5 points at itself and 6 out of range
+	const int parents[] = { TRANSFORM_HIERARCHY_NO_PARENT, 0, 1, 4, 3, 5, 100 };
+	TransformHierarchy hierarchy;
+	hierarchy.Build(std::vector<int>(parents, parents + 7));
+	CHECK(hierarchy.GetCount() == 7);
+	CHECK(hierarchy.GetParent(1) == 0 && hierarchy.GetParent(2) == 1);
+	CHECK((hierarchy.GetParent(3) == TRANSFORM_HIERARCHY_NO_PARENT) != (hierarchy.GetParent(4) == TRANSFORM_HIERARCHY_NO_PARENT));
+	CHECK(hierarchy.GetParent(5) == TRANSFORM_HIERARCHY_NO_PARENT);
+	CHECK(hierarchy.GetParent(6) == TRANSFORM_HIERARCHY_NO_PARENT);
+	CHECK(hierarchy.GetFirstChild(0) == 1 && hierarchy.GetNextSibling(1) == TRANSFORM_HIERARCHY_NO_PARENT);
+	CHECK(hierarchy.GetRoots().size() == 4);
+
+	//everything starts dirty, at identity
+	std::vector<int> changed;
+	CHECK(hierarchy.IsDirty());
+	hierarchy.Update(changed);
+	CHECK(changed.size() == 7);
+	CHECK(!hierarchy.IsDirty());
+	CHECK(hierarchy.GetWorld(2)[0] == 1.0f && hierarchy.GetWorld(2)[12] == 0.0f);
+
+	//appended nodes only link to each other
+	const int appended[] = { 0, 7, 1 };
+	hierarchy.Append(std::vector<int>(appended, appended + 3));
+	CHECK(hierarchy.GetCount() == 10);
+	CHECK(hierarchy.GetParent(7) == TRANSFORM_HIERARCHY_NO_PARENT);
+	CHECK(hierarchy.GetParent(8) == 7);
+	CHECK(hierarchy.GetParent(9) == TRANSFORM_HIERARCHY_NO_PARENT);
+	changed.clear();
+	hierarchy.Update(changed);
+	CHECK(changed.size() == 3);
+}
+
+//worlds match walking up the parents, after the first update, after moving nodes, and after appending more
+TEST(TransformHierarchyPropagates)
+{
+	const int count = 2000;
+	std::vector<int> parents;
+	MakeTestParents(count, 50, parents);
+	TransformHierarchy hierarchy;
+	hierarchy.Build(parents);
+	std::vector<std::vector<float>> locals(count, std::vector<float>(16));
+	for (int i = 0; i < count; i++)
+	{
+		MakeTestLocal(i, locals[i].data());
+		hierarchy.SetLocal(i, locals[i].data());
+	}
+	std::vector<int> changed;
+	hierarchy.Update(changed);
+	CHECK(changed.size() == count);
+	CHECK(MatchesWalking(hierarchy, locals));
+
+	//moving a node recomputes it and what is under it, parents first, and nothing else
+	const int moved = hierarchy.GetFirstChild(0);
+	CHECK(moved != TRANSFORM_HIERARCHY_NO_PARENT);
+	locals[moved][12] += 10.0f;
+	hierarchy.SetLocal(moved, locals[moved].data());
+	hierarchy.SetLocal(moved, locals[moved].data());		//twice is still once
+	changed.clear();
+	hierarchy.Update(changed);
+	CHECK(!changed.empty() && changed[0] == moved);
+	for (size_t i = 1; i < changed.size(); i++)
+	{
+		int node = changed[i];
+		while (node != moved && node != TRANSFORM_HIERARCHY_NO_PARENT)
+		{
+			node = hierarchy.GetParent(node);
+		}
+		CHECK(node == moved);
+	}
+	CHECK(MatchesWalking(hierarchy, locals));
+
+	std::vector<int> more;
+	MakeTestParents(500, 10, more);
+	hierarchy.Append(more);
+	locals.resize(count + 500, std::vector<float>(16));
+	for (int i = count; i < count + 500; i++)
+	{
+		MakeTestLocal(i, locals[i].data());
+		hierarchy.SetLocal(i, locals[i].data());
+	}
+	changed.clear();
+	hierarchy.Update(changed);
+	CHECK(changed.size() == 500);
+	CHECK(MatchesWalking(hierarchy, locals));
+}
+
+//user-018: propagation across 100k nodes, for a flat level, deep chains and a random tree. a full update, moving the
+//root of one subtree, and moving a thousand nodes scattered about
+BENCHMARK(TransformHierarchyBenchmark)
+{
+	const int count = 100000;
+	const char * names[] = { "flat", "chains", "random" };
+	for (int shape = 0; shape < 3; shape++)
+	{
+		std::vector<int> parents(count);
+		if (shape == 0)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				parents[i] = i % 100 == 0 ? TRANSFORM_HIERARCHY_NO_PARENT : i - i % 100;		//1000 groups of 100
+			}
+		}
+		else if (shape == 1)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				parents[i] = i % 10000 == 0 ? TRANSFORM_HIERARCHY_NO_PARENT : i - 1;		//10 chains 10000 long
+			}
+		}
+		else
+		{
+			MakeTestParents(count, 100, parents);
+		}
+
+		TransformHierarchy hierarchy;
+		TestTimer timer;
+		hierarchy.Build(parents);
+		const double buildSeconds = timer.GetSeconds();
+		float local[16];
+		for (int i = 0; i < count; i++)
+		{
+			MakeTestLocal(i, local);
+			hierarchy.SetLocal(i, local);
+		}
+		std::vector<int> changed;
+		changed.reserve(count);
+		timer.Restart();
+		hierarchy.Update(changed);
+		const double fullSeconds = timer.GetSeconds();
+
+		//from the middle of the list, the node under its root, so the whole group or chain moves
+		const int passes = 100;
+		int subtree = count / 2;
+		while (hierarchy.GetParent(subtree) != TRANSFORM_HIERARCHY_NO_PARENT && hierarchy.GetParent(hierarchy.GetParent(subtree)) != TRANSFORM_HIERARCHY_NO_PARENT)
+		{
+			subtree = hierarchy.GetParent(subtree);
+		}
+		size_t subtreeSize = 0;
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			changed.clear();
+			MakeTestLocal(subtree + pass, local);
+			hierarchy.SetLocal(subtree, local);
+			hierarchy.Update(changed);
+			subtreeSize = changed.size();
+		}
+		const double subtreeSeconds = timer.GetSeconds() / passes;
+
+		size_t scatteredSize = 0;
+		timer.Restart();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			changed.clear();
+			for (int i = pass; i < count; i += count / 1000)
+			{
+				MakeTestLocal(i + pass, local);
+				hierarchy.SetLocal(i, local);
+			}
+			hierarchy.Update(changed);
+			scatteredSize = changed.size();
+		}
+		const double scatteredSeconds = timer.GetSeconds() / passes;
+
+		printf("  %-6s: build %6.2f ms, full update %6.2f ms, one subtree %7.3f ms (%d nodes), 1000 scattered %6.2f ms (%d nodes)\n",
+			names[shape], buildSeconds * 1e3, fullSeconds * 1e3, subtreeSeconds * 1e3, (int)subtreeSize, scatteredSeconds * 1e3, (int)scatteredSize);
+	}
+}
@@ -1,7 +1,8 @@
 #include "ToolMain.h"
 #include "resource.h"
 #include <vector>
-#include <sstream>
+#include <string>
+#include <algorithm>
 
 //
 //ToolMain Class
@@ -9,8 +10,7 @@ ToolMain::ToolMain()
 {
 
 	m_currentChunk = 0;		//default value
-	m_sceneGraph.clear();	//clear the vector for the scenegraph
-	m_databaseConnection = NULL;
+	m_sceneGraph.Clear();	//clear the scenegraph
 
 	//zero input commands
 	m_toolInputCommands.forward		= false;
@@ -22,7 +22,11 @@ ToolMain::ToolMain()
 
 ToolMain::~ToolMain()
 {
-	sqlite3_close(m_databaseConnection);		//close the database connection
+	//a clean exit leaves nothing to recover, saved or not
+	m_autosave.Discard();
+	m_autosave.Stop();
+	m_levelCache.Close();
+	m_database.Close();		//close the database connection
 }
 
 
@@ -38,12 +42,10 @@ void ToolMain::onActionInitialise(HWND handle, int width, int height)
 	m_height	= height;
 	
 	m_d3dRenderer.Initialize(handle, m_width, m_height);
+	m_d3dRenderer.SetSceneGraph(&m_sceneGraph);		//edits made in the renderer's windows are written straight to the scenegraph
 
 	//database connection establish
-	int rc;
-	rc = sqlite3_open_v2("database/test.db",&m_databaseConnection, SQLITE_OPEN_READWRITE, NULL);
-
-	if (rc) 
+	if (!m_database.Open("database/test.db"))
 	{
 		TRACE("Can't open database");
 		//if the database cant open. Perhaps a more catastrophic error would be better here
@@ -51,6 +53,8 @@ void ToolMain::onActionInitialise(HWND handle, int width, int height)
 	else 
 	{
 		TRACE("Opened database successfully");
+		RecoverAutosave();
+		m_autosave.Start("database/test.db");
 	}
 
 	// Setup Dear ImGui context
@@ -70,220 +74,255 @@ void ToolMain::onActionInitialise(HWND handle, int width, int height)
 
 void ToolMain::onActionLoad()
 {
-	//load current chunk and objects into lists
-	if (!m_sceneGraph.empty())		//is the vector empty
+	//throw away whatever is loaded and start again from the chunks around the camera
+	m_database.EndLoadObjects();
+	const std::vector<int> residentChunks = m_chunkManager.GetResidentChunks();
+	for (size_t i = 0; i < residentChunks.size(); i++)
 	{
-		m_sceneGraph.clear();		//if not, empty it
+		m_d3dRenderer.RemoveDisplayChunk(residentChunks[i]);
 	}
 
-	//SQL
-	int rc;
-	char *sqlCommand;
-	char *ErrMSG = 0;
-	sqlite3_stmt *pResults;								//results of the query
-	sqlite3_stmt *pResultsChunk;
+	m_sceneGraph.Clear();		//everything is reloaded from the table so there are no deletes pending
+	m_autosave.Discard();
+	m_sceneGraph.SetNextID(m_database.GetMaxObjectID() + 1);		//objects in chunks not loaded keep their IDs too
 
-	//OBJECTS IN THE WORLD
-	//prepare SQL Text
-	sqlCommand = "SELECT * from Objects";				//sql command which will return all records from the objects table.
-	//Send Command and fill result object
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResults, 0 );
-	
-	//loop for each row in results until there are no more rows.  ie for every row in the results. We create and object
-	while (sqlite3_step(pResults) == SQLITE_ROW)
-	{	
-		SceneObject newSceneObject;
-		newSceneObject.ID = sqlite3_column_int(pResults, 0);
-		newSceneObject.chunk_ID = sqlite3_column_int(pResults, 1);
-		newSceneObject.model_path		= reinterpret_cast<const char*>(sqlite3_column_text(pResults, 2));
-		newSceneObject.tex_diffuse_path = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 3));
-		newSceneObject.posX = sqlite3_column_double(pResults, 4);
-		newSceneObject.posY = sqlite3_column_double(pResults, 5);
-		newSceneObject.posZ = sqlite3_column_double(pResults, 6);
-		newSceneObject.rotX = sqlite3_column_double(pResults, 7);
-		newSceneObject.rotY = sqlite3_column_double(pResults, 8);
-		newSceneObject.rotZ = sqlite3_column_double(pResults, 9);
-		newSceneObject.scaX = sqlite3_column_double(pResults, 10);
-		newSceneObject.scaY = sqlite3_column_double(pResults, 11);
-		newSceneObject.scaZ = sqlite3_column_double(pResults, 12);
-		newSceneObject.render = sqlite3_column_int(pResults, 13);
-		newSceneObject.collision = sqlite3_column_int(pResults, 14);
-		newSceneObject.collision_mesh = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 15));
-		newSceneObject.collectable = sqlite3_column_int(pResults, 16);
-		newSceneObject.destructable = sqlite3_column_int(pResults, 17);
-		newSceneObject.health_amount = sqlite3_column_int(pResults, 18);
-		newSceneObject.editor_render = sqlite3_column_int(pResults, 19);
-		newSceneObject.editor_texture_vis = sqlite3_column_int(pResults, 20);
-		newSceneObject.editor_normals_vis = sqlite3_column_int(pResults, 21);
-		newSceneObject.editor_collision_vis = sqlite3_column_int(pResults, 22);
-		newSceneObject.editor_pivot_vis = sqlite3_column_int(pResults, 23);
-		newSceneObject.pivotX = sqlite3_column_double(pResults, 24);
-		newSceneObject.pivotY = sqlite3_column_double(pResults, 25);
-		newSceneObject.pivotZ = sqlite3_column_double(pResults, 26);
-		newSceneObject.snapToGround = sqlite3_column_int(pResults, 27);
-		newSceneObject.AINode = sqlite3_column_int(pResults, 28);
-		newSceneObject.audio_path = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 29));
-		newSceneObject.volume = sqlite3_column_double(pResults, 30);
-		newSceneObject.pitch = sqlite3_column_double(pResults, 31);
-		newSceneObject.pan = sqlite3_column_int(pResults, 32);
-		newSceneObject.one_shot = sqlite3_column_int(pResults, 33);
-		newSceneObject.play_on_init = sqlite3_column_int(pResults, 34);
-		newSceneObject.play_in_editor = sqlite3_column_int(pResults, 35);
-		newSceneObject.min_dist = sqlite3_column_double(pResults, 36);
-		newSceneObject.max_dist = sqlite3_column_double(pResults, 37);
-		newSceneObject.camera = sqlite3_column_int(pResults, 38);
-		newSceneObject.path_node = sqlite3_column_int(pResults, 39);
-		newSceneObject.path_node_start = sqlite3_column_int(pResults, 40);
-		newSceneObject.path_node_end = sqlite3_column_int(pResults, 41);
-		newSceneObject.parent_id = sqlite3_column_int(pResults, 42);
-		newSceneObject.editor_wireframe = sqlite3_column_int(pResults, 43);
-		newSceneObject.name = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 44));
-
-		newSceneObject.light_type = sqlite3_column_int(pResults, 45);
-		newSceneObject.light_diffuse_r = sqlite3_column_double(pResults, 46);
-		newSceneObject.light_diffuse_g = sqlite3_column_double(pResults, 47);
-		newSceneObject.light_diffuse_b = sqlite3_column_double(pResults, 48);
-		newSceneObject.light_specular_r = sqlite3_column_double(pResults, 49);
-		newSceneObject.light_specular_g = sqlite3_column_double(pResults, 50);
-		newSceneObject.light_specular_b = sqlite3_column_double(pResults, 51);
-		newSceneObject.light_spot_cutoff = sqlite3_column_double(pResults, 52);
-		newSceneObject.light_constant = sqlite3_column_double(pResults, 53);
-		newSceneObject.light_linear = sqlite3_column_double(pResults, 54);
-		newSceneObject.light_quadratic = sqlite3_column_double(pResults, 55);
-	
+	//THE WORLD CHUNKS
+	//the rows are small, so every chunk is read up front. Their heightmaps and objects are only loaded when the camera is near
+	std::vector<ChunkObject> chunks;
+	m_database.LoadChunks(chunks);
+	m_chunkManager.SetChunks(chunks);
 
-		//send completed object to scenegraph
-		m_sceneGraph.push_back(newSceneObject);
-	}
-
-	//THE WORLD CHUNK
-	//prepare SQL Text
-	sqlCommand = "SELECT * from Chunks";				//sql command which will return all records from  chunks table. There is only one tho.
-														//Send Command and fill result object
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResultsChunk, 0);
-
-
-	sqlite3_step(pResultsChunk);
-	m_chunk.ID = sqlite3_column_int(pResultsChunk, 0);
-	m_chunk.name = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 1));
-	m_chunk.chunk_x_size_metres = sqlite3_column_int(pResultsChunk, 2);
-	m_chunk.chunk_y_size_metres = sqlite3_column_int(pResultsChunk, 3);
-	m_chunk.chunk_base_resolution = sqlite3_column_int(pResultsChunk, 4);
-	m_chunk.heightmap_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 5));
-	m_chunk.tex_diffuse_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 6));
-	m_chunk.tex_splat_alpha_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 7));
-	m_chunk.tex_splat_1_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 8));
-	m_chunk.tex_splat_2_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 9));
-	m_chunk.tex_splat_3_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 10));
-	m_chunk.tex_splat_4_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 11));
-	m_chunk.render_wireframe = sqlite3_column_int(pResultsChunk, 12);
-	m_chunk.render_normals = sqlite3_column_int(pResultsChunk, 13);
-	m_chunk.tex_diffuse_tiling = sqlite3_column_int(pResultsChunk, 14);
-	m_chunk.tex_splat_1_tiling = sqlite3_column_int(pResultsChunk, 15);
-	m_chunk.tex_splat_2_tiling = sqlite3_column_int(pResultsChunk, 16);
-	m_chunk.tex_splat_3_tiling = sqlite3_column_int(pResultsChunk, 17);
-	m_chunk.tex_splat_4_tiling = sqlite3_column_int(pResultsChunk, 18);
-
-
-	//Process REsults into renderable
-	m_d3dRenderer.BuildDisplayList(&m_sceneGraph);
-	//build the renderable chunk 
-	m_d3dRenderer.BuildDisplayChunk(&m_chunk);
+	//THE OBJECTS
+	//come from the level cache if it matches the table, otherwise from SQL while a new cache is written in the background
+	uint64_t levelCacheHash = 0;
+	if (!m_database.GetLevelCacheHash(levelCacheHash) || !m_levelCache.Open(LEVEL_CACHE_PATH, levelCacheHash))
+	{
+		m_levelCache.Close();
+		m_autosave.RebuildLevelCache(LEVEL_CACHE_PATH);
+	}
 
+	//the display objects are kept aside by ID, so the ones that stream back in are patched rather than rebuilt
+	m_d3dRenderer.DetachDisplayList();
+	UpdateChunks();
 }
 
 void ToolMain::onActionSave()
 {
-	//SQL
-	int rc;
-	char *sqlCommand;
-	char *ErrMSG = 0;
-	sqlite3_stmt *pResults;								//results of the query
-	
+	FinishLoading();	//never save a partially streamed scenegraph, the missing rows would count as unchanged
+
+	//only the objects changed since the last load or save are written, in one transaction
+	SaveStatistics stats = m_database.SaveChanges(m_sceneGraph);
+
+	if (!stats.succeeded)
+	{
+		MessageBox(NULL, L"Objects could not be saved", L"Error", MB_OK);
+		return;
+	}
+
+	TRACE("Saved %d objects, deleted %d in %.3f seconds (%.0f rows/sec)\n", stats.rowsWritten, stats.rowsDeleted, stats.seconds, stats.rowsPerSecond);
+
+	//every edit is in Objects now
+	m_autosave.Discard();
+
+	//the cache no longer matches the table. Chunks stream from SQL until the next load picks up the rebuilt one
+	m_levelCache.Close();
+	m_autosave.RebuildLevelCache(LEVEL_CACHE_PATH);
+
+	std::wstring message = L"Objects Saved: " + std::to_wstring(stats.rowsWritten) + L", Deleted: " + std::to_wstring(stats.rowsDeleted) + L" (" + std::to_wstring((int)stats.rowsPerSecond) + L" rows/sec)";
+	MessageBox(NULL, message.c_str(), L"Notification", MB_OK);
+}
+
+void ToolMain::DuplicateSelection()
+{
+	FinishLoading();	//the copies go on the end of the scenegraph, after every streamed row
+	m_d3dRenderer.DuplicateSelection();
+}
+
+void ToolMain::DeleteSelection()
+{
+	FinishLoading();
+	m_d3dRenderer.DeleteSelection();
+}
+
+void ToolMain::UpdateChunks()
+{
+	const Vector3& camera = m_d3dRenderer.GetCameraPosition();
+
+	int cameraChunk = m_chunkManager.GetChunkAt(camera.x, camera.z);
+	if (cameraChunk != -1)
+	{
+		m_currentChunk = cameraChunk;
+	}
+
+	//a chunk streams in over several frames, finish it before changing what is resident
+	if (m_database.IsLoadingObjects())
+	{
+		return;
+	}
+
+	std::vector<int> farChunks;
+	m_chunkManager.GetChunksToUnload(camera.x, camera.z, farChunks);
+	for (size_t i = 0; i < farChunks.size(); i++)
+	{
+		UnloadChunk(farChunks[i]);
+	}
+
+	int nextChunk = m_chunkManager.NextChunkToLoad(camera.x, camera.z);
+	if (nextChunk != -1)
+	{
+		LoadChunk(nextChunk);
+	}
+	else
+	{
+		m_d3dRenderer.ReleaseDetachedObjects();		//everything near the camera is back, anything not reloaded has gone
+	}
+}
+
+void ToolMain::LoadChunk(int chunkID)
+{
+	ChunkObject * chunk = m_chunkManager.GetChunk(chunkID);
+	if (chunk == NULL)
+	{
+		return;
+	}
+	m_chunkManager.SetResident(chunkID, true);
+
+	//build the renderable chunk 
+	m_d3dRenderer.BuildDisplayChunk(chunk);
+
+	//OBJECTS IN THE CHUNK
+	//from the cache they are already in memory, so the whole chunk goes in at once
+	if (m_levelCache.IsOpen())
+	{
+		const int firstNewObject = m_sceneGraph.GetCount();
+		m_sceneGraph.Reserve(firstNewObject + m_levelCache.CountObjects(chunkID));
+		if (m_levelCache.LoadObjects(chunkID, m_sceneGraph) > 0)
+		{
+			m_d3dRenderer.AppendDisplayList(&m_sceneGraph, firstNewObject);
+			m_d3dRenderer.FinishDisplayList();
+		}
+		return;
+	}
+
+	//size the scenegraph for the chunk up front, then stream the rows in batches from Tick so the first objects show up straight away
+	m_sceneGraph.Reserve(m_sceneGraph.GetCount() + m_database.CountObjects(chunkID));
+	m_database.BeginLoadObjects(chunkID);
+	StreamObjects(OBJECT_LOAD_BATCH_SIZE);
+}
+
+void ToolMain::UnloadChunk(int chunkID)
+{
+	//unsaved edits would be lost, so a chunk with any stays resident until it has been saved.
+	//that includes deletes, or the rows still in the table would bring the deleted objects back when it reloads
+	if (m_sceneGraph.HasDeletedObjects(chunkID))
+	{
+		return;
+	}
+	const int * chunkIDs = m_sceneGraph.GetChunkIDs();
+	const unsigned int * flags = m_sceneGraph.GetFlags();
+	for (int i = 0; i < m_sceneGraph.GetCount(); i++)
+	{
+		if (chunkIDs[i] == chunkID && (flags[i] & (SCENE_OBJECT_DIRTY | SCENE_OBJECT_INSERTED)))
+		{
+			return;
+		}
+	}
+
+	m_sceneGraph.RemoveChunk(chunkID);
+
+	m_d3dRenderer.RemoveDisplayChunk(chunkID);
+	m_d3dRenderer.SyncDisplayList(&m_sceneGraph);
+	m_chunkManager.SetResident(chunkID, false);
+}
+
+void ToolMain::StreamObjects(int maxRows)
+{
+	int firstNewObject = m_sceneGraph.GetCount();
+	int rowsRead = m_database.LoadObjectBatch(m_sceneGraph, maxRows);
+	if (rowsRead > 0)
+	{
+		m_d3dRenderer.AppendDisplayList(&m_sceneGraph, firstNewObject);		//only the new objects, the rest are already displayed
+	}
+
+	if (!m_database.IsLoadingObjects())
+	{
+		m_d3dRenderer.FinishDisplayList();
+
+		const AssetCache<DirectX::Model>& models = m_d3dRenderer.GetModelCache();
+		const AssetCache<ID3D11ShaderResourceView>& textures = m_d3dRenderer.GetTextureCache();
+		TRACE("Asset cache: models %d hits %d misses %u bytes, textures %d hits %d misses %u bytes\n",
+			models.GetHits(), models.GetMisses(), (unsigned)models.GetResidentBytes(),
+			textures.GetHits(), textures.GetMisses(), (unsigned)textures.GetResidentBytes());
+	}
+}
 
-	//OBJECTS IN THE WORLD Delete them all
-	//prepare SQL Text
-	sqlCommand = "DELETE FROM Objects";	 //will delete the whole object table.   Slightly risky but hey.
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResults, 0);
-	sqlite3_step(pResults);
-
-	//Populate with our new objects
-	std::wstring sqlCommand2;
-	int numObjects = m_sceneGraph.size();	//Loop thru the scengraph.
-
-	for (int i = 0; i < numObjects; i++)
-	{
-		std::stringstream command;
-		command << "INSERT INTO Objects " 
-			<<"VALUES(" << m_sceneGraph.at(i).ID << ","
-			<< m_sceneGraph.at(i).chunk_ID  << ","
-			<< "'" << m_sceneGraph.at(i).model_path <<"'" << ","
-			<< "'" << m_sceneGraph.at(i).tex_diffuse_path << "'" << ","
-			<< m_sceneGraph.at(i).posX << ","
-			<< m_sceneGraph.at(i).posY << ","
-			<< m_sceneGraph.at(i).posZ << ","
-			<< m_sceneGraph.at(i).rotX << ","
-			<< m_sceneGraph.at(i).rotY << ","
-			<< m_sceneGraph.at(i).rotZ << ","
-			<< m_sceneGraph.at(i).scaX << ","
-			<< m_sceneGraph.at(i).scaY << ","
-			<< m_sceneGraph.at(i).scaZ << ","
-			<< m_sceneGraph.at(i).render << ","
-			<< m_sceneGraph.at(i).collision << ","
-			<< "'" << m_sceneGraph.at(i).collision_mesh << "'" << ","
-			<< m_sceneGraph.at(i).collectable << ","
-			<< m_sceneGraph.at(i).destructable << ","
-			<< m_sceneGraph.at(i).health_amount << ","
-			<< m_sceneGraph.at(i).editor_render << ","
-			<< m_sceneGraph.at(i).editor_texture_vis << ","
-			<< m_sceneGraph.at(i).editor_normals_vis << ","
-			<< m_sceneGraph.at(i).editor_collision_vis << ","
-			<< m_sceneGraph.at(i).editor_pivot_vis << ","
-			<< m_sceneGraph.at(i).pivotX << ","
-			<< m_sceneGraph.at(i).pivotY << ","
-			<< m_sceneGraph.at(i).pivotZ << ","
-			<< m_sceneGraph.at(i).snapToGround << ","
-			<< m_sceneGraph.at(i).AINode << ","
-			<< "'" << m_sceneGraph.at(i).audio_path << "'" << ","
-			<< m_sceneGraph.at(i).volume << ","
-			<< m_sceneGraph.at(i).pitch << ","
-			<< m_sceneGraph.at(i).pan << ","
-			<< m_sceneGraph.at(i).one_shot << ","
-			<< m_sceneGraph.at(i).play_on_init << ","
-			<< m_sceneGraph.at(i).play_in_editor << ","
-			<< m_sceneGraph.at(i).min_dist << ","
-			<< m_sceneGraph.at(i).max_dist << ","
-			<< m_sceneGraph.at(i).camera << ","
-			<< m_sceneGraph.at(i).path_node << ","
-			<< m_sceneGraph.at(i).path_node_start << ","
-			<< m_sceneGraph.at(i).path_node_end << ","
-			<< m_sceneGraph.at(i).parent_id << ","
-			<< m_sceneGraph.at(i).editor_wireframe << ","
-			<< "'" << m_sceneGraph.at(i).name << "'" << ","
-
-			<< m_sceneGraph.at(i).light_type << ","
-			<< m_sceneGraph.at(i).light_diffuse_r << ","
-			<< m_sceneGraph.at(i).light_diffuse_g << ","
-			<< m_sceneGraph.at(i).light_diffuse_b << ","
-			<< m_sceneGraph.at(i).light_specular_r << ","
-			<< m_sceneGraph.at(i).light_specular_g << ","
-			<< m_sceneGraph.at(i).light_specular_b << ","
-			<< m_sceneGraph.at(i).light_spot_cutoff << ","
-			<< m_sceneGraph.at(i).light_constant << ","
-			<< m_sceneGraph.at(i).light_linear << ","
-			<< m_sceneGraph.at(i).light_quadratic
-
-			<< ")";
-		std::string sqlCommand2 = command.str();
-		rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand2.c_str(), -1, &pResults, 0);
-		sqlite3_step(pResults);	
-	}
-	MessageBox(NULL, L"Objects Saved", L"Notification", MB_OK);
+void ToolMain::FinishLoading()
+{
+	while (m_database.IsLoadingObjects())
+	{
+		StreamObjects(OBJECT_LOAD_BATCH_SIZE);
+	}
+}
+
+void ToolMain::AutosaveChanges()
+{
+	//only the copy happens here, a flag test per object and a row per change. The worker does the writing.
+	//every row is copied whole in this frame, so any batch of them is consistent on its own
+	const unsigned int * flags = m_sceneGraph.GetFlags();
+	int changedCount = 0;
+	for (int i = 0; i < m_sceneGraph.GetCount(); i++)
+	{
+		changedCount += (flags[i] & SCENE_OBJECT_AUTOSAVE) != 0;
+	}
+	const bool complete = changedCount <= AUTOSAVE_MAX_ROWS;
+	changedCount = std::min(changedCount, AUTOSAVE_MAX_ROWS);
+
+	std::vector<SceneObject> changedObjects(changedCount);
+	int changed = 0;
+	for (int i = 0; changed < changedCount; i++)
+	{
+		if (flags[i] & SCENE_OBJECT_AUTOSAVE)
+		{
+			m_sceneGraph.Get(i, changedObjects[changed++]);
+			m_sceneGraph.SetFlag(i, SCENE_OBJECT_AUTOSAVE, false);
+		}
+	}
+	std::vector<int> deletedObjectIDs;
+	m_sceneGraph.TakeAutosaveDeletedIDs(deletedObjectIDs);
+	m_autosave.Submit(changedObjects, deletedObjectIDs, complete);
+}
+
+void ToolMain::RecoverAutosave()
+{
+	if (!m_database.HasAutosave())
+	{
+		return;
+	}
+
+	//the last session ended without saving or closing, its autosaved edits can be written into the level before it loads
+	if (MessageBox(NULL, L"The editor did not close cleanly last time. Recover the unsaved changes?", L"Recover", MB_YESNO | MB_ICONQUESTION) == IDYES)
+	{
+		SaveStatistics stats = m_database.RecoverAutosave();
+		if (!stats.succeeded)
+		{
+			MessageBox(NULL, L"Changes could not be recovered", L"Error", MB_OK);
+			return;
+		}
+		TRACE("Recovered %d objects, deleted %d\n", stats.rowsWritten, stats.rowsDeleted);
+	}
+	else
+	{
+		m_database.ClearAutosave();
+	}
 }
 
 void ToolMain::onActionSaveTerrain()
 {
-	m_d3dRenderer.SaveDisplayChunk(&m_chunk);
+	const std::vector<int>& residentChunks = m_chunkManager.GetResidentChunks();
+	for (size_t i = 0; i < residentChunks.size(); i++)
+	{
+		m_d3dRenderer.SaveDisplayChunk(m_chunkManager.GetChunk(residentChunks[i]));
+	}
 }
 
 void ToolMain::Tick(MSG *msg)
@@ -296,8 +335,33 @@ void ToolMain::Tick(MSG *msg)
 		//add to scenegraph
 		//resend scenegraph to Direct X renderer
 
+	//carry on streaming the level in if a load is in progress, then load / unload chunks as the camera moves
+	if (m_database.IsLoadingObjects())
+	{
+		StreamObjects(OBJECT_LOAD_BATCH_SIZE);
+	}
+	UpdateChunks();
+
+	if (m_autosave.IsDue())
+	{
+		AutosaveChanges();
+	}
+
+	if (m_toolInputCommands.duplicateSelection)
+	{
+		DuplicateSelection();
+	}
+	if (m_toolInputCommands.deleteSelection)
+	{
+		DeleteSelection();
+	}
+
 	//Renderer Update Call
 	m_d3dRenderer.Tick(&m_toolInputCommands);
+	m_toolInputCommands.undo = false;
+	m_toolInputCommands.redo = false;
+	m_toolInputCommands.deleteSelection = false;
+	m_toolInputCommands.duplicateSelection = false;
 }
 
 void ToolMain::UpdateInput(MSG * msg)
@@ -310,6 +374,27 @@ void ToolMain::UpdateInput(MSG * msg)
 		//Global inputs,  mouse position and keys etc
 	case WM_KEYDOWN:
 		m_keyArray[msg->wParam] = true;
+		//shortcuts fire on the key press, and again as the key repeats.
+		//not while an ImGui field has the keyboard, where Delete and Ctrl+Z edit the text
+		if (!ImGui::GetIO().WantCaptureKeyboard)
+		{
+			if (m_keyArray[VK_CONTROL] && msg->wParam == 'Z')
+			{
+				m_toolInputCommands.undo = true;
+			}
+			if (m_keyArray[VK_CONTROL] && msg->wParam == 'Y')
+			{
+				m_toolInputCommands.redo = true;
+			}
+			if (msg->wParam == VK_DELETE)
+			{
+				m_toolInputCommands.deleteSelection = true;
+			}
+			if (m_keyArray[VK_CONTROL] && msg->wParam == 'D')
+			{
+				m_toolInputCommands.duplicateSelection = true;
+			}
+		}
 		break;
 
 	case WM_KEYUP:
@@ -353,7 +438,7 @@ void ToolMain::UpdateInput(MSG * msg)
 	}
 	else m_toolInputCommands.left = false;
 
-	if (m_keyArray['D'])
+	if (m_keyArray['D'] && !m_keyArray[VK_CONTROL])
 	{
 		m_toolInputCommands.right = true;
 	}
@@ -364,7 +449,7 @@ void ToolMain::UpdateInput(MSG * msg)
 		m_toolInputCommands.rotRight = true;
 	}
 	else m_toolInputCommands.rotRight = false;
-	if (m_keyArray['Z'])
+	if (m_keyArray['Z'] && !m_keyArray[VK_CONTROL])
 	{
 		m_toolInputCommands.rotLeft = true;
 	}
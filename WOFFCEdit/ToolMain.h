@@ -4,13 +4,22 @@
 #include "pch.h"
 #include "Game.h"
 #include "sqlite3.h"
+#include "SceneDatabase.h"
+#include "Autosave.h"
+#include "LevelCache.h"
+#include "ChunkManager.h"
 #include "SceneObject.h"
+#include "SceneStore.h"
 #include "InputCommands.h"
 #include "vendor/imgui/imgui.h"
 #include "vendor/imgui/backends/imgui_impl_win32.h"
 #include "vendor/imgui/backends/imgui_impl_dx11.h"
 #include <vector>
 
+//number of object rows read from the database per frame while a level streams in
+#define OBJECT_LOAD_BATCH_SIZE 512
+//the binary snapshot of the Objects table, see LevelCache
+#define LEVEL_CACHE_PATH "database/test.db.cache"
 
 class ToolMain
 {
@@ -22,19 +31,28 @@ public: //methods
 	const std::vector<int>& getCurrentSelectionIDs();										//returns the selection number of currently selected object so that It can be displayed.
 	void	onActionInitialise(HWND handle, int width, int height);			//Passes through handle and hieght and width and initialises DirectX renderer and SQL LITE
 	void	onActionFocusCamera();
-	void	onActionLoad();													//load the current chunk
-	afx_msg	void	onActionSave();											//save the current chunk
-	afx_msg void	onActionSaveTerrain();									//save chunk geometry
+	void	onActionLoad();													//load the chunks around the camera
+	afx_msg	void	onActionSave();											//save changes to the loaded chunks
+	afx_msg void	onActionSaveTerrain();									//save geometry of the loaded chunks
 
 	void	Tick(MSG *msg);
 	void	UpdateInput(MSG *msg);
 
 public:	//variables
-	std::vector<SceneObject>    m_sceneGraph;	//our scenegraph storing all the objects in the current chunk
-	ChunkObject					m_chunk;		//our landscape chunk
+	SceneStore					m_sceneGraph;	//our scenegraph storing all the objects in the loaded chunks
+	ChunkManager				m_chunkManager;	//every chunk in the world, and which of them are loaded
 
 private:	//methods
 	void	onContentAdded();
+	void	UpdateChunks();						//loads chunks the camera has come near and unloads the ones it has left
+	void	LoadChunk(int chunkID);				//builds the terrain and starts streaming the objects WHERE chunk_ID = chunkID
+	void	UnloadChunk(int chunkID);
+	void	StreamObjects(int maxRows);			//reads the next batch of object rows and hands them to the renderer
+	void	FinishLoading();					//streams whatever is left of the current load
+	void	AutosaveChanges();					//hands the objects changed since the last autosave to the autosave thread
+	void	RecoverAutosave();					//offers to bring back the edits a crashed session never saved
+	void	DuplicateSelection();				//once every streamed row is in, so the renderer's copies go after them
+	void	DeleteSelection();
 
 
 		
@@ -44,11 +62,13 @@ private:	//variables
 	InputCommands m_toolInputCommands;		//input commands that we want to use and possibly pass over to the renderer
 	CRect	WindowRECT;		//Window area rectangle. 
 	char	m_keyArray[256];
-	sqlite3 *m_databaseConnection;	//sqldatabase handle
+	SceneDatabase m_database;	//sqldatabase connection and prepared statements
+	LevelCache	m_levelCache;	//chunks are loaded from here instead of the database while it is open
+	Autosave	m_autosave;					//writes unsaved edits to the recovery tables in the background
 
 	int m_width;		//dimensions passed to directX
 	int m_height;
-	int m_currentChunk;			//the current chunk of thedatabase that we are operating on.  Dictates loading and saving. 
+	int m_currentChunk;			//the chunk the camera is in
 	
 
 	
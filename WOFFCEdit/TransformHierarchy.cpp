@@ -0,0 +1,291 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TRANSFORM_HIERARCHY_SSE
+#endif
+
+
+static const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+void TransformHierarchy::Build(const std::vector<int> & parents)
+{
+	Clear();
+	Append(parents);
+}
+
+void TransformHierarchy::Append(const std::vector<int> & parents)
+{
+	//the new nodes only link to each other, so they sort into a run of their own after the existing ones, and
+	//nothing already in the hierarchy moves or needs recomputing
+	const int first = GetCount();
+	const int count = first + (int)parents.size();
+	if (count == first)
+	{
+		return;
+	}
+
+	m_parent.resize(count);
+	for (int i = first; i < count; i++)
+	{
+		const int parent = parents[i - first];
+		m_parent[i] = parent >= first && parent < count && parent != i ? parent : TRANSFORM_HIERARCHY_NO_PARENT;
+	}
+
+	//walk up from each node. meeting a node already on this walk means a loop, and the node met becomes a root
+	std::vector<unsigned char> state(count - first, 0);		//0 not seen, 1 on the current walk, 2 done
+	std::vector<int> walk;
+	for (int i = first; i < count; i++)
+	{
+		int node = i;
+		while (node != TRANSFORM_HIERARCHY_NO_PARENT && state[node - first] == 0)
+		{
+			state[node - first] = 1;
+			walk.push_back(node);
+			node = m_parent[node];
+		}
+		if (node != TRANSFORM_HIERARCHY_NO_PARENT && state[node - first] == 1)
+		{
+			m_parent[node] = TRANSFORM_HIERARCHY_NO_PARENT;
+		}
+		for (size_t j = 0; j < walk.size(); j++)
+		{
+			state[walk[j] - first] = 2;
+		}
+		walk.clear();
+	}
+
+	//child lists, built backwards so siblings end up in index order
+	m_firstChild.resize(count, TRANSFORM_HIERARCHY_NO_PARENT);
+	m_nextSibling.resize(count, TRANSFORM_HIERARCHY_NO_PARENT);
+	for (int i = count - 1; i >= first; i--)
+	{
+		const int parent = m_parent[i];
+		if (parent == TRANSFORM_HIERARCHY_NO_PARENT)
+		{
+			continue;
+		}
+		m_nextSibling[i] = m_firstChild[parent];
+		m_firstChild[parent] = i;
+	}
+	const size_t firstRoot = m_roots.size();
+	for (int i = first; i < count; i++)
+	{
+		if (m_parent[i] == TRANSFORM_HIERARCHY_NO_PARENT)
+		{
+			m_roots.push_back(i);
+		}
+	}
+
+	//depth first, without recursion as chains can be as long as the list
+	m_sortedIndex.resize(count, 0);
+	std::vector<int> stack;
+	for (int root = (int)m_roots.size() - 1; root >= (int)firstRoot; root--)
+	{
+		stack.push_back(m_roots[root]);
+	}
+	std::vector<int> children;
+	while (!stack.empty())
+	{
+		const int node = stack.back();
+		stack.pop_back();
+		m_sortedIndex[node] = (int)m_order.size();
+		m_order.push_back(node);
+
+		children.clear();
+		for (int child = m_firstChild[node]; child != TRANSFORM_HIERARCHY_NO_PARENT; child = m_nextSibling[child])
+		{
+			children.push_back(child);
+		}
+		stack.insert(stack.end(), children.rbegin(), children.rend());
+	}
+
+	//subtree sizes, children before parents
+	m_sortedParent.resize(count);
+	m_subtreeEnd.resize(count, 1);
+	for (int i = first; i < count; i++)
+	{
+		const int parent = m_parent[m_order[i]];
+		m_sortedParent[i] = parent == TRANSFORM_HIERARCHY_NO_PARENT ? TRANSFORM_HIERARCHY_NO_PARENT : m_sortedIndex[parent];
+	}
+	for (int i = count - 1; i >= first; i--)
+	{
+		if (m_sortedParent[i] != TRANSFORM_HIERARCHY_NO_PARENT)
+		{
+			m_subtreeEnd[m_sortedParent[i]] += m_subtreeEnd[i];
+		}
+	}
+	for (int i = first; i < count; i++)
+	{
+		m_subtreeEnd[i] += i;
+	}
+
+	//grown by doubling, so appending in batches copies each matrix a bounded number of times
+	if ((size_t)count * 16 > m_local.size())
+	{
+		Reserve(std::max(count, (int)(m_local.size() / 16) * 2));
+	}
+	for (int i = first; i < count; i++)
+	{
+		std::memcpy(&m_local[(size_t)i * 16], identity, sizeof(identity));
+	}
+	for (size_t i = firstRoot; i < m_roots.size(); i++)
+	{
+		m_dirty.push_back(m_sortedIndex[m_roots[i]]);
+	}
+}
+
+void TransformHierarchy::Reserve(int count)
+{
+	if ((size_t)count * 16 <= m_local.size())
+	{
+		return;
+	}
+
+	m_parent.reserve(count);
+	m_firstChild.reserve(count);
+	m_nextSibling.reserve(count);
+	m_sortedIndex.reserve(count);
+	m_order.reserve(count);
+	m_sortedParent.reserve(count);
+	m_subtreeEnd.reserve(count);
+	m_local.Resize((size_t)count * 16);
+	m_world.Resize((size_t)count * 16);
+}
+
+void TransformHierarchy::Clear()
+{
+	m_parent.clear();
+	m_firstChild.clear();
+	m_nextSibling.clear();
+	m_sortedIndex.clear();
+	m_roots.clear();
+	m_order.clear();
+	m_sortedParent.clear();
+	m_subtreeEnd.clear();
+	m_local.Free();
+	m_world.Free();
+	m_dirty.clear();
+}
+
+int TransformHierarchy::GetCount() const
+{
+	return (int)m_parent.size();
+}
+
+void TransformHierarchy::SetLocal(int node, const float local[16])
+{
+	const int sorted = m_sortedIndex[node];
+	std::memcpy(&m_local[(size_t)sorted * 16], local, sizeof(float) * 16);
+	m_dirty.push_back(sorted);
+}
+
+void TransformHierarchy::Update(std::vector<int> & changed)
+{
+	if (m_dirty.empty())
+	{
+		return;
+	}
+
+	//in sorted order, a dirty node inside a range already recomputed is skipped
+	std::sort(m_dirty.begin(), m_dirty.end());
+	int done = 0;
+	for (size_t i = 0; i < m_dirty.size(); i++)
+	{
+		const int first = m_dirty[i];
+		if (first < done)
+		{
+			continue;
+		}
+		const int last = m_subtreeEnd[first];
+
+		//parents come first, so each one's world is ready by the time its children need it
+		for (int sorted = first; sorted < last; sorted++)
+		{
+			const float * local = &m_local[(size_t)sorted * 16];
+			float * world = &m_world[(size_t)sorted * 16];
+			const int parent = m_sortedParent[sorted];
+			if (parent == TRANSFORM_HIERARCHY_NO_PARENT)
+			{
+				std::memcpy(world, local, sizeof(float) * 16);
+			}
+			else
+			{
+				Multiply(local, &m_world[(size_t)parent * 16], world);
+			}
+			changed.push_back(m_order[sorted]);
+		}
+		done = last;
+	}
+	m_dirty.clear();
+}
+
+bool TransformHierarchy::IsDirty() const
+{
+	return !m_dirty.empty();
+}
+
+const float * TransformHierarchy::GetWorld(int node) const
+{
+	return &m_world[(size_t)m_sortedIndex[node] * 16];
+}
+
+int TransformHierarchy::GetParent(int node) const
+{
+	return m_parent[node];
+}
+
+int TransformHierarchy::GetFirstChild(int node) const
+{
+	return m_firstChild[node];
+}
+
+int TransformHierarchy::GetNextSibling(int node) const
+{
+	return m_nextSibling[node];
+}
+
+const std::vector<int> & TransformHierarchy::GetRoots() const
+{
+	return m_roots;
+}
+
+void TransformHierarchy::Multiply(const float a[16], const float b[16], float result[16])
+{
+#ifdef TRANSFORM_HIERARCHY_SSE
+	//each row of the result is the rows of b weighted by that row of a
+	const __m128 row0 = _mm_loadu_ps(b);
+	const __m128 row1 = _mm_loadu_ps(b + 4);
+	const __m128 row2 = _mm_loadu_ps(b + 8);
+	const __m128 row3 = _mm_loadu_ps(b + 12);
+	for (int row = 0; row < 4; row++)
+	{
+		const float * weights = a + row * 4;
+		__m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), row0);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[1]), row1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[2]), row2));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[3]), row3));
+		_mm_storeu_ps(result + row * 4, sum);
+	}
+#else
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			result[row * 4 + column] = a[row * 4 + 0] * b[column] + a[row * 4 + 1] * b[4 + column]
+				+ a[row * 4 + 2] * b[8 + column] + a[row * 4 + 3] * b[12 + column];
+		}
+	}
+#endif
+}
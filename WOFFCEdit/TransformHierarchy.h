@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "AlignedArray.h"
+
+#define TRANSFORM_HIERARCHY_NO_PARENT -1
+
+//Parent / child world matrices for a list of nodes, each with a local matrix relative to its parent.
+//Nodes are kept sorted depth first, so every parent comes before its children and each subtree is one contiguous
+//range. Propagation is then a single forward walk over packed matrices, and moving a node only recomputes its range.
+//Matrices are 4x4 row major for row vectors, as DirectXMath has them, so world = local * parent world.
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+	~TransformHierarchy();
+
+	//parents[i] is the index of node i's parent, or TRANSFORM_HIERARCHY_NO_PARENT. anything out of range is a root,
+	//and a loop of parents is broken by making one of its nodes a root. every local matrix starts as identity
+	void	Build(const std::vector<int> & parents);
+	//adds parents.size() nodes after the existing ones. their parents are indexed as in Build, but only another new
+	//node counts, anything else makes the new node a root. only the new nodes are left to recompute
+	void	Append(const std::vector<int> & parents);
+	void	Reserve(int count);		//room for this many nodes, so Append does not copy them all each time
+	void	Clear();
+	int		GetCount() const;
+
+	void	SetLocal(int node, const float local[16]);		//the node and everything under it are recomputed by the next Update
+	void	Update(std::vector<int> & changed);				//appends every node whose world matrix was recomputed, parents first
+	bool	IsDirty() const;
+	const float *	GetWorld(int node) const;
+
+	int		GetParent(int node) const;				//after loops are broken
+	int		GetFirstChild(int node) const;			//children in index order, TRANSFORM_HIERARCHY_NO_PARENT if none
+	int		GetNextSibling(int node) const;
+	const std::vector<int> &	GetRoots() const;	//in index order
+
+	static void	Multiply(const float a[16], const float b[16], float result[16]);		//a * b, result may not alias either
+
+private:
+	//per node, in index order
+	std::vector<int>	m_parent;
+	std::vector<int>	m_firstChild;
+	std::vector<int>	m_nextSibling;
+	std::vector<int>	m_sortedIndex;		//node to sorted position
+	std::vector<int>	m_roots;
+
+	//per sorted position
+	std::vector<int>	m_order;			//sorted position to node
+	std::vector<int>	m_sortedParent;		//sorted position of the parent, TRANSFORM_HIERARCHY_NO_PARENT for roots
+	std::vector<int>	m_subtreeEnd;		//one past the last sorted position under this one
+	AlignedArray<float>	m_local;			//16 floats each
+	AlignedArray<float>	m_world;
+
+	std::vector<int>	m_dirty;			//sorted positions whose subtrees need recomputing, unsorted, may overlap
+};